@@ -0,0 +1,944 @@
+#include "AssetManager.h"
+#include "DdsFile.h"
+#include "TextureStreaming.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_FAILURE_USERMSG
+#include "vendor/stb_image.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string_view>
+
+using namespace TinyEngine;
+using namespace DirectX;
+using namespace std::chrono;
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+struct AssetManager::DecodedMesh
+{
+	unsigned int index = 0;
+	bool loaded = false;
+
+	// A cooked mesh is uploaded straight from the mapped file, otherwise from the imported model.
+	bool cooked = false;
+	MeshFile meshFile;
+	ObjModel model;
+};
+
+namespace
+{
+	float SecondsSince(high_resolution_clock::time_point start)
+	{
+		return duration_cast<duration<float>>(high_resolution_clock::now() - start).count();
+	}
+
+	// Change when decoding or importing changes, so entries cached by older builds are no longer found.
+	const uint32_t TEXTURE_CACHE_VERSION = 1;
+	const uint32_t MESH_CACHE_VERSION = 1;
+
+	template<typename T>
+	void HashValue(uint64_t& hash, const T& value)
+	{
+		hash = HashBytes(&value, sizeof(value), hash);
+	}
+
+	// Key of a decoded texture, its image's contents and everything which affects its mips.
+	bool GetTextureKey(const string& path, const MipSettings& settings, uint64_t& key)
+	{
+		uint64_t hash = 0;
+		HashValue(hash, TEXTURE_CACHE_VERSION);
+		HashValue(hash, settings.filter);
+		HashValue(hash, settings.srgb);
+		HashValue(hash, settings.kaiserWidth);
+		HashValue(hash, settings.kaiserAlpha);
+		HashValue(hash, settings.maxLevels);
+
+		return HashFile(path.c_str(), key, hash);
+	}
+
+	// Key of an imported mesh, the .obj's contents, the contents of every .mtl it uses and its import settings.
+	bool GetMeshKey(const string& path, const MeshImportSettings& settings, uint64_t& key)
+	{
+		uint64_t hash = 0;
+		HashValue(hash, MESH_CACHE_VERSION);
+		HashValue(hash, MeshFileHeader::VERSION);
+		HashValue(hash, settings.weldVertices);
+		HashValue(hash, settings.weldEpsilon);
+		HashValue(hash, settings.lodCount);
+		HashValue(hash, settings.lodReduction);
+		HashValue(hash, settings.lodMaxError);
+		HashValue(hash, settings.optimizeVertexCache);
+		HashValue(hash, settings.optimizeOverdraw);
+		HashValue(hash, settings.overdrawThreshold);
+		HashValue(hash, settings.optimizeVertexFetch);
+		HashValue(hash, settings.buildMeshlets);
+		HashValue(hash, settings.meshletMaxVertices);
+		HashValue(hash, settings.meshletMaxTriangles);
+		HashValue(hash, settings.packVertices);
+		// occluder is left out, it only changes what is kept after uploading.
+
+		MappedFile file;
+		if (!file.Open(path.c_str()))
+		{
+			return false;
+		}
+
+		std::string_view text(file.GetData(), file.GetSize());
+		hash = HashBytes(text.data(), text.size(), hash);
+
+		// Material libraries are found the same way ObjParser finds them, relative to the .obj.
+		std::filesystem::path directory(path);
+		directory.remove_filename();
+
+		const std::string_view MTLLIB = "mtllib";
+		for (size_t found = text.find(MTLLIB); found != std::string_view::npos; found = text.find(MTLLIB, found + MTLLIB.size()))
+		{
+			if (found > 0 && text[found - 1] != '\n')
+			{
+				continue;
+			}
+
+			size_t start = text.find_first_not_of(" \t", found + MTLLIB.size());
+			size_t end = text.find_first_of("\r\n", found);
+			if (start == std::string_view::npos || start >= end)
+			{
+				continue;
+			}
+
+			string library(text.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start));
+			library.erase(library.find_last_not_of(" \t") + 1);
+
+			// A missing library still changes the key, by its name.
+			auto libraryPath = (directory / library).string();
+			if (!HashFile(libraryPath.c_str(), hash, hash))
+			{
+				hash = HashBytes(library.data(), library.size(), hash);
+			}
+		}
+
+		key = hash;
+		return true;
+	}
+}
+
+AssetManager::AssetManager(Renderer* renderer, ThreadPool* threadPool, DerivedDataCache* cache) :
+	_renderer(renderer), _threadPool(threadPool), _cache(cache), _decoding(0), _decodeSeconds(0.0f),
+	_streamReads(0), _residency(DEFAULT_STREAMING_BUDGET), _streamingBudget(DEFAULT_STREAMING_BUDGET), _uploadSeconds(0.0f), _busy(false), _loadSeconds(0.0f)
+{
+	_nullTexture = new Texture(renderer);
+
+	// Mid grey, so surfaces still shade while their textures load.
+	const unsigned char grey[4] = { 128, 128, 128, 0 };
+	_placeholderTexture = new Texture(renderer, grey, 1, 1);
+}
+
+AssetManager::~AssetManager()
+{
+	// Workers refer to this, so wait for them before anything goes.
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_decoded.wait(lock, [this]() { return _decoding == 0 && _streamReads == 0; });
+	}
+
+	for (auto& entry : _meshes)
+	{
+		delete entry.asset.mesh;
+
+		for (auto* material : entry.asset.materials)
+		{
+			delete material;
+		}
+	}
+
+	for (auto& entry : _textures)
+	{
+		delete entry.texture;
+	}
+
+	delete _placeholderTexture;
+	_placeholderTexture = nullptr;
+
+	delete _nullTexture;
+	_nullTexture = nullptr;
+}
+
+TextureHandle AssetManager::LoadTexture(const char* path, const MipSettings& settings)
+{
+	TextureHandle handle;
+
+	auto existing = _texturesByPath.find(path);
+	if (existing != _texturesByPath.end())
+	{
+		handle.index = existing->second;
+		return handle;
+	}
+
+	handle.index = static_cast<unsigned int>(_textures.size());
+
+	auto* texture = new Texture(_renderer);
+	texture->SetPlaceholder(*_placeholderTexture);
+
+	_textures.push_back({ path, settings, texture, AssetState::LOADING, "", 0, 0, false, 0 });
+	_texturesByPath.emplace(path, handle.index);
+
+	BeginLoad();
+
+	string pathCopy(path);
+	bool stream = _streamingBudget > 0;
+	_threadPool->Enqueue([this, handle, pathCopy, settings, stream]() { DecodeTexture(handle.index, pathCopy, settings, stream); });
+
+	return handle;
+}
+
+MeshHandle AssetManager::LoadMesh(const char* path, const MeshImportSettings& settings)
+{
+	MeshHandle handle;
+
+	auto existing = _meshesByPath.find(path);
+	if (existing != _meshesByPath.end())
+	{
+		handle.index = existing->second;
+		return handle;
+	}
+
+	handle.index = static_cast<unsigned int>(_meshes.size());
+
+	_meshes.push_back({ path, settings, MeshAsset(), AssetState::LOADING });
+	_meshesByPath.emplace(path, handle.index);
+
+	BeginLoad();
+
+	string pathCopy(path);
+	_threadPool->Enqueue([this, handle, pathCopy, settings]() { DecodeMesh(handle.index, pathCopy, settings); });
+
+	return handle;
+}
+
+MeshHandle AssetManager::CreateMesh(const char* name, const MeshData& meshData, const vector<Material>& materials, bool occluder)
+{
+	MeshHandle handle;
+
+	auto existing = _meshesByPath.find(name);
+	if (existing != _meshesByPath.end())
+	{
+		handle.index = existing->second;
+		return handle;
+	}
+
+	handle.index = static_cast<unsigned int>(_meshes.size());
+
+	MeshImportSettings settings;
+	settings.occluder = occluder;
+
+	_meshes.push_back({ name, settings, MeshAsset(), AssetState::RESIDENT });
+	_meshesByPath.emplace(name, handle.index);
+
+	auto& entry = _meshes.back();
+	entry.asset.mesh = new Mesh(_renderer);
+	entry.asset.mesh->SetOccluder(occluder);
+
+	UploadMeshData(entry.asset.mesh, meshData);
+
+	Material defaultMaterial;
+
+	for (const auto& part : meshData.parts)
+	{
+		const auto& source = part.material >= 0 && part.material < static_cast<int>(materials.size()) ? materials[part.material] : defaultMaterial;
+
+		auto* mat = new Material(source);
+		mat->ambientTexture = mat->ambientTexture ? mat->ambientTexture : _nullTexture;
+		mat->diffuseTexture = mat->diffuseTexture ? mat->diffuseTexture : _nullTexture;
+		mat->specularTexture = mat->specularTexture ? mat->specularTexture : _nullTexture;
+		mat->dirty = true;
+
+		entry.asset.materials.push_back(mat);
+	}
+
+	return handle;
+}
+
+void AssetManager::Update(float budget)
+{
+	auto start = high_resolution_clock::now();
+
+	while (true)
+	{
+		std::unique_ptr<DecodedMesh> mesh;
+		DecodedTexture texture;
+		bool streamed = false;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			// Meshes first, their materials request textures which can then decode while the rest upload.
+			if (!_decodedMeshes.empty())
+			{
+				mesh = std::move(_decodedMeshes.front());
+				_decodedMeshes.pop_front();
+			}
+			else if (!_decodedTextures.empty())
+			{
+				texture = std::move(_decodedTextures.front());
+				_decodedTextures.pop_front();
+			}
+			else if (!_streamedTextures.empty())
+			{
+				texture = std::move(_streamedTextures.front());
+				_streamedTextures.pop_front();
+				streamed = true;
+			}
+			else
+			{
+				break;
+			}
+		}
+
+		if (mesh)
+		{
+			UploadMesh(*mesh);
+		}
+		else if (streamed)
+		{
+			UploadStreamedTexture(texture);
+		}
+		else
+		{
+			UploadTexture(texture);
+		}
+
+		if (SecondsSince(start) >= budget)
+		{
+			break;
+		}
+	}
+
+	_uploadSeconds += SecondsSince(start);
+
+	UpdateStreaming();
+
+	if (_busy && !IsLoading())
+	{
+		_busy = false;
+		_loadSeconds = SecondsSince(_loadStartTime);
+	}
+}
+
+void AssetManager::RequestTexture(TextureHandle handle, const TextureDemand& demand)
+{
+	if (handle.index < _textures.size() && !_textures[handle.index].streamPath.empty())
+	{
+		_residency.Request(_textures[handle.index].residencyId, demand);
+	}
+}
+
+void AssetManager::SetStreamingBudget(uint64_t budget)
+{
+	_streamingBudget = budget;
+	_residency.SetBudget(budget);
+}
+
+void AssetManager::Flush()
+{
+	while (IsLoading())
+	{
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_decoded.wait(lock, [this]() { return _decoding == 0 || !_decodedTextures.empty() || !_decodedMeshes.empty(); });
+		}
+
+		Update(FLT_MAX);
+	}
+}
+
+Texture* AssetManager::GetTexture(TextureHandle handle) const
+{
+	return handle.index < _textures.size() ? _textures[handle.index].texture : nullptr;
+}
+
+const MeshAsset* AssetManager::GetMesh(MeshHandle handle) const
+{
+	if (handle.index < _meshes.size() && _meshes[handle.index].state == AssetState::RESIDENT)
+	{
+		return &_meshes[handle.index].asset;
+	}
+
+	if (_placeholderMesh.index < _meshes.size() && _meshes[_placeholderMesh.index].state == AssetState::RESIDENT)
+	{
+		return &_meshes[_placeholderMesh.index].asset;
+	}
+
+	return nullptr;
+}
+
+AssetState AssetManager::GetState(TextureHandle handle) const
+{
+	return handle.index < _textures.size() ? _textures[handle.index].state : AssetState::FAILED;
+}
+
+AssetState AssetManager::GetState(MeshHandle handle) const
+{
+	return handle.index < _meshes.size() ? _meshes[handle.index].state : AssetState::FAILED;
+}
+
+void AssetManager::SetPlaceholderMesh(MeshHandle handle)
+{
+	_placeholderMesh = handle;
+}
+
+Texture* AssetManager::GetNullTexture() const
+{
+	return _nullTexture;
+}
+
+bool AssetManager::IsLoading() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _decoding > 0 || !_decodedTextures.empty() || !_decodedMeshes.empty();
+}
+
+AssetManagerStats AssetManager::GetStats() const
+{
+	AssetManagerStats stats;
+
+	auto count = [&stats](AssetState state)
+	{
+		stats.requested++;
+		stats.loading += state == AssetState::LOADING;
+		stats.resident += state == AssetState::RESIDENT;
+		stats.failed += state == AssetState::FAILED;
+	};
+
+	for (const auto& entry : _textures)
+	{
+		count(entry.state);
+	}
+
+	for (const auto& entry : _meshes)
+	{
+		count(entry.state);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		stats.decodeSeconds = _decodeSeconds;
+	}
+
+	stats.uploadSeconds = _uploadSeconds;
+	stats.loadSeconds = _busy ? SecondsSince(_loadStartTime) : _loadSeconds;
+
+	if (_cache)
+	{
+		stats.cache = _cache->GetStats();
+	}
+
+	stats.streaming = _residency.GetStats();
+	for (const auto& entry : _textures)
+	{
+		if (!entry.streamPath.empty())
+		{
+			stats.residentBytes += _residency.GetBytesFrom(entry.residencyId, entry.residentLevel);
+		}
+	}
+
+	return stats;
+}
+
+void AssetManager::BeginLoad()
+{
+	if (!_busy)
+	{
+		_busy = true;
+		_loadStartTime = high_resolution_clock::now();
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_decoding++;
+}
+
+void AssetManager::DecodeTexture(unsigned int index, string path, MipSettings settings, bool stream)
+{
+	auto start = high_resolution_clock::now();
+
+	DecodedTexture decoded;
+	decoded.index = index;
+
+	// A streamed texture only reads the levels which are always resident, the rest follow as they are needed.
+	auto readDds = [&decoded, stream](const string& ddsPath)
+	{
+		if (!stream)
+		{
+			return ReadDds(ddsPath.c_str(), decoded.texture);
+		}
+
+		if (!ReadDdsLayout(ddsPath.c_str(), decoded.layout))
+		{
+			return false;
+		}
+
+		decoded.firstLevel = GetAlwaysResidentLevel(decoded.layout);
+		if (!ReadDds(ddsPath.c_str(), decoded.texture, decoded.firstLevel))
+		{
+			return false;
+		}
+
+		decoded.streamPath = ddsPath;
+		return true;
+	};
+
+	// Prefer a cooked .dds next to the source image, as long as it isn't stale.
+	std::filesystem::path cookedPath(path);
+	cookedPath.replace_extension(".dds");
+
+	std::error_code error;
+	bool loaded = false;
+	if (cookedPath == std::filesystem::path(path)
+		|| (std::filesystem::exists(cookedPath, error)
+			&& std::filesystem::last_write_time(cookedPath, error) >= std::filesystem::last_write_time(path, error)))
+	{
+		loaded = readDds(cookedPath.string());
+	}
+
+	uint64_t key = 0;
+	bool keyed = !loaded && _cache && GetTextureKey(path, settings, key);
+
+	string cachedPath;
+	if (keyed && _cache->Find(key, cachedPath))
+	{
+		loaded = readDds(cachedPath);
+		if (!loaded)
+		{
+			_cache->Remove(key);
+		}
+	}
+
+	int width, height, bpp;
+	unsigned char* pixels = loaded ? nullptr : stbi_load(path.c_str(), &width, &height, &bpp, STBI_rgb_alpha);
+	if (pixels)
+	{
+		MipChain mips;
+		GenerateMipChain(pixels, width, height, settings, mips, _threadPool);
+		stbi_image_free(pixels);
+
+		MoveMipChain(std::move(mips), decoded.texture);
+
+		if (keyed)
+		{
+			auto writePath = _cache->GetWritePath(key);
+			if (WriteDds(writePath.c_str(), decoded.texture) && _cache->Commit(key, writePath) && stream)
+			{
+				// Now the cache holds every level, only keep the ones which are always resident.
+				decoded.layout.format = decoded.texture.format;
+				decoded.layout.levels = decoded.texture.levels;
+				decoded.firstLevel = GetAlwaysResidentLevel(decoded.layout);
+				decoded.streamPath = _cache->GetEntryPath(key);
+
+				DropLevels(decoded.texture, decoded.firstLevel);
+			}
+		}
+	}
+	else if (!loaded)
+	{
+		// The reason is shared between threads, it may belong to another failure.
+		cout << "STB Failed to load Image " << path << ": " << stbi_failure_reason() << endl;
+	}
+
+	float seconds = SecondsSince(start);
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_decodedTextures.push_back(std::move(decoded));
+		_decoding--;
+		_decodeSeconds += seconds;
+		// Notified under the lock, once it is released the destructor may already have destroyed the condition.
+		_decoded.notify_all();
+	}
+}
+
+void AssetManager::StreamTexture(unsigned int index, string path, unsigned int firstLevel)
+{
+	DecodedTexture decoded;
+	decoded.index = index;
+	decoded.firstLevel = firstLevel;
+
+	// Left empty if the file can't be read, the texture then keeps the levels it has.
+	ReadDds(path.c_str(), decoded.texture, firstLevel);
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_streamedTextures.push_back(std::move(decoded));
+		_streamReads--;
+		_decoded.notify_all();
+	}
+}
+
+void AssetManager::DecodeMesh(unsigned int index, string path, MeshImportSettings settings)
+{
+	auto start = high_resolution_clock::now();
+
+	auto decoded = std::make_unique<DecodedMesh>();
+	decoded->index = index;
+
+	// Prefer a cooked .tmesh next to the source file, as long as it isn't stale.
+	std::filesystem::path cookedPath(path);
+	cookedPath.replace_extension(".tmesh");
+
+	std::error_code error;
+	if (cookedPath == std::filesystem::path(path)
+		|| (std::filesystem::exists(cookedPath, error)
+			&& std::filesystem::last_write_time(cookedPath, error) >= std::filesystem::last_write_time(path, error)))
+	{
+		decoded->cooked = decoded->loaded = decoded->meshFile.Open(cookedPath.string().c_str());
+	}
+
+	uint64_t key = 0;
+	bool keyed = !decoded->loaded && _cache && GetMeshKey(path, settings, key);
+
+	string cachedPath;
+	if (keyed && _cache->Find(key, cachedPath))
+	{
+		decoded->cooked = decoded->loaded = decoded->meshFile.Open(cachedPath.c_str());
+		if (!decoded->loaded)
+		{
+			_cache->Remove(key);
+		}
+	}
+
+	if (!decoded->loaded)
+	{
+		ObjParser parser;
+		parser.SetThreadPool(_threadPool);
+
+		if (parser.Load(path.c_str(), decoded->model))
+		{
+			auto report = ImportMesh(decoded->model.mesh, settings);
+
+			// Built up first so lines from different workers don't interleave.
+			std::ostringstream message;
+			message << "Imported " << path << ": " << report.verticesBefore << " -> " << report.verticesAfter
+				<< " vertices, " << report.bytesSaved / 1024 << " KB saved, ACMR " << report.cacheBefore.acmr << " -> " << report.cacheAfter.acmr << "." << endl;
+			cout << message.str();
+
+			decoded->loaded = true;
+
+			if (keyed)
+			{
+				auto writePath = _cache->GetWritePath(key);
+				if (MeshFile::Write(writePath.c_str(), decoded->model.mesh, decoded->model.materials))
+				{
+					_cache->Commit(key, writePath);
+				}
+			}
+		}
+		else
+		{
+			cout << "Could not load mesh: " << path << endl;
+		}
+	}
+
+	float seconds = SecondsSince(start);
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_decodedMeshes.push_back(std::move(decoded));
+		_decoding--;
+		_decodeSeconds += seconds;
+		_decoded.notify_all();
+	}
+}
+
+void AssetManager::UploadTexture(DecodedTexture& decoded)
+{
+	auto& entry = _textures[decoded.index];
+
+	if (!decoded.texture.levels.empty() && entry.texture->Load(decoded.texture))
+	{
+		entry.state = AssetState::RESIDENT;
+
+		if (!decoded.streamPath.empty())
+		{
+			entry.streamPath = std::move(decoded.streamPath);
+			entry.residencyId = _residency.Add(decoded.layout);
+			entry.residentLevel = decoded.firstLevel;
+		}
+	}
+	else
+	{
+		entry.state = AssetState::FAILED;
+	}
+}
+
+void AssetManager::UploadStreamedTexture(DecodedTexture& decoded)
+{
+	auto& entry = _textures[decoded.index];
+	entry.streaming = false;
+
+	if (!decoded.texture.levels.empty() && entry.texture->Load(decoded.texture))
+	{
+		entry.residentLevel = decoded.firstLevel;
+	}
+	else
+	{
+		// Most likely the file was evicted from the cache. Keep the levels there are.
+		cout << "Stopped streaming " << entry.path << ", its levels could not be read from " << entry.streamPath << endl;
+		entry.streamPath.clear();
+	}
+}
+
+void AssetManager::UpdateStreaming()
+{
+	_residency.Update();
+
+	// Bytes which are resident, or will be once the reads in flight are uploaded.
+	uint64_t committed = 0;
+	for (const auto& entry : _textures)
+	{
+		if (!entry.streamPath.empty())
+		{
+			unsigned int level = entry.streaming ? std::min(entry.residentLevel, entry.streamingLevel) : entry.residentLevel;
+			committed += _residency.GetBytesFrom(entry.residencyId, level);
+		}
+	}
+
+	// Drop levels first, making room for the reads which add them.
+	for (bool adding : { false, true })
+	{
+		for (unsigned int i = 0; i < _textures.size(); i++)
+		{
+			auto& entry = _textures[i];
+			if (entry.streamPath.empty() || entry.streaming)
+			{
+				continue;
+			}
+
+			unsigned int target = _residency.GetTargetLevel(entry.residencyId);
+			if (target == entry.residentLevel || (target < entry.residentLevel) != adding)
+			{
+				continue;
+			}
+
+			if (adding)
+			{
+				uint64_t added = _residency.GetBytesFrom(entry.residencyId, target) - _residency.GetBytesFrom(entry.residencyId, entry.residentLevel);
+				if (committed + added > _residency.GetBudget())
+				{
+					continue;
+				}
+
+				committed += added;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (_streamReads >= MAX_STREAM_READS)
+				{
+					return;
+				}
+				_streamReads++;
+			}
+
+			entry.streaming = true;
+			entry.streamingLevel = target;
+
+			string path = entry.streamPath;
+			_threadPool->Enqueue([this, i, path, target]() { StreamTexture(i, path, target); });
+		}
+	}
+}
+
+void AssetManager::UploadMesh(DecodedMesh& decoded)
+{
+	auto& entry = _meshes[decoded.index];
+
+	if (!decoded.loaded)
+	{
+		entry.state = AssetState::FAILED;
+		return;
+	}
+
+	entry.asset.mesh = new Mesh(_renderer);
+	entry.asset.mesh->SetOccluder(entry.settings.occluder);
+
+	if (decoded.cooked)
+	{
+		UploadCookedMesh(entry, decoded.meshFile);
+	}
+	else
+	{
+		UploadObjMesh(entry, decoded.model);
+	}
+
+	entry.state = AssetState::RESIDENT;
+}
+
+void AssetManager::UploadObjMesh(MeshEntry& entry, ObjModel& model)
+{
+	UploadMeshData(entry.asset.mesh, model.mesh);
+
+	ObjMaterial defaultMaterial;
+
+	for (const auto& part : model.mesh.parts)
+	{
+		const auto& objMat = part.material >= 0 ? model.materials[part.material] : defaultMaterial;
+
+		entry.asset.materials.push_back(ConvertMaterial(entry.path, objMat, entry.asset.textures));
+	}
+}
+
+void AssetManager::UploadMeshData(Mesh* mesh, const MeshData& meshData)
+{
+	// Before the parts, which are bounded by the vertices they use.
+	if (!meshData.packedVertices.empty())
+	{
+		mesh->SetVertices(meshData.packedVertices.data(), static_cast<unsigned int>(meshData.packedVertices.size()), meshData.quantization);
+	}
+	else
+	{
+		mesh->SetVertices(meshData.vertices.data(), static_cast<unsigned int>(meshData.vertices.size()));
+	}
+
+	vector<const unsigned int*> levels;
+	vector<unsigned int> levelCounts;
+
+	for (unsigned int i = 0; i < meshData.parts.size(); i++)
+	{
+		const auto& part = meshData.parts[i];
+
+		levels.assign(1, meshData.indices.data() + part.indexStart);
+		levelCounts.assign(1, part.indexCount);
+		for (const auto& lod : part.lods)
+		{
+			levels.push_back(meshData.indices.data() + lod.indexStart);
+			levelCounts.push_back(lod.indexCount);
+		}
+
+		mesh->AddIndexBuffer(levels.data(), levelCounts.data(), static_cast<unsigned int>(levels.size()), part.baseVertex);
+
+		if (!part.meshlets.empty())
+		{
+			mesh->SetMeshlets(i, part.meshlets.data(), static_cast<unsigned int>(part.meshlets.size()));
+		}
+	}
+
+	mesh->SetUvDensity(meshData.uvDensity);
+
+	mesh->SetLodErrors(meshData.lodErrors);
+
+	// Every part is bounded, only occluders need the positions now.
+	mesh->ReleasePositions();
+}
+
+void AssetManager::UploadCookedMesh(MeshEntry& entry, const MeshFile& meshFile)
+{
+	const auto& header = meshFile.GetHeader();
+	const auto* parts = meshFile.GetParts();
+	const auto* indices = meshFile.GetIndices();
+	auto* mesh = entry.asset.mesh;
+
+	// Buffers are filled straight from the mapped file, vertices before the parts they bound.
+	if (meshFile.IsPacked())
+	{
+		mesh->SetVertices(meshFile.GetPackedVertices(), header.vertexCount, meshFile.GetQuantization());
+	}
+	else
+	{
+		mesh->SetVertices(meshFile.GetVertices(), header.vertexCount);
+	}
+
+	ObjMaterial defaultMaterial;
+
+	for (unsigned int i = 0; i < header.partCount; i++)
+	{
+		const auto& part = parts[i];
+		auto objMat = part.material >= 0 ? meshFile.GetMaterial(part.material) : defaultMaterial;
+
+		entry.asset.materials.push_back(ConvertMaterial(entry.path, objMat, entry.asset.textures));
+
+		const unsigned int* levels[MeshFileHeader::MAX_LODS] = { indices + part.indexStart };
+		unsigned int levelCounts[MeshFileHeader::MAX_LODS] = { part.indexCount };
+
+		const auto* lods = meshFile.GetLods(i);
+		for (unsigned int level = 1; level < header.lodCount; level++)
+		{
+			levels[level] = indices + lods[level - 1].indexStart;
+			levelCounts[level] = lods[level - 1].indexCount;
+		}
+
+		mesh->AddIndexBuffer(levels, levelCounts, header.lodCount, part.baseVertex);
+
+		if (part.meshletCount > 0)
+		{
+			mesh->SetMeshlets(i, meshFile.GetMeshlets(i), part.meshletCount);
+		}
+	}
+
+	mesh->SetUvDensity(header.uvDensity);
+
+	if (header.lodCount > 1)
+	{
+		mesh->SetLodErrors(vector<float>(header.lodErrors, header.lodErrors + header.lodCount));
+	}
+
+	mesh->ReleasePositions();
+}
+
+Material* AssetManager::ConvertMaterial(const string& path, const ObjMaterial& objMat, vector<TextureHandle>& textures)
+{
+	auto* mat = new Material{};
+	mat->transparency = 1.0f - objMat.dissolve;
+
+	// Texture paths are relative to the mesh.
+	auto loadTexture = [this, &path, &textures](const string& map)
+	{
+		std::filesystem::path texPath(path);
+		texPath.remove_filename().append(map);
+
+		auto handle = LoadTexture(texPath.string().c_str());
+		if (std::find_if(textures.begin(), textures.end(), [handle](TextureHandle t) { return t.index == handle.index; }) == textures.end())
+		{
+			textures.push_back(handle);
+		}
+
+		return GetTexture(handle);
+	};
+
+	if (objMat.ambientMap != "")
+	{
+		mat->ambientTexture = loadTexture(objMat.ambientMap);
+	}
+	else
+	{
+		mat->ambientTexture = _nullTexture;
+		mat->ambient = objMat.ambient;
+	}
+
+	if (objMat.diffuseMap != "")
+	{
+		mat->diffuseTexture = loadTexture(objMat.diffuseMap);
+	}
+	else
+	{
+		mat->diffuseTexture = _nullTexture;
+		mat->diffuse = objMat.diffuse;
+	}
+
+	if (objMat.specularMap != "")
+	{
+		mat->specularTexture = loadTexture(objMat.specularMap);
+	}
+	else
+	{
+		mat->specularTexture = _nullTexture;
+		mat->specular = objMat.specular;
+		mat->specularExponent = objMat.specularExponent;
+	}
+
+	return mat;
+}
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Renderer.h"
+#include "Mesh.h"
+#include "Texture.h"
+#include "Material.h"
+#include "ThreadPool.h"
+#include "DerivedDataCache.h"
+#include "ObjParser.h"
+#include "MeshFile.h"
+#include "MeshImport.h"
+#include "MipGenerator.h"
+#include "TextureData.h"
+#include "TextureStreaming.h"
+
+namespace TinyEngine
+{
+	// Refers to an asset owned by an AssetManager. Handles are valid as soon as the asset is requested,
+	// whether or not it has finished loading.
+	template<typename T>
+	struct AssetHandle
+	{
+		static const unsigned int INVALID = ~0u;
+
+		unsigned int index = INVALID;
+
+		bool IsValid() const
+		{
+			return index != INVALID;
+		}
+	};
+
+	typedef AssetHandle<Texture> TextureHandle;
+
+	// A mesh and the material for each of its parts.
+	struct MeshAsset
+	{
+		Mesh* mesh = nullptr;
+		std::vector<Material*> materials;
+		// Every texture the materials use, to report their demand.
+		std::vector<TextureHandle> textures;
+	};
+
+	typedef AssetHandle<MeshAsset> MeshHandle;
+
+	enum class AssetState
+	{
+		// Being read and decoded, or waiting to be uploaded.
+		LOADING,
+		RESIDENT,
+		FAILED
+	};
+
+	// Counts and timings of everything an AssetManager has loaded.
+	struct AssetManagerStats
+	{
+		unsigned int requested = 0;
+		unsigned int loading = 0;
+		unsigned int resident = 0;
+		unsigned int failed = 0;
+
+		// Time spent decoding summed over the worker threads, and time spent uploading on the render thread.
+		float decodeSeconds = 0.0f;
+		float uploadSeconds = 0.0f;
+		// Time from the first request until nothing was loading.
+		float loadSeconds = 0.0f;
+
+		// Lookups of decoded textures and imported meshes, all zero without a cache.
+		DerivedDataCacheStats cache;
+
+		// Levels of streamed textures, residentBytes is what is uploaded now.
+		TextureResidencyStats streaming;
+		uint64_t residentBytes = 0;
+	};
+
+	// Loads textures and meshes without blocking the render thread.
+	// Requests return a handle straight away and queue the file to be read and decoded on the
+	// worker threads. Update uploads whatever has been decoded on the render thread. Until then
+	// textures show a placeholder, and meshes show the placeholder mesh if there is one.
+	// Assets are cached by path, requesting the same path twice returns the same handle.
+	//
+	// Textures backed by a .dds, cooked or in the cache, are streamed. They become resident with only
+	// their smallest levels, then Update reads finer levels on the workers as RequestTexture reports
+	// them needed, dropping the least needed levels to stay within the streaming budget.
+	class AssetManager
+	{
+	private:
+		struct TextureEntry
+		{
+			std::string path;
+			MipSettings settings;
+			Texture* texture;
+			AssetState state;
+
+			// .dds the texture streams from, empty if every level stays resident.
+			std::string streamPath;
+			unsigned int residencyId;
+			// Largest level uploaded.
+			unsigned int residentLevel;
+			// Is a read of different levels in flight, and the largest level it reads.
+			bool streaming;
+			unsigned int streamingLevel;
+		};
+
+		struct MeshEntry
+		{
+			std::string path;
+			MeshImportSettings settings;
+			MeshAsset asset;
+			AssetState state;
+		};
+
+		struct DecodedTexture
+		{
+			unsigned int index;
+			// Every level, empty if the image couldn't be decoded. Starts at firstLevel if streamed.
+			TextureData texture;
+			unsigned int firstLevel = 0;
+
+			// Set when the texture can stream, with the format and levels of the whole texture.
+			std::string streamPath;
+			TextureData layout;
+		};
+
+		// Defined with the decoder, holds either a mapped .tmesh or a parsed .obj.
+		struct DecodedMesh;
+
+		Renderer* _renderer;
+		ThreadPool* _threadPool;
+		DerivedDataCache* _cache;
+
+		// Only touched on the render thread, workers are given copies of what they need.
+		std::vector<TextureEntry> _textures;
+		std::vector<MeshEntry> _meshes;
+		std::unordered_map<std::string, unsigned int> _texturesByPath;
+		std::unordered_map<std::string, unsigned int> _meshesByPath;
+
+		Texture* _nullTexture;
+		Texture* _placeholderTexture;
+		MeshHandle _placeholderMesh;
+
+		// Shared with the workers.
+		mutable std::mutex _mutex;
+		std::condition_variable _decoded;
+		std::deque<DecodedTexture> _decodedTextures;
+		std::deque<std::unique_ptr<DecodedMesh>> _decodedMeshes;
+		unsigned int _decoding;
+		float _decodeSeconds;
+		// Levels read for textures which are already resident, kept apart so streaming doesn't count as loading.
+		std::deque<DecodedTexture> _streamedTextures;
+		unsigned int _streamReads;
+
+		TextureResidency _residency;
+		uint64_t _streamingBudget;
+
+		float _uploadSeconds;
+
+		// Whether anything has been loading since _loadStartTime.
+		bool _busy;
+		std::chrono::high_resolution_clock::time_point _loadStartTime;
+		float _loadSeconds;
+
+	public:
+		static constexpr float DEFAULT_UPLOAD_BUDGET = 0.004f;
+		static constexpr uint64_t DEFAULT_STREAMING_BUDGET = 256ull * 1024 * 1024;
+		// Streaming reads in flight at once, so they don't crowd out loads.
+		static const unsigned int MAX_STREAM_READS = 4;
+
+		// Construct an AssetManager.
+		//	Renderer* renderer: Renderer which assets are uploaded to
+		//	ThreadPool* threadPool: Workers which read and decode assets
+		//	DerivedDataCache* cache: Where decoded textures and imported meshes are kept between runs, nullptr to always decode
+		AssetManager(Renderer* renderer, ThreadPool* threadPool, DerivedDataCache* cache = nullptr);
+
+		// Waits for any decoding assets then releases every asset.
+		~AssetManager();
+
+		AssetManager(const AssetManager&) = delete;
+
+		// Request a texture. Any format stb_image reads, decoded to RGBA and given a full mip chain on the workers.
+		// A .dds, or an up to date .dds cooked next to the image, is uploaded as it is, keeping any block compression.
+		// Otherwise the cache is checked for the image's contents decoded with the same settings before decoding.
+		//	const char* path: Image file to load
+		//	const MipSettings& settings: How its mips are filtered, only the first request for a path is used
+		//	returns: Handle of the texture
+		TextureHandle LoadTexture(const char* path, const MipSettings& settings = MipSettings());
+
+		// Request a mesh and the textures its materials use.
+		// A .tmesh cooked next to an .obj is used instead of it if it is up to date. Otherwise the cache is
+		// checked for the .obj and its .mtl files imported with the same settings before parsing.
+		//	const char* path: .obj or .tmesh file to load
+		//	const MeshImportSettings& settings: Processing applied if an .obj is loaded, and whether the mesh is an occluder.
+		//		Only the first request for a path is used
+		//	returns: Handle of the mesh
+		MeshHandle LoadMesh(const char* path, const MeshImportSettings& settings = MeshImportSettings());
+
+		// Add a mesh made in code, such as a procedural one, uploading it straight away. Meshes made this way are
+		// cached by name as loaded ones are by path, creating the same name twice returns the same handle.
+		//	const char* name: Name of the mesh, which shouldn't be the path of a mesh which is loaded
+		//	const MeshData& meshData: Vertices and parts, with any levels of detail and meshlets they have
+		//	const std::vector<Material>& materials: Materials the parts' material indices refer to, copied.
+		//		Textures left nullptr use the null texture, parts without a material use a default one
+		//	bool occluder: Keep the mesh's positions and coarsest level on the CPU, see Mesh::SetOccluder
+		//	returns: Handle of the mesh, which is already resident
+		MeshHandle CreateMesh(const char* name, const MeshData& meshData, const std::vector<Material>& materials, bool occluder = false);
+
+		// Upload decoded assets, then pick the levels streamed textures should have from the demand reported
+		// since the last update and start reading any which differ. Call once a frame on the render thread.
+		//	float budget: Seconds to spend uploading, once it runs out the rest wait for the next frame.
+		//		At least one asset is uploaded if any are ready
+		void Update(float budget = DEFAULT_UPLOAD_BUDGET);
+
+		// Report how finely a texture is seen this frame. Call for every texture of every mesh drawn.
+		//	TextureHandle handle: Texture being drawn
+		//	const TextureDemand& demand: From ComputeTextureDemand for the mesh using it
+		void RequestTexture(TextureHandle handle, const TextureDemand& demand);
+
+		// Set the bytes streamed textures are kept under. Textures loaded while it is 0 aren't streamed.
+		//	uint64_t budget: Budget in bytes
+		void SetStreamingBudget(uint64_t budget);
+
+		// Wait for every requested asset, and any textures their materials request, to be resident or fail.
+		void Flush();
+
+		// Get a texture to draw with. Shows the placeholder until the texture is resident,
+		// the same Texture is returned throughout so it can be kept in a Material.
+		//	returns: nullptr only for an invalid handle
+		Texture* GetTexture(TextureHandle handle) const;
+
+		// Get a mesh to draw.
+		//	returns: The mesh if it is resident, otherwise the placeholder mesh, nullptr if there is neither
+		const MeshAsset* GetMesh(MeshHandle handle) const;
+
+		AssetState GetState(TextureHandle handle) const;
+		AssetState GetState(MeshHandle handle) const;
+
+		// Set the mesh drawn in place of meshes which aren't resident, usually something small loaded first with Flush.
+		void SetPlaceholderMesh(MeshHandle handle);
+
+		// Texture with no data, for Material textures which are unused.
+		Texture* GetNullTexture() const;
+
+		// Is anything still being decoded or waiting to be uploaded?
+		bool IsLoading() const;
+
+		AssetManagerStats GetStats() const;
+
+	private:
+		void DecodeTexture(unsigned int index, std::string path, MipSettings settings, bool stream);
+		void StreamTexture(unsigned int index, std::string path, unsigned int firstLevel);
+		void DecodeMesh(unsigned int index, std::string path, MeshImportSettings settings);
+
+		void UploadTexture(DecodedTexture& decoded);
+		void UploadStreamedTexture(DecodedTexture& decoded);
+
+		// Start reading levels for streamed textures whose target differs from what is resident. Reads which drop
+		// levels start first, reads which add levels only start while what they add fits in the budget.
+		void UpdateStreaming();
+		void UploadMesh(DecodedMesh& decoded);
+		void UploadObjMesh(MeshEntry& entry, ObjModel& model);
+		void UploadMeshData(Mesh* mesh, const MeshData& meshData);
+		void UploadCookedMesh(MeshEntry& entry, const MeshFile& meshFile);
+
+		Material* ConvertMaterial(const std::string& path, const ObjMaterial& objMat, std::vector<TextureHandle>& textures);
+
+		// Start timing a load if nothing was loading, called with every request.
+		void BeginLoad();
+	};
+}
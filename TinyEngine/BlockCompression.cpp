@@ -0,0 +1,902 @@
+#include "BlockCompression.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+using namespace TinyEngine;
+
+using std::cout;
+using std::endl;
+using std::vector;
+
+namespace
+{
+	// Least squares passes refining each block's endpoints after the initial fit.
+	const int REFINE_ITERATIONS = 2;
+
+	// BC7 interpolation weights for 4 bit indices, out of 64.
+	const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	inline int Clamp(int value, int low, int high)
+	{
+		return std::min(std::max(value, low), high);
+	}
+
+	// Mean and principal axis of a block's texels, over their first channels.
+	template<int CHANNELS>
+	void FitLine(const float (*texels)[4], float* mean, float* axis)
+	{
+		for (int c = 0; c < CHANNELS; c++)
+		{
+			mean[c] = 0.0f;
+			for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+			{
+				mean[c] += texels[i][c];
+			}
+			mean[c] /= BLOCK_TEXELS;
+		}
+
+		float covariance[CHANNELS][CHANNELS] = {};
+		for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			for (int a = 0; a < CHANNELS; a++)
+			{
+				for (int b = 0; b < CHANNELS; b++)
+				{
+					covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+				}
+			}
+		}
+
+		// Power iteration finds the direction the texels spread along most.
+		for (int c = 0; c < CHANNELS; c++)
+		{
+			axis[c] = 1.0f;
+		}
+
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float next[CHANNELS] = {};
+			float length = 0.0f;
+			for (int a = 0; a < CHANNELS; a++)
+			{
+				for (int b = 0; b < CHANNELS; b++)
+				{
+					next[a] += covariance[a][b] * axis[b];
+				}
+				length += next[a] * next[a];
+			}
+
+			if (length < 1e-12f)
+			{
+				break;
+			}
+
+			length = 1.0f / sqrtf(length);
+			for (int c = 0; c < CHANNELS; c++)
+			{
+				axis[c] = next[c] * length;
+			}
+		}
+	}
+
+	// Ends of the segment along axis which covers every texel.
+	template<int CHANNELS>
+	void FitEndpoints(const float (*texels)[4], const float* mean, const float* axis, float* low, float* high)
+	{
+		float minimum = FLT_MAX;
+		float maximum = -FLT_MAX;
+		for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			float t = 0.0f;
+			for (int c = 0; c < CHANNELS; c++)
+			{
+				t += (texels[i][c] - mean[c]) * axis[c];
+			}
+			minimum = std::min(minimum, t);
+			maximum = std::max(maximum, t);
+		}
+
+		for (int c = 0; c < CHANNELS; c++)
+		{
+			low[c] = std::min(std::max(mean[c] + axis[c] * minimum, 0.0f), 255.0f);
+			high[c] = std::min(std::max(mean[c] + axis[c] * maximum, 0.0f), 255.0f);
+		}
+	}
+
+	// Endpoints which best reproduce the texels given how much of the first endpoint each one uses.
+	//	returns: false if the weights don't determine the endpoints, ie. they are all the same
+	template<int CHANNELS>
+	bool SolveEndpoints(const float (*texels)[4], const float* weights, float* first, float* second)
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[CHANNELS] = {}, bx[CHANNELS] = {};
+
+		for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			float a = weights[i];
+			float b = 1.0f - a;
+
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+
+			for (int c = 0; c < CHANNELS; c++)
+			{
+				ax[c] += a * texels[i][c];
+				bx[c] += b * texels[i][c];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (fabsf(determinant) < 1e-6f)
+		{
+			return false;
+		}
+
+		determinant = 1.0f / determinant;
+		for (int c = 0; c < CHANNELS; c++)
+		{
+			first[c] = std::min(std::max((ax[c] * bb - bx[c] * ab) * determinant, 0.0f), 255.0f);
+			second[c] = std::min(std::max((bx[c] * aa - ax[c] * ab) * determinant, 0.0f), 255.0f);
+		}
+
+		return true;
+	}
+
+	void LoadTexels(const unsigned char* rgba, float (*texels)[4])
+	{
+		for (unsigned int i = 0; i < BLOCK_TEXELS * 4; i++)
+		{
+			texels[i / 4][i % 4] = rgba[i];
+		}
+	}
+
+	// BC1 color
+
+	uint16_t To565(const float* color)
+	{
+		int r = Clamp(static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+		int g = Clamp(static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+		int b = Clamp(static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void From565(uint16_t value, int* color)
+	{
+		int r = value >> 11;
+		int g = (value >> 5) & 63;
+		int b = value & 31;
+
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// Palette of a BC1 block, with three colors and transparent black if first <= second and allowed.
+	void ColorPalette(uint16_t first, uint16_t second, bool allowThreeColor, int (*palette)[4])
+	{
+		From565(first, palette[0]);
+		From565(second, palette[1]);
+
+		palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+
+		if (first > second || !allowThreeColor)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+		}
+		else
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+			palette[3][3] = 0;
+		}
+	}
+
+	// Pick each texel's nearest color in the four color palette.
+	//	returns: Squared error of the block
+	int MatchColors(const float (*texels)[4], uint16_t first, uint16_t second, unsigned char* indices)
+	{
+		int palette[4][4];
+		ColorPalette(first, second, false, palette);
+
+		int error = 0;
+		for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			int best = INT32_MAX;
+			for (int p = 0; p < 4; p++)
+			{
+				int distance = 0;
+				for (int c = 0; c < 3; c++)
+				{
+					int d = static_cast<int>(texels[i][c]) - palette[p][c];
+					distance += d * d;
+				}
+
+				if (distance < best)
+				{
+					best = distance;
+					indices[i] = static_cast<unsigned char>(p);
+				}
+			}
+			error += best;
+		}
+
+		return error;
+	}
+
+	// Write a four color BC1 block, used by BC1 itself and the color half of BC3.
+	void EncodeColor(const unsigned char* rgba, unsigned char* block)
+	{
+		float texels[BLOCK_TEXELS][4];
+		LoadTexels(rgba, texels);
+
+		float mean[3], axis[3], low[3], high[3];
+		FitLine<3>(texels, mean, axis);
+		FitEndpoints<3>(texels, mean, axis, low, high);
+
+		uint16_t first = To565(high);
+		uint16_t second = To565(low);
+		unsigned char indices[BLOCK_TEXELS];
+		int error = MatchColors(texels, first, second, indices);
+
+		// Fraction of the first color each index uses.
+		const float INDEX_WEIGHTS[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+		for (int iteration = 0; iteration < REFINE_ITERATIONS && error > 0; iteration++)
+		{
+			float weights[BLOCK_TEXELS];
+			for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+			{
+				weights[i] = INDEX_WEIGHTS[indices[i]];
+			}
+
+			float refinedFirst[3], refinedSecond[3];
+			if (!SolveEndpoints<3>(texels, weights, refinedFirst, refinedSecond))
+			{
+				break;
+			}
+
+			uint16_t candidateFirst = To565(refinedFirst);
+			uint16_t candidateSecond = To565(refinedSecond);
+			unsigned char candidateIndices[BLOCK_TEXELS];
+			int candidateError = MatchColors(texels, candidateFirst, candidateSecond, candidateIndices);
+
+			if (candidateError >= error)
+			{
+				break;
+			}
+
+			first = candidateFirst;
+			second = candidateSecond;
+			error = candidateError;
+			memcpy(indices, candidateIndices, sizeof(indices));
+		}
+
+		// The four color palette is only used when the first color is larger.
+		if (first < second)
+		{
+			std::swap(first, second);
+			for (auto& index : indices)
+			{
+				index ^= 1;
+			}
+		}
+		else if (first == second)
+		{
+			memset(indices, 0, sizeof(indices));
+		}
+
+		uint32_t bits = 0;
+		for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			bits |= static_cast<uint32_t>(indices[i]) << (i * 2);
+		}
+
+		block[0] = first & 0xff;
+		block[1] = first >> 8;
+		block[2] = second & 0xff;
+		block[3] = second >> 8;
+		memcpy(block + 4, &bits, 4);
+	}
+
+	void DecodeColor(const unsigned char* block, bool allowThreeColor, unsigned char* rgba)
+	{
+		uint16_t first = static_cast<uint16_t>(block[0] | (block[1] << 8));
+		uint16_t second = static_cast<uint16_t>(block[2] | (block[3] << 8));
+
+		int palette[4][4];
+		ColorPalette(first, second, allowThreeColor, palette);
+
+		uint32_t bits;
+		memcpy(&bits, block + 4, 4);
+
+		for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			const int* color = palette[(bits >> (i * 2)) & 3];
+			for (int c = 0; c < 4; c++)
+			{
+				rgba[i * 4 + c] = static_cast<unsigned char>(color[c]);
+			}
+		}
+	}
+
+	// BC4 single channel, used for BC3 alpha and both BC5 channels
+
+	void EncodeChannel(const unsigned char* rgba, int channel, unsigned char* block)
+	{
+		int minimum = 255;
+		int maximum = 0;
+		for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			minimum = std::min(minimum, static_cast<int>(rgba[i * 4 + channel]));
+			maximum = std::max(maximum, static_cast<int>(rgba[i * 4 + channel]));
+		}
+
+		// The first value larger selects 8 interpolated values.
+		block[0] = static_cast<unsigned char>(maximum);
+		block[1] = static_cast<unsigned char>(minimum);
+
+		int palette[8] = { maximum, minimum };
+		for (int i = 1; i < 7; i++)
+		{
+			palette[i + 1] = ((7 - i) * maximum + i * minimum) / 7;
+		}
+
+		uint64_t bits = 0;
+		if (maximum > minimum)
+		{
+			for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+			{
+				int value = rgba[i * 4 + channel];
+
+				int best = 0;
+				for (int p = 1; p < 8; p++)
+				{
+					if (abs(value - palette[p]) < abs(value - palette[best]))
+					{
+						best = p;
+					}
+				}
+
+				bits |= static_cast<uint64_t>(best) << (i * 3);
+			}
+		}
+
+		for (int i = 0; i < 6; i++)
+		{
+			block[2 + i] = static_cast<unsigned char>(bits >> (i * 8));
+		}
+	}
+
+	void DecodeChannel(const unsigned char* block, int channel, unsigned char* rgba)
+	{
+		int first = block[0];
+		int second = block[1];
+
+		int palette[8] = { first, second };
+		if (first > second)
+		{
+			for (int i = 1; i < 7; i++)
+			{
+				palette[i + 1] = ((7 - i) * first + i * second) / 7;
+			}
+		}
+		else
+		{
+			for (int i = 1; i < 5; i++)
+			{
+				palette[i + 1] = ((5 - i) * first + i * second) / 5;
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; i++)
+		{
+			bits |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+		}
+
+		for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			rgba[i * 4 + channel] = static_cast<unsigned char>(palette[(bits >> (i * 3)) & 7]);
+		}
+	}
+
+	// BC7
+
+	// A 128 bit block read or written from the least significant bit up.
+	struct BlockBits
+	{
+		unsigned char* bytes;
+		unsigned int position = 0;
+
+		void Write(unsigned int value, unsigned int count)
+		{
+			for (unsigned int i = 0; i < count; i++, position++)
+			{
+				if ((value >> i) & 1)
+				{
+					bytes[position / 8] |= 1 << (position % 8);
+				}
+			}
+		}
+
+		unsigned int Read(unsigned int count)
+		{
+			unsigned int value = 0;
+			for (unsigned int i = 0; i < count; i++, position++)
+			{
+				value |= ((bytes[position / 8] >> (position % 8)) & 1) << i;
+			}
+			return value;
+		}
+	};
+
+	struct Mode6Endpoints
+	{
+		// 7 bit endpoints and their shared low bits.
+		int first[4];
+		int second[4];
+		int firstBit;
+		int secondBit;
+	};
+
+	void ExpandMode6(const Mode6Endpoints& endpoints, int* first, int* second)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			first[c] = (endpoints.first[c] << 1) | endpoints.firstBit;
+			second[c] = (endpoints.second[c] << 1) | endpoints.secondBit;
+		}
+	}
+
+	// Pick each texel's nearest palette entry, starting from its projection onto the endpoints.
+	//	returns: Squared error of the block
+	int MatchMode6(const float (*texels)[4], const Mode6Endpoints& endpoints, unsigned char* indices)
+	{
+		int first[4], second[4];
+		ExpandMode6(endpoints, first, second);
+
+		int palette[16][4];
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 4; c++)
+			{
+				palette[i][c] = ((64 - BC7_WEIGHTS[i]) * first[c] + BC7_WEIGHTS[i] * second[c] + 32) >> 6;
+			}
+		}
+
+		float direction[4];
+		float lengthSq = 0.0f;
+		for (int c = 0; c < 4; c++)
+		{
+			direction[c] = static_cast<float>(second[c] - first[c]);
+			lengthSq += direction[c] * direction[c];
+		}
+
+		int error = 0;
+		for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			int guess = 0;
+			if (lengthSq > 0.0f)
+			{
+				float t = 0.0f;
+				for (int c = 0; c < 4; c++)
+				{
+					t += (texels[i][c] - first[c]) * direction[c];
+				}
+				guess = Clamp(static_cast<int>(t / lengthSq * 15.0f + 0.5f), 0, 15);
+			}
+
+			// The weights are nearly even, so the nearest entry is the guess or a neighbour.
+			int best = INT32_MAX;
+			for (int p = std::max(guess - 1, 0); p <= std::min(guess + 1, 15); p++)
+			{
+				int distance = 0;
+				for (int c = 0; c < 4; c++)
+				{
+					int d = static_cast<int>(texels[i][c]) - palette[p][c];
+					distance += d * d;
+				}
+
+				if (distance < best)
+				{
+					best = distance;
+					indices[i] = static_cast<unsigned char>(p);
+				}
+			}
+			error += best;
+		}
+
+		return error;
+	}
+
+	// Quantize float endpoints with whichever pair of low bits fits the texels best.
+	int QuantizeMode6(const float (*texels)[4], const float* first, const float* second, Mode6Endpoints& endpoints, unsigned char* indices)
+	{
+		int bestError = INT32_MAX;
+
+		for (int bits = 0; bits < 4; bits++)
+		{
+			Mode6Endpoints candidate;
+			candidate.firstBit = bits & 1;
+			candidate.secondBit = bits >> 1;
+
+			for (int c = 0; c < 4; c++)
+			{
+				candidate.first[c] = Clamp(static_cast<int>((first[c] - candidate.firstBit) * 0.5f + 0.5f), 0, 127);
+				candidate.second[c] = Clamp(static_cast<int>((second[c] - candidate.secondBit) * 0.5f + 0.5f), 0, 127);
+			}
+
+			unsigned char candidateIndices[BLOCK_TEXELS];
+			int error = MatchMode6(texels, candidate, candidateIndices);
+			if (error < bestError)
+			{
+				bestError = error;
+				endpoints = candidate;
+				memcpy(indices, candidateIndices, BLOCK_TEXELS);
+			}
+		}
+
+		return bestError;
+	}
+
+	// Copy a block's texels out of a level, repeating the edge texels where the block overhangs it.
+	void GatherBlock(const unsigned char* level, int width, int height, int blockX, int blockY, unsigned char* rgba)
+	{
+		for (int y = 0; y < 4; y++)
+		{
+			int sourceY = std::min(blockY * 4 + y, height - 1);
+			for (int x = 0; x < 4; x++)
+			{
+				int sourceX = std::min(blockX * 4 + x, width - 1);
+				memcpy(rgba + (y * 4 + x) * 4, level + (static_cast<size_t>(sourceY) * width + sourceX) * 4, 4);
+			}
+		}
+	}
+
+	void EncodeBlock(TextureFormat format, const unsigned char* rgba, unsigned char* block)
+	{
+		switch (format)
+		{
+		case TextureFormat::BC1:
+			EncodeBlockBC1(rgba, block);
+			break;
+		case TextureFormat::BC3:
+			EncodeBlockBC3(rgba, block);
+			break;
+		case TextureFormat::BC5:
+			EncodeBlockBC5(rgba, block);
+			break;
+		case TextureFormat::BC7:
+			EncodeBlockBC7(rgba, block);
+			break;
+		default:
+			break;
+		}
+	}
+
+	void DecodeBlock(TextureFormat format, const unsigned char* block, unsigned char* rgba)
+	{
+		switch (format)
+		{
+		case TextureFormat::BC1:
+			DecodeBlockBC1(block, rgba);
+			break;
+		case TextureFormat::BC3:
+			DecodeBlockBC3(block, rgba);
+			break;
+		case TextureFormat::BC5:
+			DecodeBlockBC5(block, rgba);
+			break;
+		case TextureFormat::BC7:
+			DecodeBlockBC7(block, rgba);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+void TinyEngine::EncodeBlockBC1(const unsigned char* rgba, unsigned char* block)
+{
+	EncodeColor(rgba, block);
+}
+
+void TinyEngine::EncodeBlockBC3(const unsigned char* rgba, unsigned char* block)
+{
+	EncodeChannel(rgba, 3, block);
+	EncodeColor(rgba, block + 8);
+}
+
+void TinyEngine::EncodeBlockBC5(const unsigned char* rgba, unsigned char* block)
+{
+	EncodeChannel(rgba, 0, block);
+	EncodeChannel(rgba, 1, block + 8);
+}
+
+void TinyEngine::EncodeBlockBC7(const unsigned char* rgba, unsigned char* block)
+{
+	float texels[BLOCK_TEXELS][4];
+	LoadTexels(rgba, texels);
+
+	float mean[4], axis[4], low[4], high[4];
+	FitLine<4>(texels, mean, axis);
+	FitEndpoints<4>(texels, mean, axis, low, high);
+
+	Mode6Endpoints endpoints;
+	unsigned char indices[BLOCK_TEXELS];
+	int error = QuantizeMode6(texels, low, high, endpoints, indices);
+
+	for (int iteration = 0; iteration < REFINE_ITERATIONS && error > 0; iteration++)
+	{
+		float weights[BLOCK_TEXELS];
+		for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			weights[i] = (64 - BC7_WEIGHTS[indices[i]]) / 64.0f;
+		}
+
+		float refinedLow[4], refinedHigh[4];
+		if (!SolveEndpoints<4>(texels, weights, refinedLow, refinedHigh))
+		{
+			break;
+		}
+
+		Mode6Endpoints candidate;
+		unsigned char candidateIndices[BLOCK_TEXELS];
+		int candidateError = QuantizeMode6(texels, refinedLow, refinedHigh, candidate, candidateIndices);
+
+		if (candidateError >= error)
+		{
+			break;
+		}
+
+		endpoints = candidate;
+		error = candidateError;
+		memcpy(indices, candidateIndices, sizeof(indices));
+	}
+
+	// The first index's top bit isn't stored, it must be 0.
+	if (indices[0] & 8)
+	{
+		std::swap(endpoints.first, endpoints.second);
+		std::swap(endpoints.firstBit, endpoints.secondBit);
+		for (auto& index : indices)
+		{
+			index = 15 - index;
+		}
+	}
+
+	memset(block, 0, 16);
+	BlockBits bits = { block };
+
+	// Mode 6 is six 0 bits then a 1.
+	bits.Write(1 << 6, 7);
+
+	for (int c = 0; c < 4; c++)
+	{
+		bits.Write(endpoints.first[c], 7);
+		bits.Write(endpoints.second[c], 7);
+	}
+
+	bits.Write(endpoints.firstBit, 1);
+	bits.Write(endpoints.secondBit, 1);
+
+	bits.Write(indices[0], 3);
+	for (unsigned int i = 1; i < BLOCK_TEXELS; i++)
+	{
+		bits.Write(indices[i], 4);
+	}
+}
+
+void TinyEngine::DecodeBlockBC1(const unsigned char* block, unsigned char* rgba)
+{
+	DecodeColor(block, true, rgba);
+}
+
+void TinyEngine::DecodeBlockBC3(const unsigned char* block, unsigned char* rgba)
+{
+	DecodeColor(block + 8, false, rgba);
+	DecodeChannel(block, 3, rgba);
+}
+
+void TinyEngine::DecodeBlockBC5(const unsigned char* block, unsigned char* rgba)
+{
+	for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+	{
+		rgba[i * 4 + 2] = 0;
+		rgba[i * 4 + 3] = 255;
+	}
+
+	DecodeChannel(block, 0, rgba);
+	DecodeChannel(block + 8, 1, rgba);
+}
+
+void TinyEngine::DecodeBlockBC7(const unsigned char* block, unsigned char* rgba)
+{
+	BlockBits bits = { const_cast<unsigned char*>(block) };
+
+	if (bits.Read(7) != 1 << 6)
+	{
+		for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+		{
+			rgba[i * 4] = rgba[i * 4 + 1] = rgba[i * 4 + 2] = 0;
+			rgba[i * 4 + 3] = 255;
+		}
+		return;
+	}
+
+	Mode6Endpoints endpoints;
+	for (int c = 0; c < 4; c++)
+	{
+		endpoints.first[c] = bits.Read(7);
+		endpoints.second[c] = bits.Read(7);
+	}
+
+	endpoints.firstBit = bits.Read(1);
+	endpoints.secondBit = bits.Read(1);
+
+	int first[4], second[4];
+	ExpandMode6(endpoints, first, second);
+
+	for (unsigned int i = 0; i < BLOCK_TEXELS; i++)
+	{
+		int weight = BC7_WEIGHTS[bits.Read(i == 0 ? 3 : 4)];
+		for (int c = 0; c < 4; c++)
+		{
+			rgba[i * 4 + c] = static_cast<unsigned char>(((64 - weight) * first[c] + weight * second[c] + 32) >> 6);
+		}
+	}
+}
+
+bool TinyEngine::CompressTexture(const MipChain& mips, TextureFormat format, TextureData& compressed, ThreadPool* threadPool)
+{
+	if (!IsBlockCompressed(format) || mips.levels.empty())
+	{
+		cout << "Can only compress a mip chain to a block compressed format." << endl;
+		return false;
+	}
+
+	const auto& first = mips.levels[0];
+	if (first.width % 4 != 0 || first.height % 4 != 0)
+	{
+		cout << "Can't block compress a " << first.width << "x" << first.height << " texture, its sides must be multiples of 4." << endl;
+		return false;
+	}
+
+	compressed.format = format;
+	AllocateTextureLevels(compressed, first.width, first.height, static_cast<unsigned int>(mips.levels.size()));
+
+	// Every row of blocks in every level is a separate job.
+	struct BlockRow
+	{
+		unsigned int level;
+		int row;
+	};
+
+	vector<BlockRow> rows;
+	for (unsigned int level = 0; level < mips.levels.size(); level++)
+	{
+		for (int row = 0; row < (mips.levels[level].height + 3) / 4; row++)
+		{
+			rows.push_back({ level, row });
+		}
+	}
+
+	const unsigned int blockBytes = GetBlockBytes(format);
+
+	auto compressRow = [&](size_t job)
+	{
+		const auto& row = rows[job];
+		const auto& source = mips.levels[row.level];
+		const auto& destination = compressed.levels[row.level];
+
+		int blocksWide = (source.width + 3) / 4;
+		unsigned char* blocks = compressed.data.data() + destination.offset + static_cast<size_t>(row.row) * blocksWide * blockBytes;
+
+		unsigned char texels[BLOCK_TEXELS * 4];
+		for (int x = 0; x < blocksWide; x++)
+		{
+			GatherBlock(mips.GetLevelData(row.level), source.width, source.height, x, row.row, texels);
+			EncodeBlock(format, texels, blocks + x * blockBytes);
+		}
+	};
+
+	if (threadPool)
+	{
+		threadPool->ParallelFor(rows.size(), compressRow);
+	}
+	else
+	{
+		for (size_t i = 0; i < rows.size(); i++)
+		{
+			compressRow(i);
+		}
+	}
+
+	return true;
+}
+
+void TinyEngine::DecompressLevel(const TextureData& texture, unsigned int level, vector<unsigned char>& rgba)
+{
+	const auto& info = texture.levels[level];
+	const unsigned char* data = texture.GetLevelData(level);
+
+	rgba.resize(static_cast<size_t>(info.width) * info.height * 4);
+
+	if (!IsBlockCompressed(texture.format))
+	{
+		memcpy(rgba.data(), data, rgba.size());
+		return;
+	}
+
+	const unsigned int blockBytes = GetBlockBytes(texture.format);
+	int blocksWide = (info.width + 3) / 4;
+	int blocksHigh = (info.height + 3) / 4;
+
+	unsigned char texels[BLOCK_TEXELS * 4];
+	for (int blockY = 0; blockY < blocksHigh; blockY++)
+	{
+		for (int blockX = 0; blockX < blocksWide; blockX++)
+		{
+			DecodeBlock(texture.format, data + (static_cast<size_t>(blockY) * blocksWide + blockX) * blockBytes, texels);
+
+			// Texels past the level's edge are padding and dropped.
+			for (int y = 0; y < 4 && blockY * 4 + y < info.height; y++)
+			{
+				for (int x = 0; x < 4 && blockX * 4 + x < info.width; x++)
+				{
+					size_t texel = static_cast<size_t>(blockY * 4 + y) * info.width + blockX * 4 + x;
+					memcpy(&rgba[texel * 4], texels + (y * 4 + x) * 4, 4);
+				}
+			}
+		}
+	}
+}
+
+float TinyEngine::ComputePsnr(const unsigned char* a, const unsigned char* b, size_t texelCount, unsigned int channels)
+{
+	double squaredError = 0.0;
+	for (size_t i = 0; i < texelCount; i++)
+	{
+		for (unsigned int c = 0; c < channels; c++)
+		{
+			double difference = static_cast<double>(a[i * 4 + c]) - b[i * 4 + c];
+			squaredError += difference * difference;
+		}
+	}
+
+	double meanSquaredError = squaredError / (static_cast<double>(texelCount) * channels);
+	if (meanSquaredError <= 0.0)
+	{
+		return 99.0f;
+	}
+
+	return static_cast<float>(10.0 * log10(255.0 * 255.0 / meanSquaredError));
+}
+
+unsigned int TinyEngine::GetPsnrChannels(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::BC1:
+		return 3;
+	case TextureFormat::BC5:
+		return 2;
+	default:
+		return 4;
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include "MipGenerator.h"
+#include "TextureData.h"
+#include "ThreadPool.h"
+
+namespace TinyEngine
+{
+	// Texels of a 4x4 block, RGBA8 in rows.
+	const unsigned int BLOCK_TEXELS = 16;
+
+	// Compress one block. Each writes GetBlockBytes of its format.
+	// BC1 ignores alpha. BC5 keeps red and green. BC7 only writes mode 6, a single RGBA subset with 4 bit indices.
+	void EncodeBlockBC1(const unsigned char* rgba, unsigned char* block);
+	void EncodeBlockBC3(const unsigned char* rgba, unsigned char* block);
+	void EncodeBlockBC5(const unsigned char* rgba, unsigned char* block);
+	void EncodeBlockBC7(const unsigned char* rgba, unsigned char* block);
+
+	// Decompress one block to 16 RGBA8 texels. Channels a format doesn't store are written as 0, or 255 for alpha.
+	// BC7 only decodes mode 6 blocks, as written by EncodeBlockBC7, other modes decode as black.
+	void DecodeBlockBC1(const unsigned char* block, unsigned char* rgba);
+	void DecodeBlockBC3(const unsigned char* block, unsigned char* rgba);
+	void DecodeBlockBC5(const unsigned char* block, unsigned char* rgba);
+	void DecodeBlockBC7(const unsigned char* block, unsigned char* rgba);
+
+	// Compress every level of a mip chain, spreading rows of blocks across the workers.
+	// Block compressed textures must have a first level whose sides are multiples of 4.
+	//	const MipChain& mips: RGBA8 levels to compress
+	//	TextureFormat format: Block compressed format to use
+	//	TextureData& compressed: Receives the compressed levels
+	//	ThreadPool* threadPool: Workers to use, nullptr runs on the calling thread
+	//	returns: false if the format isn't block compressed or the first level's size isn't a multiple of 4
+	bool CompressTexture(const MipChain& mips, TextureFormat format, TextureData& compressed, ThreadPool* threadPool = nullptr);
+
+	// Decompress a level to RGBA8 texels, to see what compression lost.
+	//	const TextureData& texture: Texture to read from
+	//	unsigned int level: Level to decompress
+	//	std::vector<unsigned char>& rgba: Receives width * height texels
+	void DecompressLevel(const TextureData& texture, unsigned int level, std::vector<unsigned char>& rgba);
+
+	// Peak signal to noise ratio between two RGBA8 images, in decibels. Higher is closer, identical images give 99.
+	//	const unsigned char* a: First image
+	//	const unsigned char* b: Second image
+	//	size_t texelCount: Texels in each image
+	//	unsigned int channels: Number of leading channels to compare, 3 for RGB, 2 for RG
+	float ComputePsnr(const unsigned char* a, const unsigned char* b, size_t texelCount, unsigned int channels);
+
+	// Number of leading channels a format keeps, to pass to ComputePsnr.
+	unsigned int GetPsnrChannels(TextureFormat format);
+}
@@ -0,0 +1,955 @@
+#include "BoundingVolumeHierarchy.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <queue>
+
+using namespace TinyEngine;
+using namespace DirectX;
+
+using std::cout;
+using std::endl;
+using std::vector;
+
+using Box = BoundingVolumeHierarchy::Box;
+
+namespace
+{
+	const unsigned int BIN_COUNT = 16;
+
+	Box MakeBox(const Bounds& bounds)
+	{
+		const auto& c = bounds.center;
+		const auto& e = bounds.extents;
+		return { { c.x - e.x, c.y - e.y, c.z - e.z }, { c.x + e.x, c.y + e.y, c.z + e.z } };
+	}
+
+	Box Union(const Box& a, const Box& b)
+	{
+		return {
+			{ std::min(a.minimum.x, b.minimum.x), std::min(a.minimum.y, b.minimum.y), std::min(a.minimum.z, b.minimum.z) },
+			{ std::max(a.maximum.x, b.maximum.x), std::max(a.maximum.y, b.maximum.y), std::max(a.maximum.z, b.maximum.z) } };
+	}
+
+	Box Grow(const Box& box, float margin)
+	{
+		return {
+			{ box.minimum.x - margin, box.minimum.y - margin, box.minimum.z - margin },
+			{ box.maximum.x + margin, box.maximum.y + margin, box.maximum.z + margin } };
+	}
+
+	float Area(const Box& box)
+	{
+		float x = box.maximum.x - box.minimum.x;
+		float y = box.maximum.y - box.minimum.y;
+		float z = box.maximum.z - box.minimum.z;
+		return 2.0f * (x * y + y * z + z * x);
+	}
+
+	bool Contains(const Box& outer, const Box& inner)
+	{
+		return outer.minimum.x <= inner.minimum.x && outer.minimum.y <= inner.minimum.y && outer.minimum.z <= inner.minimum.z
+			&& outer.maximum.x >= inner.maximum.x && outer.maximum.y >= inner.maximum.y && outer.maximum.z >= inner.maximum.z;
+	}
+
+	bool Overlaps(const Box& a, const Box& b)
+	{
+		return a.minimum.x <= b.maximum.x && a.minimum.y <= b.maximum.y && a.minimum.z <= b.maximum.z
+			&& a.maximum.x >= b.minimum.x && a.maximum.y >= b.minimum.y && a.maximum.z >= b.minimum.z;
+	}
+
+	float DistanceSq(const Box& box, const XMFLOAT3& point)
+	{
+		float x = std::max({ box.minimum.x - point.x, 0.0f, point.x - box.maximum.x });
+		float y = std::max({ box.minimum.y - point.y, 0.0f, point.y - box.maximum.y });
+		float z = std::max({ box.minimum.z - point.z, 0.0f, point.z - box.maximum.z });
+		return x * x + y * y + z * z;
+	}
+
+	float GetAxis(const XMFLOAT3& v, int axis)
+	{
+		return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+	}
+
+	float Centroid(const Box& box, int axis)
+	{
+		return (GetAxis(box.minimum, axis) + GetAxis(box.maximum, axis)) * 0.5f;
+	}
+
+	// Slab test, how far along a ray it enters a box, or FLT_MAX if it misses or the box is past maxDistance.
+	float IntersectRay(const Box& box, const XMFLOAT3& origin, const XMFLOAT3& inverseDirection, float maxDistance)
+	{
+		float tx1 = (box.minimum.x - origin.x) * inverseDirection.x;
+		float tx2 = (box.maximum.x - origin.x) * inverseDirection.x;
+		float ty1 = (box.minimum.y - origin.y) * inverseDirection.y;
+		float ty2 = (box.maximum.y - origin.y) * inverseDirection.y;
+		float tz1 = (box.minimum.z - origin.z) * inverseDirection.z;
+		float tz2 = (box.maximum.z - origin.z) * inverseDirection.z;
+
+		float enter = std::max({ std::min(tx1, tx2), std::min(ty1, ty2), std::min(tz1, tz2), 0.0f });
+		float exit = std::min({ std::max(tx1, tx2), std::max(ty1, ty2), std::max(tz1, tz2), maxDistance });
+
+		return enter <= exit ? enter : FLT_MAX;
+	}
+
+	// Which side of a plane a box is on: -1 behind it, 1 in front of it, 0 across it.
+	int ClassifyBox(const Box& box, const XMFLOAT4& plane)
+	{
+		float cx = (box.minimum.x + box.maximum.x) * 0.5f;
+		float cy = (box.minimum.y + box.maximum.y) * 0.5f;
+		float cz = (box.minimum.z + box.maximum.z) * 0.5f;
+		float ex = (box.maximum.x - box.minimum.x) * 0.5f;
+		float ey = (box.maximum.y - box.minimum.y) * 0.5f;
+		float ez = (box.maximum.z - box.minimum.z) * 0.5f;
+
+		float distance = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+		float reach = fabsf(plane.x) * ex + fabsf(plane.y) * ey + fabsf(plane.z) * ez;
+
+		return distance + reach < 0.0f ? -1 : distance - reach >= 0.0f ? 1 : 0;
+	}
+}
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy(float margin, float rebuildThreshold) : _root(INVALID_HANDLE), _freeList(INVALID_HANDLE), _count(0),
+	_margin(margin), _rebuildThreshold(rebuildThreshold), _internalArea(0.0), _builtCost(0.0f)
+{
+
+}
+
+unsigned int BoundingVolumeHierarchy::Insert(const Bounds& bounds, void* userData)
+{
+	unsigned int leaf = AllocateNode();
+	auto& node = _nodes[leaf];
+	node.tight = MakeBox(bounds);
+	node.box = Grow(node.tight, _margin);
+	node.height = 0;
+	node.userData = userData;
+
+	InsertLeaf(leaf);
+	_count++;
+
+	return leaf;
+}
+
+void BoundingVolumeHierarchy::Remove(unsigned int handle)
+{
+	if (!IsHandle(handle))
+	{
+		cout << "Cannot remove missing bounding volume " << handle << "." << endl;
+		return;
+	}
+
+	RemoveLeaf(handle);
+	FreeNode(handle);
+	_count--;
+}
+
+bool BoundingVolumeHierarchy::Update(unsigned int handle, const Bounds& bounds)
+{
+	if (!IsHandle(handle))
+	{
+		cout << "Cannot update missing bounding volume " << handle << "." << endl;
+		return false;
+	}
+
+	auto tight = MakeBox(bounds);
+	_nodes[handle].tight = tight;
+
+	if (Contains(_nodes[handle].box, tight))
+	{
+		return false;
+	}
+
+	auto box = Grow(tight, _margin);
+
+	// Refitting after a jump would leave every box above stretched between the old place and the new.
+	if (!Overlaps(_nodes[handle].box, box))
+	{
+		RemoveLeaf(handle);
+		_nodes[handle].box = box;
+		InsertLeaf(handle);
+	}
+	else
+	{
+		_nodes[handle].box = box;
+		Refit(_nodes[handle].parent, false);
+	}
+
+	return true;
+}
+
+void BoundingVolumeHierarchy::Rebuild()
+{
+	vector<unsigned int> leaves;
+	leaves.reserve(_count);
+
+	for (unsigned int i = 0; i < _nodes.size(); i++)
+	{
+		if (_nodes[i].height == 0)
+		{
+			leaves.push_back(i);
+		}
+		else if (_nodes[i].height > 0)
+		{
+			FreeNode(i);
+		}
+	}
+
+	// Starts again from nothing, so rounding doesn't build up.
+	_internalArea = 0.0;
+
+	_root = leaves.empty() ? INVALID_HANDLE : Build(leaves.data(), static_cast<unsigned int>(leaves.size()));
+	if (_root != INVALID_HANDLE)
+	{
+		_nodes[_root].parent = INVALID_HANDLE;
+	}
+
+	_builtCost = GetCost();
+}
+
+bool BoundingVolumeHierarchy::RebuildIfDegraded()
+{
+	if (GetCost() <= _builtCost * _rebuildThreshold)
+	{
+		return false;
+	}
+
+	Rebuild();
+	return true;
+}
+
+void BoundingVolumeHierarchy::Clear()
+{
+	_nodes.clear();
+	_root = INVALID_HANDLE;
+	_freeList = INVALID_HANDLE;
+	_count = 0;
+	_internalArea = 0.0;
+	_builtCost = 0.0f;
+}
+
+void BoundingVolumeHierarchy::QueryFrustum(const Frustum& frustum, vector<unsigned int>& handles) const
+{
+	handles.clear();
+
+	if (_root == INVALID_HANDLE)
+	{
+		return;
+	}
+
+	// Each node carries the planes it still has to be tested against.
+	const unsigned int ALL_PLANES = (1 << 6) - 1;
+
+	struct Entry
+	{
+		unsigned int node;
+		unsigned int planes;
+	};
+
+	vector<Entry> stack;
+	stack.reserve(64);
+	stack.push_back({ _root, ALL_PLANES });
+
+	// Leaves across a plane are gathered and culled together in SIMD batches once the walk is done.
+	FrustumCuller leaves;
+	vector<unsigned int> leafNodes;
+	vector<unsigned int> visible;
+
+	while (!stack.empty())
+	{
+		auto entry = stack.back();
+		stack.pop_back();
+
+		const auto& node = _nodes[entry.node];
+		bool leaf = node.height == 0;
+
+		if (leaf && entry.planes)
+		{
+			leaves.Add(GetBounds(entry.node));
+			leafNodes.push_back(entry.node);
+			continue;
+		}
+
+		const auto& box = leaf ? node.tight : node.box;
+
+		bool outside = false;
+		for (unsigned int i = 0; i < 6 && entry.planes && !outside; i++)
+		{
+			if (entry.planes & (1 << i))
+			{
+				int side = ClassifyBox(box, frustum.planes[i]);
+				outside = side < 0;
+				if (side > 0)
+				{
+					entry.planes &= ~(1 << i);
+				}
+			}
+		}
+
+		if (outside)
+		{
+			continue;
+		}
+
+		if (leaf)
+		{
+			handles.push_back(entry.node);
+		}
+		else
+		{
+			stack.push_back({ node.children[1], entry.planes });
+			stack.push_back({ node.children[0], entry.planes });
+		}
+	}
+
+	// Planes a leaf's parent was entirely inside are tested again, which the leaf passes as it is inside its parent.
+	leaves.Cull(frustum, visible);
+	for (auto index : visible)
+	{
+		handles.push_back(leafNodes[index]);
+	}
+}
+
+void BoundingVolumeHierarchy::QuerySphere(XMFLOAT3 center, float radius, vector<unsigned int>& handles) const
+{
+	handles.clear();
+
+	if (_root == INVALID_HANDLE)
+	{
+		return;
+	}
+
+	float radiusSq = radius * radius;
+
+	vector<unsigned int> stack;
+	stack.reserve(64);
+	stack.push_back(_root);
+
+	while (!stack.empty())
+	{
+		const auto& node = _nodes[stack.back()];
+		unsigned int index = stack.back();
+		stack.pop_back();
+
+		bool leaf = node.height == 0;
+		if (DistanceSq(leaf ? node.tight : node.box, center) > radiusSq)
+		{
+			continue;
+		}
+
+		if (leaf)
+		{
+			handles.push_back(index);
+		}
+		else
+		{
+			stack.push_back(node.children[1]);
+			stack.push_back(node.children[0]);
+		}
+	}
+}
+
+void BoundingVolumeHierarchy::QueryBounds(const Bounds& bounds, vector<unsigned int>& handles) const
+{
+	handles.clear();
+
+	if (_root == INVALID_HANDLE)
+	{
+		return;
+	}
+
+	auto query = MakeBox(bounds);
+
+	vector<unsigned int> stack;
+	stack.reserve(64);
+	stack.push_back(_root);
+
+	while (!stack.empty())
+	{
+		const auto& node = _nodes[stack.back()];
+		unsigned int index = stack.back();
+		stack.pop_back();
+
+		bool leaf = node.height == 0;
+		if (!Overlaps(leaf ? node.tight : node.box, query))
+		{
+			continue;
+		}
+
+		if (leaf)
+		{
+			handles.push_back(index);
+		}
+		else
+		{
+			stack.push_back(node.children[1]);
+			stack.push_back(node.children[0]);
+		}
+	}
+}
+
+unsigned int BoundingVolumeHierarchy::Raycast(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, float* distance) const
+{
+	unsigned int hit = INVALID_HANDLE;
+	float best = maxDistance;
+
+	if (_root == INVALID_HANDLE)
+	{
+		return hit;
+	}
+
+	// Axes the ray doesn't move along divide to infinity, which the slab test handles.
+	XMFLOAT3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	struct Entry
+	{
+		unsigned int node;
+		float enter;
+	};
+
+	float rootEnter = IntersectRay(_nodes[_root].box, origin, inverseDirection, best);
+	if (rootEnter == FLT_MAX)
+	{
+		return hit;
+	}
+
+	vector<Entry> stack;
+	stack.reserve(64);
+	stack.push_back({ _root, rootEnter });
+
+	while (!stack.empty())
+	{
+		auto entry = stack.back();
+		stack.pop_back();
+
+		// A closer hit may have been found since it was pushed.
+		if (entry.enter > best)
+		{
+			continue;
+		}
+
+		const auto& node = _nodes[entry.node];
+		if (node.height == 0)
+		{
+			// Misses are FLT_MAX, which an unbounded ray's best would otherwise accept.
+			float enter = IntersectRay(node.tight, origin, inverseDirection, best);
+			if (enter != FLT_MAX && enter <= best)
+			{
+				best = enter;
+				hit = entry.node;
+			}
+
+			continue;
+		}
+
+		float enter0 = IntersectRay(_nodes[node.children[0]].box, origin, inverseDirection, best);
+		float enter1 = IntersectRay(_nodes[node.children[1]].box, origin, inverseDirection, best);
+
+		// The nearer child is popped first.
+		bool nearFirst = enter0 <= enter1;
+		Entry children[2] = { { node.children[0], enter0 }, { node.children[1], enter1 } };
+
+		for (const auto& child : { children[nearFirst ? 1 : 0], children[nearFirst ? 0 : 1] })
+		{
+			if (child.enter != FLT_MAX)
+			{
+				stack.push_back(child);
+			}
+		}
+	}
+
+	if (distance && hit != INVALID_HANDLE)
+	{
+		*distance = best;
+	}
+
+	return hit;
+}
+
+void BoundingVolumeHierarchy::QueryNearest(XMFLOAT3 point, unsigned int count, vector<unsigned int>& handles, float maxDistance) const
+{
+	handles.clear();
+
+	if (_root == INVALID_HANDLE || count == 0)
+	{
+		return;
+	}
+
+	// Nodes by how close their boxes are. A node's box holds everything below it, so once a leaf is the
+	// closest thing left nothing still to be visited can be closer.
+	struct Entry
+	{
+		float distanceSq;
+		unsigned int node;
+
+		bool operator>(const Entry& other) const
+		{
+			return distanceSq > other.distanceSq;
+		}
+	};
+
+	float maxDistanceSq = maxDistance == FLT_MAX ? FLT_MAX : maxDistance * maxDistance;
+
+	std::priority_queue<Entry, vector<Entry>, std::greater<Entry>> open;
+	open.push({ DistanceSq(_nodes[_root].height == 0 ? _nodes[_root].tight : _nodes[_root].box, point), _root });
+
+	while (!open.empty() && handles.size() < count)
+	{
+		auto entry = open.top();
+		open.pop();
+
+		if (entry.distanceSq > maxDistanceSq)
+		{
+			break;
+		}
+
+		const auto& node = _nodes[entry.node];
+		if (node.height == 0)
+		{
+			handles.push_back(entry.node);
+			continue;
+		}
+
+		for (auto child : node.children)
+		{
+			const auto& childNode = _nodes[child];
+			open.push({ DistanceSq(childNode.height == 0 ? childNode.tight : childNode.box, point), child });
+		}
+	}
+}
+
+void* BoundingVolumeHierarchy::GetUserData(unsigned int handle) const
+{
+	return IsHandle(handle) ? _nodes[handle].userData : nullptr;
+}
+
+Bounds BoundingVolumeHierarchy::GetBounds(unsigned int handle) const
+{
+	Bounds bounds;
+	if (IsHandle(handle))
+	{
+		auto minimum = XMLoadFloat3(&_nodes[handle].tight.minimum);
+		auto maximum = XMLoadFloat3(&_nodes[handle].tight.maximum);
+		XMStoreFloat3(&bounds.center, (minimum + maximum) * 0.5f);
+		XMStoreFloat3(&bounds.extents, (maximum - minimum) * 0.5f);
+		bounds.radius = XMVectorGetX(XMVector3Length(maximum - minimum)) * 0.5f;
+	}
+
+	return bounds;
+}
+
+unsigned int BoundingVolumeHierarchy::GetCount() const
+{
+	return _count;
+}
+
+int BoundingVolumeHierarchy::GetHeight() const
+{
+	return _root != INVALID_HANDLE ? _nodes[_root].height : 0;
+}
+
+float BoundingVolumeHierarchy::GetCost() const
+{
+	if (_root == INVALID_HANDLE)
+	{
+		return 0.0f;
+	}
+
+	float rootArea = Area(_nodes[_root].box);
+	return rootArea > 0.0f ? static_cast<float>(_internalArea / rootArea) : 0.0f;
+}
+
+bool BoundingVolumeHierarchy::Validate() const
+{
+	if (_root == INVALID_HANDLE)
+	{
+		return _count == 0;
+	}
+
+	if (_nodes[_root].parent != INVALID_HANDLE)
+	{
+		return false;
+	}
+
+	unsigned int leaves = 0;
+	double area = 0.0;
+
+	vector<unsigned int> stack(1, _root);
+	while (!stack.empty())
+	{
+		unsigned int index = stack.back();
+		stack.pop_back();
+
+		const auto& node = _nodes[index];
+		if (node.height == 0)
+		{
+			leaves++;
+			if (!Contains(node.box, node.tight))
+			{
+				return false;
+			}
+
+			continue;
+		}
+
+		area += Area(node.box);
+
+		for (auto child : node.children)
+		{
+			if (child >= _nodes.size() || _nodes[child].parent != index || _nodes[child].height < 0 || !Contains(node.box, _nodes[child].box))
+			{
+				return false;
+			}
+
+			stack.push_back(child);
+		}
+
+		if (node.height != 1 + std::max(_nodes[node.children[0]].height, _nodes[node.children[1]].height))
+		{
+			return false;
+		}
+	}
+
+	return leaves == _count && fabs(area - _internalArea) <= 1e-3 * std::max(area, 1.0);
+}
+
+unsigned int BoundingVolumeHierarchy::AllocateNode()
+{
+	unsigned int index = _freeList;
+	if (index != INVALID_HANDLE)
+	{
+		_freeList = _nodes[index].parent;
+	}
+	else
+	{
+		index = static_cast<unsigned int>(_nodes.size());
+		_nodes.emplace_back();
+	}
+
+	auto& node = _nodes[index];
+	node.box = {};
+	node.tight = {};
+	node.parent = INVALID_HANDLE;
+	node.children[0] = INVALID_HANDLE;
+	node.children[1] = INVALID_HANDLE;
+	node.height = 0;
+	node.userData = nullptr;
+
+	return index;
+}
+
+void BoundingVolumeHierarchy::FreeNode(unsigned int index)
+{
+	auto& node = _nodes[index];
+	if (node.height > 0)
+	{
+		_internalArea -= Area(node.box);
+	}
+
+	node.height = -1;
+	node.parent = _freeList;
+	_freeList = index;
+}
+
+void BoundingVolumeHierarchy::SetBox(unsigned int index, const Box& box)
+{
+	auto& node = _nodes[index];
+	if (node.height > 0)
+	{
+		_internalArea += static_cast<double>(Area(box)) - Area(node.box);
+	}
+
+	node.box = box;
+}
+
+void BoundingVolumeHierarchy::InsertLeaf(unsigned int leaf)
+{
+	if (_root == INVALID_HANDLE)
+	{
+		_root = leaf;
+		_nodes[leaf].parent = INVALID_HANDLE;
+		return;
+	}
+
+	// Walk down to the sibling which adds the least area. Going down a child costs the area the leaf
+	// adds to every node on the way, stopping here costs a new parent the size of both.
+	auto leafBox = _nodes[leaf].box;
+	unsigned int index = _root;
+
+	while (_nodes[index].height > 0)
+	{
+		const auto& node = _nodes[index];
+
+		float area = Area(node.box);
+		float combinedArea = Area(Union(node.box, leafBox));
+
+		float cost = 2.0f * combinedArea;
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float childCosts[2];
+		for (int i = 0; i < 2; i++)
+		{
+			const auto& child = _nodes[node.children[i]];
+			float childArea = Area(Union(child.box, leafBox));
+			childCosts[i] = (child.height == 0 ? childArea : childArea - Area(child.box)) + inheritanceCost;
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1])
+		{
+			break;
+		}
+
+		index = childCosts[0] < childCosts[1] ? node.children[0] : node.children[1];
+	}
+
+	unsigned int sibling = index;
+	unsigned int oldParent = _nodes[sibling].parent;
+
+	unsigned int newParent = AllocateNode();
+	auto& parent = _nodes[newParent];
+	parent.parent = oldParent;
+	parent.children[0] = sibling;
+	parent.children[1] = leaf;
+	parent.height = _nodes[sibling].height + 1;
+	SetBox(newParent, Union(leafBox, _nodes[sibling].box));
+
+	if (oldParent != INVALID_HANDLE)
+	{
+		auto& children = _nodes[oldParent].children;
+		children[children[0] == sibling ? 0 : 1] = newParent;
+	}
+	else
+	{
+		_root = newParent;
+	}
+
+	_nodes[sibling].parent = newParent;
+	_nodes[leaf].parent = newParent;
+
+	Refit(_nodes[newParent].parent, true);
+}
+
+void BoundingVolumeHierarchy::RemoveLeaf(unsigned int leaf)
+{
+	if (leaf == _root)
+	{
+		_root = INVALID_HANDLE;
+		return;
+	}
+
+	unsigned int parent = _nodes[leaf].parent;
+	unsigned int grandParent = _nodes[parent].parent;
+	unsigned int sibling = _nodes[parent].children[_nodes[parent].children[0] == leaf ? 1 : 0];
+
+	// The sibling takes the parent's place.
+	_nodes[sibling].parent = grandParent;
+	FreeNode(parent);
+
+	if (grandParent != INVALID_HANDLE)
+	{
+		auto& children = _nodes[grandParent].children;
+		children[children[0] == parent ? 0 : 1] = sibling;
+
+		Refit(grandParent, true);
+	}
+	else
+	{
+		_root = sibling;
+	}
+}
+
+void BoundingVolumeHierarchy::Refit(unsigned int index, bool balance)
+{
+	while (index != INVALID_HANDLE)
+	{
+		if (balance)
+		{
+			index = Balance(index);
+		}
+
+		auto& node = _nodes[index];
+		const auto& child0 = _nodes[node.children[0]];
+		const auto& child1 = _nodes[node.children[1]];
+
+		node.height = 1 + std::max(child0.height, child1.height);
+		SetBox(index, Union(child0.box, child1.box));
+
+		index = node.parent;
+	}
+}
+
+unsigned int BoundingVolumeHierarchy::Balance(unsigned int index)
+{
+	auto& a = _nodes[index];
+	if (a.height < 2)
+	{
+		return index;
+	}
+
+	int difference = _nodes[a.children[1]].height - _nodes[a.children[0]].height;
+	if (difference >= -1 && difference <= 1)
+	{
+		return index;
+	}
+
+	// The taller child takes this node's place. It keeps its own taller child and hands its shorter one down to this node.
+	int taller = difference > 0 ? 1 : 0;
+	unsigned int up = a.children[taller];
+	auto& b = _nodes[up];
+
+	unsigned int keep = b.children[0];
+	unsigned int give = b.children[1];
+	if (_nodes[keep].height < _nodes[give].height)
+	{
+		std::swap(keep, give);
+	}
+
+	b.parent = a.parent;
+	if (b.parent != INVALID_HANDLE)
+	{
+		auto& children = _nodes[b.parent].children;
+		children[children[0] == index ? 0 : 1] = up;
+	}
+	else
+	{
+		_root = up;
+	}
+
+	b.children[0] = index;
+	b.children[1] = keep;
+	a.parent = up;
+
+	a.children[taller] = give;
+	_nodes[give].parent = index;
+
+	const auto& other = _nodes[a.children[1 - taller]];
+	a.height = 1 + std::max(other.height, _nodes[give].height);
+	SetBox(index, Union(other.box, _nodes[give].box));
+
+	b.height = 1 + std::max(a.height, _nodes[keep].height);
+	SetBox(up, Union(a.box, _nodes[keep].box));
+
+	return up;
+}
+
+unsigned int BoundingVolumeHierarchy::Build(unsigned int* leaves, unsigned int count)
+{
+	if (count == 1)
+	{
+		return leaves[0];
+	}
+
+	// Bin the leaves by centroid along the axis they are most spread over.
+	Box centroids = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const auto& box = _nodes[leaves[i]].box;
+		XMFLOAT3 centroid(Centroid(box, 0), Centroid(box, 1), Centroid(box, 2));
+		centroids = Union(centroids, { centroid, centroid });
+	}
+
+	XMFLOAT3 spread(centroids.maximum.x - centroids.minimum.x, centroids.maximum.y - centroids.minimum.y, centroids.maximum.z - centroids.minimum.z);
+	int axis = spread.x >= spread.y && spread.x >= spread.z ? 0 : spread.y >= spread.z ? 1 : 2;
+
+	float axisMinimum = GetAxis(centroids.minimum, axis);
+	float axisSpread = GetAxis(spread, axis);
+
+	unsigned int split = count / 2;
+
+	if (axisSpread > 0.0f)
+	{
+		float scale = BIN_COUNT / axisSpread;
+		auto binOf = [&](unsigned int leaf)
+		{
+			return std::min(BIN_COUNT - 1, static_cast<unsigned int>((Centroid(_nodes[leaf].box, axis) - axisMinimum) * scale));
+		};
+
+		Box binBoxes[BIN_COUNT];
+		unsigned int binCounts[BIN_COUNT] = {};
+		for (auto& box : binBoxes)
+		{
+			box = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+		}
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int bin = binOf(leaves[i]);
+			binBoxes[bin] = Union(binBoxes[bin], _nodes[leaves[i]].box);
+			binCounts[bin]++;
+		}
+
+		// Cost of splitting after each bin, the area of each side times the leaves in it.
+		float rightCosts[BIN_COUNT] = {};
+		Box right = binBoxes[BIN_COUNT - 1];
+		unsigned int rightCount = binCounts[BIN_COUNT - 1];
+		for (unsigned int bin = BIN_COUNT - 1; bin > 0; bin--)
+		{
+			rightCosts[bin - 1] = rightCount ? Area(right) * rightCount : 0.0f;
+			right = Union(right, binBoxes[bin - 1]);
+			rightCount += binCounts[bin - 1];
+		}
+
+		float bestCost = FLT_MAX;
+		unsigned int bestBin = BIN_COUNT;
+		Box left = binBoxes[0];
+		unsigned int leftCount = 0;
+		for (unsigned int bin = 0; bin + 1 < BIN_COUNT; bin++)
+		{
+			if (bin > 0)
+			{
+				left = Union(left, binBoxes[bin]);
+			}
+
+			leftCount += binCounts[bin];
+			if (leftCount == 0 || leftCount == count)
+			{
+				continue;
+			}
+
+			float cost = Area(left) * leftCount + rightCosts[bin];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestBin = bin;
+			}
+		}
+
+		if (bestBin < BIN_COUNT)
+		{
+			auto middle = std::partition(leaves, leaves + count, [&](unsigned int leaf) { return binOf(leaf) <= bestBin; });
+			split = static_cast<unsigned int>(middle - leaves);
+		}
+	}
+
+	// Leaves which can't be told apart are split in half.
+	if (split == 0 || split == count || axisSpread <= 0.0f)
+	{
+		split = count / 2;
+		std::nth_element(leaves, leaves + split, leaves + count,
+			[&](unsigned int a, unsigned int b) { return Centroid(_nodes[a].box, axis) < Centroid(_nodes[b].box, axis); });
+	}
+
+	unsigned int index = AllocateNode();
+	unsigned int child0 = Build(leaves, split);
+	unsigned int child1 = Build(leaves + split, count - split);
+
+	auto& node = _nodes[index];
+	node.children[0] = child0;
+	node.children[1] = child1;
+	node.height = 1 + std::max(_nodes[child0].height, _nodes[child1].height);
+	SetBox(index, Union(_nodes[child0].box, _nodes[child1].box));
+
+	_nodes[child0].parent = index;
+	_nodes[child1].parent = index;
+
+	return index;
+}
+
+bool BoundingVolumeHierarchy::IsLeaf(unsigned int index) const
+{
+	return _nodes[index].height == 0;
+}
+
+bool BoundingVolumeHierarchy::IsHandle(unsigned int handle) const
+{
+	return handle < _nodes.size() && IsLeaf(handle);
+}
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cfloat>
+#include <vector>
+#include "FrustumCulling.h"
+
+namespace TinyEngine
+{
+	// A binary tree of axis aligned boxes over objects which come, go and move, for finding what is in view,
+	// near a point or hit by a ray without visiting every object.
+	//
+	// Every object is a leaf, found by the handle Insert returns. A leaf's box is its bounds grown by a margin,
+	// so small moves change nothing. Inserting picks the sibling which adds the least surface area (SAH) and
+	// the path back to the root is rotated to keep it balanced, as in Box2D's dynamic tree. Moving a leaf past
+	// its margin refits the boxes above it without restructuring, which is cheap but slowly loosens the tree;
+	// RebuildIfDegraded rebuilds it top down with a binned SAH once its cost has grown enough.
+	// Doesn't touch any device, so it can be used and tested on its own.
+	class BoundingVolumeHierarchy
+	{
+	public:
+		// How boxes are stored, by their corners.
+		struct Box
+		{
+			DirectX::XMFLOAT3 minimum;
+			DirectX::XMFLOAT3 maximum;
+		};
+
+	private:
+		struct Node
+		{
+			// Union of the children, or a leaf's bounds grown by the margin.
+			Box box;
+			// A leaf's bounds as they were given, which queries test.
+			Box tight;
+			// Next free node while the node is free.
+			unsigned int parent;
+			// INVALID_HANDLE for leaves.
+			unsigned int children[2];
+			// 0 for leaves, -1 while the node is free.
+			int height;
+			void* userData;
+		};
+
+		std::vector<Node> _nodes;
+		unsigned int _root;
+		unsigned int _freeList;
+		unsigned int _count;
+
+		float _margin;
+		float _rebuildThreshold;
+
+		// Sum of the internal nodes' surface areas, kept as boxes change, and the cost of the tree when it was last rebuilt.
+		double _internalArea;
+		float _builtCost;
+
+	public:
+		static const unsigned int INVALID_HANDLE = ~0u;
+
+		// Construct an empty BoundingVolumeHierarchy.
+		//	float margin: How far a leaf's box reaches past its bounds, in world units
+		//	float rebuildThreshold: How many times its cost after the last rebuild the tree may reach before
+		//		RebuildIfDegraded rebuilds it
+		BoundingVolumeHierarchy(float margin = 0.1f, float rebuildThreshold = 1.5f);
+		~BoundingVolumeHierarchy() = default;
+
+		BoundingVolumeHierarchy(const BoundingVolumeHierarchy&) = delete;
+
+		// Add an object.
+		//	const Bounds& bounds: Bounds of the object, only the box is used
+		//	void* userData: Anything to find the object by, see GetUserData
+		//	returns: Handle of the object's leaf
+		unsigned int Insert(const Bounds& bounds, void* userData);
+
+		// Remove an object.
+		//	unsigned int handle: From Insert
+		void Remove(unsigned int handle);
+
+		// Move an object. Nothing changes while the bounds stay inside its margin, past that the boxes above it
+		// are refit, or it is reinserted if it has moved away from where it was altogether.
+		//	unsigned int handle: From Insert
+		//	const Bounds& bounds: New bounds of the object
+		//	returns: true if any box of the tree changed
+		bool Update(unsigned int handle, const Bounds& bounds);
+
+		// Rebuild every internal node top down, splitting where the surface area heuristic is lowest.
+		// Handles stay the same.
+		void Rebuild();
+
+		// Rebuild if the cost has grown past the threshold since the last rebuild.
+		//	returns: true if the tree was rebuilt
+		bool RebuildIfDegraded();
+
+		// Remove every object.
+		void Clear();
+
+		// Find the objects whose boxes are at least partly inside a frustum. Subtrees entirely inside are
+		// taken whole and planes a node is entirely inside aren't tested again below it. Leaves still across
+		// a plane are culled together with a FrustumCuller, 8 at a time.
+		//	const Frustum& frustum: Frustum to cull against
+		//	std::vector<unsigned int>& handles: Receives the handles of the objects, cleared first
+		void QueryFrustum(const Frustum& frustum, std::vector<unsigned int>& handles) const;
+
+		// Find the objects whose boxes touch a sphere.
+		//	DirectX::XMFLOAT3 center: Center of the sphere
+		//	float radius: Radius of the sphere
+		//	std::vector<unsigned int>& handles: Receives the handles of the objects, cleared first
+		void QuerySphere(DirectX::XMFLOAT3 center, float radius, std::vector<unsigned int>& handles) const;
+
+		// Find the objects whose boxes overlap a box.
+		//	const Bounds& bounds: Box to test against
+		//	std::vector<unsigned int>& handles: Receives the handles of the objects, cleared first
+		void QueryBounds(const Bounds& bounds, std::vector<unsigned int>& handles) const;
+
+		// Find the first object whose box a ray hits, visiting nearer nodes first and skipping any further than the best hit.
+		//	DirectX::XMFLOAT3 origin: Start of the ray
+		//	DirectX::XMFLOAT3 direction: Direction of the ray, distances are in multiples of its length
+		//	float maxDistance: Furthest the ray reaches
+		//	float* distance: Receives how far along the ray the box was hit, 0 if the ray starts inside it. Optional
+		//	returns: Handle of the object, INVALID_HANDLE if nothing was hit
+		unsigned int Raycast(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, float* distance = nullptr) const;
+
+		// Find the objects whose boxes are closest to a point, visiting the closest nodes first.
+		//	DirectX::XMFLOAT3 point: Point to measure from, objects whose boxes contain it are 0 away
+		//	unsigned int count: Most objects to find
+		//	std::vector<unsigned int>& handles: Receives the handles of the objects, closest first, cleared first
+		//	float maxDistance: Ignore objects further than this
+		void QueryNearest(DirectX::XMFLOAT3 point, unsigned int count, std::vector<unsigned int>& handles, float maxDistance = FLT_MAX) const;
+
+		void* GetUserData(unsigned int handle) const;
+
+		// Bounds of an object's box, as they were last given.
+		Bounds GetBounds(unsigned int handle) const;
+
+		// Number of objects.
+		unsigned int GetCount() const;
+
+		// Longest path from the root to a leaf, 0 for a single leaf.
+		int GetHeight() const;
+
+		// Surface area heuristic cost: the summed surface areas of the internal nodes over the root's,
+		// proportional to the expected nodes a random ray visits.
+		float GetCost() const;
+
+		// Check every link, height and box of the tree, used to test it.
+		//	returns: false if anything is wrong
+		bool Validate() const;
+
+	private:
+		unsigned int AllocateNode();
+		void FreeNode(unsigned int index);
+
+		// Set a node's box, keeping _internalArea up to date.
+		void SetBox(unsigned int index, const Box& box);
+
+		void InsertLeaf(unsigned int leaf);
+		void RemoveLeaf(unsigned int leaf);
+
+		// Refit the boxes and heights of a node and every node above it, optionally rotating to balance them.
+		void Refit(unsigned int index, bool balance);
+
+		// Rotate a node's taller child up into its place if its children's heights differ by more than one.
+		//	returns: The node now in its place
+		unsigned int Balance(unsigned int index);
+
+		// Build internal nodes over some leaves.
+		//	returns: Root of the subtree
+		unsigned int Build(unsigned int* leaves, unsigned int count);
+
+		bool IsLeaf(unsigned int index) const;
+		bool IsHandle(unsigned int handle) const;
+	};
+}
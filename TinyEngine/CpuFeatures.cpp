@@ -0,0 +1,41 @@
+#include "CpuFeatures.h"
+
+#ifdef _MSC_VER
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+bool TinyEngine::HasAvx2()
+{
+	static const bool supported = []()
+	{
+#if !defined(TINY_ENGINE_AVX2)
+		return false;
+#elif defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7)
+		{
+			return false;
+		}
+
+		// AVX and OSXSAVE, then the OS must have enabled saving the SSE and AVX registers.
+		__cpuid(info, 1);
+		const int avx = 1 << 28;
+		const int osxsave = 1 << 27;
+		if ((info[2] & (avx | osxsave)) != (avx | osxsave) || (_xgetbv(0) & 6) != 6)
+		{
+			return false;
+		}
+
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__)
+		return __builtin_cpu_supports("avx2") != 0;
+#else
+		return false;
+#endif
+	}();
+
+	return supported;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+// Defined where AVX2 paths can be compiled into a build which targets SSE2: MSVC accepts AVX2 intrinsics
+// whatever /arch is set to, other compilers only when the whole build targets AVX2. Those paths must only
+// run when HasAvx2 returns true.
+#if defined(_MSC_VER) || defined(__AVX2__)
+#define TINY_ENGINE_AVX2
+#endif
+
+namespace TinyEngine
+{
+	// Can the AVX2 paths run? They must be compiled in, the CPU support AVX2 and the OS save the 256 bit
+	// registers. Checked once, the first call.
+	bool HasAvx2();
+}
@@ -0,0 +1,279 @@
+#include "DdsFile.h"
+#include "MappedFile.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace TinyEngine;
+
+using std::cout;
+using std::endl;
+
+namespace
+{
+	const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+
+	const uint32_t DDSD_CAPS = 0x1;
+	const uint32_t DDSD_HEIGHT = 0x2;
+	const uint32_t DDSD_WIDTH = 0x4;
+	const uint32_t DDSD_PIXELFORMAT = 0x1000;
+	const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+	const uint32_t DDSD_LINEARSIZE = 0x80000;
+
+	const uint32_t DDSCAPS_COMPLEX = 0x8;
+	const uint32_t DDSCAPS_TEXTURE = 0x1000;
+	const uint32_t DDSCAPS_MIPMAP = 0x400000;
+
+	const uint32_t DDPF_FOURCC = 0x4;
+	const uint32_t DDPF_RGB = 0x40;
+
+	// Cube maps and volumes are flagged in caps2.
+	const uint32_t DDSCAPS2_CUBEMAP_OR_VOLUME = 0x200 | 0x200000;
+
+	const uint32_t RESOURCE_DIMENSION_TEXTURE2D = 3;
+
+	// DXGI_FORMAT values, so this file doesn't need the D3D headers.
+	const uint32_t DXGI_RGBA8_UNORM = 28;
+	const uint32_t DXGI_BC1_UNORM = 71;
+	const uint32_t DXGI_BC3_UNORM = 77;
+	const uint32_t DXGI_BC5_UNORM = 83;
+	const uint32_t DXGI_BC7_UNORM = 98;
+
+	constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+	}
+
+	bool FromDxgiFormat(uint32_t dxgiFormat, TextureFormat& format)
+	{
+		switch (dxgiFormat)
+		{
+		case DXGI_RGBA8_UNORM:
+			format = TextureFormat::RGBA8;
+			return true;
+		case DXGI_BC1_UNORM:
+			format = TextureFormat::BC1;
+			return true;
+		case DXGI_BC3_UNORM:
+			format = TextureFormat::BC3;
+			return true;
+		case DXGI_BC5_UNORM:
+			format = TextureFormat::BC5;
+			return true;
+		case DXGI_BC7_UNORM:
+			format = TextureFormat::BC7;
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	uint32_t ToDxgiFormat(TextureFormat format)
+	{
+		switch (format)
+		{
+		case TextureFormat::BC1:
+			return DXGI_BC1_UNORM;
+		case TextureFormat::BC3:
+			return DXGI_BC3_UNORM;
+		case TextureFormat::BC5:
+			return DXGI_BC5_UNORM;
+		case TextureFormat::BC7:
+			return DXGI_BC7_UNORM;
+		default:
+			return DXGI_RGBA8_UNORM;
+		}
+	}
+
+	// Work out the format of a file without a DX10 header.
+	bool FromLegacyPixelFormat(const DdsPixelFormat& pixelFormat, TextureFormat& format)
+	{
+		if (pixelFormat.flags & DDPF_FOURCC)
+		{
+			switch (pixelFormat.fourCC)
+			{
+			case MakeFourCC('D', 'X', 'T', '1'):
+				format = TextureFormat::BC1;
+				return true;
+			case MakeFourCC('D', 'X', 'T', '5'):
+				format = TextureFormat::BC3;
+				return true;
+			case MakeFourCC('A', 'T', 'I', '2'):
+			case MakeFourCC('B', 'C', '5', 'U'):
+				format = TextureFormat::BC5;
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		bool rgba = (pixelFormat.flags & DDPF_RGB) && pixelFormat.rgbBitCount == 32
+			&& pixelFormat.rBitMask == 0x000000ff && pixelFormat.gBitMask == 0x0000ff00 && pixelFormat.bBitMask == 0x00ff0000;
+
+		if (rgba)
+		{
+			format = TextureFormat::RGBA8;
+			return true;
+		}
+
+		return false;
+	}
+
+	// Map a .dds and lay out its levels without reading them.
+	//	size_t& dataOffset: Receives where the first level starts in the file
+	bool OpenDds(MappedFile& file, const char* path, TextureData& layout, size_t& dataOffset)
+	{
+		if (!file.Open(path))
+		{
+			cout << "Could not open texture file: " << path << endl;
+			return false;
+		}
+
+		const char* data = file.GetData();
+		size_t size = file.GetSize();
+		size_t offset = sizeof(uint32_t) + sizeof(DdsHeader);
+
+		if (size < offset)
+		{
+			cout << "Texture file is too small: " << path << endl;
+			return false;
+		}
+
+		uint32_t magic;
+		DdsHeader header;
+		memcpy(&magic, data, sizeof(magic));
+		memcpy(&header, data + sizeof(magic), sizeof(header));
+
+		if (magic != DDS_MAGIC || header.size != sizeof(DdsHeader) || header.pixelFormat.size != sizeof(DdsPixelFormat))
+		{
+			cout << "Texture file is not a .dds: " << path << endl;
+			return false;
+		}
+
+		TextureFormat format;
+		bool supported = !(header.caps2 & DDSCAPS2_CUBEMAP_OR_VOLUME);
+
+		if ((header.pixelFormat.flags & DDPF_FOURCC) && header.pixelFormat.fourCC == MakeFourCC('D', 'X', '1', '0'))
+		{
+			if (size < offset + sizeof(DdsHeaderDx10))
+			{
+				cout << "Texture file is too small: " << path << endl;
+				return false;
+			}
+
+			DdsHeaderDx10 dx10;
+			memcpy(&dx10, data + offset, sizeof(dx10));
+			offset += sizeof(dx10);
+
+			supported = supported && FromDxgiFormat(dx10.dxgiFormat, format)
+				&& dx10.resourceDimension == RESOURCE_DIMENSION_TEXTURE2D && dx10.arraySize == 1;
+		}
+		else
+		{
+			supported = supported && FromLegacyPixelFormat(header.pixelFormat, format);
+		}
+
+		unsigned int levelCount = (header.flags & DDSD_MIPMAPCOUNT) && header.mipMapCount > 0 ? header.mipMapCount : 1;
+
+		if (!supported || header.width == 0 || header.height == 0 || levelCount > GetMipLevelCount(header.width, header.height))
+		{
+			cout << "Texture file holds an unsupported format or layout: " << path << endl;
+			return false;
+		}
+
+		layout.format = format;
+		layout.data.clear();
+		size_t levelBytes = LayoutTextureLevels(layout, header.width, header.height, levelCount);
+
+		if (size - offset < levelBytes)
+		{
+			cout << "Texture file is corrupt: " << path << endl;
+			layout.levels.clear();
+			return false;
+		}
+
+		dataOffset = offset;
+		return true;
+	}
+}
+
+bool TinyEngine::ReadDds(const char* path, TextureData& texture, unsigned int firstLevel)
+{
+	MappedFile file;
+	TextureData layout;
+	size_t dataOffset;
+	if (!OpenDds(file, path, layout, dataOffset))
+	{
+		return false;
+	}
+
+	if (firstLevel >= layout.levels.size())
+	{
+		cout << "Texture file has no level " << firstLevel << ": " << path << endl;
+		return false;
+	}
+
+	// Levels are stored largest first, so the ones wanted are a single run at the end of the file.
+	const auto& first = layout.levels[firstLevel];
+	texture.format = layout.format;
+	AllocateTextureLevels(texture, first.width, first.height, static_cast<unsigned int>(layout.levels.size()) - firstLevel);
+
+	memcpy(texture.data.data(), file.GetData() + dataOffset + first.offset, texture.data.size());
+
+	return true;
+}
+
+bool TinyEngine::ReadDdsLayout(const char* path, TextureData& layout)
+{
+	MappedFile file;
+	size_t dataOffset;
+	return OpenDds(file, path, layout, dataOffset);
+}
+
+bool TinyEngine::WriteDds(const char* path, const TextureData& texture)
+{
+	if (texture.levels.empty())
+	{
+		cout << "Can't write a texture with no levels: " << path << endl;
+		return false;
+	}
+
+	DdsHeader header = {};
+	header.size = sizeof(DdsHeader);
+	header.flags = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+	header.width = texture.levels[0].width;
+	header.height = texture.levels[0].height;
+	header.pitchOrLinearSize = static_cast<uint32_t>(texture.levels[0].size);
+	header.mipMapCount = static_cast<uint32_t>(texture.levels.size());
+	header.pixelFormat.size = sizeof(DdsPixelFormat);
+	header.pixelFormat.flags = DDPF_FOURCC;
+	header.pixelFormat.fourCC = MakeFourCC('D', 'X', '1', '0');
+	header.caps = DDSCAPS_TEXTURE | DDSCAPS_MIPMAP | DDSCAPS_COMPLEX;
+
+	DdsHeaderDx10 dx10 = {};
+	dx10.dxgiFormat = ToDxgiFormat(texture.format);
+	dx10.resourceDimension = RESOURCE_DIMENSION_TEXTURE2D;
+	dx10.arraySize = 1;
+
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		cout << "Could not open texture file for writing: " << path << endl;
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(&dx10), sizeof(dx10));
+
+	// Levels are laid out back to back in TextureData just as they are in the file.
+	file.write(reinterpret_cast<const char*>(texture.data.data()), static_cast<std::streamsize>(texture.data.size()));
+
+	if (!file.good())
+	{
+		cout << "Failed to write texture file: " << path << endl;
+		return false;
+	}
+
+	return true;
+}
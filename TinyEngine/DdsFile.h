@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include "TextureData.h"
+
+namespace TinyEngine
+{
+	// The parts of a .dds file's headers which TinyEngine reads and writes.
+	// A .dds is the "DDS " magic, a DdsHeader, a DdsHeaderDx10 if the pixel format's fourCC is "DX10",
+	// then every level's texels largest first, tightly packed.
+	struct DdsPixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t rBitMask;
+		uint32_t gBitMask;
+		uint32_t bBitMask;
+		uint32_t aBitMask;
+	};
+
+	struct DdsHeader
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DdsPixelFormat pixelFormat;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct DdsHeaderDx10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+
+	// Read a 2D texture and its mips out of a .dds file.
+	// Reads RGBA8, BC1, BC3, BC5 and BC7 with a DX10 header, and the legacy DXT1, DXT5, ATI2 and 32 bit RGBA layouts.
+	//	const char* path: Path to the file
+	//	TextureData& texture: Receives the texture's levels
+	//	unsigned int firstLevel: Largest level to read, the levels before it are skipped and texture starts at it
+	//	returns: false if the file could not be opened, is corrupt, has no firstLevel or holds something other than a supported 2D texture
+	bool ReadDds(const char* path, TextureData& texture, unsigned int firstLevel = 0);
+
+	// Read the format and level sizes of a .dds file without reading its texels.
+	//	const char* path: Path to the file
+	//	TextureData& layout: Receives the format and levels, its data is left empty
+	//	returns: false if ReadDds would fail to read the file
+	bool ReadDdsLayout(const char* path, TextureData& layout);
+
+	// Write a texture and its mips to a .dds file with a DX10 header.
+	//	const char* path: Path to write to
+	//	const TextureData& texture: Texture to write
+	//	returns: false if the file could not be written
+	bool WriteDds(const char* path, const TextureData& texture);
+}
@@ -0,0 +1,338 @@
+#include "DerivedDataCache.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+using namespace TinyEngine;
+
+using std::cout;
+using std::endl;
+using std::string;
+
+namespace fs = std::filesystem;
+
+namespace
+{
+	const char* ENTRY_EXTENSION = ".ddc";
+	const char* WRITE_EXTENSION = ".tmp";
+
+	const uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+	const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+	const uint64_t PRIME3 = 0x165667B19E3779F9ull;
+	const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ull;
+	const uint64_t PRIME5 = 0x27D4EB2F165667C5ull;
+
+	inline uint64_t RotateLeft(uint64_t value, int bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	inline uint64_t Read64(const unsigned char* p)
+	{
+		uint64_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline uint32_t Read32(const unsigned char* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline uint64_t Round(uint64_t accumulator, uint64_t input)
+	{
+		accumulator += input * PRIME2;
+		accumulator = RotateLeft(accumulator, 31);
+		return accumulator * PRIME1;
+	}
+
+	inline uint64_t MergeRound(uint64_t accumulator, uint64_t value)
+	{
+		accumulator ^= Round(0, value);
+		return accumulator * PRIME1 + PRIME4;
+	}
+
+	// Keys are written as 16 hex digits.
+	bool ParseKey(const string& name, uint64_t& key)
+	{
+		if (name.size() != 16)
+		{
+			return false;
+		}
+
+		key = 0;
+		for (char c : name)
+		{
+			int digit = c >= '0' && c <= '9' ? c - '0' : c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+			if (digit < 0)
+			{
+				return false;
+			}
+			key = (key << 4) | static_cast<uint64_t>(digit);
+		}
+
+		return true;
+	}
+}
+
+uint64_t TinyEngine::HashBytes(const void* data, size_t size, uint64_t seed)
+{
+	const auto* p = static_cast<const unsigned char*>(data);
+	const auto* end = p + size;
+
+	uint64_t hash;
+
+	// Four independent lanes of 8 bytes keep the multipliers busy on long inputs.
+	if (size >= 32)
+	{
+		uint64_t lanes[4] = { seed + PRIME1 + PRIME2, seed + PRIME2, seed, seed - PRIME1 };
+
+		const auto* limit = end - 32;
+		do
+		{
+			for (int lane = 0; lane < 4; lane++, p += 8)
+			{
+				lanes[lane] = Round(lanes[lane], Read64(p));
+			}
+		} while (p <= limit);
+
+		hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+		for (auto lane : lanes)
+		{
+			hash = MergeRound(hash, lane);
+		}
+	}
+	else
+	{
+		hash = seed + PRIME5;
+	}
+
+	hash += size;
+
+	for (; p + 8 <= end; p += 8)
+	{
+		hash ^= Round(0, Read64(p));
+		hash = RotateLeft(hash, 27) * PRIME1 + PRIME4;
+	}
+
+	if (p + 4 <= end)
+	{
+		hash ^= static_cast<uint64_t>(Read32(p)) * PRIME1;
+		hash = RotateLeft(hash, 23) * PRIME2 + PRIME3;
+		p += 4;
+	}
+
+	for (; p < end; p++)
+	{
+		hash ^= *p * PRIME5;
+		hash = RotateLeft(hash, 11) * PRIME1;
+	}
+
+	hash ^= hash >> 33;
+	hash *= PRIME2;
+	hash ^= hash >> 29;
+	hash *= PRIME3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+bool TinyEngine::HashFile(const char* path, uint64_t& hash, uint64_t seed)
+{
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		return false;
+	}
+
+	hash = HashBytes(file.GetData(), file.GetSize(), seed);
+	return true;
+}
+
+DerivedDataCache::DerivedDataCache(const char* directory, uint64_t maxBytes) : _directory(directory), _maxBytes(maxBytes), _nextWrite(0)
+{
+	std::error_code error;
+	fs::create_directories(_directory, error);
+
+	struct Found
+	{
+		uint64_t key;
+		uint64_t size;
+		fs::file_time_type lastUsed;
+	};
+
+	std::vector<Found> found;
+	for (fs::directory_iterator it(_directory, error), end; !error && it != end; it.increment(error))
+	{
+		const auto& path = it->path();
+
+		// Entries which were being written when the game last exited are incomplete.
+		if (path.extension() == WRITE_EXTENSION)
+		{
+			fs::remove(path, error);
+			continue;
+		}
+
+		uint64_t key;
+		if (path.extension() == ENTRY_EXTENSION && ParseKey(path.stem().string(), key))
+		{
+			found.push_back({ key, static_cast<uint64_t>(fs::file_size(path, error)), fs::last_write_time(path, error) });
+		}
+	}
+
+	std::sort(found.begin(), found.end(), [](const Found& a, const Found& b) { return a.lastUsed > b.lastUsed; });
+
+	for (const auto& entry : found)
+	{
+		_recent.push_back(entry.key);
+		_entries[entry.key] = { entry.size, std::prev(_recent.end()) };
+		_stats.bytes += entry.size;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	Evict();
+}
+
+bool DerivedDataCache::Find(uint64_t key, string& path)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto entry = _entries.find(key);
+	if (entry == _entries.end())
+	{
+		_stats.misses++;
+		return false;
+	}
+
+	_stats.hits++;
+	_recent.splice(_recent.begin(), _recent, entry->second.recent);
+
+	path = GetEntryPath(key);
+
+	// Keeps the order for the next run. Failing to is harmless, the entry just looks older.
+	std::error_code error;
+	fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+
+	return true;
+}
+
+string DerivedDataCache::GetWritePath(uint64_t key)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	// Numbered so two workers producing the same key don't write over each other.
+	fs::path path(GetEntryPath(key));
+	path.replace_extension(std::to_string(_nextWrite++) + WRITE_EXTENSION);
+
+	return path.string();
+}
+
+bool DerivedDataCache::Commit(uint64_t key, const string& writtenPath)
+{
+	std::error_code error;
+	auto size = static_cast<uint64_t>(fs::file_size(writtenPath, error));
+	if (error)
+	{
+		cout << "Could not add to the derived data cache, " << writtenPath << " is missing." << endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	if (size > _maxBytes)
+	{
+		fs::remove(writtenPath, error);
+		return false;
+	}
+
+	auto existing = _entries.find(key);
+	if (existing != _entries.end())
+	{
+		RemoveEntry(existing);
+	}
+
+	auto path = GetEntryPath(key);
+	fs::rename(writtenPath, path, error);
+	if (error)
+	{
+		cout << "Could not add " << path << " to the derived data cache: " << error.message() << endl;
+		fs::remove(writtenPath, error);
+		return false;
+	}
+
+	_recent.push_front(key);
+	_entries[key] = { size, _recent.begin() };
+	_stats.bytes += size;
+	_stats.stores++;
+
+	Evict();
+
+	return true;
+}
+
+void DerivedDataCache::Remove(uint64_t key)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto entry = _entries.find(key);
+	if (entry != _entries.end())
+	{
+		RemoveEntry(entry);
+	}
+}
+
+uint64_t DerivedDataCache::GetMaxBytes() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _maxBytes;
+}
+
+void DerivedDataCache::SetMaxBytes(uint64_t maxBytes)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_maxBytes = maxBytes;
+	Evict();
+}
+
+DerivedDataCacheStats DerivedDataCache::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	auto stats = _stats;
+	stats.entries = static_cast<unsigned int>(_entries.size());
+	return stats;
+}
+
+string DerivedDataCache::GetEntryPath(uint64_t key) const
+{
+	char name[17];
+	snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+
+	return (fs::path(_directory) / (string(name) + ENTRY_EXTENSION)).string();
+}
+
+void DerivedDataCache::Evict()
+{
+	while (_stats.bytes > _maxBytes && !_recent.empty())
+	{
+		RemoveEntry(_entries.find(_recent.back()));
+		_stats.evictions++;
+	}
+}
+
+void DerivedDataCache::RemoveEntry(std::unordered_map<uint64_t, Entry>::iterator entry)
+{
+	// A file which is still mapped can't be deleted on Windows. It is left for the next run to index.
+	std::error_code error;
+	fs::remove(GetEntryPath(entry->first), error);
+
+	_stats.bytes -= entry->second.size;
+	_recent.erase(entry->second.recent);
+	_entries.erase(entry);
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace TinyEngine
+{
+	// Hash a block of memory to 64 bits with xxHash64.
+	//	const void* data: Bytes to hash
+	//	size_t size: Number of bytes
+	//	uint64_t seed: Starting value, pass a previous hash to chain several inputs together
+	uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+	// Hash the contents of a file with HashBytes.
+	//	const char* path: File to hash
+	//	uint64_t& hash: Receives the hash
+	//	uint64_t seed: Starting value, see HashBytes
+	//	returns: false if the file could not be opened
+	bool HashFile(const char* path, uint64_t& hash, uint64_t seed = 0);
+
+	struct DerivedDataCacheStats
+	{
+		unsigned int hits = 0;
+		unsigned int misses = 0;
+		unsigned int stores = 0;
+		unsigned int evictions = 0;
+
+		// What is in the cache now.
+		unsigned int entries = 0;
+		uint64_t bytes = 0;
+	};
+
+	// An on disk cache of data derived from source assets, such as decoded textures and imported meshes.
+	// Entries are named by a key hashed from everything that went into them, usually the source file's
+	// contents and the import settings, so a changed source or setting simply misses and stale entries
+	// age out. Once the cache is larger than its limit the least recently used entries are deleted.
+	// Entries are whole files in whatever format their producer writes, eg. .dds or .tmesh, which can be
+	// read back in place. Safe to use from several threads.
+	class DerivedDataCache
+	{
+	private:
+		struct Entry
+		{
+			uint64_t size;
+			// Position in _recent.
+			std::list<uint64_t>::iterator recent;
+		};
+
+		std::string _directory;
+		uint64_t _maxBytes;
+
+		mutable std::mutex _mutex;
+		std::unordered_map<uint64_t, Entry> _entries;
+		// Keys from most to least recently used.
+		std::list<uint64_t> _recent;
+		unsigned int _nextWrite;
+		DerivedDataCacheStats _stats;
+
+	public:
+		static constexpr uint64_t DEFAULT_MAX_BYTES = 1024ull * 1024 * 1024;
+
+		// Construct a DerivedDataCache, creating its directory or indexing the entries already in it.
+		// Entries are ordered by their files' modification times, which are updated whenever they are used.
+		//	const char* directory: Directory holding the entries
+		//	uint64_t maxBytes: Size the cache is kept under
+		DerivedDataCache(const char* directory, uint64_t maxBytes = DEFAULT_MAX_BYTES);
+		~DerivedDataCache() = default;
+
+		DerivedDataCache(const DerivedDataCache&) = delete;
+
+		// Look up an entry, marking it as the most recently used. Counts a hit or a miss.
+		//	uint64_t key: Key of the entry
+		//	std::string& path: Receives the entry's file if there is one
+		//	returns: true if the cache holds the key
+		bool Find(uint64_t key, std::string& path);
+
+		// Get a path to write a new entry to. The file isn't part of the cache until it is committed.
+		//	uint64_t key: Key of the entry which will be written
+		std::string GetWritePath(uint64_t key);
+
+		// Move a written file into the cache, replacing any entry with the same key, then evict least
+		// recently used entries until the cache fits its limit. A file larger than the limit is deleted.
+		//	uint64_t key: Key of the entry
+		//	const std::string& writtenPath: File from GetWritePath which has been written
+		//	returns: false if the file could not be moved into the cache
+		bool Commit(uint64_t key, const std::string& writtenPath);
+
+		// Delete an entry, eg. because it couldn't be read. Its files may still be in use and stay on disk
+		// until the next time the cache is opened.
+		//	uint64_t key: Key of the entry
+		void Remove(uint64_t key);
+
+		// Get the size limit in bytes.
+		uint64_t GetMaxBytes() const;
+
+		// Change the size limit, evicting entries if the cache no longer fits.
+		//	uint64_t maxBytes: Size the cache is kept under
+		void SetMaxBytes(uint64_t maxBytes);
+
+		DerivedDataCacheStats GetStats() const;
+
+		// Path an entry is kept at, whether or not the cache holds it. Doesn't count as a lookup.
+		//	uint64_t key: Key of the entry
+		std::string GetEntryPath(uint64_t key) const;
+
+	private:
+		// Delete least recently used entries until the cache fits. _mutex must be held.
+		void Evict();
+
+		// Forget an entry and delete its file. _mutex must be held.
+		void RemoveEntry(std::unordered_map<uint64_t, Entry>::iterator entry);
+	};
+}
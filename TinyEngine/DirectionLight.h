@@ -0,0 +1,14 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+namespace TinyEngine
+{
+	// Represents a light source at infinity. Behaves like the sun.
+	struct DirectionLight
+	{
+		DirectX::XMFLOAT4 color;
+		DirectX::XMFLOAT3 direction;
+		float _pad;
+	};
+}
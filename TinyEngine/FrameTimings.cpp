@@ -0,0 +1,85 @@
+#include "FrameTimings.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace TinyEngine;
+using std::vector;
+
+void FrameTimings::AddFrame(float update, float submit, float present, float frame)
+{
+	_seconds[static_cast<unsigned int>(FramePhase::UPDATE)].push_back(update);
+	_seconds[static_cast<unsigned int>(FramePhase::SUBMIT)].push_back(submit);
+	_seconds[static_cast<unsigned int>(FramePhase::PRESENT)].push_back(present);
+	_seconds[static_cast<unsigned int>(FramePhase::FRAME)].push_back(frame);
+}
+
+unsigned int FrameTimings::GetFrameCount() const
+{
+	return static_cast<unsigned int>(_seconds[0].size());
+}
+
+FramePhaseSummary FrameTimings::Summarize(FramePhase phase) const
+{
+	FramePhaseSummary summary;
+
+	vector<float> sorted = _seconds[static_cast<unsigned int>(phase)];
+	if (sorted.empty())
+	{
+		return summary;
+	}
+
+	std::sort(sorted.begin(), sorted.end());
+
+	double sum = 0.0;
+	for (float seconds : sorted)
+	{
+		sum += seconds;
+	}
+
+	// Smallest sample at least the given fraction of the samples are no slower than.
+	auto percentile = [&sorted](double fraction)
+	{
+		auto rank = static_cast<size_t>(std::ceil(fraction * static_cast<double>(sorted.size())));
+		return static_cast<double>(sorted[std::min(std::max<size_t>(rank, 1), sorted.size()) - 1]);
+	};
+
+	summary.mean = sum / static_cast<double>(sorted.size()) * 1000.0;
+	summary.p50 = percentile(0.50) * 1000.0;
+	summary.p99 = percentile(0.99) * 1000.0;
+	summary.max = static_cast<double>(sorted.back()) * 1000.0;
+
+	return summary;
+}
+
+void FrameTimings::WriteJson(std::ostream& out) const
+{
+	out << "{\"frames\": " << GetFrameCount();
+
+	for (unsigned int i = 0; i < PHASE_COUNT; i++)
+	{
+		auto phase = static_cast<FramePhase>(i);
+		auto summary = Summarize(phase);
+
+		out << ", \"" << GetPhaseName(phase) << "\": {\"mean_ms\": " << summary.mean << ", \"p50_ms\": " << summary.p50
+			<< ", \"p99_ms\": " << summary.p99 << ", \"max_ms\": " << summary.max << "}";
+	}
+
+	out << "}";
+}
+
+const char* FrameTimings::GetPhaseName(FramePhase phase)
+{
+	switch (phase)
+	{
+	case FramePhase::UPDATE:
+		return "update";
+	case FramePhase::SUBMIT:
+		return "submit";
+	case FramePhase::PRESENT:
+		return "present";
+	case FramePhase::FRAME:
+		return "frame";
+	}
+
+	return "unknown";
+}
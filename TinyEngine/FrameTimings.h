@@ -0,0 +1,64 @@
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+namespace TinyEngine
+{
+	// Parts of a frame TinyEngineGame times.
+	enum class FramePhase
+	{
+		// Uploading assets, reading input and the game's OnUpdate, which queues its draws.
+		UPDATE,
+		// Clearing and submitting every draw queued to the device.
+		SUBMIT,
+		// Presenting, or waiting for the GPU without a window.
+		PRESENT,
+		// The whole frame.
+		FRAME
+	};
+
+	// Summary of one phase over every frame, in milliseconds.
+	struct FramePhaseSummary
+	{
+		double mean = 0.0;
+		double p50 = 0.0;
+		double p99 = 0.0;
+		double max = 0.0;
+	};
+
+	// Seconds each phase of a number of frames took, summarized as their mean and percentiles.
+	// Doesn't touch any device, so it can be used and tested on its own.
+	class FrameTimings
+	{
+	public:
+		static const unsigned int PHASE_COUNT = 4;
+
+	private:
+		// Seconds of every frame, per phase.
+		std::vector<float> _seconds[PHASE_COUNT];
+
+	public:
+		// Add a frame.
+		//	float update: Seconds spent in FramePhase::UPDATE
+		//	float submit: Seconds spent in FramePhase::SUBMIT
+		//	float present: Seconds spent in FramePhase::PRESENT
+		//	float frame: Seconds the whole frame took, at least the sum of the others
+		void AddFrame(float update, float submit, float present, float frame);
+
+		unsigned int GetFrameCount() const;
+
+		// Summarize a phase. Percentiles are the nearest rank, so p99 of fewer than 100 frames is the slowest frame.
+		//	FramePhase phase: Phase to summarize
+		//	returns: All zeros if no frames were added
+		FramePhaseSummary Summarize(FramePhase phase) const;
+
+		// Write every phase's summary as a JSON object, e.g.
+		// {"frames": 2, "update": {"mean_ms": 1.5, "p50_ms": 1, "p99_ms": 2, "max_ms": 2}, "submit": {...}, ...}
+		//	std::ostream& out: Stream to write to
+		void WriteJson(std::ostream& out) const;
+
+		// Name of a phase as WriteJson writes it.
+		static const char* GetPhaseName(FramePhase phase);
+	};
+}
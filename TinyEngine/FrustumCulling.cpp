@@ -0,0 +1,306 @@
+#include "FrustumCulling.h"
+#include "CpuFeatures.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <immintrin.h>
+
+using namespace TinyEngine;
+using namespace DirectX;
+
+using std::vector;
+
+namespace
+{
+	Bounds MakeBounds(XMVECTOR minimum, XMVECTOR maximum)
+	{
+		Bounds bounds;
+		XMStoreFloat3(&bounds.center, (minimum + maximum) * 0.5f);
+		XMStoreFloat3(&bounds.extents, (maximum - minimum) * 0.5f);
+		return bounds;
+	}
+
+	// Append the indices of the set bits of a lane mask.
+	inline void AppendVisible(int mask, unsigned int first, vector<unsigned int>& visible)
+	{
+		while (mask)
+		{
+			unsigned int lane = 0;
+			while (!(mask & (1 << lane)))
+			{
+				lane++;
+			}
+
+			visible.push_back(first + lane);
+			mask &= mask - 1;
+		}
+	}
+}
+
+Bounds TinyEngine::ComputeBounds(const XMFLOAT3* positions, unsigned int count)
+{
+	if (count == 0)
+	{
+		return Bounds();
+	}
+
+	XMVECTOR minimum = XMVectorReplicate(FLT_MAX);
+	XMVECTOR maximum = XMVectorReplicate(-FLT_MAX);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		auto position = XMLoadFloat3(&positions[i]);
+		minimum = XMVectorMin(minimum, position);
+		maximum = XMVectorMax(maximum, position);
+	}
+
+	auto bounds = MakeBounds(minimum, maximum);
+
+	// The farthest point from the box's center, which is tighter than the box's corners.
+	XMVECTOR center = XMLoadFloat3(&bounds.center);
+	XMVECTOR radiusSq = XMVectorZero();
+	for (unsigned int i = 0; i < count; i++)
+	{
+		radiusSq = XMVectorMax(radiusSq, XMVector3LengthSq(XMLoadFloat3(&positions[i]) - center));
+	}
+
+	bounds.radius = sqrtf(XMVectorGetX(radiusSq));
+
+	return bounds;
+}
+
+Bounds TinyEngine::ComputeBounds(const XMFLOAT3* positions, const unsigned int* indices, unsigned int indexCount)
+{
+	if (indexCount == 0)
+	{
+		return Bounds();
+	}
+
+	XMVECTOR minimum = XMVectorReplicate(FLT_MAX);
+	XMVECTOR maximum = XMVectorReplicate(-FLT_MAX);
+	for (unsigned int i = 0; i < indexCount; i++)
+	{
+		auto position = XMLoadFloat3(&positions[indices[i]]);
+		minimum = XMVectorMin(minimum, position);
+		maximum = XMVectorMax(maximum, position);
+	}
+
+	auto bounds = MakeBounds(minimum, maximum);
+
+	XMVECTOR center = XMLoadFloat3(&bounds.center);
+	XMVECTOR radiusSq = XMVectorZero();
+	for (unsigned int i = 0; i < indexCount; i++)
+	{
+		radiusSq = XMVectorMax(radiusSq, XMVector3LengthSq(XMLoadFloat3(&positions[indices[i]]) - center));
+	}
+
+	bounds.radius = sqrtf(XMVectorGetX(radiusSq));
+
+	return bounds;
+}
+
+Bounds TinyEngine::TransformBounds(const Bounds& bounds, FXMMATRIX transform)
+{
+	Bounds result;
+
+	XMStoreFloat3(&result.center, XMVector3TransformCoord(XMLoadFloat3(&bounds.center), transform));
+
+	// Each axis of the new box is as long as the old box's axes projected onto it (Arvo).
+	XMVECTOR extents = XMLoadFloat3(&bounds.extents);
+	XMVECTOR newExtents = XMVectorAbs(transform.r[0]) * XMVectorSplatX(extents)
+		+ XMVectorAbs(transform.r[1]) * XMVectorSplatY(extents)
+		+ XMVectorAbs(transform.r[2]) * XMVectorSplatZ(extents);
+	XMStoreFloat3(&result.extents, newExtents);
+
+	float scaleSq = std::max({
+		XMVectorGetX(XMVector3LengthSq(transform.r[0])),
+		XMVectorGetX(XMVector3LengthSq(transform.r[1])),
+		XMVectorGetX(XMVector3LengthSq(transform.r[2])) });
+	result.radius = bounds.radius * sqrtf(scaleSq);
+
+	return result;
+}
+
+Frustum TinyEngine::MakeFrustum(FXMMATRIX transform)
+{
+	Frustum frustum;
+
+	// Columns of the matrix are rows of its transpose.
+	XMMATRIX columns = XMMatrixTranspose(transform);
+
+	XMVECTOR planes[6] = {
+		columns.r[3] + columns.r[0],
+		columns.r[3] - columns.r[0],
+		columns.r[3] + columns.r[1],
+		columns.r[3] - columns.r[1],
+		columns.r[2],
+		columns.r[3] - columns.r[2]
+	};
+
+	for (int i = 0; i < 6; i++)
+	{
+		XMStoreFloat4(&frustum.planes[i], XMPlaneNormalize(planes[i]));
+	}
+
+	return frustum;
+}
+
+FrustumCuller::FrustumCuller() : _count(0)
+{
+
+}
+
+void FrustumCuller::Clear()
+{
+	_count = 0;
+
+	for (auto* component : { &_centerX, &_centerY, &_centerZ, &_extentX, &_extentY, &_extentZ })
+	{
+		component->clear();
+	}
+}
+
+void FrustumCuller::Reserve(unsigned int count)
+{
+	size_t padded = (static_cast<size_t>(count) + BATCH_SIZE - 1) / BATCH_SIZE * BATCH_SIZE;
+
+	for (auto* component : { &_centerX, &_centerY, &_centerZ, &_extentX, &_extentY, &_extentZ })
+	{
+		component->reserve(padded);
+	}
+}
+
+unsigned int FrustumCuller::Add(const Bounds& bounds)
+{
+	// Kept a whole number of batches long, so Cull never reads past the end. The padding is never reported.
+	if (_count == _centerX.size())
+	{
+		for (auto* component : { &_centerX, &_centerY, &_centerZ, &_extentX, &_extentY, &_extentZ })
+		{
+			component->resize(_count + BATCH_SIZE, 0.0f);
+		}
+	}
+
+	_centerX[_count] = bounds.center.x;
+	_centerY[_count] = bounds.center.y;
+	_centerZ[_count] = bounds.center.z;
+	_extentX[_count] = bounds.extents.x;
+	_extentY[_count] = bounds.extents.y;
+	_extentZ[_count] = bounds.extents.z;
+
+	return _count++;
+}
+
+unsigned int FrustumCuller::GetCount() const
+{
+	return _count;
+}
+
+void FrustumCuller::Cull(const Frustum& frustum, vector<unsigned int>& visible) const
+{
+	visible.clear();
+
+	// A box is behind a plane when its center is further behind it than the box reaches towards it:
+	//	dot(n, c) + w < -dot(|n|, e)
+	// Every batch is tested against all 6 planes, branching is slower than the few extra instructions.
+	const float* cx = _centerX.data();
+	const float* cy = _centerY.data();
+	const float* cz = _centerZ.data();
+	const float* ex = _extentX.data();
+	const float* ey = _extentY.data();
+	const float* ez = _extentZ.data();
+
+#ifdef TINY_ENGINE_AVX2
+	bool avx2 = HasAvx2();
+#endif
+
+	for (unsigned int first = 0; first < _count; first += BATCH_SIZE)
+	{
+		int mask = 0;
+
+#ifdef TINY_ENGINE_AVX2
+		if (avx2)
+		{
+			__m256 centerX = _mm256_loadu_ps(cx + first);
+			__m256 centerY = _mm256_loadu_ps(cy + first);
+			__m256 centerZ = _mm256_loadu_ps(cz + first);
+			__m256 extentX = _mm256_loadu_ps(ex + first);
+			__m256 extentY = _mm256_loadu_ps(ey + first);
+			__m256 extentZ = _mm256_loadu_ps(ez + first);
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (const auto& plane : frustum.planes)
+			{
+				__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(_mm256_set1_ps(plane.x), centerX),
+					_mm256_mul_ps(_mm256_set1_ps(plane.y), centerY)),
+					_mm256_mul_ps(_mm256_set1_ps(plane.z), centerZ)),
+					_mm256_set1_ps(plane.w));
+				__m256 reach = _mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(_mm256_set1_ps(fabsf(plane.x)), extentX),
+					_mm256_mul_ps(_mm256_set1_ps(fabsf(plane.y)), extentY)),
+					_mm256_mul_ps(_mm256_set1_ps(fabsf(plane.z)), extentZ));
+
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), _mm256_setzero_ps(), _CMP_GE_OQ));
+			}
+
+			mask = _mm256_movemask_ps(inside);
+		}
+		else
+#endif
+		for (unsigned int half = 0; half < BATCH_SIZE; half += 4)
+		{
+			__m128 centerX = _mm_loadu_ps(cx + first + half);
+			__m128 centerY = _mm_loadu_ps(cy + first + half);
+			__m128 centerZ = _mm_loadu_ps(cz + first + half);
+			__m128 extentX = _mm_loadu_ps(ex + first + half);
+			__m128 extentY = _mm_loadu_ps(ey + first + half);
+			__m128 extentZ = _mm_loadu_ps(ez + first + half);
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (const auto& plane : frustum.planes)
+			{
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(_mm_set1_ps(plane.x), centerX),
+					_mm_mul_ps(_mm_set1_ps(plane.y), centerY)),
+					_mm_mul_ps(_mm_set1_ps(plane.z), centerZ)),
+					_mm_set1_ps(plane.w));
+				__m128 reach = _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(_mm_set1_ps(fabsf(plane.x)), extentX),
+					_mm_mul_ps(_mm_set1_ps(fabsf(plane.y)), extentY)),
+					_mm_mul_ps(_mm_set1_ps(fabsf(plane.z)), extentZ));
+
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+			}
+
+			mask |= _mm_movemask_ps(inside) << half;
+		}
+
+		// Drop the padding of the last batch.
+		unsigned int lanes = std::min(BATCH_SIZE, _count - first);
+		mask &= (1 << lanes) - 1;
+
+		AppendVisible(mask, first, visible);
+	}
+}
+
+void FrustumCuller::CullReference(const Frustum& frustum, vector<unsigned int>& visible) const
+{
+	visible.clear();
+
+	for (unsigned int i = 0; i < _count; i++)
+	{
+		bool inside = true;
+		for (const auto& plane : frustum.planes)
+		{
+			float distance = plane.x * _centerX[i] + plane.y * _centerY[i] + plane.z * _centerZ[i] + plane.w;
+			float reach = fabsf(plane.x) * _extentX[i] + fabsf(plane.y) * _extentY[i] + fabsf(plane.z) * _extentZ[i];
+
+			inside = inside && distance + reach >= 0.0f;
+		}
+
+		if (inside)
+		{
+			visible.push_back(i);
+		}
+	}
+}
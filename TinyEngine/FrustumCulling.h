@@ -0,0 +1,93 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+namespace TinyEngine
+{
+	// An axis aligned box and a sphere around the same points, sharing a center.
+	struct Bounds
+	{
+		DirectX::XMFLOAT3 center = { 0.0f, 0.0f, 0.0f };
+		// Half the size of the box along each axis.
+		DirectX::XMFLOAT3 extents = { 0.0f, 0.0f, 0.0f };
+		// Radius of the sphere, never more than the length of extents.
+		float radius = 0.0f;
+	};
+
+	// The planes of a view volume.
+	struct Frustum
+	{
+		// Normalized, a point is inside when dot(plane.xyz, p) + plane.w >= 0. Left, right, bottom, top, near, far.
+		DirectX::XMFLOAT4 planes[6];
+	};
+
+	// Bound some points.
+	//	const DirectX::XMFLOAT3* positions: Points to bound
+	//	unsigned int count: Number of points, empty bounds if 0
+	Bounds ComputeBounds(const DirectX::XMFLOAT3* positions, unsigned int count);
+
+	// Bound the points some indices reference.
+	//	const DirectX::XMFLOAT3* positions: Points the indices reference
+	//	const unsigned int* indices: Indices of the points to bound
+	//	unsigned int indexCount: Number of indices, empty bounds if 0
+	Bounds ComputeBounds(const DirectX::XMFLOAT3* positions, const unsigned int* indices, unsigned int indexCount);
+
+	// Move bounds through a transform. The box grows to hold the rotated box and the sphere is scaled by
+	// the largest scale of the transform.
+	//	const Bounds& bounds: Bounds to move
+	//	DirectX::FXMMATRIX transform: Transform to move them by, eg. a world matrix
+	Bounds TransformBounds(const Bounds& bounds, DirectX::FXMMATRIX transform);
+
+	// Pull the planes of the clip volume back through a transform (Gribb and Hartmann). Pass view * projection
+	// for world space planes, or world * view * projection for an object's own space.
+	//	DirectX::FXMMATRIX transform: Transform into clip space
+	Frustum MakeFrustum(DirectX::FXMMATRIX transform);
+
+	// Culls many bounding boxes against a frustum at once. Boxes are stored as separate arrays of each
+	// component, so a batch of 8 is tested with a handful of AVX instructions, or as two halves with SSE on
+	// CPUs without AVX2.
+	// Only the boxes are tested, spheres are never tighter.
+	// Doesn't touch any device, so it can be used and tested on its own.
+	class FrustumCuller
+	{
+	private:
+		static const unsigned int BATCH_SIZE = 8;
+
+		std::vector<float> _centerX;
+		std::vector<float> _centerY;
+		std::vector<float> _centerZ;
+		std::vector<float> _extentX;
+		std::vector<float> _extentY;
+		std::vector<float> _extentZ;
+		unsigned int _count;
+
+	public:
+		FrustumCuller();
+		~FrustumCuller() = default;
+
+		FrustumCuller(const FrustumCuller&) = delete;
+
+		// Remove every box, keeping the memory for the next frame's.
+		void Clear();
+
+		// Make room for a number of boxes.
+		void Reserve(unsigned int count);
+
+		// Add a box to cull.
+		//	const Bounds& bounds: Bounds whose box is culled
+		//	returns: Index of the box, the order they were added in
+		unsigned int Add(const Bounds& bounds);
+
+		unsigned int GetCount() const;
+
+		// Find the boxes which are at least partly inside a frustum. A box is outside when it is entirely
+		// behind any one plane, so a few large boxes near the corners are kept when they needn't be.
+		//	const Frustum& frustum: Frustum to cull against
+		//	std::vector<unsigned int>& visible: Receives the indices of visible boxes in increasing order, cleared first
+		void Cull(const Frustum& frustum, std::vector<unsigned int>& visible) const;
+
+		// Scalar version of Cull, finds the same boxes. Used to check the SIMD path.
+		void CullReference(const Frustum& frustum, std::vector<unsigned int>& visible) const;
+	};
+}
@@ -0,0 +1,172 @@
+#define TINY_ENGINE_EXPOSE_NATIVE
+#include "GeometryArena.h"
+#include <algorithm>
+#include <iostream>
+
+using namespace TinyEngine;
+
+using std::cout;
+using std::endl;
+
+GeometryArena::GeometryArena(IRenderer* renderer, unsigned int vertexCapacity, unsigned int indexCapacity)
+	: _renderer(renderer), _rebuildCount(0)
+{
+	_vertexPools[static_cast<int>(VertexFormat::STANDARD)].stride = sizeof(VertexStandard);
+	_vertexPools[static_cast<int>(VertexFormat::PACKED)].stride = sizeof(VertexPacked);
+
+	for (auto& pool : _vertexPools)
+	{
+		pool.bindFlags = D3D11_BIND_VERTEX_BUFFER;
+		pool.initialCapacity = vertexCapacity;
+	}
+
+	_indexPool.stride = sizeof(unsigned int);
+	_indexPool.bindFlags = D3D11_BIND_INDEX_BUFFER;
+	_indexPool.initialCapacity = indexCapacity;
+}
+
+unsigned int GeometryArena::AllocateVertices(VertexFormat format, const void* vertices, unsigned int numVertices)
+{
+	return Allocate(_vertexPools[static_cast<int>(format)], vertices, numVertices);
+}
+
+void GeometryArena::FreeVertices(VertexFormat format, unsigned int allocation)
+{
+	_vertexPools[static_cast<int>(format)].allocator.Free(allocation);
+}
+
+unsigned int GeometryArena::GetVertexOffset(VertexFormat format, unsigned int allocation) const
+{
+	return _vertexPools[static_cast<int>(format)].allocator.GetOffset(allocation);
+}
+
+unsigned int GeometryArena::AllocateIndices(const unsigned int* indices, unsigned int numIndices)
+{
+	return Allocate(_indexPool, indices, numIndices);
+}
+
+void GeometryArena::FreeIndices(unsigned int allocation)
+{
+	_indexPool.allocator.Free(allocation);
+}
+
+unsigned int GeometryArena::GetIndexOffset(unsigned int allocation) const
+{
+	return _indexPool.allocator.GetOffset(allocation);
+}
+
+void GeometryArena::Defragment()
+{
+	for (auto* pool : { &_vertexPools[0], &_vertexPools[1], &_indexPool })
+	{
+		if (pool->buffer && pool->allocator.GetFreeRangeCount() > 1)
+		{
+			Rebuild(*pool, pool->allocator.GetCapacity());
+		}
+	}
+}
+
+GeometryArenaStats GeometryArena::GetStats() const
+{
+	GeometryArenaStats stats;
+	stats.rebuildCount = _rebuildCount;
+
+	for (const auto* pool : { &_vertexPools[0], &_vertexPools[1], &_indexPool })
+	{
+		if (!pool->buffer)
+		{
+			continue;
+		}
+
+		stats.bufferCount++;
+		stats.capacityBytes += static_cast<size_t>(pool->allocator.GetCapacity()) * pool->stride;
+		stats.allocatedBytes += static_cast<size_t>(pool->allocator.GetAllocatedSize()) * pool->stride;
+		stats.allocationCount += pool->allocator.GetAllocationCount();
+		stats.freeRangeCount += pool->allocator.GetFreeRangeCount();
+	}
+
+	return stats;
+}
+
+unsigned int GeometryArena::Allocate(Pool& pool, const void* data, unsigned int count)
+{
+	auto allocation = pool.allocator.Allocate(count);
+
+	if (allocation == RangeAllocator::INVALID_HANDLE)
+	{
+		auto& allocator = pool.allocator;
+
+		// Compacting is enough if there is room in total, otherwise at least double so growth stays amortized.
+		unsigned int capacity = allocator.GetCapacity();
+		if (allocator.GetFreeSize() < count)
+		{
+			capacity = std::max(std::max(capacity * 2, allocator.GetAllocatedSize() + count), pool.initialCapacity);
+		}
+
+		if (!Rebuild(pool, capacity))
+		{
+			return RangeAllocator::INVALID_HANDLE;
+		}
+
+		allocation = allocator.Allocate(count);
+	}
+
+	if (count > 0)
+	{
+		D3D11_BOX box = {};
+		box.left = pool.allocator.GetOffset(allocation) * pool.stride;
+		box.right = box.left + count * pool.stride;
+		box.bottom = 1;
+		box.back = 1;
+
+		_renderer->GetImmediateContext()->UpdateSubresource(pool.buffer.Get(), 0, &box, data, 0, 0);
+	}
+
+	return allocation;
+}
+
+bool GeometryArena::Rebuild(Pool& pool, unsigned int capacity)
+{
+	D3D11_BUFFER_DESC bd;
+	bd.ByteWidth = capacity * pool.stride;
+	bd.Usage = D3D11_USAGE_DEFAULT;
+	bd.BindFlags = pool.bindFlags;
+	bd.CPUAccessFlags = NULL;
+	bd.MiscFlags = NULL;
+	bd.StructureByteStride = 0;
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+
+	HRESULT hr;
+	hr = _renderer->GetDevice()->CreateBuffer(&bd, nullptr, &buffer);
+	if (FAILED(hr))
+	{
+		cout << "Failed to create Geometry Arena Buffer of " << bd.ByteWidth << " bytes." << endl;
+		return false;
+	}
+
+	pool.allocator.Defragment(_moves);
+	pool.allocator.Grow(capacity);
+
+	// Copy into a new buffer, a buffer can't copy onto an overlapping range of itself.
+	if (pool.buffer)
+	{
+		auto context = _renderer->GetImmediateContext();
+
+		for (const auto& move : _moves)
+		{
+			D3D11_BOX box = {};
+			box.left = move.from * pool.stride;
+			box.right = box.left + move.size * pool.stride;
+			box.bottom = 1;
+			box.back = 1;
+
+			context->CopySubresourceRegion(buffer.Get(), 0, move.to * pool.stride, 0, 0, pool.buffer.Get(), 0, &box);
+		}
+	}
+
+	pool.buffer = buffer;
+	_rebuildCount++;
+
+	return true;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <d3d11.h>
+#include <vector>
+#include <wrl/client.h>
+#include "IRenderer.h"
+#include "Mesh.h"
+#include "RangeAllocator.h"
+
+namespace TinyEngine
+{
+	// How full a GeometryArena's buffers are.
+	struct GeometryArenaStats
+	{
+		unsigned int bufferCount = 0;
+		size_t capacityBytes = 0;
+		size_t allocatedBytes = 0;
+		unsigned int allocationCount = 0;
+		unsigned int freeRangeCount = 0;
+		// Times a buffer was reallocated to grow or defragment.
+		unsigned int rebuildCount = 0;
+	};
+
+	// Shared vertex and index buffers which every Mesh suballocates from, so drawing
+	// many meshes doesn't need a buffer per mesh and part.
+	// There is one vertex buffer per VertexFormat and one 32 bit index buffer. When an allocation
+	// doesn't fit, the buffer is defragmented, and grown if that isn't enough. Allocations are
+	// referred to by handle because both move them, look their offsets up when drawing.
+	class GeometryArena
+	{
+	private:
+		struct Pool
+		{
+			Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+			RangeAllocator allocator;
+			unsigned int stride;
+			unsigned int bindFlags;
+			unsigned int initialCapacity;
+		};
+
+		IRenderer* _renderer;
+
+		Pool _vertexPools[2];
+		Pool _indexPool;
+
+		unsigned int _rebuildCount;
+
+		std::vector<RangeMove> _moves;
+
+	public:
+		static const unsigned int DEFAULT_VERTEX_CAPACITY = 1 << 16;
+		static const unsigned int DEFAULT_INDEX_CAPACITY = 1 << 18;
+
+		// Construct a GeometryArena. Buffers are created on first use.
+		//	IRenderer* renderer: Renderer this is associated with
+		//	unsigned int vertexCapacity: Vertices each vertex buffer starts with room for
+		//	unsigned int indexCapacity: Indices the index buffer starts with room for
+		GeometryArena(IRenderer* renderer, unsigned int vertexCapacity = DEFAULT_VERTEX_CAPACITY, unsigned int indexCapacity = DEFAULT_INDEX_CAPACITY);
+		~GeometryArena() = default;
+
+		GeometryArena(const GeometryArena&) = delete;
+
+		// Copy vertices into the arena.
+		//	VertexFormat format: Type of the vertices, VertexStandard or VertexPacked
+		//	const void* vertices: Array of vertex data
+		//	unsigned int numVertices: Number of vertices in the array
+		//	returns: Handle of the vertices, RangeAllocator::INVALID_HANDLE if the buffer couldn't grow
+		unsigned int AllocateVertices(VertexFormat format, const void* vertices, unsigned int numVertices);
+
+		void FreeVertices(VertexFormat format, unsigned int allocation);
+
+		// First vertex of an allocation, use it as part of the base vertex when drawing.
+		unsigned int GetVertexOffset(VertexFormat format, unsigned int allocation) const;
+
+		// Copy indices into the arena.
+		//	const unsigned int* indices: Array of indices
+		//	unsigned int numIndices: Number of indices in the array
+		//	returns: Handle of the indices, RangeAllocator::INVALID_HANDLE if the buffer couldn't grow
+		unsigned int AllocateIndices(const unsigned int* indices, unsigned int numIndices);
+
+		void FreeIndices(unsigned int allocation);
+
+		// First index of an allocation, add it to the start index when drawing.
+		unsigned int GetIndexOffset(unsigned int allocation) const;
+
+		// Pack every buffer's allocations together, for example after unloading a level.
+		void Defragment();
+
+		GeometryArenaStats GetStats() const;
+
+#ifdef TINY_ENGINE_EXPOSE_NATIVE
+		Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer(VertexFormat format) const
+		{
+			return _vertexPools[static_cast<int>(format)].buffer;
+		}
+
+		Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer() const
+		{
+			return _indexPool.buffer;
+		}
+#endif
+
+	private:
+		unsigned int Allocate(Pool& pool, const void* data, unsigned int count);
+
+		// Reallocate a pool's buffer with its allocations packed together.
+		//	returns: false if the new buffer couldn't be created, the pool is left as it was
+		bool Rebuild(Pool& pool, unsigned int capacity);
+	};
+}
@@ -0,0 +1,105 @@
+#include "MappedFile.h"
+#include <iostream>
+
+using std::cout;
+using std::endl;
+
+TinyEngine::MappedFile::MappedFile() : _file(INVALID_HANDLE_VALUE), _mapping(nullptr), _data(nullptr), _size(0)
+{
+}
+
+TinyEngine::MappedFile::MappedFile(const char* path) : MappedFile()
+{
+	Open(path);
+}
+
+TinyEngine::MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool TinyEngine::MappedFile::Open(const char* path)
+{
+	Close();
+
+	_file = CreateFile(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size = {};
+	if (!GetFileSizeEx(_file, &size))
+	{
+		cout << "Could not get the size of: " << path << endl;
+		Close();
+
+		return false;
+	}
+
+	_size = static_cast<size_t>(size.QuadPart);
+
+	// Empty files can't be mapped but are still valid.
+	if (_size == 0)
+	{
+		return true;
+	}
+
+	_mapping = CreateFileMapping(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!_mapping)
+	{
+		cout << "Failed to create file mapping for: " << path << endl;
+		Close();
+
+		return false;
+	}
+
+	_data = static_cast<const char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!_data)
+	{
+		cout << "Failed to map view of: " << path << endl;
+		Close();
+
+		return false;
+	}
+
+	return true;
+}
+
+void TinyEngine::MappedFile::Close()
+{
+	if (_data)
+	{
+		UnmapViewOfFile(_data);
+		_data = nullptr;
+	}
+
+	if (_mapping)
+	{
+		CloseHandle(_mapping);
+		_mapping = nullptr;
+	}
+
+	if (_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(_file);
+		_file = INVALID_HANDLE_VALUE;
+	}
+
+	_size = 0;
+}
+
+bool TinyEngine::MappedFile::IsOpen() const
+{
+	return _file != INVALID_HANDLE_VALUE;
+}
+
+const char* TinyEngine::MappedFile::GetData() const
+{
+	return _data;
+}
+
+size_t TinyEngine::MappedFile::GetSize() const
+{
+	return _size;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Windows.h>
+
+namespace TinyEngine
+{
+	// A read only view of a file which has been mapped into memory.
+	// Lets the file be read in place without copying it into a buffer first.
+	class MappedFile
+	{
+	private:
+		HANDLE _file;
+		HANDLE _mapping;
+
+		const char* _data;
+		size_t _size;
+
+	public:
+		// Construct a MappedFile which has not been opened.
+		MappedFile();
+
+		// Construct a MappedFile and open the file at path.
+		//	const char* path: Path to the file to map
+		MappedFile(const char* path);
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+
+		// Map a file into memory. Closes any file which is already open.
+		//	const char* path: Path to the file to map
+		//	returns: true if the file was mapped
+		bool Open(const char* path);
+
+		// Unmap and close the current file.
+		void Close();
+
+		// Is a file currently mapped?
+		bool IsOpen() const;
+
+		// Get a pointer to the first byte of the file. nullptr if not open or empty.
+		const char* GetData() const;
+
+		// Get the size of the file in bytes.
+		size_t GetSize() const;
+	};
+}
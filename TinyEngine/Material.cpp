@@ -9,8 +9,14 @@ Material::Material()
 }
 
 Material::Material(const Material& material)
+{
+	*this = material;
+}
+
+Material& Material::operator=(const Material& material)
 {
 	shader = material.shader;
+	instancedShader = material.instancedShader;
 
 	ambient = material.ambient;
 	ambientTexture = material.ambientTexture;
@@ -23,6 +29,17 @@ Material::Material(const Material& material)
 	specularTexture = material.specularTexture;
 
 	transparency = material.transparency;
+
+	// The copy gets its own constants, created when it is first drawn. Assigning a material to itself
+	// keeps them, as they are already its own.
+	if (&material != this)
+	{
+		_constants.Reset();
+	}
+
+	dirty = true;
+
+	return *this;
 }
 
 TinyEngine::Material::~Material()
@@ -1,11 +1,15 @@
 #pragma once
 
 #include <DirectXMath.h>
+#include <d3d11.h>
+#include <wrl/client.h>
 #include "Texture.h"
 #include "Shader.h"
 
 namespace TinyEngine
 {
+	class Renderer;
+
 	// Standard material used by the renderer.
 	// Any unused textures must contain a texture created
 	// with this constructor (null object): Texture(renderer);
@@ -15,6 +19,10 @@ namespace TinyEngine
 	public:
 		// Shader which this material uses.
 		Shader* shader = nullptr;
+		// Shader to draw several instances at once with, taking their world matrices from vertex buffer
+		// slot 1 like DefaultInstancedVertexShader. Instances of materials with a shader but without
+		// this are drawn one at a time. Unused by materials without a shader.
+		Shader* instancedShader = nullptr;
 		
 		// Ambient component of this material. (Emissive)
 		DirectX::XMFLOAT3 ambient = {};
@@ -36,9 +44,20 @@ namespace TinyEngine
 		// Transparency. Unused by the default shader.
 		float transparency = 0.0f;
 
+		// Set after changing any of the colors, the specular exponent or the transparency so the renderer
+		// uploads them again. Textures and shaders are bound as they are and don't need it.
+		bool dirty = true;
+
+	private:
+		// The values above as the shaders read them, created and updated by the Renderer.
+		Microsoft::WRL::ComPtr<ID3D11Buffer> _constants;
+
+		friend class Renderer;
+
 	public:
 		Material();
 		Material(const Material& material);
+		Material& operator=(const Material& material);
 
 		~Material();
 	};
@@ -10,60 +10,266 @@ using std::cout;
 using std::endl;
 using std::vector;
 
-Mesh::Mesh(Renderer* renderer) : _renderer(renderer), _numVertices(0)
+Mesh::Mesh(Renderer* renderer) : _renderer(renderer), _vertexAllocation(RangeAllocator::INVALID_HANDLE), _numVertices(0),
+	_vertexFormat(VertexFormat::STANDARD), _occluder(false), _uvDensity(1.0f)
 {
 
 }
 
 Mesh::~Mesh()
 {
+	FreeVertices();
 
+	auto* arena = _renderer->GetGeometryArena();
+	for (const auto& part : _parts)
+	{
+		if (part.indexAllocation != RangeAllocator::INVALID_HANDLE)
+		{
+			arena->FreeIndices(part.indexAllocation);
+		}
+	}
+}
+
+void Mesh::SetVertices(const VertexStandard* vertices, unsigned int numVertices)
+{
+	_quantization = VertexQuantization();
+
+	_positions.resize(numVertices);
+	for (unsigned int i = 0; i < numVertices; i++)
+	{
+		_positions[i] = vertices[i].position;
+	}
+
+	UpdateBounds();
+	AllocateVertices(vertices, numVertices, VertexFormat::STANDARD);
+}
+
+void Mesh::SetVertices(const VertexPacked* vertices, unsigned int numVertices, const VertexQuantization& quantization)
+{
+	_quantization = quantization;
+
+	// Bounded by the decoded positions, which is what is drawn.
+	_positions.resize(numVertices);
+	for (unsigned int i = 0; i < numVertices; i++)
+	{
+		_positions[i] = UnpackVertex(vertices[i], quantization).position;
+	}
+
+	UpdateBounds();
+	AllocateVertices(vertices, numVertices, VertexFormat::PACKED);
+}
+
+VertexFormat Mesh::GetVertexFormat() const
+{
+	return _vertexFormat;
+}
+
+Microsoft::WRL::ComPtr<ID3D11Buffer> Mesh::GetVertexBuffer() const
+{
+	return _renderer->GetGeometryArena()->GetVertexBuffer(_vertexFormat);
+}
+
+unsigned int Mesh::GetVertexOffset() const
+{
+	return _vertexAllocation != RangeAllocator::INVALID_HANDLE ? _renderer->GetGeometryArena()->GetVertexOffset(_vertexFormat, _vertexAllocation) : 0;
+}
+
+unsigned int Mesh::GetIndexOffset(size_t part) const
+{
+	auto allocation = _parts[part].indexAllocation;
+	return allocation != RangeAllocator::INVALID_HANDLE ? _renderer->GetGeometryArena()->GetIndexOffset(allocation) : 0;
 }
 
-void Mesh::SetVertices(VertexStandard* vertices, unsigned int numVertices)
+void Mesh::AllocateVertices(const void* vertices, unsigned int numVertices, VertexFormat format)
 {
+	FreeVertices();
+
+	_vertexFormat = format;
 	_numVertices = numVertices;
 
-	D3D11_BUFFER_DESC bd;
-	bd.ByteWidth = numVertices * sizeof(VertexStandard);
-	bd.Usage = D3D11_USAGE_IMMUTABLE;
-	bd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	bd.CPUAccessFlags = NULL;
-	bd.MiscFlags = NULL;
-	bd.StructureByteStride = 0;
+	_vertexAllocation = _renderer->GetGeometryArena()->AllocateVertices(format, vertices, numVertices);
+	if (_vertexAllocation == RangeAllocator::INVALID_HANDLE)
+	{
+		cout << "Failed to allocate " << numVertices << " vertices." << endl;
+		_numVertices = 0;
+	}
+}
+
+void Mesh::FreeVertices()
+{
+	if (_vertexAllocation != RangeAllocator::INVALID_HANDLE)
+	{
+		_renderer->GetGeometryArena()->FreeVertices(_vertexFormat, _vertexAllocation);
+		_vertexAllocation = RangeAllocator::INVALID_HANDLE;
+	}
+}
+
+void Mesh::AddIndexBuffer(const unsigned int* indices, unsigned int numIndices, unsigned int baseVertex)
+{
+	AddIndexBuffer(&indices, &numIndices, 1, baseVertex);
+}
 
-	D3D11_SUBRESOURCE_DATA pData = {};
-	pData.pSysMem = vertices;
+void Mesh::AddIndexBuffer(const unsigned int* const* levels, const unsigned int* numIndices, unsigned int numLevels, unsigned int baseVertex)
+{
+	// All levels share one allocation, each drawn from its own range.
+	vector<MeshPartLod> lods;
+	unsigned int totalIndices = 0;
 
-	HRESULT hr;
-	hr = _renderer->GetDevice()->CreateBuffer(&bd, &pData, &_vertexBuffer);
-	if (FAILED(hr))
+	for (unsigned int level = 0; level < numLevels; level++)
 	{
-		cout << "Failed to create Vertex Buffer." << endl;
+		lods.push_back({ totalIndices, numIndices[level] });
+		totalIndices += numIndices[level];
+	}
+
+	vector<unsigned int> indices;
+	indices.reserve(totalIndices);
+
+	for (unsigned int level = 0; level < numLevels; level++)
+	{
+		indices.insert(indices.end(), levels[level], levels[level] + numIndices[level]);
+	}
+
+	auto indexAllocation = _renderer->GetGeometryArena()->AllocateIndices(indices.data(), totalIndices);
+	if (indexAllocation == RangeAllocator::INVALID_HANDLE)
+	{
+		cout << "Failed to allocate " << totalIndices << " indices." << endl;
+		lods.assign(numLevels, { 0, 0 });
+	}
+
+	auto bounds = numLevels > 0 ? ComputePartBounds(levels[0], numIndices[0], baseVertex) : _bounds;
+	_parts.push_back({ indexAllocation, lods.empty() ? 0 : lods[0].size, baseVertex, lods, {}, bounds });
+
+	// Whole triangles only, any reaching past the vertices are left out.
+	if (_occluder && numLevels > 0)
+	{
+		const auto* coarsest = levels[numLevels - 1];
+		for (unsigned int i = 0; i + 2 < numIndices[numLevels - 1]; i += 3)
+		{
+			unsigned int a = coarsest[i] + baseVertex;
+			unsigned int b = coarsest[i + 1] + baseVertex;
+			unsigned int c = coarsest[i + 2] + baseVertex;
+
+			if (a < _positions.size() && b < _positions.size() && c < _positions.size())
+			{
+				_occluderIndices.insert(_occluderIndices.end(), { a, b, c });
+			}
+		}
 	}
 }
 
-void Mesh::AddIndexBuffer(unsigned int* indices, unsigned int numIndices, unsigned int baseVertex)
+void Mesh::SetMeshlets(unsigned int part, const Meshlet* meshlets, unsigned int numMeshlets)
 {
-	D3D11_BUFFER_DESC bd;
-	bd.ByteWidth = numIndices * sizeof(unsigned int);
-	bd.Usage = D3D11_USAGE_IMMUTABLE;
-	bd.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	bd.CPUAccessFlags = NULL;
-	bd.MiscFlags = NULL;
-	bd.StructureByteStride = 0;
+	if (part >= _parts.size())
+	{
+		cout << "Cannot set meshlets of missing mesh part " << part << "." << endl;
+		return;
+	}
 
-	D3D11_SUBRESOURCE_DATA pData = {};
-	pData.pSysMem = indices;
+	_parts[part].meshlets.assign(meshlets, meshlets + numMeshlets);
+}
+
+void Mesh::SetLodErrors(const vector<float>& errors)
+{
+	_lodErrors = errors;
+}
+
+const vector<float>& Mesh::GetLodErrors() const
+{
+	return _lodErrors;
+}
+
+unsigned int Mesh::GetLodCount() const
+{
+	return _lodErrors.empty() ? 1 : static_cast<unsigned int>(_lodErrors.size());
+}
+
+const Bounds& Mesh::GetBounds() const
+{
+	return _bounds;
+}
+
+const Bounds& Mesh::GetPartBounds(size_t part) const
+{
+	return _parts[part].bounds;
+}
+
+void Mesh::SetOccluder(bool occluder)
+{
+	_occluder = occluder;
+}
+
+bool Mesh::IsOccluder() const
+{
+	return _occluder;
+}
+
+void Mesh::ReleasePositions()
+{
+	if (!_occluder)
+	{
+		vector<DirectX::XMFLOAT3>().swap(_positions);
+		vector<unsigned int>().swap(_occluderIndices);
+	}
+}
 
-	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+const vector<DirectX::XMFLOAT3>& Mesh::GetPositions() const
+{
+	return _positions;
+}
+
+const vector<unsigned int>& Mesh::GetOccluderIndices() const
+{
+	return _occluderIndices;
+}
+
+DirectX::XMFLOAT3 Mesh::GetBoundsCenter() const
+{
+	return _bounds.center;
+}
+
+float Mesh::GetBoundsRadius() const
+{
+	return _bounds.radius;
+}
 
-	HRESULT hr;
-	hr = _renderer->GetDevice()->CreateBuffer(&bd, &pData, &indexBuffer);
-	if (FAILED(hr))
+void Mesh::UpdateBounds()
+{
+	_bounds = ComputeBounds(_positions.data(), static_cast<unsigned int>(_positions.size()));
+
+	// Their indices are gone, the whole mesh is the best that can be done.
+	for (auto& part : _parts)
 	{
-		cout << "Failed to create Index Buffer." << endl;
+		part.bounds = _bounds;
 	}
+}
 
-	_parts.push_back({ indexBuffer, numIndices, baseVertex });
+Bounds Mesh::ComputePartBounds(const unsigned int* indices, unsigned int numIndices, unsigned int baseVertex) const
+{
+	if (_positions.empty())
+	{
+		return _bounds;
+	}
+
+	// Indices outside the vertices would be drawn as garbage anyway, they are left out rather than read past the end.
+	vector<unsigned int> valid;
+	valid.reserve(numIndices);
+	for (unsigned int i = 0; i < numIndices; i++)
+	{
+		if (static_cast<size_t>(indices[i]) + baseVertex < _positions.size())
+		{
+			valid.push_back(indices[i] + baseVertex);
+		}
+	}
+
+	return ComputeBounds(_positions.data(), valid.data(), static_cast<unsigned int>(valid.size()));
+}
+
+void Mesh::SetUvDensity(float density)
+{
+	_uvDensity = density;
+}
+
+float Mesh::GetUvDensity() const
+{
+	return _uvDensity;
 }
@@ -2,6 +2,10 @@
 #include "Material.h"
 #include <vector>
 #include "VertexStandard.h"
+#include "VertexPacked.h"
+#include "Meshlet.h"
+#include "FrustumCulling.h"
+#include "RangeAllocator.h"
 #include <d3d11.h>
 #include <wrl/client.h>
 
@@ -9,23 +13,57 @@ namespace TinyEngine
 {
 	class Renderer;
 
+	// Vertex types a Mesh can be drawn with.
+	enum class VertexFormat
+	{
+		STANDARD,
+		PACKED
+	};
+
 	// Class representing a 3D model.
+	// Its vertices and indices live in the renderer's GeometryArena, the mesh only holds its allocations.
 	class Mesh
 	{
 	private:
+		struct MeshPartLod {
+			unsigned int start;
+			unsigned int size;
+		};
+
 		struct MeshPart {
-			Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+			// Allocation in the arena's index buffer.
+			unsigned int indexAllocation;
 			unsigned int size;
 			unsigned int baseVertex;
+			// Index ranges in the allocation for each level of detail, lods[0] is the full detail level.
+			std::vector<MeshPartLod> lods;
+			// Clusters of the full detail level, culled separately when drawn. Empty to draw the level whole.
+			std::vector<Meshlet> meshlets;
+			// Object space bounds of the full detail level.
+			Bounds bounds;
 		};
 
 		Renderer* _renderer;
 
-		Microsoft::WRL::ComPtr<ID3D11Buffer> _vertexBuffer;
+		// Allocation in the arena's vertex buffer for _vertexFormat.
+		unsigned int _vertexAllocation;
 		unsigned int _numVertices;
 
+		VertexFormat _vertexFormat;
+		VertexQuantization _quantization;
+
 		std::vector<MeshPart> _parts;
 
+		// Object space positions of the vertices, kept to bound the parts added after them and, for occluders, to occlude with.
+		std::vector<DirectX::XMFLOAT3> _positions;
+		// Coarsest level of every part, indexing _positions directly. Only built for occluders.
+		std::vector<unsigned int> _occluderIndices;
+		bool _occluder;
+
+		std::vector<float> _lodErrors;
+		Bounds _bounds;
+		float _uvDensity;
+
 	public:
 		// Construct a Mesh instance.
 		//	Renderer* renderer: referance to the renderer which this belongs to.
@@ -34,30 +72,110 @@ namespace TinyEngine
 
 		Mesh(const Mesh&) = delete;
 
-		// Set the vertices of this mesh.
-		//	VertexStandard* vertices: Array of vertex data
+		// Set the vertices of this mesh, which also sets its bounds. Parts are bounded when they are added,
+		// so set the vertices first, parts added before them are given the bounds of the whole mesh.
+		//	const VertexStandard* vertices: Array of vertex data
+		//	unsigned int numVertices: Number of vertices in the vertex array
+		void SetVertices(const VertexStandard* vertices, unsigned int numVertices);
+
+		// Set the vertices of this mesh to packed vertices. The default shader decodes them.
+		//	const VertexPacked* vertices: Array of vertex data
 		//	unsigned int numVertices: Number of vertices in the vertex array
-		void SetVertices(VertexStandard* vertices, unsigned int numVertices);
+		//	const VertexQuantization& quantization: Bounds the positions were quantized to
+		void SetVertices(const VertexPacked* vertices, unsigned int numVertices, const VertexQuantization& quantization);
+
+		VertexFormat GetVertexFormat() const;
 
 		// Add an index buffer to this mesh.
-		//	unsigned int* indices: Array of indices
+		//	const unsigned int* indices: Array of indices
 		//	unsigned int* numIndices: number of indices in the index array
 		//	unsigned int baseVertex: the vertex which this index buffer will
 		//		use as the first one when drawing. Lets you reuse vertices.
-		void AddIndexBuffer(unsigned int* indices, unsigned int numIndices, unsigned int baseVertex = 0);
+		void AddIndexBuffer(const unsigned int* indices, unsigned int numIndices, unsigned int baseVertex = 0);
+
+		// Add an index buffer holding several levels of detail for the same part.
+		//	const unsigned int* const* levels: Array of index arrays, levels[0] is the full detail level
+		//	const unsigned int* numIndices: Number of indices in each level
+		//	unsigned int numLevels: Number of levels
+		//	unsigned int baseVertex: See AddIndexBuffer
+		void AddIndexBuffer(const unsigned int* const* levels, const unsigned int* numIndices, unsigned int numLevels, unsigned int baseVertex = 0);
+
+		// Give a part meshlets so the renderer can cull its full detail level in pieces.
+		//	unsigned int part: Part the meshlets belong to, in the order the index buffers were added
+		//	const Meshlet* meshlets: Meshlets over the part's full detail indices
+		//	unsigned int numMeshlets: Number of meshlets
+		void SetMeshlets(unsigned int part, const Meshlet* meshlets, unsigned int numMeshlets);
+
+		// Set the simplification error of each level of detail in object space, level 0 being 0.
+		//	const std::vector<float>& errors: Error per level, empty if the mesh has no levels
+		void SetLodErrors(const std::vector<float>& errors);
+
+		const std::vector<float>& GetLodErrors() const;
+
+		// Number of levels of detail, at least 1.
+		unsigned int GetLodCount() const;
+
+		// Object space bounds of the vertices, used to cull the mesh and pick a level of detail.
+		const Bounds& GetBounds() const;
+
+		// Object space bounds of a part's full detail level.
+		//	size_t part: Part, in the order the index buffers were added
+		const Bounds& GetPartBounds(size_t part) const;
+
+		// Keep the positions and the coarsest level of every part on the CPU, to rasterize the mesh as an occluder.
+		// Set it before the vertices and index buffers, which are what build them.
+		//	bool occluder: Whether to keep them
+		void SetOccluder(bool occluder);
+
+		bool IsOccluder() const;
+
+		// Drop the positions, kept until now to bound the parts as they are added, unless the mesh is an occluder.
+		// Parts added after this are given the bounds of the whole mesh.
+		void ReleasePositions();
+
+		// Object space positions of the vertices, for work done on the CPU. Empty once released, see ReleasePositions.
+		const std::vector<DirectX::XMFLOAT3>& GetPositions() const;
+
+		// Triangles of every part's coarsest level of detail, with base vertices applied, to rasterize as an occluder.
+		// Simplification keeps them close to the surface, so they hide about what the mesh does at a fraction of the cost.
+		// Empty unless the mesh is an occluder.
+		const std::vector<unsigned int>& GetOccluderIndices() const;
+
+		DirectX::XMFLOAT3 GetBoundsCenter() const;
+
+		float GetBoundsRadius() const;
+
+		// Set the average texture coordinate units per object space unit, used to pick which texture mips to stream.
+		//	float density: See ComputeUvDensity
+		void SetUvDensity(float density);
+
+		float GetUvDensity() const;
 
 #ifdef TINY_ENGINE_EXPOSE_NATIVE
-		Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer() const
-		{
-			return _vertexBuffer;
-		}
+		Microsoft::WRL::ComPtr<ID3D11Buffer> GetVertexBuffer() const;
+
+		// First vertex of this mesh in the vertex buffer. Add it to a part's baseVertex when drawing.
+		unsigned int GetVertexOffset() const;
+
+		// First index of a part in the index buffer. Add it to a level's start when drawing.
+		unsigned int GetIndexOffset(size_t part) const;
 
 		unsigned int GetNumVertices() const
 		{
 			return _numVertices;
 		}
 
-		MeshPart GetMeshPart(size_t part) const
+		unsigned int GetVertexStride() const
+		{
+			return _vertexFormat == VertexFormat::PACKED ? sizeof(VertexPacked) : sizeof(VertexStandard);
+		}
+
+		const VertexQuantization& GetQuantization() const
+		{
+			return _quantization;
+		}
+
+		const MeshPart& GetMeshPart(size_t part) const
 		{
 			return _parts[part];
 		}
@@ -67,5 +185,15 @@ namespace TinyEngine
 			return _parts.size();
 		}
 #endif
+
+	private:
+		void AllocateVertices(const void* vertices, unsigned int numVertices, VertexFormat format);
+		void FreeVertices();
+
+		// Bound _positions, and every part as they can't be bounded on their own any more.
+		void UpdateBounds();
+
+		// Bound the vertices a part's indices reference, or the whole mesh if there are no vertices yet.
+		Bounds ComputePartBounds(const unsigned int* indices, unsigned int numIndices, unsigned int baseVertex) const;
 	};
 }
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include "VertexStandard.h"
+#include "VertexPacked.h"
+#include "Meshlet.h"
+
+namespace TinyEngine
+{
+	// A simplified level of detail of a part. A range of MeshData::indices, relative to the part's baseVertex.
+	struct MeshDataLod
+	{
+		unsigned int indexStart = 0;
+		unsigned int indexCount = 0;
+	};
+
+	// A range of a MeshData's index array which is drawn with a single material.
+	struct MeshDataPart
+	{
+		// First index of this part in MeshData::indices.
+		unsigned int indexStart = 0;
+		// Number of indices in this part.
+		unsigned int indexCount = 0;
+		// First vertex used by this part. Indices are relative to this vertex.
+		unsigned int baseVertex = 0;
+		// Number of vertices owned by this part, starting at baseVertex.
+		unsigned int vertexCount = 0;
+		// Index of the material used by this part. -1 if it has no material.
+		int material = -1;
+		// Simplified levels of detail, lods[0] is level 1. They use the part's vertices.
+		std::vector<MeshDataLod> lods;
+		// Clusters of the full detail level's triangles, empty unless the mesh was imported with meshlets.
+		std::vector<Meshlet> meshlets;
+	};
+
+	// CPU side geometry, used while importing a mesh before it is uploaded to a Mesh.
+	struct MeshData
+	{
+		std::vector<VertexStandard> vertices;
+		std::vector<unsigned int> indices;
+		std::vector<MeshDataPart> parts;
+
+		// Object space error of each level of detail, lodErrors[0] is the full detail level.
+		// Empty if the mesh has no levels of detail.
+		std::vector<float> lodErrors;
+
+		// Packed copy of vertices, empty unless the mesh was imported with packing enabled.
+		std::vector<VertexPacked> packedVertices;
+		// Decodes packedVertices' positions.
+		VertexQuantization quantization;
+
+		// Average texture coordinate units per object space unit, see ComputeUvDensity.
+		float uvDensity = 1.0f;
+	};
+}
@@ -0,0 +1,352 @@
+#include "MeshFile.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace TinyEngine;
+
+using std::cout;
+using std::endl;
+using std::vector;
+
+namespace
+{
+	const uint64_t SECTION_ALIGNMENT = 16;
+
+	inline uint64_t AlignUp(uint64_t offset)
+	{
+		return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+	}
+
+	// Is [offset, offset + size) inside the file and aligned?
+	inline bool IsValidSection(uint64_t offset, uint64_t size, uint64_t fileSize)
+	{
+		return offset % SECTION_ALIGNMENT == 0 && offset <= fileSize && size <= fileSize - offset;
+	}
+
+	uint32_t AddString(std::string& table, const std::string& value)
+	{
+		if (value.empty())
+		{
+			return MeshFileMaterial::NO_STRING;
+		}
+
+		auto offset = static_cast<uint32_t>(table.size());
+		table.append(value.c_str(), value.size() + 1);
+		return offset;
+	}
+}
+
+MeshFile::MeshFile() : _header(nullptr)
+{
+}
+
+bool MeshFile::Open(const char* path)
+{
+	_header = nullptr;
+
+	if (!_file.Open(path))
+	{
+		cout << "Could not open mesh file: " << path << endl;
+		return false;
+	}
+
+	uint64_t fileSize = _file.GetSize();
+	if (fileSize < sizeof(MeshFileHeader))
+	{
+		cout << "Mesh file is too small: " << path << endl;
+		_file.Close();
+		return false;
+	}
+
+	const auto* header = reinterpret_cast<const MeshFileHeader*>(_file.GetData());
+
+	bool knownStride = header->vertexStride == sizeof(VertexStandard) || header->vertexStride == sizeof(VertexPacked);
+
+	if (header->magic != MeshFileHeader::MAGIC || header->version != MeshFileHeader::VERSION || !knownStride)
+	{
+		cout << "Mesh file is not a compatible .tmesh: " << path << endl;
+		_file.Close();
+		return false;
+	}
+
+	bool valid = IsValidSection(header->vertexOffset, static_cast<uint64_t>(header->vertexCount) * header->vertexStride, fileSize)
+		&& IsValidSection(header->indexOffset, static_cast<uint64_t>(header->indexCount) * sizeof(unsigned int), fileSize)
+		&& IsValidSection(header->partOffset, static_cast<uint64_t>(header->partCount) * sizeof(MeshFilePart), fileSize)
+		&& IsValidSection(header->materialOffset, static_cast<uint64_t>(header->materialCount) * sizeof(MeshFileMaterial), fileSize)
+		&& IsValidSection(header->stringTableOffset, header->stringTableSize, fileSize)
+		&& header->lodCount >= 1 && header->lodCount <= MeshFileHeader::MAX_LODS
+		&& IsValidSection(header->lodOffset, static_cast<uint64_t>(header->partCount) * (header->lodCount - 1) * sizeof(MeshFileLod), fileSize)
+		&& IsValidSection(header->meshletOffset, static_cast<uint64_t>(header->meshletCount) * sizeof(Meshlet), fileSize);
+
+	if (valid)
+	{
+		_header = header;
+
+		const auto* parts = GetParts();
+		for (uint32_t i = 0; valid && i < header->partCount; i++)
+		{
+			const auto& part = parts[i];
+			valid = static_cast<uint64_t>(part.indexStart) + part.indexCount <= header->indexCount
+				&& static_cast<uint64_t>(part.baseVertex) + part.vertexCount <= header->vertexCount
+				&& part.material < static_cast<int32_t>(header->materialCount)
+				&& static_cast<uint64_t>(part.meshletStart) + part.meshletCount <= header->meshletCount;
+
+			const auto* lods = GetLods(i);
+			for (uint32_t level = 0; valid && level + 1 < header->lodCount; level++)
+			{
+				valid = static_cast<uint64_t>(lods[level].indexStart) + lods[level].indexCount <= header->indexCount;
+			}
+
+			const auto* meshlets = GetMeshlets(i);
+			for (uint32_t m = 0; valid && m < part.meshletCount; m++)
+			{
+				valid = static_cast<uint64_t>(meshlets[m].indexStart) + meshlets[m].indexCount <= part.indexCount;
+			}
+		}
+	}
+
+	if (!valid)
+	{
+		cout << "Mesh file is corrupt: " << path << endl;
+		_header = nullptr;
+		_file.Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool MeshFile::Write(const char* path, const MeshData& mesh, const vector<ObjMaterial>& materials)
+{
+	bool packed = !mesh.packedVertices.empty();
+
+	if (mesh.lodErrors.size() > MeshFileHeader::MAX_LODS)
+	{
+		cout << "Mesh has too many levels of detail for a .tmesh: " << mesh.lodErrors.size() << endl;
+		return false;
+	}
+
+	MeshFileHeader header = {};
+	header.magic = MeshFileHeader::MAGIC;
+	header.version = MeshFileHeader::VERSION;
+	header.vertexStride = packed ? sizeof(VertexPacked) : sizeof(VertexStandard);
+	header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+	header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+	header.partCount = static_cast<uint32_t>(mesh.parts.size());
+	header.materialCount = static_cast<uint32_t>(materials.size());
+	header.lodCount = mesh.lodErrors.empty() ? 1 : static_cast<uint32_t>(mesh.lodErrors.size());
+
+	std::copy(mesh.lodErrors.begin(), mesh.lodErrors.end(), header.lodErrors);
+
+	float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (const auto& vertex : mesh.vertices)
+	{
+		const float position[3] = { vertex.position.x, vertex.position.y, vertex.position.z };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			boundsMin[axis] = std::min(boundsMin[axis], position[axis]);
+			boundsMax[axis] = std::max(boundsMax[axis], position[axis]);
+		}
+	}
+
+	if (mesh.vertices.empty())
+	{
+		std::fill(boundsMin, boundsMin + 3, 0.0f);
+		std::fill(boundsMax, boundsMax + 3, 0.0f);
+	}
+
+	memcpy(header.boundsMin, boundsMin, sizeof(boundsMin));
+	memcpy(header.boundsMax, boundsMax, sizeof(boundsMax));
+
+	memcpy(header.quantizationOffset, &mesh.quantization.offset, sizeof(header.quantizationOffset));
+	memcpy(header.quantizationScale, &mesh.quantization.scale, sizeof(header.quantizationScale));
+	header.uvDensity = mesh.uvDensity;
+
+	const void* vertexData = packed ? static_cast<const void*>(mesh.packedVertices.data()) : mesh.vertices.data();
+	size_t vertexBytes = mesh.vertices.size() * header.vertexStride;
+
+	vector<MeshFilePart> parts;
+	vector<Meshlet> meshlets;
+	for (const auto& part : mesh.parts)
+	{
+		MeshFilePart filePart = {};
+		filePart.indexStart = part.indexStart;
+		filePart.indexCount = part.indexCount;
+		filePart.baseVertex = part.baseVertex;
+		filePart.vertexCount = part.vertexCount;
+		filePart.material = part.material;
+		filePart.meshletStart = static_cast<uint32_t>(meshlets.size());
+		filePart.meshletCount = static_cast<uint32_t>(part.meshlets.size());
+		parts.push_back(filePart);
+
+		meshlets.insert(meshlets.end(), part.meshlets.begin(), part.meshlets.end());
+	}
+
+	vector<MeshFileLod> lods;
+	for (const auto& part : mesh.parts)
+	{
+		for (uint32_t level = 0; level + 1 < header.lodCount; level++)
+		{
+			// Every part has a range for every level, GenerateLods guarantees it.
+			MeshFileLod fileLod = {};
+			fileLod.indexStart = part.lods[level].indexStart;
+			fileLod.indexCount = part.lods[level].indexCount;
+			lods.push_back(fileLod);
+		}
+	}
+
+	std::string strings;
+	vector<MeshFileMaterial> fileMaterials;
+	for (const auto& material : materials)
+	{
+		MeshFileMaterial fileMaterial = {};
+		memcpy(fileMaterial.ambient, &material.ambient, sizeof(fileMaterial.ambient));
+		memcpy(fileMaterial.diffuse, &material.diffuse, sizeof(fileMaterial.diffuse));
+		memcpy(fileMaterial.specular, &material.specular, sizeof(fileMaterial.specular));
+		fileMaterial.specularExponent = material.specularExponent;
+		fileMaterial.dissolve = material.dissolve;
+		fileMaterial.name = AddString(strings, material.name);
+		fileMaterial.ambientMap = AddString(strings, material.ambientMap);
+		fileMaterial.diffuseMap = AddString(strings, material.diffuseMap);
+		fileMaterial.specularMap = AddString(strings, material.specularMap);
+		fileMaterials.push_back(fileMaterial);
+	}
+
+	header.stringTableSize = static_cast<uint32_t>(strings.size());
+
+	header.vertexOffset = AlignUp(sizeof(MeshFileHeader));
+	header.indexOffset = AlignUp(header.vertexOffset + vertexBytes);
+	header.partOffset = AlignUp(header.indexOffset + mesh.indices.size() * sizeof(unsigned int));
+	header.materialOffset = AlignUp(header.partOffset + parts.size() * sizeof(MeshFilePart));
+	header.stringTableOffset = AlignUp(header.materialOffset + fileMaterials.size() * sizeof(MeshFileMaterial));
+	header.lodOffset = AlignUp(header.stringTableOffset + strings.size());
+	header.meshletCount = static_cast<uint32_t>(meshlets.size());
+	header.meshletOffset = AlignUp(header.lodOffset + lods.size() * sizeof(MeshFileLod));
+
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		cout << "Could not open mesh file for writing: " << path << endl;
+		return false;
+	}
+
+	uint64_t written = 0;
+	auto writeSection = [&file, &written](uint64_t offset, const void* data, size_t size)
+	{
+		static const char padding[SECTION_ALIGNMENT] = {};
+		file.write(padding, static_cast<std::streamsize>(offset - written));
+		file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+		written = offset + size;
+	};
+
+	writeSection(0, &header, sizeof(header));
+	writeSection(header.vertexOffset, vertexData, vertexBytes);
+	writeSection(header.indexOffset, mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+	writeSection(header.partOffset, parts.data(), parts.size() * sizeof(MeshFilePart));
+	writeSection(header.materialOffset, fileMaterials.data(), fileMaterials.size() * sizeof(MeshFileMaterial));
+	writeSection(header.stringTableOffset, strings.data(), strings.size());
+	writeSection(header.lodOffset, lods.data(), lods.size() * sizeof(MeshFileLod));
+	writeSection(header.meshletOffset, meshlets.data(), meshlets.size() * sizeof(Meshlet));
+
+	if (!file.good())
+	{
+		cout << "Failed to write mesh file: " << path << endl;
+		return false;
+	}
+
+	return true;
+}
+
+const MeshFileHeader& MeshFile::GetHeader() const
+{
+	return *_header;
+}
+
+bool MeshFile::IsPacked() const
+{
+	return _header->vertexStride == sizeof(VertexPacked);
+}
+
+VertexQuantization MeshFile::GetQuantization() const
+{
+	VertexQuantization quantization;
+	quantization.offset = DirectX::XMFLOAT3(_header->quantizationOffset);
+	quantization.scale = DirectX::XMFLOAT3(_header->quantizationScale);
+	return quantization;
+}
+
+const VertexStandard* MeshFile::GetVertices() const
+{
+	return IsPacked() ? nullptr : reinterpret_cast<const VertexStandard*>(_file.GetData() + _header->vertexOffset);
+}
+
+const VertexPacked* MeshFile::GetPackedVertices() const
+{
+	return IsPacked() ? reinterpret_cast<const VertexPacked*>(_file.GetData() + _header->vertexOffset) : nullptr;
+}
+
+const unsigned int* MeshFile::GetIndices() const
+{
+	return reinterpret_cast<const unsigned int*>(_file.GetData() + _header->indexOffset);
+}
+
+const MeshFilePart* MeshFile::GetParts() const
+{
+	return reinterpret_cast<const MeshFilePart*>(_file.GetData() + _header->partOffset);
+}
+
+const MeshFileLod* MeshFile::GetLods(unsigned int part) const
+{
+	if (_header->lodCount <= 1)
+	{
+		return nullptr;
+	}
+
+	return reinterpret_cast<const MeshFileLod*>(_file.GetData() + _header->lodOffset) + static_cast<size_t>(part) * (_header->lodCount - 1);
+}
+
+const Meshlet* MeshFile::GetMeshlets(unsigned int part) const
+{
+	return reinterpret_cast<const Meshlet*>(_file.GetData() + _header->meshletOffset) + GetParts()[part].meshletStart;
+}
+
+ObjMaterial MeshFile::GetMaterial(unsigned int index) const
+{
+	const auto& fileMaterial = reinterpret_cast<const MeshFileMaterial*>(_file.GetData() + _header->materialOffset)[index];
+
+	ObjMaterial material;
+	material.name = GetString(fileMaterial.name);
+	material.ambient = DirectX::XMFLOAT3(fileMaterial.ambient);
+	material.diffuse = DirectX::XMFLOAT3(fileMaterial.diffuse);
+	material.specular = DirectX::XMFLOAT3(fileMaterial.specular);
+	material.specularExponent = fileMaterial.specularExponent;
+	material.dissolve = fileMaterial.dissolve;
+	material.ambientMap = GetString(fileMaterial.ambientMap);
+	material.diffuseMap = GetString(fileMaterial.diffuseMap);
+	material.specularMap = GetString(fileMaterial.specularMap);
+
+	return material;
+}
+
+const char* MeshFile::GetString(uint32_t offset) const
+{
+	if (offset == MeshFileMaterial::NO_STRING || offset >= _header->stringTableSize)
+	{
+		return "";
+	}
+
+	const char* table = _file.GetData() + _header->stringTableOffset;
+
+	// Strings written by the cooker are terminated, but don't trust the file.
+	if (!memchr(table + offset, '\0', _header->stringTableSize - offset))
+	{
+		return "";
+	}
+
+	return table + offset;
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "MappedFile.h"
+#include "MeshData.h"
+#include "ObjParser.h"
+
+namespace TinyEngine
+{
+	// Binary mesh container (.tmesh) written by TinyEngineCooker.
+	// Every section starts on a 16 byte boundary and is stored exactly as it is uploaded,
+	// so a Mesh can be created straight from a mapped file without any parsing.
+	//
+	// Layout:
+	//	MeshFileHeader
+	//	VertexStandard[vertexCount] or VertexPacked[vertexCount], see vertexStride
+	//	unsigned int[indexCount]
+	//	MeshFilePart[partCount]
+	//	MeshFileMaterial[materialCount]
+	//	char[stringTableSize] - null terminated strings referenced by the materials
+	//	MeshFileLod[partCount * (lodCount - 1)] - each part's simplified levels, part by part
+	//	Meshlet[meshletCount] - each part's meshlets, see MeshFilePart::meshletStart
+	struct MeshFileHeader
+	{
+		static const uint32_t MAGIC = 0x48534D54; // "TMSH"
+		static const uint32_t VERSION = 5;
+		// Levels of detail a file can hold, including the full detail level.
+		static const uint32_t MAX_LODS = 8;
+
+		uint32_t magic;
+		uint32_t version;
+		// sizeof the vertex type stored in the file, VertexStandard or VertexPacked.
+		uint32_t vertexStride;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint32_t partCount;
+		uint32_t materialCount;
+		uint32_t stringTableSize;
+		// Levels of detail including the full detail level, 1 if the mesh has none.
+		uint32_t lodCount;
+
+		// Axis aligned bounds of every vertex.
+		float boundsMin[3];
+		float boundsMax[3];
+
+		// Decodes packed positions, see VertexQuantization.
+		float quantizationOffset[3];
+		float quantizationScale[3];
+
+		// Texture coordinate units per object space unit, see ComputeUvDensity.
+		float uvDensity;
+
+		// Object space simplification error of each level, lodErrors[0] is 0.
+		float lodErrors[MAX_LODS];
+
+		// Meshlets of every part.
+		uint32_t meshletCount;
+		uint32_t _pad;
+
+		// Byte offsets of each section from the start of the file.
+		uint64_t vertexOffset;
+		uint64_t indexOffset;
+		uint64_t partOffset;
+		uint64_t materialOffset;
+		uint64_t stringTableOffset;
+		uint64_t lodOffset;
+		uint64_t meshletOffset;
+	};
+
+	// A MeshDataPart as stored in a .tmesh.
+	struct MeshFilePart
+	{
+		uint32_t indexStart;
+		uint32_t indexCount;
+		uint32_t baseVertex;
+		uint32_t vertexCount;
+		int32_t material;
+		// The part's meshlets in the meshlet section.
+		uint32_t meshletStart;
+		uint32_t meshletCount;
+		uint32_t _pad;
+	};
+
+	// A MeshDataLod as stored in a .tmesh.
+	struct MeshFileLod
+	{
+		uint32_t indexStart;
+		uint32_t indexCount;
+	};
+
+	// An ObjMaterial as stored in a .tmesh. Strings are offsets into the string table.
+	struct MeshFileMaterial
+	{
+		static const uint32_t NO_STRING = ~0u;
+
+		float ambient[3];
+		float diffuse[3];
+		float specular[3];
+		float specularExponent;
+		float dissolve;
+
+		uint32_t name;
+		uint32_t ambientMap;
+		uint32_t diffuseMap;
+		uint32_t specularMap;
+		uint32_t _pad;
+	};
+
+	// A .tmesh file mapped into memory.
+	class MeshFile
+	{
+	private:
+		MappedFile _file;
+		const MeshFileHeader* _header;
+
+	public:
+		MeshFile();
+		~MeshFile() = default;
+
+		MeshFile(const MeshFile&) = delete;
+
+		// Map and validate a .tmesh file.
+		//	const char* path: Path to the file
+		//	returns: false if the file could not be opened or is not a valid .tmesh
+		bool Open(const char* path);
+
+		// Write a mesh and its materials to a .tmesh file.
+		// The mesh's packed vertices are written if it has any, as are its levels of detail and meshlets.
+		//	const char* path: Path to write to
+		//	const MeshData& mesh: Geometry to write
+		//	const std::vector<ObjMaterial>& materials: Materials referenced by the mesh's parts
+		//	returns: false if the file could not be written
+		static bool Write(const char* path, const MeshData& mesh, const std::vector<ObjMaterial>& materials);
+
+		const MeshFileHeader& GetHeader() const;
+
+		// Does the file hold VertexPacked rather than VertexStandard vertices?
+		bool IsPacked() const;
+		VertexQuantization GetQuantization() const;
+
+		// Pointers into the mapped file, valid while this MeshFile is open.
+		// Only the getter matching IsPacked returns vertices, the other returns nullptr.
+		const VertexStandard* GetVertices() const;
+		const VertexPacked* GetPackedVertices() const;
+		const unsigned int* GetIndices() const;
+		const MeshFilePart* GetParts() const;
+
+		// A part's simplified levels, lodCount - 1 of them. nullptr if the mesh has no levels.
+		//	unsigned int part: Part to get the levels of
+		const MeshFileLod* GetLods(unsigned int part) const;
+
+		// A part's meshlets, MeshFilePart::meshletCount of them.
+		//	unsigned int part: Part to get the meshlets of
+		const Meshlet* GetMeshlets(unsigned int part) const;
+
+		// Read a material out of the file.
+		//	unsigned int index: Material to read
+		//	returns: The material with its strings copied out of the file
+		ObjMaterial GetMaterial(unsigned int index) const;
+
+	private:
+		const char* GetString(uint32_t offset) const;
+	};
+}
@@ -0,0 +1,102 @@
+#include "MeshImport.h"
+#include "MeshSimplify.h"
+#include "MeshWeld.h"
+#include <cmath>
+
+using namespace TinyEngine;
+using namespace DirectX;
+
+float TinyEngine::ComputeUvDensity(const MeshData& mesh)
+{
+	double uvArea = 0.0;
+	double surfaceArea = 0.0;
+
+	for (const auto& part : mesh.parts)
+	{
+		const auto* indices = mesh.indices.data() + part.indexStart;
+		const auto* vertices = mesh.vertices.data() + part.baseVertex;
+
+		for (unsigned int i = 0; i + 2 < part.indexCount; i += 3)
+		{
+			const auto& a = vertices[indices[i]];
+			const auto& b = vertices[indices[i + 1]];
+			const auto& c = vertices[indices[i + 2]];
+
+			XMVECTOR p0 = XMLoadFloat3(&a.position);
+			XMVECTOR edges = XMVector3Cross(XMLoadFloat3(&b.position) - p0, XMLoadFloat3(&c.position) - p0);
+			surfaceArea += XMVectorGetX(XMVector3Length(edges)) * 0.5;
+
+			float u1 = b.texcoord.x - a.texcoord.x, v1 = b.texcoord.y - a.texcoord.y;
+			float u2 = c.texcoord.x - a.texcoord.x, v2 = c.texcoord.y - a.texcoord.y;
+			uvArea += std::fabs(u1 * v2 - u2 * v1) * 0.5;
+		}
+	}
+
+	if (surfaceArea <= 0.0 || uvArea <= 0.0)
+	{
+		return 1.0f;
+	}
+
+	return static_cast<float>(std::sqrt(uvArea / surfaceArea));
+}
+
+MeshImportReport TinyEngine::ImportMesh(MeshData& mesh, const MeshImportSettings& settings)
+{
+	MeshImportReport report;
+	report.verticesBefore = static_cast<unsigned int>(mesh.vertices.size());
+
+	if (settings.weldVertices)
+	{
+		WeldVertices(mesh, settings.weldEpsilon);
+	}
+
+	report.verticesAfter = static_cast<unsigned int>(mesh.vertices.size());
+	report.bytesSaved = static_cast<size_t>(report.verticesBefore - report.verticesAfter) * sizeof(VertexStandard);
+
+	if (settings.lodCount > 0)
+	{
+		// Simplify before optimizing so every level gets reordered for the cache.
+		GenerateLods(mesh, settings.lodCount, settings.lodReduction, settings.lodMaxError);
+	}
+
+	report.cacheBefore = AnalyzeVertexCache(mesh);
+
+	if (settings.optimizeVertexCache || settings.optimizeVertexFetch)
+	{
+		OptimizeMesh(mesh, settings.optimizeVertexCache, settings.optimizeOverdraw, settings.overdrawThreshold, settings.optimizeVertexFetch);
+	}
+
+	for (auto& part : mesh.parts)
+	{
+		part.meshlets.clear();
+
+		if (settings.buildMeshlets)
+		{
+			// After the cache optimizer, meshlets are seeded in its order and keep most of its locality.
+			BuildMeshlets(mesh.indices.data() + part.indexStart, part.indexCount, mesh.vertices.data() + part.baseVertex, part.vertexCount,
+				part.meshlets, settings.meshletMaxVertices, settings.meshletMaxTriangles);
+
+			report.meshletCount += static_cast<unsigned int>(part.meshlets.size());
+		}
+	}
+
+	report.cacheAfter = AnalyzeVertexCache(mesh);
+
+	mesh.packedVertices.clear();
+	mesh.quantization = VertexQuantization();
+
+	if (settings.packVertices)
+	{
+		auto count = static_cast<unsigned int>(mesh.vertices.size());
+
+		mesh.quantization = ComputeVertexQuantization(mesh.vertices.data(), count);
+		mesh.packedVertices.resize(count);
+		PackVertices(mesh.vertices.data(), count, mesh.quantization, mesh.packedVertices.data());
+
+		report.packingError = MeasurePackingError(mesh.vertices.data(), mesh.packedVertices.data(), count, mesh.quantization);
+	}
+
+	mesh.uvDensity = ComputeUvDensity(mesh);
+
+	return report;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include "MeshData.h"
+#include "MeshOptimize.h"
+
+namespace TinyEngine
+{
+	// Processing applied to a mesh after it is read and before it is uploaded.
+	struct MeshImportSettings
+	{
+		// Merge duplicate vertices, OBJ files produce one vertex per face corner.
+		bool weldVertices = true;
+		// Vertices closer than this are merged. 0 only merges exact duplicates.
+		float weldEpsilon = 0.0f;
+
+		// Simplified levels of detail to generate, 0 disables them.
+		unsigned int lodCount = 3;
+		// Fraction of triangles each level keeps from the previous one.
+		float lodReduction = 0.5f;
+		// Largest simplification error allowed, relative to each part's largest extent.
+		float lodMaxError = 0.05f;
+
+		// Reorder each part's triangles for the post-transform vertex cache.
+		bool optimizeVertexCache = true;
+		// Reorder clusters of triangles to reduce overdraw, needs optimizeVertexCache.
+		bool optimizeOverdraw = true;
+		// How much the ACMR may worsen to allow finer overdraw clusters, 1.05 allows 5%.
+		float overdrawThreshold = 1.05f;
+		// Reorder each part's vertices into the order they are first used.
+		bool optimizeVertexFetch = true;
+
+		// Split each part's full detail level into meshlets which can be culled on their own.
+		// Their order replaces the overdraw order.
+		bool buildMeshlets = false;
+		unsigned int meshletMaxVertices = MESHLET_MAX_VERTICES;
+		unsigned int meshletMaxTriangles = MESHLET_MAX_TRIANGLES;
+
+		// Fill MeshData::packedVertices with 16 byte vertices. Opt in, check the report's packingError first.
+		bool packVertices = false;
+
+		// Keep the mesh's positions and coarsest level on the CPU once it is loaded, so actors can occlude with it.
+		// See Mesh::SetOccluder. Only used by AssetManager, it doesn't change what is imported.
+		bool occluder = false;
+	};
+
+	// Statistics about what an import did to a mesh.
+	struct MeshImportReport
+	{
+		unsigned int verticesBefore = 0;
+		unsigned int verticesAfter = 0;
+
+		// Vertex buffer bytes saved by welding.
+		size_t bytesSaved = 0;
+
+		// Vertex cache efficiency before and after optimization. Equal if the optimizers didn't run.
+		VertexCacheStatistics cacheBefore;
+		VertexCacheStatistics cacheAfter;
+
+		// Meshlets built over every part, zero if buildMeshlets was off.
+		unsigned int meshletCount = 0;
+
+		// Error introduced by packing, zero if packVertices was off.
+		VertexPackingError packingError;
+	};
+
+	// Average texture coordinate units per object space unit over a mesh's full detail triangles,
+	// the square root of their total texture coordinate area over their total surface area.
+	// Used to estimate how many texels of a texture cover each pixel. 1 if the mesh has no area.
+	//	const MeshData& mesh: Mesh to measure
+	float ComputeUvDensity(const MeshData& mesh);
+
+	// Run the import stages enabled in settings on a mesh. Always computes the mesh's uvDensity.
+	//	MeshData& mesh: Mesh to process in place
+	//	const MeshImportSettings& settings: Stages to run
+	//	returns: What the import did
+	MeshImportReport ImportMesh(MeshData& mesh, const MeshImportSettings& settings);
+}
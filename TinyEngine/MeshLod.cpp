@@ -0,0 +1,46 @@
+#include "MeshLod.h"
+#include <algorithm>
+#include <cfloat>
+
+using namespace TinyEngine;
+using namespace DirectX;
+
+float TinyEngine::ProjectError(float error, float distance, float projectionYScale)
+{
+	if (distance <= 0.0f)
+	{
+		return FLT_MAX;
+	}
+
+	return error * projectionYScale / distance;
+}
+
+unsigned int TinyEngine::SelectLod(const float* lodErrors, unsigned int lodCount, XMFLOAT3 center, float radius,
+	FXMMATRIX world, CXMMATRIX view, CXMMATRIX projection, float maxScreenError)
+{
+	if (lodCount <= 1)
+	{
+		return 0;
+	}
+
+	// Errors and the radius scale with the largest axis of the world matrix.
+	float scale = std::max(std::max(
+		XMVectorGetX(XMVector3Length(world.r[0])),
+		XMVectorGetX(XMVector3Length(world.r[1]))),
+		XMVectorGetX(XMVector3Length(world.r[2])));
+
+	XMVECTOR centerView = XMVector3TransformCoord(XMVector3TransformCoord(XMLoadFloat3(&center), world), view);
+
+	// Distance to the nearest point of the bounding sphere, so nothing inside it is ever simplified.
+	float distance = XMVectorGetX(XMVector3Length(centerView)) - radius * scale;
+
+	float projectionYScale = XMVectorGetY(projection.r[1]);
+
+	unsigned int lod = 0;
+	while (lod + 1 < lodCount && ProjectError(lodErrors[lod + 1] * scale, distance, projectionYScale) <= maxScreenError)
+	{
+		lod++;
+	}
+
+	return lod;
+}
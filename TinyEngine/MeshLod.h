@@ -0,0 +1,31 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+namespace TinyEngine
+{
+	// Largest projected simplification error, in normalized device coordinates, a level of detail may have.
+	// The viewport is 2 units high, so this is about one pixel at 1080p.
+	const float DEFAULT_MAX_SCREEN_ERROR = 0.002f;
+
+	// Project an object space error at some distance onto the screen.
+	//	float error: Error in world units
+	//	float distance: Distance from the eye
+	//	float projectionYScale: projection._22, cot(fovY / 2) for a perspective projection
+	//	returns: The error's height in normalized device coordinates
+	float ProjectError(float error, float distance, float projectionYScale);
+
+	// Pick the coarsest level of detail whose projected error is within maxScreenError.
+	// Only depends on its arguments, so it gives the same answer for the same view every time.
+	//	const float* lodErrors: Object space error of each level, ascending. lodErrors[0] is full detail
+	//	unsigned int lodCount: Number of levels
+	//	DirectX::XMFLOAT3 center: Object space centre of the mesh's bounding sphere
+	//	float radius: Object space radius of the mesh's bounding sphere
+	//	DirectX::FXMMATRIX world: World matrix of the mesh
+	//	DirectX::CXMMATRIX view: View matrix of the camera
+	//	DirectX::CXMMATRIX projection: Projection matrix of the camera
+	//	float maxScreenError: See DEFAULT_MAX_SCREEN_ERROR
+	//	returns: The level to draw
+	unsigned int SelectLod(const float* lodErrors, unsigned int lodCount, DirectX::XMFLOAT3 center, float radius,
+		DirectX::FXMMATRIX world, DirectX::CXMMATRIX view, DirectX::CXMMATRIX projection, float maxScreenError = DEFAULT_MAX_SCREEN_ERROR);
+}
@@ -0,0 +1,542 @@
+#include "MeshOptimize.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+using namespace TinyEngine;
+using namespace DirectX;
+
+using std::vector;
+
+namespace
+{
+	const unsigned int NO_TRIANGLE = ~0u;
+
+	// Forsyth's tuning, see "Linear-Speed Vertex Cache Optimisation".
+	const unsigned int FORSYTH_CACHE_SIZE = 32;
+	const unsigned int FORSYTH_VALENCE_TABLE_SIZE = 32;
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRIANGLE_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+
+	// Entries in the cache simulated when looking for overdraw cluster boundaries.
+	const unsigned int OVERDRAW_CACHE_SIZE = 16;
+
+	struct ForsythScores
+	{
+		float cachePosition[FORSYTH_CACHE_SIZE];
+		float valence[FORSYTH_VALENCE_TABLE_SIZE];
+
+		ForsythScores()
+		{
+			for (unsigned int i = 0; i < FORSYTH_CACHE_SIZE; i++)
+			{
+				// The last triangle's vertices get a fixed score so it isn't favoured over its neighbours.
+				cachePosition[i] = i < 3
+					? LAST_TRIANGLE_SCORE
+					: powf(1.0f - static_cast<float>(i - 3) / static_cast<float>(FORSYTH_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+			}
+
+			valence[0] = 0.0f;
+			for (unsigned int i = 1; i < FORSYTH_VALENCE_TABLE_SIZE; i++)
+			{
+				valence[i] = VALENCE_BOOST_SCALE * powf(static_cast<float>(i), -VALENCE_BOOST_POWER);
+			}
+		}
+
+		float Score(int cachePosition, unsigned int liveTriangles) const
+		{
+			if (liveTriangles == 0)
+			{
+				// Nothing left to draw with this vertex.
+				return -1.0f;
+			}
+
+			float score = cachePosition >= 0 ? this->cachePosition[cachePosition] : 0.0f;
+
+			score += liveTriangles < FORSYTH_VALENCE_TABLE_SIZE
+				? valence[liveTriangles]
+				: VALENCE_BOOST_SCALE * powf(static_cast<float>(liveTriangles), -VALENCE_BOOST_POWER);
+
+			return score;
+		}
+	};
+
+	// Add a triangle to a FIFO cache, vertices are in the cache if they missed within the last cacheSize misses.
+	//	returns: The number of vertices which missed
+	inline unsigned int UpdateCache(const unsigned int* triangle, unsigned int cacheSize, unsigned int* timestamps, unsigned int& timestamp)
+	{
+		unsigned int misses = 0;
+
+		for (int i = 0; i < 3; i++)
+		{
+			auto vertex = triangle[i];
+			if (timestamp - timestamps[vertex] > cacheSize)
+			{
+				timestamps[vertex] = timestamp++;
+				misses++;
+			}
+		}
+
+		return misses;
+	}
+
+	// Triangles where the cache has been flushed, the start of a disjoint patch of the mesh.
+	void FindHardBoundaries(const unsigned int* indices, unsigned int triangleCount, vector<unsigned int>& timestamps, vector<unsigned int>& boundaries)
+	{
+		std::fill(timestamps.begin(), timestamps.end(), 0);
+		unsigned int timestamp = OVERDRAW_CACHE_SIZE + 1;
+
+		for (unsigned int i = 0; i < triangleCount; i++)
+		{
+			auto misses = UpdateCache(indices + i * 3, OVERDRAW_CACHE_SIZE, timestamps.data(), timestamp);
+
+			if (i == 0 || misses == 3)
+			{
+				boundaries.push_back(i);
+			}
+		}
+	}
+
+	// Split each hard cluster wherever the ACMR so far is within threshold of the whole cluster's.
+	void FindSoftBoundaries(const unsigned int* indices, unsigned int triangleCount, const vector<unsigned int>& hardBoundaries,
+		float threshold, vector<unsigned int>& timestamps, vector<unsigned int>& boundaries)
+	{
+		std::fill(timestamps.begin(), timestamps.end(), 0);
+		unsigned int timestamp = 0;
+
+		for (size_t cluster = 0; cluster < hardBoundaries.size(); cluster++)
+		{
+			auto start = hardBoundaries[cluster];
+			auto end = cluster + 1 < hardBoundaries.size() ? hardBoundaries[cluster + 1] : triangleCount;
+
+			timestamp += OVERDRAW_CACHE_SIZE + 1;
+
+			unsigned int clusterMisses = 0;
+			for (auto i = start; i < end; i++)
+			{
+				clusterMisses += UpdateCache(indices + i * 3, OVERDRAW_CACHE_SIZE, timestamps.data(), timestamp);
+			}
+
+			float clusterThreshold = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+			boundaries.push_back(start);
+
+			timestamp += OVERDRAW_CACHE_SIZE + 1;
+
+			unsigned int runningMisses = 0;
+			unsigned int runningTriangles = 0;
+
+			for (auto i = start; i < end; i++)
+			{
+				runningMisses += UpdateCache(indices + i * 3, OVERDRAW_CACHE_SIZE, timestamps.data(), timestamp);
+				runningTriangles++;
+
+				if (static_cast<float>(runningMisses) / static_cast<float>(runningTriangles) <= clusterThreshold)
+				{
+					// Target reached, start a new cluster on the next triangle with a cold cache.
+					boundaries.push_back(i + 1);
+
+					timestamp += OVERDRAW_CACHE_SIZE + 1;
+					runningMisses = 0;
+					runningTriangles = 0;
+				}
+			}
+
+			// The last triangle may have closed the cluster, which would leave an empty one behind.
+			if (boundaries.back() == end)
+			{
+				boundaries.pop_back();
+			}
+		}
+	}
+
+	// New position of each vertex: the order the indices first use them, then the unused ones.
+	void BuildFetchRemap(const unsigned int* indices, unsigned int indexCount, unsigned int vertexCount, vector<unsigned int>& remap)
+	{
+		const unsigned int UNUSED = ~0u;
+
+		remap.assign(vertexCount, UNUSED);
+		unsigned int next = 0;
+
+		for (unsigned int i = 0; i < indexCount; i++)
+		{
+			auto& target = remap[indices[i]];
+			if (target == UNUSED)
+			{
+				target = next++;
+			}
+		}
+
+		for (auto& target : remap)
+		{
+			if (target == UNUSED)
+			{
+				target = next++;
+			}
+		}
+	}
+
+	void ApplyFetchRemap(const vector<unsigned int>& remap, VertexStandard* vertices, unsigned int vertexCount)
+	{
+		vector<VertexStandard> reordered(vertexCount);
+		for (unsigned int v = 0; v < vertexCount; v++)
+		{
+			reordered[remap[v]] = vertices[v];
+		}
+
+		std::copy(reordered.begin(), reordered.end(), vertices);
+	}
+}
+
+void VertexCacheStatistics::Add(const VertexCacheStatistics& other)
+{
+	vertexTransforms += other.vertexTransforms;
+	triangleCount += other.triangleCount;
+	vertexCount += other.vertexCount;
+
+	acmr = triangleCount > 0 ? static_cast<float>(vertexTransforms) / static_cast<float>(triangleCount) : 0.0f;
+	atvr = vertexCount > 0 ? static_cast<float>(vertexTransforms) / static_cast<float>(vertexCount) : 0.0f;
+}
+
+VertexCacheStatistics TinyEngine::AnalyzeVertexCache(const unsigned int* indices, unsigned int indexCount, unsigned int vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStatistics statistics;
+
+	vector<unsigned int> timestamps(vertexCount, 0);
+	unsigned int timestamp = cacheSize + 1;
+
+	vector<bool> referenced(vertexCount, false);
+
+	unsigned int triangleCount = indexCount / 3;
+	for (unsigned int i = 0; i < triangleCount; i++)
+	{
+		statistics.vertexTransforms += UpdateCache(indices + i * 3, cacheSize, timestamps.data(), timestamp);
+	}
+
+	for (unsigned int i = 0; i < triangleCount * 3; i++)
+	{
+		if (!referenced[indices[i]])
+		{
+			referenced[indices[i]] = true;
+			statistics.vertexCount++;
+		}
+	}
+
+	statistics.triangleCount = triangleCount;
+
+	// Fills in the ratios.
+	statistics.Add(VertexCacheStatistics());
+
+	return statistics;
+}
+
+VertexCacheStatistics TinyEngine::AnalyzeVertexCache(const MeshData& mesh, unsigned int cacheSize)
+{
+	VertexCacheStatistics statistics;
+
+	for (const auto& part : mesh.parts)
+	{
+		statistics.Add(AnalyzeVertexCache(mesh.indices.data() + part.indexStart, part.indexCount, part.vertexCount, cacheSize));
+	}
+
+	return statistics;
+}
+
+void TinyEngine::OptimizeVertexCache(unsigned int* indices, unsigned int indexCount, unsigned int vertexCount)
+{
+	static const ForsythScores scores;
+
+	unsigned int triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Triangles using each vertex. Each vertex's live triangles are kept at the front of its range.
+	vector<unsigned int> liveTriangles(vertexCount, 0);
+	for (unsigned int i = 0; i < triangleCount * 3; i++)
+	{
+		liveTriangles[indices[i]]++;
+	}
+
+	vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+	}
+
+	vector<unsigned int> adjacency(triangleCount * 3);
+	{
+		vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (unsigned int i = 0; i < triangleCount * 3; i++)
+		{
+			adjacency[fill[indices[i]]++] = i / 3;
+		}
+	}
+
+	vector<int> cachePositions(vertexCount, -1);
+	vector<float> vertexScores(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		vertexScores[v] = scores.Score(-1, liveTriangles[v]);
+	}
+
+	vector<float> triangleScores(triangleCount);
+	vector<bool> emitted(triangleCount, false);
+
+	unsigned int bestTriangle = 0;
+	for (unsigned int t = 0; t < triangleCount; t++)
+	{
+		const auto* triangle = indices + t * 3;
+		triangleScores[t] = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+
+		if (triangleScores[t] > triangleScores[bestTriangle])
+		{
+			bestTriangle = t;
+		}
+	}
+
+	vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+
+	unsigned int cache[FORSYTH_CACHE_SIZE + 3];
+	unsigned int cacheCount = 0;
+
+	unsigned int inputCursor = 0;
+
+	while (output.size() < triangleCount * 3)
+	{
+		if (bestTriangle == NO_TRIANGLE)
+		{
+			// Dead end, nothing in the cache has triangles left. Continue from the first remaining triangle.
+			while (emitted[inputCursor])
+			{
+				inputCursor++;
+			}
+			bestTriangle = inputCursor;
+		}
+
+		const auto* triangle = indices + bestTriangle * 3;
+		output.insert(output.end(), triangle, triangle + 3);
+		emitted[bestTriangle] = true;
+
+		// Remove the triangle from its vertices' live lists.
+		for (int corner = 0; corner < 3; corner++)
+		{
+			auto vertex = triangle[corner];
+			auto* begin = adjacency.data() + adjacencyOffsets[vertex];
+			auto* end = begin + liveTriangles[vertex];
+
+			auto* found = std::find(begin, end, bestTriangle);
+			if (found != end)
+			{
+				*found = *(end - 1);
+				liveTriangles[vertex]--;
+			}
+		}
+
+		// Move the triangle's vertices to the front of the LRU cache.
+		unsigned int newCache[FORSYTH_CACHE_SIZE + 3];
+		unsigned int newCacheCount = 0;
+
+		for (int corner = 0; corner < 3; corner++)
+		{
+			auto vertex = triangle[corner];
+			if (std::find(newCache, newCache + newCacheCount, vertex) == newCache + newCacheCount)
+			{
+				newCache[newCacheCount++] = vertex;
+			}
+		}
+
+		const unsigned int triangleVertices = newCacheCount;
+
+		for (unsigned int i = 0; i < cacheCount; i++)
+		{
+			auto vertex = cache[i];
+			if (std::find(newCache, newCache + triangleVertices, vertex) == newCache + triangleVertices)
+			{
+				newCache[newCacheCount++] = vertex;
+			}
+		}
+
+		// Rescore every vertex which moved, including the ones pushed out of the cache.
+		for (unsigned int i = 0; i < newCacheCount; i++)
+		{
+			auto vertex = newCache[i];
+			cachePositions[vertex] = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+			vertexScores[vertex] = scores.Score(cachePositions[vertex], liveTriangles[vertex]);
+		}
+
+		bestTriangle = NO_TRIANGLE;
+		float bestScore = -1.0f;
+
+		for (unsigned int i = 0; i < newCacheCount; i++)
+		{
+			auto vertex = newCache[i];
+			const auto* begin = adjacency.data() + adjacencyOffsets[vertex];
+
+			for (unsigned int j = 0; j < liveTriangles[vertex]; j++)
+			{
+				auto t = begin[j];
+				const auto* adjacent = indices + t * 3;
+
+				float score = vertexScores[adjacent[0]] + vertexScores[adjacent[1]] + vertexScores[adjacent[2]];
+				triangleScores[t] = score;
+
+				if (i < FORSYTH_CACHE_SIZE && score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+
+		cacheCount = std::min(newCacheCount, FORSYTH_CACHE_SIZE);
+		std::copy(newCache, newCache + cacheCount, cache);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void TinyEngine::OptimizeOverdraw(unsigned int* indices, unsigned int indexCount, const VertexStandard* vertices, unsigned int vertexCount, float threshold)
+{
+	unsigned int triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	vector<unsigned int> timestamps(vertexCount);
+
+	vector<unsigned int> hardBoundaries;
+	FindHardBoundaries(indices, triangleCount, timestamps, hardBoundaries);
+
+	vector<unsigned int> clusters;
+	FindSoftBoundaries(indices, triangleCount, hardBoundaries, threshold, timestamps, clusters);
+
+	// Area weighted centroid and normal of each cluster, and the centroid of the whole mesh.
+	vector<XMFLOAT3> clusterCentroids(clusters.size());
+	vector<XMFLOAT3> clusterNormals(clusters.size());
+
+	XMVECTOR meshCentroid = XMVectorZero();
+	float meshArea = 0.0f;
+
+	for (size_t cluster = 0; cluster < clusters.size(); cluster++)
+	{
+		auto start = clusters[cluster];
+		auto end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangleCount;
+
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+
+		for (auto t = start; t < end; t++)
+		{
+			XMVECTOR a = XMLoadFloat3(&vertices[indices[t * 3 + 0]].position);
+			XMVECTOR b = XMLoadFloat3(&vertices[indices[t * 3 + 1]].position);
+			XMVECTOR c = XMLoadFloat3(&vertices[indices[t * 3 + 2]].position);
+
+			// Twice the area.
+			XMVECTOR cross = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+			float triangleArea = XMVectorGetX(XMVector3Length(cross));
+
+			centroid = XMVectorAdd(centroid, XMVectorScale(XMVectorAdd(XMVectorAdd(a, b), c), triangleArea / 3.0f));
+			normal = XMVectorAdd(normal, cross);
+			area += triangleArea;
+		}
+
+		meshCentroid = XMVectorAdd(meshCentroid, centroid);
+		meshArea += area;
+
+		XMStoreFloat3(&clusterCentroids[cluster], area > 0.0f ? XMVectorScale(centroid, 1.0f / area) : centroid);
+		XMStoreFloat3(&clusterNormals[cluster], XMVector3Normalize(normal));
+	}
+
+	if (meshArea > 0.0f)
+	{
+		meshCentroid = XMVectorScale(meshCentroid, 1.0f / meshArea);
+	}
+
+	// Clusters facing away from the centre of the mesh are likely to occlude the others, draw them first.
+	vector<float> sortKeys(clusters.size());
+	for (size_t cluster = 0; cluster < clusters.size(); cluster++)
+	{
+		XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&clusterCentroids[cluster]), meshCentroid);
+		sortKeys[cluster] = XMVectorGetX(XMVector3Dot(offset, XMLoadFloat3(&clusterNormals[cluster])));
+	}
+
+	vector<unsigned int> order(clusters.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](unsigned int a, unsigned int b) { return sortKeys[a] > sortKeys[b]; });
+
+	vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+
+	for (auto cluster : order)
+	{
+		auto start = clusters[cluster];
+		auto end = cluster + 1 < clusters.size() ? clusters[cluster + 1] : triangleCount;
+		output.insert(output.end(), indices + start * 3, indices + end * 3);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void TinyEngine::OptimizeVertexFetch(unsigned int* indices, unsigned int indexCount, VertexStandard* vertices, unsigned int vertexCount)
+{
+	vector<unsigned int> remap;
+	BuildFetchRemap(indices, indexCount, vertexCount, remap);
+	ApplyFetchRemap(remap, vertices, vertexCount);
+
+	for (unsigned int i = 0; i < indexCount; i++)
+	{
+		indices[i] = remap[indices[i]];
+	}
+}
+
+void TinyEngine::OptimizeMesh(MeshData& mesh, bool vertexCache, bool overdraw, float overdrawThreshold, bool vertexFetch)
+{
+	vector<unsigned int> remap;
+
+	for (const auto& part : mesh.parts)
+	{
+		auto* vertices = mesh.vertices.data() + part.baseVertex;
+
+		// The full detail level followed by the simplified ones, they all share the part's vertices.
+		vector<MeshDataLod> levels(1);
+		levels[0].indexStart = part.indexStart;
+		levels[0].indexCount = part.indexCount;
+		levels.insert(levels.end(), part.lods.begin(), part.lods.end());
+
+		if (vertexCache)
+		{
+			for (const auto& level : levels)
+			{
+				auto* indices = mesh.indices.data() + level.indexStart;
+				OptimizeVertexCache(indices, level.indexCount, part.vertexCount);
+
+				if (overdraw)
+				{
+					OptimizeOverdraw(indices, level.indexCount, vertices, part.vertexCount, overdrawThreshold);
+				}
+			}
+		}
+
+		if (vertexFetch)
+		{
+			// Order for the full detail level, the simplified levels use a subset of its vertices.
+			BuildFetchRemap(mesh.indices.data() + part.indexStart, part.indexCount, part.vertexCount, remap);
+			ApplyFetchRemap(remap, vertices, part.vertexCount);
+
+			for (const auto& level : levels)
+			{
+				for (unsigned int i = level.indexStart; i < level.indexStart + level.indexCount; i++)
+				{
+					mesh.indices[i] = remap[mesh.indices[i]];
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "MeshData.h"
+
+namespace TinyEngine
+{
+	// How well an index buffer uses a FIFO post-transform vertex cache.
+	struct VertexCacheStatistics
+	{
+		// Vertices the simulated cache had to transform.
+		unsigned int vertexTransforms = 0;
+		unsigned int triangleCount = 0;
+		// Distinct vertices referenced by the indices.
+		unsigned int vertexCount = 0;
+
+		// Average cache miss ratio, transforms per triangle. 0.5 is ideal for a regular grid, 3 is the worst case.
+		float acmr = 0.0f;
+		// Average transform to vertex ratio, transforms per referenced vertex. 1 is ideal.
+		float atvr = 0.0f;
+
+		// Accumulate another index buffer's statistics into these.
+		void Add(const VertexCacheStatistics& other);
+	};
+
+	// Simulate a FIFO post-transform cache over a triangle list.
+	//	const unsigned int* indices: Triangle list
+	//	unsigned int indexCount: Number of indices
+	//	unsigned int vertexCount: Number of vertices the indices can reference
+	//	unsigned int cacheSize: Entries in the simulated cache
+	//	returns: Cache statistics for the indices
+	VertexCacheStatistics AnalyzeVertexCache(const unsigned int* indices, unsigned int indexCount, unsigned int vertexCount, unsigned int cacheSize = 16);
+
+	// Analyze every part of a mesh and combine the results.
+	VertexCacheStatistics AnalyzeVertexCache(const MeshData& mesh, unsigned int cacheSize = 16);
+
+	// Reorder triangles for post-transform cache locality using Forsyth's linear-speed algorithm.
+	//	unsigned int* indices: Triangle list to reorder in place
+	//	unsigned int indexCount: Number of indices
+	//	unsigned int vertexCount: Number of vertices the indices can reference
+	void OptimizeVertexCache(unsigned int* indices, unsigned int indexCount, unsigned int vertexCount);
+
+	// Reorder clusters of cache optimized triangles so outward facing clusters are drawn first,
+	// which reduces overdraw (Sander et al, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw").
+	// Run this after OptimizeVertexCache, the clusters are the runs it produced.
+	//	unsigned int* indices: Triangle list to reorder in place
+	//	unsigned int indexCount: Number of indices
+	//	const VertexStandard* vertices: Vertices the indices reference
+	//	unsigned int vertexCount: Number of vertices
+	//	float threshold: How much the ACMR may worsen to allow finer clusters, 1.05 allows 5%
+	void OptimizeOverdraw(unsigned int* indices, unsigned int indexCount, const VertexStandard* vertices, unsigned int vertexCount, float threshold = 1.05f);
+
+	// Reorder vertices into the order the indices first reference them, and remap the indices.
+	// Vertices which aren't referenced are moved to the end.
+	//	unsigned int* indices: Triangle list to remap in place
+	//	unsigned int indexCount: Number of indices
+	//	VertexStandard* vertices: Vertices to reorder in place
+	//	unsigned int vertexCount: Number of vertices
+	void OptimizeVertexFetch(unsigned int* indices, unsigned int indexCount, VertexStandard* vertices, unsigned int vertexCount);
+
+	// Run the optimizers on every part of a mesh, including its levels of detail. Parts keep their index and vertex ranges.
+	//	MeshData& mesh: Mesh to optimize in place
+	//	bool vertexCache: Reorder triangles for the post-transform cache
+	//	bool overdraw: Reorder triangle clusters to reduce overdraw, needs vertexCache
+	//	float overdrawThreshold: See OptimizeOverdraw
+	//	bool vertexFetch: Reorder vertices for fetch locality
+	void OptimizeMesh(MeshData& mesh, bool vertexCache = true, bool overdraw = true, float overdrawThreshold = 1.05f, bool vertexFetch = true);
+}
@@ -0,0 +1,593 @@
+#include "MeshSimplify.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+using namespace TinyEngine;
+
+using std::vector;
+
+namespace
+{
+	// Open borders are held in place by planes perpendicular to them, weighted by this.
+	const double BORDER_WEIGHT = 10.0;
+
+	enum class VertexKind : uint8_t
+	{
+		// Can collapse onto any neighbour.
+		MANIFOLD,
+		// On an open border, can only collapse along it.
+		BORDER,
+		// Touches a non-manifold edge, never collapses.
+		LOCKED
+	};
+
+	struct Vector3
+	{
+		double x, y, z;
+	};
+
+	inline Vector3 Subtract(const Vector3& a, const Vector3& b)
+	{
+		return { a.x - b.x, a.y - b.y, a.z - b.z };
+	}
+
+	inline Vector3 Cross(const Vector3& a, const Vector3& b)
+	{
+		return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+	}
+
+	inline double Dot(const Vector3& a, const Vector3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	inline double Length(const Vector3& a)
+	{
+		return sqrt(Dot(a, a));
+	}
+
+	// Sum of squared distances to a set of weighted planes: p'Ap + 2b'p + c.
+	struct Quadric
+	{
+		double a00 = 0, a11 = 0, a22 = 0;
+		double a01 = 0, a02 = 0, a12 = 0;
+		double b0 = 0, b1 = 0, b2 = 0;
+		double c = 0;
+		double weight = 0;
+
+		void AddPlane(const Vector3& normal, double distance, double planeWeight)
+		{
+			a00 += normal.x * normal.x * planeWeight;
+			a11 += normal.y * normal.y * planeWeight;
+			a22 += normal.z * normal.z * planeWeight;
+			a01 += normal.x * normal.y * planeWeight;
+			a02 += normal.x * normal.z * planeWeight;
+			a12 += normal.y * normal.z * planeWeight;
+			b0 += normal.x * distance * planeWeight;
+			b1 += normal.y * distance * planeWeight;
+			b2 += normal.z * distance * planeWeight;
+			c += distance * distance * planeWeight;
+			weight += planeWeight;
+		}
+
+		void Add(const Quadric& other)
+		{
+			a00 += other.a00; a11 += other.a11; a22 += other.a22;
+			a01 += other.a01; a02 += other.a02; a12 += other.a12;
+			b0 += other.b0; b1 += other.b1; b2 += other.b2;
+			c += other.c;
+			weight += other.weight;
+		}
+
+		// Mean squared distance from p to the planes.
+		double Evaluate(const Vector3& p) const
+		{
+			double r = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z
+				+ 2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+				+ 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+
+			return weight > 0.0 ? fabs(r) / weight : 0.0;
+		}
+	};
+
+	struct Collapse
+	{
+		unsigned int from;
+		unsigned int to;
+		double cost;
+	};
+
+	inline uint64_t EdgeKey(unsigned int a, unsigned int b)
+	{
+		return (static_cast<uint64_t>(a) << 32) | b;
+	}
+
+	inline bool HasEdge(const vector<uint64_t>& sortedEdges, unsigned int a, unsigned int b)
+	{
+		return std::binary_search(sortedEdges.begin(), sortedEdges.end(), EdgeKey(a, b));
+	}
+
+	// How different two vertices' attributes are, used to pick which vertex a corner collapses to.
+	inline float AttributeDistance(const VertexStandard& a, const VertexStandard& b)
+	{
+		float du = a.texcoord.x - b.texcoord.x;
+		float dv = a.texcoord.y - b.texcoord.y;
+		float dn = a.normal.x * b.normal.x + a.normal.y * b.normal.y + a.normal.z * b.normal.z;
+
+		return du * du + dv * dv + (1.0f - dn);
+	}
+}
+
+unsigned int TinyEngine::SimplifyIndices(unsigned int* destination, const unsigned int* indices, unsigned int indexCount,
+	const VertexStandard* vertices, unsigned int vertexCount, unsigned int targetIndexCount, float targetError, float* resultError)
+{
+	unsigned int triangleCount = indexCount / 3;
+
+	if (resultError)
+	{
+		*resultError = 0.0f;
+	}
+
+	// Normalize positions into a unit cube so errors are relative to the extent.
+	float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		const float p[3] = { vertices[v].position.x, vertices[v].position.y, vertices[v].position.z };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			minimum[axis] = std::min(minimum[axis], p[axis]);
+			maximum[axis] = std::max(maximum[axis], p[axis]);
+		}
+	}
+
+	float extent = std::max(std::max(maximum[0] - minimum[0], maximum[1] - minimum[1]), maximum[2] - minimum[2]);
+	double scale = extent > 0.0f ? 1.0 / extent : 0.0;
+
+	vector<Vector3> positions(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		positions[v] = {
+			(vertices[v].position.x - minimum[0]) * scale,
+			(vertices[v].position.y - minimum[1]) * scale,
+			(vertices[v].position.z - minimum[2]) * scale };
+	}
+
+	// Vertices sharing a position are simplified as one. The lowest index in each group represents it.
+	vector<unsigned int> sorted(vertexCount);
+	std::iota(sorted.begin(), sorted.end(), 0);
+	auto positionLess = [vertices](unsigned int a, unsigned int b)
+	{
+		const auto& pa = vertices[a].position;
+		const auto& pb = vertices[b].position;
+		if (pa.x != pb.x) return pa.x < pb.x;
+		if (pa.y != pb.y) return pa.y < pb.y;
+		if (pa.z != pb.z) return pa.z < pb.z;
+		return a < b;
+	};
+	std::sort(sorted.begin(), sorted.end(), positionLess);
+
+	vector<unsigned int> representative(vertexCount);
+	// Vertices sharing each representative's position, as ranges of wedges.
+	vector<unsigned int> wedgeStart(vertexCount, 0);
+	vector<unsigned int> wedgeCount(vertexCount, 0);
+	vector<unsigned int> wedges(sorted);
+
+	for (unsigned int i = 0; i < vertexCount;)
+	{
+		unsigned int j = i + 1;
+		const auto& p = vertices[sorted[i]].position;
+		while (j < vertexCount && vertices[sorted[j]].position.x == p.x && vertices[sorted[j]].position.y == p.y && vertices[sorted[j]].position.z == p.z)
+		{
+			j++;
+		}
+
+		// sorted is ordered by index within a position, so the first is the lowest.
+		unsigned int group = sorted[i];
+		for (unsigned int k = i; k < j; k++)
+		{
+			representative[sorted[k]] = group;
+		}
+
+		wedgeStart[group] = i;
+		wedgeCount[group] = j - i;
+		i = j;
+	}
+
+	// Triangles as representatives, plus the vertex each corner currently uses.
+	vector<unsigned int> corners;
+	vector<unsigned int> triangles;
+	corners.reserve(triangleCount * 3);
+	triangles.reserve(triangleCount * 3);
+
+	for (unsigned int t = 0; t < triangleCount; t++)
+	{
+		unsigned int a = representative[indices[t * 3 + 0]];
+		unsigned int b = representative[indices[t * 3 + 1]];
+		unsigned int c = representative[indices[t * 3 + 2]];
+
+		if (a == b || b == c || c == a)
+		{
+			continue;
+		}
+
+		triangles.insert(triangles.end(), { a, b, c });
+		corners.insert(corners.end(), indices + t * 3, indices + t * 3 + 3);
+	}
+
+	// Classify vertices from the directed edges. An edge without its reverse is an open border,
+	// an edge which appears twice in the same direction is non-manifold.
+	vector<uint64_t> edges;
+	edges.reserve(triangles.size());
+	for (size_t t = 0; t < triangles.size(); t += 3)
+	{
+		for (int e = 0; e < 3; e++)
+		{
+			edges.push_back(EdgeKey(triangles[t + e], triangles[t + (e + 1) % 3]));
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+
+	vector<VertexKind> kinds(vertexCount, VertexKind::MANIFOLD);
+	vector<Quadric> quadrics(vertexCount);
+
+	for (size_t i = 0; i < edges.size(); i++)
+	{
+		auto a = static_cast<unsigned int>(edges[i] >> 32);
+		auto b = static_cast<unsigned int>(edges[i]);
+
+		if (i + 1 < edges.size() && edges[i + 1] == edges[i])
+		{
+			kinds[a] = VertexKind::LOCKED;
+			kinds[b] = VertexKind::LOCKED;
+		}
+		else if (!HasEdge(edges, b, a))
+		{
+			if (kinds[a] != VertexKind::LOCKED)
+			{
+				kinds[a] = VertexKind::BORDER;
+			}
+			if (kinds[b] != VertexKind::LOCKED)
+			{
+				kinds[b] = VertexKind::BORDER;
+			}
+		}
+	}
+
+	// Plane quadrics, weighted by area, and border planes to keep open edges in place.
+	for (size_t t = 0; t < triangles.size(); t += 3)
+	{
+		const auto& p0 = positions[triangles[t + 0]];
+		const auto& p1 = positions[triangles[t + 1]];
+		const auto& p2 = positions[triangles[t + 2]];
+
+		Vector3 normal = Cross(Subtract(p1, p0), Subtract(p2, p0));
+		double area = Length(normal);
+		if (area == 0.0)
+		{
+			continue;
+		}
+
+		normal = { normal.x / area, normal.y / area, normal.z / area };
+
+		Quadric quadric;
+		quadric.AddPlane(normal, -Dot(normal, p0), area * 0.5);
+
+		for (int e = 0; e < 3; e++)
+		{
+			unsigned int a = triangles[t + e];
+			unsigned int b = triangles[t + (e + 1) % 3];
+
+			quadrics[a].Add(quadric);
+
+			if (!HasEdge(edges, b, a))
+			{
+				Vector3 edge = Subtract(positions[b], positions[a]);
+				double length = Length(edge);
+				if (length > 0.0)
+				{
+					Vector3 borderNormal = Cross(edge, normal);
+					double borderLength = Length(borderNormal);
+					borderNormal = { borderNormal.x / borderLength, borderNormal.y / borderLength, borderNormal.z / borderLength };
+
+					Quadric border;
+					border.AddPlane(borderNormal, -Dot(borderNormal, positions[a]), length * length * BORDER_WEIGHT);
+					quadrics[a].Add(border);
+					quadrics[b].Add(border);
+				}
+			}
+		}
+	}
+
+	const double maxCost = static_cast<double>(targetError) * static_cast<double>(targetError);
+	double worstCost = 0.0;
+
+	vector<unsigned int> collapseTarget(vertexCount);
+	vector<bool> touched(vertexCount);
+	vector<Collapse> candidates;
+	vector<unsigned int> adjacencyOffsets;
+	vector<unsigned int> adjacency;
+
+	while (triangles.size() > targetIndexCount)
+	{
+		unsigned int liveTriangles = static_cast<unsigned int>(triangles.size() / 3);
+
+		// Directed edges of the current triangles, for border tests.
+		edges.clear();
+		for (size_t t = 0; t < triangles.size(); t += 3)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				edges.push_back(EdgeKey(triangles[t + e], triangles[t + (e + 1) % 3]));
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+
+		// Triangles around each vertex, for flip tests.
+		adjacencyOffsets.assign(vertexCount + 1, 0);
+		for (auto v : triangles)
+		{
+			adjacencyOffsets[v + 1]++;
+		}
+		std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+		adjacency.resize(triangles.size());
+		{
+			vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < triangles.size(); i++)
+			{
+				adjacency[fill[triangles[i]]++] = static_cast<unsigned int>(i / 3);
+			}
+		}
+
+		auto canCollapse = [&](unsigned int from, unsigned int to)
+		{
+			if (kinds[from] == VertexKind::MANIFOLD)
+			{
+				return true;
+			}
+
+			// A border vertex may only slide along its border.
+			return kinds[from] == VertexKind::BORDER && kinds[to] != VertexKind::MANIFOLD
+				&& (!HasEdge(edges, to, from) || !HasEdge(edges, from, to));
+		};
+
+		candidates.clear();
+		for (size_t i = 0; i < edges.size(); i++)
+		{
+			auto a = static_cast<unsigned int>(edges[i] >> 32);
+			auto b = static_cast<unsigned int>(edges[i]);
+
+			// Each undirected edge once, from its lower vertex or from its only direction.
+			if (a > b && HasEdge(edges, b, a))
+			{
+				continue;
+			}
+
+			bool ab = canCollapse(a, b);
+			bool ba = canCollapse(b, a);
+
+			double costAB = ab ? quadrics[a].Evaluate(positions[b]) : DBL_MAX;
+			double costBA = ba ? quadrics[b].Evaluate(positions[a]) : DBL_MAX;
+
+			if (ab || ba)
+			{
+				candidates.push_back(costAB <= costBA ? Collapse{ a, b, costAB } : Collapse{ b, a, costBA });
+			}
+		}
+
+		std::stable_sort(candidates.begin(), candidates.end(), [](const Collapse& x, const Collapse& y) { return x.cost < y.cost; });
+
+		// Each collapse removes about two triangles, don't overshoot the target in one pass.
+		unsigned int goal = std::max((liveTriangles - targetIndexCount / 3) / 2, 1u);
+		unsigned int collapses = 0;
+
+		std::iota(collapseTarget.begin(), collapseTarget.end(), 0);
+		std::fill(touched.begin(), touched.end(), false);
+
+		for (const auto& candidate : candidates)
+		{
+			if (candidate.cost > maxCost || collapses >= goal)
+			{
+				break;
+			}
+
+			if (touched[candidate.from] || touched[candidate.to])
+			{
+				continue;
+			}
+
+			// Reject collapses which would flip a surviving triangle.
+			bool flips = false;
+			const auto& target = positions[candidate.to];
+
+			for (auto k = adjacencyOffsets[candidate.from]; k < adjacencyOffsets[candidate.from + 1] && !flips; k++)
+			{
+				const auto* triangle = &triangles[adjacency[k] * 3];
+				if (triangle[0] == candidate.to || triangle[1] == candidate.to || triangle[2] == candidate.to)
+				{
+					continue;
+				}
+
+				int corner = triangle[0] == candidate.from ? 0 : (triangle[1] == candidate.from ? 1 : 2);
+				const auto& b = positions[triangle[(corner + 1) % 3]];
+				const auto& c = positions[triangle[(corner + 2) % 3]];
+				const auto& a = positions[candidate.from];
+
+				Vector3 before = Cross(Subtract(b, a), Subtract(c, a));
+				Vector3 after = Cross(Subtract(b, target), Subtract(c, target));
+
+				flips = Dot(before, after) <= 0.0;
+			}
+
+			if (flips)
+			{
+				continue;
+			}
+
+			collapseTarget[candidate.from] = candidate.to;
+			quadrics[candidate.to].Add(quadrics[candidate.from]);
+			touched[candidate.from] = true;
+			touched[candidate.to] = true;
+
+			worstCost = std::max(worstCost, candidate.cost);
+			collapses++;
+		}
+
+		if (collapses == 0)
+		{
+			break;
+		}
+
+		// Apply the collapses and drop triangles which became degenerate.
+		size_t write = 0;
+		for (size_t t = 0; t < triangles.size(); t += 3)
+		{
+			unsigned int collapsed[3];
+			unsigned int vertex[3];
+
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int from = triangles[t + k];
+				unsigned int to = collapseTarget[from];
+
+				collapsed[k] = to;
+				vertex[k] = corners[t + k];
+
+				if (to != from)
+				{
+					// Use whichever vertex at the new position looks most like the old one.
+					const auto& original = vertices[corners[t + k]];
+					float best = FLT_MAX;
+
+					for (auto w = wedgeStart[to]; w < wedgeStart[to] + wedgeCount[to]; w++)
+					{
+						float distance = AttributeDistance(original, vertices[wedges[w]]);
+						if (distance < best)
+						{
+							best = distance;
+							vertex[k] = wedges[w];
+						}
+					}
+				}
+			}
+
+			if (collapsed[0] == collapsed[1] || collapsed[1] == collapsed[2] || collapsed[2] == collapsed[0])
+			{
+				continue;
+			}
+
+			for (int k = 0; k < 3; k++)
+			{
+				triangles[write + k] = collapsed[k];
+				corners[write + k] = vertex[k];
+			}
+			write += 3;
+		}
+
+		triangles.resize(write);
+		corners.resize(write);
+	}
+
+	std::copy(corners.begin(), corners.end(), destination);
+
+	if (resultError)
+	{
+		*resultError = static_cast<float>(sqrt(worstCost));
+	}
+
+	return static_cast<unsigned int>(corners.size());
+}
+
+void TinyEngine::GenerateLods(MeshData& mesh, unsigned int levelCount, float reduction, float maxError)
+{
+	mesh.lodErrors.clear();
+	for (auto& part : mesh.parts)
+	{
+		part.lods.clear();
+	}
+
+	if (levelCount == 0 || mesh.parts.empty())
+	{
+		return;
+	}
+
+	// Errors come back relative to each part's extent.
+	vector<float> extents;
+	for (const auto& part : mesh.parts)
+	{
+		float minimum[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float maximum[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		for (unsigned int v = part.baseVertex; v < part.baseVertex + part.vertexCount; v++)
+		{
+			const float p[3] = { mesh.vertices[v].position.x, mesh.vertices[v].position.y, mesh.vertices[v].position.z };
+			for (int axis = 0; axis < 3; axis++)
+			{
+				minimum[axis] = std::min(minimum[axis], p[axis]);
+				maximum[axis] = std::max(maximum[axis], p[axis]);
+			}
+		}
+
+		extents.push_back(part.vertexCount > 0 ? std::max(std::max(maximum[0] - minimum[0], maximum[1] - minimum[1]), maximum[2] - minimum[2]) : 0.0f);
+	}
+
+	mesh.lodErrors.push_back(0.0f);
+
+	vector<unsigned int> simplified;
+	float ratio = 1.0f;
+
+	for (unsigned int level = 1; level <= levelCount; level++)
+	{
+		ratio *= reduction;
+
+		auto levelStart = mesh.indices.size();
+		float levelError = mesh.lodErrors.back();
+		bool reduced = false;
+
+		for (size_t p = 0; p < mesh.parts.size(); p++)
+		{
+			auto& part = mesh.parts[p];
+			unsigned int previousCount = part.lods.empty() ? part.indexCount : part.lods.back().indexCount;
+			unsigned int target = static_cast<unsigned int>(part.indexCount * ratio) / 3 * 3;
+
+			simplified.resize(part.indexCount);
+
+			float error = 0.0f;
+			unsigned int count = SimplifyIndices(simplified.data(), mesh.indices.data() + part.indexStart, part.indexCount,
+				mesh.vertices.data() + part.baseVertex, part.vertexCount, target, maxError, &error);
+
+			reduced |= count < previousCount;
+			levelError = std::max(levelError, error * extents[p]);
+
+			MeshDataLod lod;
+			lod.indexStart = static_cast<unsigned int>(mesh.indices.size());
+			lod.indexCount = count;
+			part.lods.push_back(lod);
+
+			mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.begin() + count);
+		}
+
+		if (!reduced)
+		{
+			// Nothing got simpler, drop the level and stop.
+			mesh.indices.resize(levelStart);
+			for (auto& part : mesh.parts)
+			{
+				part.lods.pop_back();
+			}
+			break;
+		}
+
+		mesh.lodErrors.push_back(levelError);
+	}
+
+	if (mesh.lodErrors.size() == 1)
+	{
+		mesh.lodErrors.clear();
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "MeshData.h"
+#include "VertexStandard.h"
+
+namespace TinyEngine
+{
+	// Simplify a triangle list by collapsing edges, cheapest first by quadric error (Garland and Heckbert).
+	// Vertices are collapsed onto existing vertices so the result indexes the same vertex buffer.
+	// Vertices which share a position are collapsed together, each corner then takes the collapsed
+	// vertex whose texcoord and normal are closest to its own. Open borders only collapse along themselves.
+	//	unsigned int* destination: Receives the simplified indices, needs room for indexCount. May alias indices
+	//	const unsigned int* indices: Triangle list to simplify
+	//	unsigned int indexCount: Number of indices
+	//	const VertexStandard* vertices: Vertices the indices reference
+	//	unsigned int vertexCount: Number of vertices
+	//	unsigned int targetIndexCount: Stop once there are this many indices or fewer
+	//	float targetError: Stop before the error exceeds this, relative to the largest extent of the vertices
+	//	float* resultError: Receives the error of the result relative to the largest extent. Optional
+	//	returns: Number of indices written to destination
+	unsigned int SimplifyIndices(unsigned int* destination, const unsigned int* indices, unsigned int indexCount,
+		const VertexStandard* vertices, unsigned int vertexCount, unsigned int targetIndexCount, float targetError, float* resultError = nullptr);
+
+	// Build levels of detail for every part of a mesh, filling MeshDataPart::lods and MeshData::lodErrors.
+	// Each level aims for reduction times the previous level's triangles. Generation stops early once no part
+	// can be simplified further within maxError.
+	//	MeshData& mesh: Mesh to add levels to. Existing levels are replaced
+	//	unsigned int levelCount: Simplified levels to build, not counting the full detail level
+	//	float reduction: Fraction of triangles each level keeps, 0.5 halves them
+	//	float maxError: Largest error allowed, relative to each part's largest extent
+	void GenerateLods(MeshData& mesh, unsigned int levelCount, float reduction = 0.5f, float maxError = 0.05f);
+}
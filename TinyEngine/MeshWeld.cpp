@@ -0,0 +1,188 @@
+#include "MeshWeld.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+using namespace TinyEngine;
+
+using std::vector;
+
+namespace
+{
+	const unsigned int EMPTY_SLOT = ~0u;
+
+	inline uint64_t Mix(uint64_t h)
+	{
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ull;
+		h ^= h >> 33;
+		return h;
+	}
+
+	inline uint64_t HashVertex(const VertexStandard& vertex)
+	{
+		static_assert(sizeof(VertexStandard) == 8 * sizeof(uint32_t), "VertexStandard is expected to be 8 tightly packed floats.");
+
+		uint32_t words[8];
+		memcpy(words, &vertex, sizeof(words));
+
+		uint64_t h = 0;
+		for (auto word : words)
+		{
+			h = Mix(h ^ word);
+		}
+		return h;
+	}
+
+	inline bool IsNear(const VertexStandard& a, const VertexStandard& b, float epsilon)
+	{
+		return fabsf(a.position.x - b.position.x) <= epsilon
+			&& fabsf(a.position.y - b.position.y) <= epsilon
+			&& fabsf(a.position.z - b.position.z) <= epsilon
+			&& fabsf(a.texcoord.x - b.texcoord.x) <= epsilon
+			&& fabsf(a.texcoord.y - b.texcoord.y) <= epsilon
+			&& fabsf(a.normal.x - b.normal.x) <= epsilon
+			&& fabsf(a.normal.y - b.normal.y) <= epsilon
+			&& fabsf(a.normal.z - b.normal.z) <= epsilon;
+	}
+
+	inline uint64_t HashCell(int64_t x, int64_t y, int64_t z)
+	{
+		return Mix(Mix(Mix(static_cast<uint64_t>(x)) ^ static_cast<uint64_t>(y)) ^ static_cast<uint64_t>(z));
+	}
+
+	// Weld bitwise identical vertices with an open addressing table.
+	// Writes the unique vertices to out, which may alias in.
+	unsigned int WeldExact(const VertexStandard* in, unsigned int count, VertexStandard* out, unsigned int* remap, vector<unsigned int>& table)
+	{
+		size_t tableSize = 1;
+		while (tableSize < static_cast<size_t>(count) * 2)
+		{
+			tableSize *= 2;
+		}
+
+		table.assign(tableSize, EMPTY_SLOT);
+		const size_t mask = tableSize - 1;
+
+		unsigned int unique = 0;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const VertexStandard vertex = in[i];
+
+			size_t slot = HashVertex(vertex) & mask;
+			while (table[slot] != EMPTY_SLOT && memcmp(&out[table[slot]], &vertex, sizeof(VertexStandard)) != 0)
+			{
+				slot = (slot + 1) & mask;
+			}
+
+			if (table[slot] == EMPTY_SLOT)
+			{
+				table[slot] = unique;
+				out[unique++] = vertex;
+			}
+
+			remap[i] = table[slot];
+		}
+
+		return unique;
+	}
+
+	// Weld vertices within epsilon of each other. Positions are bucketed into a grid of
+	// epsilon sized cells so only the neighbouring cells need to be searched.
+	unsigned int WeldNear(const VertexStandard* in, unsigned int count, VertexStandard* out, unsigned int* remap, float epsilon, vector<unsigned int>& next)
+	{
+		std::unordered_map<uint64_t, unsigned int> cells;
+		cells.reserve(count);
+
+		next.assign(count, EMPTY_SLOT);
+
+		const float cellScale = 1.0f / epsilon;
+
+		unsigned int unique = 0;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const VertexStandard vertex = in[i];
+
+			auto cx = static_cast<int64_t>(floorf(vertex.position.x * cellScale));
+			auto cy = static_cast<int64_t>(floorf(vertex.position.y * cellScale));
+			auto cz = static_cast<int64_t>(floorf(vertex.position.z * cellScale));
+
+			unsigned int match = EMPTY_SLOT;
+
+			for (int z = -1; z <= 1 && match == EMPTY_SLOT; z++)
+			{
+				for (int y = -1; y <= 1 && match == EMPTY_SLOT; y++)
+				{
+					for (int x = -1; x <= 1 && match == EMPTY_SLOT; x++)
+					{
+						auto cell = cells.find(HashCell(cx + x, cy + y, cz + z));
+						if (cell == cells.end())
+						{
+							continue;
+						}
+
+						for (auto candidate = cell->second; candidate != EMPTY_SLOT; candidate = next[candidate])
+						{
+							if (IsNear(out[candidate], vertex, epsilon))
+							{
+								match = candidate;
+								break;
+							}
+						}
+					}
+				}
+			}
+
+			if (match == EMPTY_SLOT)
+			{
+				match = unique++;
+				out[match] = vertex;
+
+				auto& head = cells.emplace(HashCell(cx, cy, cz), EMPTY_SLOT).first->second;
+				next[match] = head;
+				head = match;
+			}
+
+			remap[i] = match;
+		}
+
+		return unique;
+	}
+}
+
+void TinyEngine::WeldVertices(MeshData& mesh, float epsilon)
+{
+	vector<unsigned int> remap;
+	vector<unsigned int> scratch;
+
+	unsigned int writeVertex = 0;
+
+	// Parts are compacted towards the front of the vertex array in place.
+	for (auto& part : mesh.parts)
+	{
+		const auto* in = mesh.vertices.data() + part.baseVertex;
+		auto* out = mesh.vertices.data() + writeVertex;
+
+		remap.resize(part.vertexCount);
+
+		unsigned int unique = epsilon > 0.0f
+			? WeldNear(in, part.vertexCount, out, remap.data(), epsilon, scratch)
+			: WeldExact(in, part.vertexCount, out, remap.data(), scratch);
+
+		for (unsigned int i = part.indexStart; i < part.indexStart + part.indexCount; i++)
+		{
+			mesh.indices[i] = remap[mesh.indices[i]];
+		}
+
+		part.baseVertex = writeVertex;
+		part.vertexCount = unique;
+
+		writeVertex += unique;
+	}
+
+	mesh.vertices.resize(writeVertex);
+	mesh.vertices.shrink_to_fit();
+}
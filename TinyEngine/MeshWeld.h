@@ -0,0 +1,13 @@
+#pragma once
+
+#include "MeshData.h"
+
+namespace TinyEngine
+{
+	// Merge duplicate vertices within each part of a mesh and remap its indices to match.
+	// Parts keep their own vertex ranges so baseVertex stays valid.
+	//	MeshData& mesh: Mesh to weld in place
+	//	float epsilon: Largest difference in any position, texcoord or normal component
+	//		for two vertices to be merged. 0 only merges exact duplicates
+	void WeldVertices(MeshData& mesh, float epsilon = 0.0f);
+}
@@ -0,0 +1,332 @@
+#include "Meshlet.h"
+#include "FrustumCulling.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace TinyEngine;
+using namespace DirectX;
+
+using std::vector;
+
+namespace
+{
+	const unsigned int NO_MESHLET = ~0u;
+	const unsigned int NO_TRIANGLE = ~0u;
+
+	// Cones wider than this are too unlikely to be culled to be worth testing, about 84 degrees.
+	const float MIN_CONE_COSINE = 0.1f;
+
+	inline XMVECTOR LoadPosition(const VertexStandard* vertices, unsigned int index)
+	{
+		return XMLoadFloat3(&vertices[index].position);
+	}
+
+	Meshlet ComputeMeshletBounds(const unsigned int* indices, unsigned int indexCount, unsigned int vertexCount, const VertexStandard* vertices)
+	{
+		Meshlet meshlet = {};
+		meshlet.indexCount = indexCount;
+		meshlet.vertexCount = vertexCount;
+
+		XMVECTOR minimum = XMVectorReplicate(FLT_MAX);
+		XMVECTOR maximum = XMVectorReplicate(-FLT_MAX);
+		for (unsigned int i = 0; i < indexCount; i++)
+		{
+			auto position = LoadPosition(vertices, indices[i]);
+			minimum = XMVectorMin(minimum, position);
+			maximum = XMVectorMax(maximum, position);
+		}
+
+		XMVECTOR center = (minimum + maximum) * 0.5f;
+
+		float radius = 0.0f;
+		for (unsigned int i = 0; i < indexCount; i++)
+		{
+			radius = std::max(radius, XMVectorGetX(XMVector3Length(LoadPosition(vertices, indices[i]) - center)));
+		}
+
+		XMStoreFloat3(&meshlet.center, center);
+		meshlet.radius = radius;
+
+		// Front faces are clockwise, which makes (b - a) x (c - a) point out of them.
+		vector<XMFLOAT3> normals;
+		XMVECTOR axis = XMVectorZero();
+		for (unsigned int i = 0; i < indexCount; i += 3)
+		{
+			auto a = LoadPosition(vertices, indices[i]);
+			auto normal = XMVector3Cross(LoadPosition(vertices, indices[i + 1]) - a, LoadPosition(vertices, indices[i + 2]) - a);
+
+			float length = XMVectorGetX(XMVector3Length(normal));
+			if (length > 0.0f)
+			{
+				normal /= length;
+				axis += normal;
+
+				normals.emplace_back();
+				XMStoreFloat3(&normals.back(), normal);
+			}
+		}
+
+		float axisLength = XMVectorGetX(XMVector3Length(axis));
+		if (normals.empty() || axisLength <= 0.0f)
+		{
+			meshlet.coneAxis = XMFLOAT3(0.0f, 0.0f, 1.0f);
+			meshlet.coneSine = 1.0f;
+			meshlet.coneCosine = 0.0f;
+			return meshlet;
+		}
+
+		axis /= axisLength;
+
+		float minimumCosine = 1.0f;
+		for (const auto& normal : normals)
+		{
+			minimumCosine = std::min(minimumCosine, XMVectorGetX(XMVector3Dot(axis, XMLoadFloat3(&normal))));
+		}
+
+		XMStoreFloat3(&meshlet.coneAxis, axis);
+
+		if (minimumCosine < MIN_CONE_COSINE)
+		{
+			meshlet.coneSine = 1.0f;
+			meshlet.coneCosine = 0.0f;
+		}
+		else
+		{
+			meshlet.coneCosine = minimumCosine;
+			meshlet.coneSine = sqrtf(1.0f - minimumCosine * minimumCosine);
+		}
+
+		return meshlet;
+	}
+}
+
+void MeshletCullStats::Add(const MeshletCullStats& other)
+{
+	tested += other.tested;
+	frustumCulled += other.frustumCulled;
+	coneCulled += other.coneCulled;
+	visible += other.visible;
+	visibleTriangles += other.visibleTriangles;
+	totalTriangles += other.totalTriangles;
+}
+
+void TinyEngine::BuildMeshlets(unsigned int* indices, unsigned int indexCount, const VertexStandard* vertices, unsigned int vertexCount,
+	vector<Meshlet>& meshlets, unsigned int maxVertices, unsigned int maxTriangles)
+{
+	meshlets.clear();
+
+	maxVertices = std::max(maxVertices, 3u);
+	maxTriangles = std::max(maxTriangles, 1u);
+
+	unsigned int triangleCount = indexCount / 3;
+
+	// Triangles using each vertex.
+	vector<unsigned int> triangleOffsets(vertexCount + 1, 0);
+	for (unsigned int i = 0; i < triangleCount * 3; i++)
+	{
+		triangleOffsets[indices[i] + 1]++;
+	}
+
+	for (unsigned int v = 0; v < vertexCount; v++)
+	{
+		triangleOffsets[v + 1] += triangleOffsets[v];
+	}
+
+	vector<unsigned int> vertexTriangles(triangleCount * 3);
+	{
+		vector<unsigned int> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		for (unsigned int i = 0; i < triangleCount * 3; i++)
+		{
+			vertexTriangles[fill[indices[i]]++] = i / 3;
+		}
+	}
+
+	vector<bool> emitted(triangleCount, false);
+	vector<unsigned int> vertexMeshlet(vertexCount, NO_MESHLET);
+
+	vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+
+	vector<unsigned int> meshletVertices;
+	meshletVertices.reserve(maxVertices);
+
+	unsigned int seed = 0;
+	unsigned int emittedCount = 0;
+
+	while (emittedCount < triangleCount)
+	{
+		auto meshletIndex = static_cast<unsigned int>(meshlets.size());
+		auto meshletStart = static_cast<unsigned int>(output.size());
+		unsigned int meshletTriangles = 0;
+
+		meshletVertices.clear();
+		XMVECTOR positionSum = XMVectorZero();
+
+		auto addTriangle = [&](unsigned int triangle)
+		{
+			emitted[triangle] = true;
+			emittedCount++;
+			meshletTriangles++;
+
+			for (unsigned int corner = 0; corner < 3; corner++)
+			{
+				auto vertex = indices[triangle * 3 + corner];
+				output.push_back(vertex);
+
+				if (vertexMeshlet[vertex] != meshletIndex)
+				{
+					vertexMeshlet[vertex] = meshletIndex;
+					meshletVertices.push_back(vertex);
+					positionSum += LoadPosition(vertices, vertex);
+				}
+			}
+		};
+
+		// Start each meshlet at the next triangle in the input order, cache optimized input keeps these close together.
+		while (emitted[seed])
+		{
+			seed++;
+		}
+
+		addTriangle(seed);
+
+		while (meshletTriangles < maxTriangles)
+		{
+			XMVECTOR centroid = positionSum / static_cast<float>(meshletVertices.size());
+
+			// Prefer triangles adding the fewest vertices, then the ones closest to the meshlet's centre.
+			unsigned int best = NO_TRIANGLE;
+			unsigned int bestNewVertices = 4;
+			float bestDistance = FLT_MAX;
+
+			for (auto vertex : meshletVertices)
+			{
+				for (unsigned int i = triangleOffsets[vertex]; i < triangleOffsets[vertex + 1]; i++)
+				{
+					auto triangle = vertexTriangles[i];
+					if (emitted[triangle])
+					{
+						continue;
+					}
+
+					const auto* corners = indices + triangle * 3;
+
+					unsigned int newVertices = (vertexMeshlet[corners[0]] != meshletIndex)
+						+ (vertexMeshlet[corners[1]] != meshletIndex)
+						+ (vertexMeshlet[corners[2]] != meshletIndex);
+
+					if (meshletVertices.size() + newVertices > maxVertices || newVertices > bestNewVertices)
+					{
+						continue;
+					}
+
+					auto triangleCentroid = (LoadPosition(vertices, corners[0]) + LoadPosition(vertices, corners[1]) + LoadPosition(vertices, corners[2])) / 3.0f;
+					float distance = XMVectorGetX(XMVector3LengthSq(triangleCentroid - centroid));
+
+					if (newVertices < bestNewVertices || distance < bestDistance)
+					{
+						best = triangle;
+						bestNewVertices = newVertices;
+						bestDistance = distance;
+					}
+				}
+			}
+
+			if (best == NO_TRIANGLE)
+			{
+				break;
+			}
+
+			addTriangle(best);
+		}
+
+		auto meshlet = ComputeMeshletBounds(output.data() + meshletStart, meshletTriangles * 3, static_cast<unsigned int>(meshletVertices.size()), vertices);
+		meshlet.indexStart = meshletStart;
+		meshlets.push_back(meshlet);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+MeshletCullView TinyEngine::MakeMeshletCullView(FXMMATRIX world, CXMMATRIX view, CXMMATRIX projection, XMFLOAT3 eyePosition)
+{
+	MeshletCullView cullView;
+
+	// Planes pulled back through the whole transform are in object space.
+	auto frustum = MakeFrustum(world * view * projection);
+	std::copy(std::begin(frustum.planes), std::end(frustum.planes), cullView.planes);
+
+	// Which side of a triangle the eye is on doesn't change under an affine transform,
+	// so the normal cones can be tested in object space too.
+	XMVECTOR determinant;
+	XMMATRIX inverseWorld = XMMatrixInverse(&determinant, world);
+	XMStoreFloat3(&cullView.eyePosition, XMVector3TransformCoord(XMLoadFloat3(&eyePosition), inverseWorld));
+
+	return cullView;
+}
+
+void TinyEngine::CullMeshlets(const MeshletCullView& view, const Meshlet* meshlets, unsigned int meshletCount,
+	vector<MeshletRange>& visible, MeshletCullStats* stats)
+{
+	visible.clear();
+
+	MeshletCullStats result;
+	result.tested = meshletCount;
+
+	const auto& eye = view.eyePosition;
+
+	for (unsigned int m = 0; m < meshletCount; m++)
+	{
+		const auto& meshlet = meshlets[m];
+		const auto& center = meshlet.center;
+
+		result.totalTriangles += meshlet.indexCount / 3;
+
+		bool inside = true;
+		for (int i = 0; i < 6 && inside; i++)
+		{
+			const auto& plane = view.planes[i];
+			inside = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w >= -meshlet.radius;
+		}
+
+		if (!inside)
+		{
+			result.frustumCulled++;
+			continue;
+		}
+
+		if (meshlet.coneCosine > 0.0f)
+		{
+			// The meshlet is back facing if every normal within the cone points away from every point of the sphere,
+			// ie. the angle from the axis to the eye's direction plus the cone's half angle is under 90 degrees with radius to spare.
+			float toCenter[3] = { center.x - eye.x, center.y - eye.y, center.z - eye.z };
+			float along = toCenter[0] * meshlet.coneAxis.x + toCenter[1] * meshlet.coneAxis.y + toCenter[2] * meshlet.coneAxis.z;
+			float distanceSq = toCenter[0] * toCenter[0] + toCenter[1] * toCenter[1] + toCenter[2] * toCenter[2];
+			float across = sqrtf(std::max(distanceSq - along * along, 0.0f));
+
+			if (along > 0.0f && along * meshlet.coneCosine - across * meshlet.coneSine >= meshlet.radius)
+			{
+				result.coneCulled++;
+				continue;
+			}
+		}
+
+		result.visible++;
+		result.visibleTriangles += meshlet.indexCount / 3;
+
+		if (!visible.empty() && visible.back().indexStart + visible.back().indexCount == meshlet.indexStart)
+		{
+			visible.back().indexCount += meshlet.indexCount;
+		}
+		else
+		{
+			visible.push_back({ meshlet.indexStart, meshlet.indexCount });
+		}
+	}
+
+	if (stats)
+	{
+		*stats = result;
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vector>
+#include <DirectXMath.h>
+#include "VertexStandard.h"
+
+namespace TinyEngine
+{
+	// Default meshlet limits, sized so a meshlet's vertices and triangles fit mesh shader and
+	// compute culling workgroups on current hardware.
+	const unsigned int MESHLET_MAX_VERTICES = 64;
+	const unsigned int MESHLET_MAX_TRIANGLES = 124;
+
+	// A small cluster of a part's triangles with bounds for culling it on its own.
+	// Stored as is in .tmesh files.
+	struct Meshlet
+	{
+		// Object space bounding sphere of the meshlet's vertices.
+		DirectX::XMFLOAT3 center;
+		float radius;
+
+		// Cone around the triangles' front face normals, its half angle stored as a sine and cosine.
+		// coneCosine is 0 when the triangles face too many ways for the cone to cull anything.
+		DirectX::XMFLOAT3 coneAxis;
+		float coneSine;
+		float coneCosine;
+
+		// Range of the part's indices, relative to the part's first index.
+		unsigned int indexStart;
+		unsigned int indexCount;
+		// Distinct vertices the range references.
+		unsigned int vertexCount;
+	};
+
+	// A range of visible indices to draw.
+	struct MeshletRange
+	{
+		unsigned int indexStart;
+		unsigned int indexCount;
+	};
+
+	// Object space view a mesh's meshlets are culled against. Build it once per draw.
+	struct MeshletCullView
+	{
+		// Normalized frustum planes, a point is inside when dot(plane.xyz, p) + plane.w >= 0.
+		DirectX::XMFLOAT4 planes[6];
+		DirectX::XMFLOAT3 eyePosition;
+	};
+
+	// What CullMeshlets rejected.
+	struct MeshletCullStats
+	{
+		unsigned int tested = 0;
+		unsigned int frustumCulled = 0;
+		unsigned int coneCulled = 0;
+		unsigned int visible = 0;
+		unsigned int visibleTriangles = 0;
+		unsigned int totalTriangles = 0;
+
+		// Accumulate another cull's statistics into these.
+		void Add(const MeshletCullStats& other);
+	};
+
+	// Split a triangle list into meshlets, reordering its triangles so each meshlet is a contiguous range.
+	// Meshlets are grown from triangles which share the most vertices with them, so they stay compact
+	// and their normal cones stay narrow.
+	//	unsigned int* indices: Triangle list to reorder in place
+	//	unsigned int indexCount: Number of indices
+	//	const VertexStandard* vertices: Vertices the indices reference
+	//	unsigned int vertexCount: Number of vertices
+	//	std::vector<Meshlet>& meshlets: Receives the meshlets, cleared first
+	//	unsigned int maxVertices: Most distinct vertices in a meshlet, at least 3
+	//	unsigned int maxTriangles: Most triangles in a meshlet, at least 1
+	void BuildMeshlets(unsigned int* indices, unsigned int indexCount, const VertexStandard* vertices, unsigned int vertexCount,
+		std::vector<Meshlet>& meshlets, unsigned int maxVertices = MESHLET_MAX_VERTICES, unsigned int maxTriangles = MESHLET_MAX_TRIANGLES);
+
+	// Move a view into a mesh's object space, where its meshlet bounds are.
+	//	DirectX::FXMMATRIX world: World matrix of the mesh
+	//	DirectX::CXMMATRIX view: View matrix of the camera
+	//	DirectX::CXMMATRIX projection: Projection matrix of the camera
+	//	DirectX::XMFLOAT3 eyePosition: World space position of the camera
+	//	returns: The view to pass to CullMeshlets
+	MeshletCullView MakeMeshletCullView(DirectX::FXMMATRIX world, DirectX::CXMMATRIX view, DirectX::CXMMATRIX projection, DirectX::XMFLOAT3 eyePosition);
+
+	// Find the meshlets which may be visible: inside the frustum and not entirely back facing.
+	// Adjacent visible meshlets are merged into one range.
+	//	const MeshletCullView& view: See MakeMeshletCullView
+	//	const Meshlet* meshlets: Meshlets to cull
+	//	unsigned int meshletCount: Number of meshlets
+	//	std::vector<MeshletRange>& visible: Receives the index ranges to draw, cleared first
+	//	MeshletCullStats* stats: Receives what was culled. Optional
+	void CullMeshlets(const MeshletCullView& view, const Meshlet* meshlets, unsigned int meshletCount,
+		std::vector<MeshletRange>& visible, MeshletCullStats* stats = nullptr);
+}
@@ -0,0 +1,445 @@
+#include "MipGenerator.h"
+#include "CpuFeatures.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+
+using namespace TinyEngine;
+
+using std::vector;
+
+namespace
+{
+	const float PI = 3.14159265358979f;
+
+	// Rows given to each job when a level is split across threads.
+	const int ROWS_PER_JOB = 16;
+
+	// Resolution of the table used to encode linear values as sRGB. Fine enough that the steepest
+	// part of the curve, near black, still moves less than a tenth of a step per entry.
+	const int LINEAR_TO_SRGB_STEPS = 65536;
+
+	float SrgbToLinear(float c)
+	{
+		return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+	}
+
+	float LinearToSrgb(float l)
+	{
+		return l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+	}
+
+	unsigned char EncodeUnorm(float value)
+	{
+		return static_cast<unsigned char>(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+	}
+
+	const float* GetDecodeTable(bool srgb)
+	{
+		struct Tables
+		{
+			float srgb[256];
+			float linear[256];
+
+			Tables()
+			{
+				for (int i = 0; i < 256; i++)
+				{
+					linear[i] = i / 255.0f;
+					srgb[i] = SrgbToLinear(linear[i]);
+				}
+			}
+		};
+
+		static const Tables tables;
+		return srgb ? tables.srgb : tables.linear;
+	}
+
+	const unsigned char* GetEncodeTable()
+	{
+		struct Table
+		{
+			unsigned char srgb[LINEAR_TO_SRGB_STEPS];
+
+			Table()
+			{
+				for (int i = 0; i < LINEAR_TO_SRGB_STEPS; i++)
+				{
+					srgb[i] = EncodeUnorm(LinearToSrgb(static_cast<float>(i) / (LINEAR_TO_SRGB_STEPS - 1)));
+				}
+			}
+		};
+
+		static const Table table;
+		return table.srgb;
+	}
+
+	// Modified Bessel function of the first kind, order 0, for the Kaiser window.
+	float BesselI0(float x)
+	{
+		float sum = 1.0f;
+		float term = 1.0f;
+		float halfX = x * 0.5f;
+
+		for (int k = 1; k < 32 && term > sum * 1e-7f; k++)
+		{
+			term *= (halfX / k) * (halfX / k);
+			sum += term;
+		}
+
+		return sum;
+	}
+
+	float Sinc(float x)
+	{
+		return fabsf(x) < 1e-5f ? 1.0f : sinf(PI * x) / (PI * x);
+	}
+
+	// One dimension of a separable filter. Output texel i reads count[i] texels from start[i],
+	// weighted by weights[i * stride + k]. Texels past the edge are folded onto the edge texel.
+	struct FilterTaps
+	{
+		vector<int> start;
+		vector<int> count;
+		vector<float> weights;
+		int stride;
+	};
+
+	void BuildTaps(int sourceSize, int size, const MipSettings& settings, FilterTaps& taps)
+	{
+		float scale = static_cast<float>(sourceSize) / size;
+		float radius = settings.filter == MipFilter::BOX ? scale * 0.5f : settings.kaiserWidth * scale;
+
+		taps.stride = static_cast<int>(ceilf(radius * 2.0f)) + 2;
+		taps.start.resize(size);
+		taps.count.resize(size);
+		taps.weights.assign(static_cast<size_t>(size) * taps.stride, 0.0f);
+
+		float windowScale = 1.0f / BesselI0(settings.kaiserAlpha);
+
+		for (int i = 0; i < size; i++)
+		{
+			float center = (i + 0.5f) * scale;
+			int first = static_cast<int>(floorf(center - radius));
+			int last = static_cast<int>(ceilf(center + radius));
+
+			int start = std::max(first, 0);
+			int end = std::min(last, sourceSize);
+			float* weights = &taps.weights[static_cast<size_t>(i) * taps.stride];
+
+			float sum = 0.0f;
+			for (int j = first; j < last; j++)
+			{
+				float weight;
+				if (settings.filter == MipFilter::BOX)
+				{
+					// Overlap of the texel with the footprint.
+					weight = std::max(std::min(j + 1.0f, center + radius) - std::max(static_cast<float>(j), center - radius), 0.0f);
+				}
+				else
+				{
+					// Distance in texels of the level being made, where the sinc's zeros fall.
+					float t = (j + 0.5f - center) / scale;
+					float x = t / settings.kaiserWidth;
+					weight = fabsf(x) < 1.0f ? Sinc(t) * BesselI0(settings.kaiserAlpha * sqrtf(1.0f - x * x)) * windowScale : 0.0f;
+				}
+
+				weights[std::min(std::max(j, start), end - 1) - start] += weight;
+				sum += weight;
+			}
+
+			taps.start[i] = start;
+			taps.count[i] = end - start;
+
+			for (int k = 0; k < end - start; k++)
+			{
+				weights[k] /= sum;
+			}
+		}
+	}
+
+	int GetLevelsToMake(int width, int height, const MipSettings& settings)
+	{
+		int levels = static_cast<int>(GetMipLevelCount(width, height));
+		return settings.maxLevels > 0 ? std::min(levels, static_cast<int>(settings.maxLevels)) : levels;
+	}
+
+	// Size each level and the chain's data, and copy in the first level.
+	void BeginChain(const unsigned char* rgba, int width, int height, int levelCount, MipChain& chain)
+	{
+		chain.levels.clear();
+
+		size_t size = 0;
+		for (int level = 0; level < levelCount; level++)
+		{
+			int levelWidth = std::max(width >> level, 1);
+			int levelHeight = std::max(height >> level, 1);
+
+			chain.levels.push_back({ levelWidth, levelHeight, size });
+			size += static_cast<size_t>(levelWidth) * levelHeight * 4;
+		}
+
+		chain.data.resize(size);
+		memcpy(chain.data.data(), rgba, static_cast<size_t>(width) * height * 4);
+	}
+
+	// Call body for blocks of rows in [0, rows), across the workers if there are any.
+	template<typename Body>
+	void ForRows(ThreadPool* threadPool, int rows, const Body& body)
+	{
+		int jobs = (rows + ROWS_PER_JOB - 1) / ROWS_PER_JOB;
+
+		if (!threadPool || jobs <= 1)
+		{
+			body(0, rows);
+			return;
+		}
+
+		threadPool->ParallelFor(jobs, [&body, rows](size_t job)
+		{
+			int first = static_cast<int>(job) * ROWS_PER_JOB;
+			body(first, std::min(first + ROWS_PER_JOB, rows));
+		});
+	}
+
+	// Filter rows of RGBA floats horizontally. Each texel is one SSE register.
+	void FilterRows(const float* source, int sourceWidth, float* destination, int width, const FilterTaps& taps, int firstRow, int lastRow)
+	{
+		for (int y = firstRow; y < lastRow; y++)
+		{
+			const float* sourceRow = source + static_cast<size_t>(y) * sourceWidth * 4;
+			float* row = destination + static_cast<size_t>(y) * width * 4;
+
+			for (int x = 0; x < width; x++)
+			{
+				const float* texel = sourceRow + taps.start[x] * 4;
+				const float* weights = &taps.weights[static_cast<size_t>(x) * taps.stride];
+
+				__m128 sum = _mm_setzero_ps();
+				for (int k = 0; k < taps.count[x]; k++)
+				{
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(texel + k * 4), _mm_set1_ps(weights[k])));
+				}
+
+				_mm_storeu_ps(row + x * 4, sum);
+			}
+		}
+	}
+
+	// Filter whole rows vertically, every float of a row gets the same weight so they are done 8 or 4 at a time.
+	void FilterColumns(const float* source, float* destination, int width, const FilterTaps& taps, int firstRow, int lastRow)
+	{
+		const int rowFloats = width * 4;
+#ifdef TINY_ENGINE_AVX2
+		const bool avx2 = HasAvx2();
+#endif
+
+		for (int y = firstRow; y < lastRow; y++)
+		{
+			const float* sourceRows = source + static_cast<size_t>(taps.start[y]) * rowFloats;
+			const float* weights = &taps.weights[static_cast<size_t>(y) * taps.stride];
+			const int count = taps.count[y];
+			float* row = destination + static_cast<size_t>(y) * rowFloats;
+
+			int i = 0;
+
+#ifdef TINY_ENGINE_AVX2
+			if (avx2)
+			{
+				for (; i + 8 <= rowFloats; i += 8)
+				{
+					__m256 sum = _mm256_setzero_ps();
+					for (int k = 0; k < count; k++)
+					{
+						sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(sourceRows + static_cast<size_t>(k) * rowFloats + i), _mm256_set1_ps(weights[k])));
+					}
+
+					_mm256_storeu_ps(row + i, sum);
+				}
+			}
+#endif
+
+			for (; i < rowFloats; i += 4)
+			{
+				__m128 sum = _mm_setzero_ps();
+				for (int k = 0; k < count; k++)
+				{
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(sourceRows + static_cast<size_t>(k) * rowFloats + i), _mm_set1_ps(weights[k])));
+				}
+
+				_mm_storeu_ps(row + i, sum);
+			}
+		}
+	}
+
+	void DecodeRows(const unsigned char* rgba, float* texels, int width, bool srgb, int firstRow, int lastRow)
+	{
+		const float* color = GetDecodeTable(srgb);
+		const float* alpha = GetDecodeTable(false);
+
+		size_t end = static_cast<size_t>(lastRow) * width * 4;
+		for (size_t i = static_cast<size_t>(firstRow) * width * 4; i < end; i += 4)
+		{
+			texels[i] = color[rgba[i]];
+			texels[i + 1] = color[rgba[i + 1]];
+			texels[i + 2] = color[rgba[i + 2]];
+			texels[i + 3] = alpha[rgba[i + 3]];
+		}
+	}
+
+	void EncodeRows(const float* texels, unsigned char* rgba, int width, bool srgb, int firstRow, int lastRow)
+	{
+		const unsigned char* table = GetEncodeTable();
+
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 tableScale = _mm_set1_ps(LINEAR_TO_SRGB_STEPS - 1.0f);
+		const __m128 unormScale = _mm_set1_ps(255.0f);
+
+		size_t end = static_cast<size_t>(lastRow) * width * 4;
+		for (size_t i = static_cast<size_t>(firstRow) * width * 4; i < end; i += 4)
+		{
+			__m128 texel = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(texels + i), zero), one);
+
+			alignas(16) int unorm[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(unorm), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(texel, unormScale), half)));
+
+			if (srgb)
+			{
+				alignas(16) int index[4];
+				_mm_store_si128(reinterpret_cast<__m128i*>(index), _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(texel, tableScale), half)));
+
+				rgba[i] = table[index[0]];
+				rgba[i + 1] = table[index[1]];
+				rgba[i + 2] = table[index[2]];
+			}
+			else
+			{
+				rgba[i] = static_cast<unsigned char>(unorm[0]);
+				rgba[i + 1] = static_cast<unsigned char>(unorm[1]);
+				rgba[i + 2] = static_cast<unsigned char>(unorm[2]);
+			}
+
+			rgba[i + 3] = static_cast<unsigned char>(unorm[3]);
+		}
+	}
+}
+
+unsigned int TinyEngine::GetMipLevelCount(int width, int height)
+{
+	unsigned int levels = 1;
+	for (int size = std::max(width, height); size > 1; size >>= 1)
+	{
+		levels++;
+	}
+
+	return levels;
+}
+
+void TinyEngine::GenerateMipChain(const unsigned char* rgba, int width, int height, const MipSettings& settings, MipChain& chain, ThreadPool* threadPool)
+{
+	int levelCount = GetLevelsToMake(width, height, settings);
+	BeginChain(rgba, width, height, levelCount, chain);
+
+	if (levelCount <= 1)
+	{
+		return;
+	}
+
+	vector<float> source(static_cast<size_t>(width) * height * 4);
+	vector<float> filtered;
+	vector<float> destination;
+
+	ForRows(threadPool, height, [&](int first, int last) { DecodeRows(rgba, source.data(), width, settings.srgb, first, last); });
+
+	FilterTaps horizontal;
+	FilterTaps vertical;
+
+	for (int level = 1; level < levelCount; level++)
+	{
+		const auto& previous = chain.levels[level - 1];
+		const auto& current = chain.levels[level];
+
+		BuildTaps(previous.width, current.width, settings, horizontal);
+		BuildTaps(previous.height, current.height, settings, vertical);
+
+		// Narrow every row first, so the vertical pass reads less.
+		filtered.resize(static_cast<size_t>(current.width) * previous.height * 4);
+		destination.resize(static_cast<size_t>(current.width) * current.height * 4);
+
+		ForRows(threadPool, previous.height, [&](int first, int last)
+		{
+			FilterRows(source.data(), previous.width, filtered.data(), current.width, horizontal, first, last);
+		});
+
+		unsigned char* levelData = chain.data.data() + current.offset;
+
+		ForRows(threadPool, current.height, [&](int first, int last)
+		{
+			FilterColumns(filtered.data(), destination.data(), current.width, vertical, first, last);
+			EncodeRows(destination.data(), levelData, current.width, settings.srgb, first, last);
+		});
+
+		std::swap(source, destination);
+	}
+}
+
+void TinyEngine::GenerateMipChainReference(const unsigned char* rgba, int width, int height, const MipSettings& settings, MipChain& chain)
+{
+	int levelCount = GetLevelsToMake(width, height, settings);
+	BeginChain(rgba, width, height, levelCount, chain);
+
+	vector<float> source(static_cast<size_t>(width) * height * 4);
+	for (size_t i = 0; i < source.size(); i++)
+	{
+		float value = rgba[i] / 255.0f;
+		source[i] = settings.srgb && i % 4 != 3 ? SrgbToLinear(value) : value;
+	}
+
+	FilterTaps horizontal;
+	FilterTaps vertical;
+
+	for (int level = 1; level < levelCount; level++)
+	{
+		const auto& previous = chain.levels[level - 1];
+		const auto& current = chain.levels[level];
+
+		BuildTaps(previous.width, current.width, settings, horizontal);
+		BuildTaps(previous.height, current.height, settings, vertical);
+
+		vector<float> destination(static_cast<size_t>(current.width) * current.height * 4);
+		unsigned char* levelData = chain.data.data() + current.offset;
+
+		for (int y = 0; y < current.height; y++)
+		{
+			for (int x = 0; x < current.width; x++)
+			{
+				for (int c = 0; c < 4; c++)
+				{
+					float sum = 0.0f;
+					for (int ky = 0; ky < vertical.count[y]; ky++)
+					{
+						float row = 0.0f;
+						for (int kx = 0; kx < horizontal.count[x]; kx++)
+						{
+							size_t texel = static_cast<size_t>(vertical.start[y] + ky) * previous.width + horizontal.start[x] + kx;
+							row += source[texel * 4 + c] * horizontal.weights[static_cast<size_t>(x) * horizontal.stride + kx];
+						}
+
+						sum += row * vertical.weights[static_cast<size_t>(y) * vertical.stride + ky];
+					}
+
+					size_t i = (static_cast<size_t>(y) * current.width + x) * 4 + c;
+					destination[i] = sum;
+
+					float clamped = std::min(std::max(sum, 0.0f), 1.0f);
+					levelData[i] = EncodeUnorm(settings.srgb && c != 3 ? LinearToSrgb(clamped) : clamped);
+				}
+			}
+		}
+
+		source.swap(destination);
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "ThreadPool.h"
+
+namespace TinyEngine
+{
+	enum class MipFilter
+	{
+		// Average of the texels each one covers. Cheap but slightly blurry.
+		BOX,
+		// Kaiser windowed sinc. Sharper, at the cost of a wider kernel.
+		KAISER
+	};
+
+	// How a mip chain is filtered.
+	struct MipSettings
+	{
+		MipFilter filter = MipFilter::BOX;
+
+		// Treat RGB as sRGB, filtering in linear space so mips don't darken. Alpha is always linear.
+		// Turn off for data which isn't color, such as normal maps.
+		bool srgb = true;
+
+		// Half width of the Kaiser kernel in texels of the level being made, and its window shape.
+		float kaiserWidth = 3.0f;
+		float kaiserAlpha = 4.0f;
+
+		// Levels to make including the first, 0 makes every level down to 1x1.
+		unsigned int maxLevels = 0;
+	};
+
+	struct MipLevel
+	{
+		int width;
+		int height;
+		// Offset of the level's first texel in MipChain::data.
+		size_t offset;
+	};
+
+	// RGBA8 texels of every level of a texture, largest first.
+	struct MipChain
+	{
+		std::vector<unsigned char> data;
+		std::vector<MipLevel> levels;
+
+		const unsigned char* GetLevelData(unsigned int level) const
+		{
+			return data.data() + levels[level].offset;
+		}
+	};
+
+	// Number of levels in a full chain for a texture, down to and including 1x1.
+	unsigned int GetMipLevelCount(int width, int height);
+
+	// Make a mip chain from RGBA8 texels. Each level is filtered from the one before it, which is kept
+	// as linear floats so no precision is lost between levels. The filters are separable and run with
+	// SSE, and AVX where the CPU supports AVX2, over the rows of each level in parallel.
+	//	const unsigned char* rgba: Texels of the first level
+	//	int width: Width of the first level
+	//	int height: Height of the first level
+	//	const MipSettings& settings: Filtering to use
+	//	MipChain& chain: Receives every level, starting with a copy of rgba
+	//	ThreadPool* threadPool: Workers to split each level across, nullptr runs on the calling thread
+	void GenerateMipChain(const unsigned char* rgba, int width, int height, const MipSettings& settings, MipChain& chain, ThreadPool* threadPool = nullptr);
+
+	// Straightforward scalar version of GenerateMipChain, which its results can be checked against.
+	// Matches it to within one step per channel.
+	void GenerateMipChainReference(const unsigned char* rgba, int width, int height, const MipSettings& settings, MipChain& chain);
+}
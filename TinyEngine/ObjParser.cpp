@@ -0,0 +1,713 @@
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+
+using namespace TinyEngine;
+using namespace DirectX;
+
+using std::cout;
+using std::endl;
+using std::string_view;
+using std::vector;
+
+namespace
+{
+	// How many bytes are parsed between progress reports and cancel checks.
+	const size_t PROGRESS_INTERVAL = 1 << 20;
+
+	// Smallest amount of a file worth handing to another thread.
+	const size_t MIN_CHUNK_SIZE = 1 << 20;
+
+	// Chunks per pool thread, so uneven chunks still balance.
+	const size_t CHUNKS_PER_THREAD = 4;
+
+	inline bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	inline const char* SkipSpace(const char* p, const char* end)
+	{
+		while (p < end && IsSpace(*p))
+		{
+			p++;
+		}
+		return p;
+	}
+
+	inline const char* SkipToken(const char* p, const char* end)
+	{
+		while (p < end && !IsSpace(*p))
+		{
+			p++;
+		}
+		return p;
+	}
+
+	inline const char* FindLineEnd(const char* p, const char* end)
+	{
+		auto* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+		return lineEnd ? lineEnd : end;
+	}
+
+	// Rest of the line with surrounding whitespace removed.
+	inline string_view Tail(const char* p, const char* end)
+	{
+		p = SkipSpace(p, end);
+		while (end > p && IsSpace(end[-1]))
+		{
+			end--;
+		}
+		return string_view(p, end - p);
+	}
+
+	inline bool ParseFloat(const char*& p, const char* end, float& value)
+	{
+		p = SkipSpace(p, end);
+		if (p < end && *p == '+')
+		{
+			p++;
+		}
+
+		auto result = std::from_chars(p, end, value);
+		if (result.ec != std::errc())
+		{
+			return false;
+		}
+
+		p = result.ptr;
+		return true;
+	}
+
+	inline bool ParseInt(const char*& p, const char* end, int& value)
+	{
+		auto result = std::from_chars(p, end, value);
+		if (result.ec != std::errc())
+		{
+			return false;
+		}
+
+		p = result.ptr;
+		return true;
+	}
+
+	// Marks an absent corner component.
+	const int MISSING_INDEX = INT_MIN;
+
+	const unsigned int POSITION_BIT = 1;
+	const unsigned int TEXCOORD_BIT = 2;
+	const unsigned int NORMAL_BIT = 4;
+
+	// Convert a 1 based obj index to 0 based. Negative indices are relative to
+	// the number of elements read so far and are flagged in relativeMask.
+	inline int LocalIndex(int index, size_t localCount, unsigned int bit, unsigned int& relativeMask)
+	{
+		if (index > 0)
+		{
+			return index - 1;
+		}
+
+		relativeMask |= bit;
+		return static_cast<int>(localCount) + index;
+	}
+
+	// Turn a chunk local index into a global one. false if it is out of range.
+	inline bool ResolveIndex(int& index, unsigned int relativeMask, unsigned int bit, unsigned int base, size_t count)
+	{
+		if (relativeMask & bit)
+		{
+			index += static_cast<int>(base);
+		}
+
+		return index >= 0 && static_cast<size_t>(index) < count;
+	}
+
+	inline bool ParseFloat3(const char* p, const char* end, XMFLOAT3& value)
+	{
+		return ParseFloat(p, end, value.x) && ParseFloat(p, end, value.y) && ParseFloat(p, end, value.z);
+	}
+}
+
+ObjParser::ObjParser() : _threadPool(nullptr), _bytesParsed(0), _cancelled(false)
+{
+}
+
+void ObjParser::SetProgressCallback(ProgressCallback onProgress)
+{
+	_onProgress = onProgress;
+}
+
+void ObjParser::SetCancelCallback(CancelCallback shouldCancel)
+{
+	_shouldCancel = shouldCancel;
+}
+
+void ObjParser::SetThreadPool(ThreadPool* threadPool)
+{
+	_threadPool = threadPool;
+}
+
+bool ObjParser::Load(const char* path, ObjModel& model)
+{
+	MappedFile file(path);
+	if (!file.IsOpen())
+	{
+		cout << "Could not open obj file: " << path << endl;
+		return false;
+	}
+
+	auto directory = std::filesystem::path(path).remove_filename().string();
+
+	return Parse(file.GetData(), file.GetSize(), directory.c_str(), model);
+}
+
+bool ObjParser::LoadMaterials(const char* path, vector<ObjMaterial>& materials)
+{
+	MappedFile file(path);
+	if (!file.IsOpen())
+	{
+		cout << "Could not open mtl file: " << path << endl;
+		return false;
+	}
+
+	ParseMaterials(file.GetData(), file.GetSize(), materials);
+
+	return true;
+}
+
+// The file is parsed in three passes so that it can be split across threads:
+//	1. Each chunk of lines is tokenized on its own. Negative indices are kept relative to the chunk.
+//	2. Prefix sums of each chunk's element counts give every chunk its global offsets.
+//	3. Each chunk resolves its indices and writes its vertices and indices straight into the mesh.
+// A serial parse is the same with a single chunk, so both produce identical meshes.
+bool ObjParser::Parse(const char* data, size_t size, const char* directory, ObjModel& model)
+{
+	model.mesh.vertices.clear();
+	model.mesh.indices.clear();
+	model.mesh.parts.clear();
+	model.materials.clear();
+
+	_partMaterials.clear();
+	_bytesParsed = 0;
+	_cancelled = false;
+
+	SplitChunks(data, size);
+
+	ForEachChunk([this, size](Chunk& chunk) { ParseChunk(chunk, size); });
+
+	if (_cancelled)
+	{
+		cout << "Obj load cancelled." << endl;
+		return false;
+	}
+
+	size_t lineBase = 0;
+	for (const auto& chunk : _chunks)
+	{
+		if (chunk.errorLine)
+		{
+			cout << "Malformed obj line " << lineBase + chunk.errorLine << ": " << chunk.errorText << endl;
+			return false;
+		}
+
+		lineBase += chunk.lineCount;
+	}
+
+	for (const auto& chunk : _chunks)
+	{
+		for (const auto& library : chunk.materialLibraries)
+		{
+			std::string mtlPath(directory);
+			mtlPath.append(library.data(), library.size());
+
+			LoadMaterials(mtlPath.c_str(), model.materials);
+		}
+	}
+
+	unsigned int positionCount = 0, texcoordCount = 0, normalCount = 0, vertexCount = 0, indexCount = 0;
+	for (auto& chunk : _chunks)
+	{
+		chunk.positionBase = positionCount;
+		chunk.texcoordBase = texcoordCount;
+		chunk.normalBase = normalCount;
+		chunk.vertexBase = vertexCount;
+		chunk.indexBase = indexCount;
+
+		positionCount += static_cast<unsigned int>(chunk.positions.size());
+		texcoordCount += static_cast<unsigned int>(chunk.texcoords.size());
+		normalCount += static_cast<unsigned int>(chunk.normals.size());
+		vertexCount += chunk.vertexCount;
+		indexCount += chunk.indexCount;
+	}
+
+	_positions.resize(positionCount);
+	_texcoords.resize(texcoordCount);
+	_normals.resize(normalCount);
+
+	ForEachChunk([this](Chunk& chunk)
+	{
+		std::copy(chunk.positions.begin(), chunk.positions.end(), _positions.begin() + chunk.positionBase);
+		std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), _texcoords.begin() + chunk.texcoordBase);
+		std::copy(chunk.normals.begin(), chunk.normals.end(), _normals.begin() + chunk.normalBase);
+	});
+
+	model.mesh.vertices.resize(vertexCount);
+	model.mesh.indices.resize(indexCount);
+
+	BuildParts(model.mesh);
+
+	ForEachChunk([this, &model](Chunk& chunk) { EmitChunk(chunk, model.mesh); });
+
+	for (const auto& chunk : _chunks)
+	{
+		if (chunk.emitFailed)
+		{
+			cout << "Obj face references an element which does not exist." << endl;
+			return false;
+		}
+	}
+
+	// Resolve material names now that every library has been read.
+	for (size_t i = 0; i < model.mesh.parts.size(); i++)
+	{
+		auto& part = model.mesh.parts[i];
+		for (size_t m = 0; m < model.materials.size(); m++)
+		{
+			if (model.materials[m].name == _partMaterials[i])
+			{
+				part.material = static_cast<int>(m);
+				break;
+			}
+		}
+	}
+
+	if (_onProgress)
+	{
+		_onProgress(1.0f);
+	}
+
+	return !model.mesh.parts.empty();
+}
+
+void ObjParser::SplitChunks(const char* data, size_t size)
+{
+	size_t chunkCount = 1;
+	if (_threadPool)
+	{
+		chunkCount = std::min(_threadPool->GetThreadCount() * CHUNKS_PER_THREAD, size / MIN_CHUNK_SIZE);
+		chunkCount = std::max<size_t>(chunkCount, 1);
+	}
+
+	_chunks.resize(chunkCount);
+
+	const char* end = data + size;
+	const char* begin = data;
+
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		const char* chunkEnd = end;
+
+		// Move each split forward to the start of the next line.
+		if (i + 1 < chunkCount)
+		{
+			chunkEnd = std::max(begin, data + size / chunkCount * (i + 1));
+			chunkEnd = std::min(FindLineEnd(chunkEnd, end) + 1, end);
+		}
+
+		_chunks[i].begin = begin;
+		_chunks[i].end = chunkEnd;
+
+		begin = chunkEnd;
+	}
+}
+
+void ObjParser::ParseChunk(Chunk& chunk, size_t fileSize)
+{
+	chunk.positions.clear();
+	chunk.texcoords.clear();
+	chunk.normals.clear();
+	chunk.corners.clear();
+	chunk.faceSizes.clear();
+	chunk.partBreaks.clear();
+	chunk.materialLibraries.clear();
+
+	chunk.vertexCount = 0;
+	chunk.indexCount = 0;
+	chunk.lineCount = 0;
+	chunk.errorLine = 0;
+	chunk.errorText = {};
+	chunk.emitFailed = false;
+
+	const char* p = chunk.begin;
+	const char* end = chunk.end;
+	const char* lastReport = p;
+
+	while (p < end)
+	{
+		const char* lineEnd = FindLineEnd(p, end);
+		chunk.lineCount++;
+
+		if (static_cast<size_t>(p - lastReport) >= PROGRESS_INTERVAL)
+		{
+			if (!ReportProgress(p - lastReport, fileSize))
+			{
+				return;
+			}
+
+			lastReport = p;
+		}
+
+		const char* tokenStart = SkipSpace(p, lineEnd);
+		const char* tokenEnd = SkipToken(tokenStart, lineEnd);
+		string_view token(tokenStart, tokenEnd - tokenStart);
+
+		bool ok = true;
+
+		if (token == "v")
+		{
+			XMFLOAT3 position;
+			ok = ParseFloat3(tokenEnd, lineEnd, position);
+			chunk.positions.push_back(position);
+		}
+		else if (token == "vt")
+		{
+			XMFLOAT2 texcoord = { 0.0f, 0.0f };
+			const char* cursor = tokenEnd;
+			ok = ParseFloat(cursor, lineEnd, texcoord.x);
+			// v is optional.
+			ParseFloat(cursor, lineEnd, texcoord.y);
+			chunk.texcoords.push_back(texcoord);
+		}
+		else if (token == "vn")
+		{
+			XMFLOAT3 normal;
+			ok = ParseFloat3(tokenEnd, lineEnd, normal);
+			chunk.normals.push_back(normal);
+		}
+		else if (token == "f")
+		{
+			auto faceStart = chunk.corners.size();
+
+			const char* cursor = SkipSpace(tokenEnd, lineEnd);
+			while (ok && cursor < lineEnd)
+			{
+				int position = 0, texcoord = 0, normal = 0;
+
+				ok = ParseInt(cursor, lineEnd, position) && position != 0;
+				if (ok && cursor < lineEnd && *cursor == '/')
+				{
+					cursor++;
+					if (cursor < lineEnd && *cursor != '/')
+					{
+						ok = ParseInt(cursor, lineEnd, texcoord);
+					}
+
+					if (ok && cursor < lineEnd && *cursor == '/')
+					{
+						cursor++;
+						ok = ParseInt(cursor, lineEnd, normal);
+					}
+				}
+
+				Corner corner;
+				corner.relativeMask = 0;
+				corner.position = LocalIndex(position, chunk.positions.size(), POSITION_BIT, corner.relativeMask);
+				corner.texcoord = texcoord ? LocalIndex(texcoord, chunk.texcoords.size(), TEXCOORD_BIT, corner.relativeMask) : MISSING_INDEX;
+				corner.normal = normal ? LocalIndex(normal, chunk.normals.size(), NORMAL_BIT, corner.relativeMask) : MISSING_INDEX;
+
+				chunk.corners.push_back(corner);
+
+				cursor = SkipSpace(cursor, lineEnd);
+			}
+
+			auto cornerCount = static_cast<unsigned int>(chunk.corners.size() - faceStart);
+			ok = ok && cornerCount >= 3;
+
+			if (ok)
+			{
+				chunk.faceSizes.push_back(cornerCount);
+				chunk.vertexCount += cornerCount;
+				chunk.indexCount += (cornerCount - 2) * 3;
+			}
+		}
+		else if (token == "usemtl")
+		{
+			chunk.partBreaks.push_back({ chunk.vertexCount, chunk.indexCount, Tail(tokenEnd, lineEnd), true });
+		}
+		else if (token == "o" || token == "g")
+		{
+			chunk.partBreaks.push_back({ chunk.vertexCount, chunk.indexCount, {}, false });
+		}
+		else if (token == "mtllib")
+		{
+			chunk.materialLibraries.push_back(Tail(tokenEnd, lineEnd));
+		}
+
+		if (!ok)
+		{
+			chunk.errorLine = chunk.lineCount;
+			chunk.errorText = string_view(p, lineEnd - p);
+			return;
+		}
+
+		p = lineEnd + 1;
+	}
+
+	ReportProgress(end - lastReport, fileSize);
+}
+
+void ObjParser::BuildParts(MeshData& mesh)
+{
+	unsigned int partIndexStart = 0;
+	unsigned int partVertexStart = 0;
+	string_view currentMaterial;
+
+	auto endPart = [&](unsigned int vertexEnd, unsigned int indexEnd)
+	{
+		if (indexEnd > partIndexStart)
+		{
+			MeshDataPart part;
+			part.indexStart = partIndexStart;
+			part.indexCount = indexEnd - partIndexStart;
+			part.baseVertex = partVertexStart;
+			part.vertexCount = vertexEnd - partVertexStart;
+
+			mesh.parts.push_back(part);
+			_partMaterials.push_back(currentMaterial);
+		}
+
+		partIndexStart = indexEnd;
+		partVertexStart = vertexEnd;
+	};
+
+	for (auto& chunk : _chunks)
+	{
+		chunk.partVertexBase = partVertexStart;
+
+		for (const auto& partBreak : chunk.partBreaks)
+		{
+			endPart(chunk.vertexBase + partBreak.vertexCount, chunk.indexBase + partBreak.indexCount);
+
+			if (partBreak.setsMaterial)
+			{
+				currentMaterial = partBreak.material;
+			}
+		}
+	}
+
+	endPart(static_cast<unsigned int>(mesh.vertices.size()), static_cast<unsigned int>(mesh.indices.size()));
+}
+
+void ObjParser::EmitChunk(Chunk& chunk, MeshData& mesh)
+{
+	auto* vertexOut = mesh.vertices.data() + chunk.vertexBase;
+	auto* indexOut = mesh.indices.data() + chunk.indexBase;
+
+	unsigned int localVertex = 0;
+	unsigned int partVertexBase = chunk.partVertexBase;
+	size_t nextBreak = 0;
+
+	const auto* corner = chunk.corners.data();
+
+	for (auto faceSize : chunk.faceSizes)
+	{
+		// Breaks read before this face start a new part here.
+		while (nextBreak < chunk.partBreaks.size() && chunk.partBreaks[nextBreak].vertexCount <= localVertex)
+		{
+			partVertexBase = chunk.vertexBase + chunk.partBreaks[nextBreak].vertexCount;
+			nextBreak++;
+		}
+
+		bool hasNormals = true;
+		for (unsigned int i = 0; i < faceSize; i++)
+		{
+			auto c = corner[i];
+
+			bool ok = ResolveIndex(c.position, c.relativeMask, POSITION_BIT, chunk.positionBase, _positions.size());
+			if (c.texcoord != MISSING_INDEX)
+			{
+				ok = ok && ResolveIndex(c.texcoord, c.relativeMask, TEXCOORD_BIT, chunk.texcoordBase, _texcoords.size());
+			}
+
+			if (c.normal != MISSING_INDEX)
+			{
+				ok = ok && ResolveIndex(c.normal, c.relativeMask, NORMAL_BIT, chunk.normalBase, _normals.size());
+			}
+			else
+			{
+				hasNormals = false;
+			}
+
+			if (!ok)
+			{
+				chunk.emitFailed = true;
+				return;
+			}
+
+			vertexOut[i].position = _positions[c.position];
+			vertexOut[i].texcoord = c.texcoord != MISSING_INDEX ? _texcoords[c.texcoord] : XMFLOAT2(0.0f, 0.0f);
+			vertexOut[i].normal = c.normal != MISSING_INDEX ? _normals[c.normal] : XMFLOAT3(0.0f, 0.0f, 0.0f);
+		}
+
+		// Faces without normals get a flat normal.
+		if (!hasNormals)
+		{
+			const auto& p0 = vertexOut[0].position;
+			const auto& p1 = vertexOut[1].position;
+			const auto& p2 = vertexOut[2].position;
+
+			XMFLOAT3 a = { p0.x - p1.x, p0.y - p1.y, p0.z - p1.z };
+			XMFLOAT3 b = { p2.x - p1.x, p2.y - p1.y, p2.z - p1.z };
+
+			XMFLOAT3 faceNormal = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+
+			float length = sqrtf(faceNormal.x * faceNormal.x + faceNormal.y * faceNormal.y + faceNormal.z * faceNormal.z);
+			if (length > 0.0f)
+			{
+				faceNormal = { faceNormal.x / length, faceNormal.y / length, faceNormal.z / length };
+			}
+
+			for (unsigned int i = 0; i < faceSize; i++)
+			{
+				vertexOut[i].normal = faceNormal;
+			}
+		}
+
+		// Fan triangulation, indices are relative to the start of the part.
+		unsigned int first = chunk.vertexBase + localVertex - partVertexBase;
+		for (unsigned int i = 2; i < faceSize; i++)
+		{
+			indexOut[0] = first;
+			indexOut[1] = first + i - 1;
+			indexOut[2] = first + i;
+			indexOut += 3;
+		}
+
+		vertexOut += faceSize;
+		corner += faceSize;
+		localVertex += faceSize;
+	}
+}
+
+void ObjParser::ForEachChunk(const std::function<void(Chunk&)>& body)
+{
+	if (_threadPool && _chunks.size() > 1)
+	{
+		_threadPool->ParallelFor(_chunks.size(), [this, &body](size_t i) { body(_chunks[i]); });
+	}
+	else
+	{
+		for (auto& chunk : _chunks)
+		{
+			body(chunk);
+		}
+	}
+}
+
+bool ObjParser::ReportProgress(size_t bytes, size_t fileSize)
+{
+	size_t parsed = _bytesParsed += bytes;
+
+	if (_cancelled)
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(_callbackMutex);
+
+	if (_shouldCancel && _shouldCancel())
+	{
+		_cancelled = true;
+		return false;
+	}
+
+	if (_onProgress)
+	{
+		_onProgress(static_cast<float>(parsed) / static_cast<float>(fileSize));
+	}
+
+	return true;
+}
+
+void ObjParser::ParseMaterials(const char* data, size_t size, vector<ObjMaterial>& materials)
+{
+	const char* p = data;
+	const char* end = data + size;
+
+	ObjMaterial* material = nullptr;
+
+	while (p < end)
+	{
+		const char* lineEnd = FindLineEnd(p, end);
+
+		const char* tokenStart = SkipSpace(p, lineEnd);
+		const char* tokenEnd = SkipToken(tokenStart, lineEnd);
+		string_view token(tokenStart, tokenEnd - tokenStart);
+
+		p = lineEnd + 1;
+
+		if (token == "newmtl")
+		{
+			materials.emplace_back();
+			material = &materials.back();
+			material->name = Tail(tokenEnd, lineEnd);
+
+			continue;
+		}
+
+		// Anything before the first newmtl has nothing to apply to.
+		if (!material)
+		{
+			continue;
+		}
+
+		const char* cursor = tokenEnd;
+
+		if (token == "Ka")
+		{
+			ParseFloat3(cursor, lineEnd, material->ambient);
+		}
+		else if (token == "Kd")
+		{
+			ParseFloat3(cursor, lineEnd, material->diffuse);
+		}
+		else if (token == "Ks")
+		{
+			ParseFloat3(cursor, lineEnd, material->specular);
+		}
+		else if (token == "Ns")
+		{
+			ParseFloat(cursor, lineEnd, material->specularExponent);
+		}
+		else if (token == "d")
+		{
+			ParseFloat(cursor, lineEnd, material->dissolve);
+		}
+		else if (token == "Tr")
+		{
+			float transparency = 0.0f;
+			if (ParseFloat(cursor, lineEnd, transparency))
+			{
+				material->dissolve = 1.0f - transparency;
+			}
+		}
+		else if (token == "map_Ka")
+		{
+			material->ambientMap = Tail(tokenEnd, lineEnd);
+		}
+		else if (token == "map_Kd")
+		{
+			material->diffuseMap = Tail(tokenEnd, lineEnd);
+		}
+		else if (token == "map_Ks")
+		{
+			material->specularMap = Tail(tokenEnd, lineEnd);
+		}
+	}
+}
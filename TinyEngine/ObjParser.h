@@ -0,0 +1,177 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "MeshData.h"
+#include "ThreadPool.h"
+
+namespace TinyEngine
+{
+	// A material read from a .mtl file.
+	struct ObjMaterial
+	{
+		std::string name;
+
+		// Ka
+		DirectX::XMFLOAT3 ambient = { 0.0f, 0.0f, 0.0f };
+		// Kd
+		DirectX::XMFLOAT3 diffuse = { 0.0f, 0.0f, 0.0f };
+		// Ks
+		DirectX::XMFLOAT3 specular = { 0.0f, 0.0f, 0.0f };
+		// Ns
+		float specularExponent = 0.0f;
+		// d, 1 is fully opaque.
+		float dissolve = 1.0f;
+
+		// Texture paths, relative to the .mtl file.
+		std::string ambientMap;
+		std::string diffuseMap;
+		std::string specularMap;
+	};
+
+	// The contents of an .obj file and the materials it references.
+	struct ObjModel
+	{
+		// Geometry. Each part's material indexes into materials.
+		MeshData mesh;
+		std::vector<ObjMaterial> materials;
+	};
+
+	// Reads Wavefront .obj and .mtl files.
+	// Files are memory mapped and tokenized in place, nothing is allocated per line.
+	// A parser can be reused to load several files, its scratch memory is kept between loads.
+	class ObjParser
+	{
+	public:
+		// Called periodically while parsing.
+		//	float progress: Fraction of the file which has been parsed, 0 - 1
+		using ProgressCallback = std::function<void(float progress)>;
+
+		// Polled periodically while parsing. Return true to stop the load.
+		using CancelCallback = std::function<bool()>;
+
+	private:
+		// A face corner. Each component is a 0 based index, MISSING_INDEX if absent.
+		// Components flagged in relativeMask came from negative indices and are
+		// relative to the start of their chunk until they are resolved.
+		struct Corner
+		{
+			int position;
+			int texcoord;
+			int normal;
+			unsigned int relativeMask;
+		};
+
+		// Something which ends the current part: o, g or usemtl.
+		struct PartBreak
+		{
+			// Chunk local vertex and index counts when the break was read.
+			unsigned int vertexCount;
+			unsigned int indexCount;
+			// Name given to usemtl. Empty for o and g.
+			std::string_view material;
+			bool setsMaterial;
+		};
+
+		// A range of lines parsed independently of the rest of the file.
+		struct Chunk
+		{
+			const char* begin;
+			const char* end;
+
+			std::vector<DirectX::XMFLOAT3> positions;
+			std::vector<DirectX::XMFLOAT2> texcoords;
+			std::vector<DirectX::XMFLOAT3> normals;
+
+			std::vector<Corner> corners;
+			std::vector<unsigned int> faceSizes;
+			std::vector<PartBreak> partBreaks;
+			std::vector<std::string_view> materialLibraries;
+
+			unsigned int vertexCount;
+			unsigned int indexCount;
+			size_t lineCount;
+
+			// First malformed line, 0 if there wasn't one.
+			size_t errorLine;
+			std::string_view errorText;
+
+			// Totals of all previous chunks, filled in once every chunk has been parsed.
+			unsigned int positionBase;
+			unsigned int texcoordBase;
+			unsigned int normalBase;
+			unsigned int vertexBase;
+			unsigned int indexBase;
+			// baseVertex of the part which is open at the start of this chunk.
+			unsigned int partVertexBase;
+
+			bool emitFailed;
+		};
+
+		ProgressCallback _onProgress;
+		CancelCallback _shouldCancel;
+
+		ThreadPool* _threadPool;
+
+		std::vector<Chunk> _chunks;
+
+		std::vector<DirectX::XMFLOAT3> _positions;
+		std::vector<DirectX::XMFLOAT2> _texcoords;
+		std::vector<DirectX::XMFLOAT3> _normals;
+
+		// Material name used by each part, points into the mapped file.
+		std::vector<std::string_view> _partMaterials;
+
+		// Guards the callbacks, which may be called from several threads.
+		std::mutex _callbackMutex;
+		std::atomic<size_t> _bytesParsed;
+		std::atomic<bool> _cancelled;
+
+	public:
+		ObjParser();
+		~ObjParser() = default;
+
+		ObjParser(const ObjParser&) = delete;
+
+		// Set the callback used to report progress. Optional.
+		void SetProgressCallback(ProgressCallback onProgress);
+
+		// Set the callback used to cancel a load. Optional.
+		void SetCancelCallback(CancelCallback shouldCancel);
+
+		// Parse large files in parallel on a thread pool.
+		// The result is identical to a serial parse. Callbacks may then be called from worker threads.
+		//	ThreadPool* threadPool: Pool to parse on. nullptr parses on the calling thread
+		void SetThreadPool(ThreadPool* threadPool);
+
+		// Load an .obj file and any material libraries it references.
+		// Faces are triangulated as fans, a vertex is emitted for each face corner.
+		//	const char* path: Path to the .obj file
+		//	ObjModel& model: Receives the loaded model, existing contents are replaced
+		//	returns: false if the file could not be read, was malformed or the load was cancelled
+		bool Load(const char* path, ObjModel& model);
+
+		// Load an .mtl file, appending its materials.
+		//	const char* path: Path to the .mtl file
+		//	std::vector<ObjMaterial>& materials: Materials to append to
+		//	returns: false if the file could not be read
+		bool LoadMaterials(const char* path, std::vector<ObjMaterial>& materials);
+
+	private:
+		bool Parse(const char* data, size_t size, const char* directory, ObjModel& model);
+		void ParseMaterials(const char* data, size_t size, std::vector<ObjMaterial>& materials);
+
+		void SplitChunks(const char* data, size_t size);
+		void ParseChunk(Chunk& chunk, size_t fileSize);
+		void BuildParts(MeshData& mesh);
+		void EmitChunk(Chunk& chunk, MeshData& mesh);
+
+		void ForEachChunk(const std::function<void(Chunk&)>& body);
+		bool ReportProgress(size_t bytes, size_t fileSize);
+	};
+}
@@ -0,0 +1,591 @@
+#include "OcclusionCulling.h"
+#include "CpuFeatures.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <immintrin.h>
+
+using namespace TinyEngine;
+using namespace DirectX;
+
+using std::vector;
+
+namespace
+{
+	// Edges closer to horizontal than this, in pixels of height, are treated as horizontal.
+	const float MIN_EDGE_HEIGHT = 1e-6f;
+
+	// Bits lo to hi of a row, inclusive.
+	inline uint32_t RowBits(unsigned int lo, unsigned int hi)
+	{
+		uint32_t below = hi >= 31 ? ~0u : (1u << (hi + 1)) - 1;
+		return below & (~0u << lo);
+	}
+
+	inline XMFLOAT4 Lerp(const XMFLOAT4& a, const XMFLOAT4& b, float t)
+	{
+		return XMFLOAT4(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t);
+	}
+}
+
+OcclusionCuller::OcclusionCuller(unsigned int width, unsigned int height)
+{
+	_tilesX = std::max(1u, (width + TILE_WIDTH - 1) / TILE_WIDTH);
+	_tilesY = std::max(1u, (height + TILE_HEIGHT - 1) / TILE_HEIGHT);
+	_width = _tilesX * TILE_WIDTH;
+	_height = _tilesY * TILE_HEIGHT;
+	_avx2 = HasAvx2();
+
+	_tiles.resize(static_cast<size_t>(_tilesX) * _tilesY);
+	_bins.resize(_tilesY);
+
+	XMStoreFloat4x4(&_viewProjection, XMMatrixIdentity());
+
+	Clear();
+}
+
+void OcclusionCuller::Clear()
+{
+	for (auto& tile : _tiles)
+	{
+		std::fill(std::begin(tile.mask), std::end(tile.mask), 0u);
+		tile.zMax0 = FLT_MAX;
+		tile.zMax1 = 0.0f;
+	}
+
+	_triangles.clear();
+	_stats = OcclusionStats();
+}
+
+void OcclusionCuller::SetViewProjection(FXMMATRIX viewProjection)
+{
+	XMStoreFloat4x4(&_viewProjection, viewProjection);
+}
+
+void OcclusionCuller::AddOccluder(const XMFLOAT3* positions, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount,
+	FXMMATRIX world, bool cullBackFaces)
+{
+	XMMATRIX transform = world * XMLoadFloat4x4(&_viewProjection);
+
+	_clipVertices.resize(vertexCount);
+	for (unsigned int i = 0; i < vertexCount; i++)
+	{
+		XMStoreFloat4(&_clipVertices[i], XMVector3Transform(XMLoadFloat3(&positions[i]), transform));
+	}
+
+	for (unsigned int i = 0; i + 2 < indexCount; i += 3)
+	{
+		if (indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount)
+		{
+			continue;
+		}
+
+		_stats.triangles++;
+		AddTriangle(_clipVertices[indices[i]], _clipVertices[indices[i + 1]], _clipVertices[indices[i + 2]], cullBackFaces);
+	}
+}
+
+void OcclusionCuller::RenderOccluders(ThreadPool* threadPool)
+{
+	for (auto& bin : _bins)
+	{
+		bin.clear();
+	}
+
+	for (unsigned int i = 0; i < _triangles.size(); i++)
+	{
+		const auto& triangle = _triangles[i];
+		for (unsigned int tileY = triangle.minY / TILE_HEIGHT; tileY <= triangle.maxY / TILE_HEIGHT; tileY++)
+		{
+			_bins[tileY].push_back(i);
+		}
+	}
+
+	// No two rows share a tile, so they need nothing to keep them apart.
+	if (threadPool)
+	{
+		threadPool->ParallelFor(_tilesY, [this](size_t tileY) { RasterizeRow(static_cast<unsigned int>(tileY)); });
+	}
+	else
+	{
+		for (unsigned int tileY = 0; tileY < _tilesY; tileY++)
+		{
+			RasterizeRow(tileY);
+		}
+	}
+}
+
+bool OcclusionCuller::TestBounds(const Bounds& bounds) const
+{
+	unsigned int minX, minY, maxX, maxY;
+	float zNear;
+
+	int projected = ProjectBounds(bounds, minX, minY, maxX, maxY, zNear);
+	if (projected != 0)
+	{
+		return projected > 0;
+	}
+
+	for (unsigned int tileY = minY / TILE_HEIGHT; tileY <= maxY / TILE_HEIGHT; tileY++)
+	{
+		for (unsigned int tileX = minX / TILE_WIDTH; tileX <= maxX / TILE_WIDTH; tileX++)
+		{
+			const auto& tile = _tiles[tileY * _tilesX + tileX];
+
+			// Behind the whole tile, whatever its mask.
+			bool nearerThanTile = zNear < tile.zMax0;
+			bool nearerThanLayer = zNear < std::min(tile.zMax0, tile.zMax1);
+			if (!nearerThanTile)
+			{
+				continue;
+			}
+
+			unsigned int left = tileX * TILE_WIDTH;
+			uint32_t columns = RowBits(std::max(minX, left) - left, std::min(maxX, left + TILE_WIDTH - 1) - left);
+
+			for (unsigned int row = 0; row < TILE_HEIGHT; row++)
+			{
+				unsigned int y = tileY * TILE_HEIGHT + row;
+				if (y < minY || y > maxY)
+				{
+					continue;
+				}
+
+				if ((columns & ~tile.mask[row]) || (nearerThanLayer && (columns & tile.mask[row])))
+				{
+					return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+void OcclusionCuller::RasterizeReference(vector<float>& depth) const
+{
+	depth.assign(static_cast<size_t>(_width) * _height, FLT_MAX);
+
+	uint32_t coverage[TILE_HEIGHT];
+	for (const auto& triangle : _triangles)
+	{
+		for (unsigned int tileY = triangle.minY / TILE_HEIGHT; tileY <= triangle.maxY / TILE_HEIGHT; tileY++)
+		{
+			for (unsigned int tileX = triangle.minX / TILE_WIDTH; tileX <= triangle.maxX / TILE_WIDTH; tileX++)
+			{
+				ComputeCoverage(triangle, tileX, tileY, coverage);
+
+				float left = static_cast<float>(tileX * TILE_WIDTH);
+				float top = static_cast<float>(tileY * TILE_HEIGHT);
+
+				for (unsigned int row = 0; row < TILE_HEIGHT; row++)
+				{
+					for (unsigned int column = 0; column < TILE_WIDTH; column++)
+					{
+						if (!(coverage[row] & (1u << column)))
+						{
+							continue;
+						}
+
+						float x = left + (column + 0.5f);
+						float y = top + (row + 0.5f);
+						float z = triangle.z0 + triangle.dzdx * (x - triangle.x0) + triangle.dzdy * (y - triangle.y0);
+						z = std::min(std::max(z, triangle.minZ), triangle.maxZ);
+
+						auto& pixel = depth[(static_cast<size_t>(tileY) * TILE_HEIGHT + row) * _width + tileX * TILE_WIDTH + column];
+						pixel = std::min(pixel, z);
+					}
+				}
+			}
+		}
+	}
+}
+
+bool OcclusionCuller::TestBoundsReference(const Bounds& bounds, const vector<float>& depth) const
+{
+	unsigned int minX, minY, maxX, maxY;
+	float zNear;
+
+	int projected = ProjectBounds(bounds, minX, minY, maxX, maxY, zNear);
+	if (projected != 0)
+	{
+		return projected > 0;
+	}
+
+	for (unsigned int y = minY; y <= maxY; y++)
+	{
+		for (unsigned int x = minX; x <= maxX; x++)
+		{
+			if (zNear < depth[static_cast<size_t>(y) * _width + x])
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+void OcclusionCuller::GetDepth(vector<float>& depth) const
+{
+	depth.resize(static_cast<size_t>(_width) * _height);
+
+	for (unsigned int y = 0; y < _height; y++)
+	{
+		for (unsigned int x = 0; x < _width; x++)
+		{
+			const auto& tile = _tiles[(y / TILE_HEIGHT) * _tilesX + x / TILE_WIDTH];
+			bool inLayer = (tile.mask[y % TILE_HEIGHT] >> (x % TILE_WIDTH)) & 1;
+
+			depth[static_cast<size_t>(y) * _width + x] = inLayer ? std::min(tile.zMax0, tile.zMax1) : tile.zMax0;
+		}
+	}
+}
+
+unsigned int OcclusionCuller::GetWidth() const
+{
+	return _width;
+}
+
+unsigned int OcclusionCuller::GetHeight() const
+{
+	return _height;
+}
+
+const OcclusionStats& OcclusionCuller::GetStats() const
+{
+	return _stats;
+}
+
+void OcclusionCuller::AddTriangle(const XMFLOAT4& a, const XMFLOAT4& b, const XMFLOAT4& c, bool cullBackFaces)
+{
+	// Only the near plane, z >= 0, needs clipping. Everything else is clamped to the screen.
+	const XMFLOAT4* input[3] = { &a, &b, &c };
+	XMFLOAT4 clipped[4];
+	unsigned int count = 0;
+
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		const auto& current = *input[i];
+		const auto& next = *input[(i + 1) % 3];
+
+		bool currentInside = current.z >= 0.0f;
+		bool nextInside = next.z >= 0.0f;
+
+		if (currentInside)
+		{
+			clipped[count++] = current;
+		}
+
+		if (currentInside != nextInside)
+		{
+			clipped[count++] = Lerp(current, next, current.z / (current.z - next.z));
+		}
+	}
+
+	if (count < 3)
+	{
+		return;
+	}
+
+	SetupTriangle(clipped, cullBackFaces);
+
+	if (count == 4)
+	{
+		XMFLOAT4 second[3] = { clipped[0], clipped[2], clipped[3] };
+		SetupTriangle(second, cullBackFaces);
+	}
+}
+
+void OcclusionCuller::SetupTriangle(const XMFLOAT4* vertices, bool cullBackFaces)
+{
+	XMFLOAT3 p[3];
+	for (int i = 0; i < 3; i++)
+	{
+		const auto& v = vertices[i];
+		if (v.w <= 0.0f)
+		{
+			return;
+		}
+
+		float inverseW = 1.0f / v.w;
+		p[i] = XMFLOAT3((v.x * inverseW * 0.5f + 0.5f) * _width, (0.5f - v.y * inverseW * 0.5f) * _height, v.z * inverseW);
+	}
+
+	// Clockwise on screen, with y down, is positive.
+	float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[1].y - p[0].y) * (p[2].x - p[0].x);
+	if (area == 0.0f || (cullBackFaces && area < 0.0f))
+	{
+		return;
+	}
+
+	if (area < 0.0f)
+	{
+		std::swap(p[1], p[2]);
+		area = -area;
+	}
+
+	// Pixels whose centers are inside the triangle's bounds.
+	float minX = std::min({ p[0].x, p[1].x, p[2].x });
+	float maxX = std::max({ p[0].x, p[1].x, p[2].x });
+	float minY = std::min({ p[0].y, p[1].y, p[2].y });
+	float maxY = std::max({ p[0].y, p[1].y, p[2].y });
+
+	float firstX = ceilf(minX - 0.5f);
+	float lastX = floorf(maxX - 0.5f);
+	float firstY = ceilf(minY - 0.5f);
+	float lastY = floorf(maxY - 0.5f);
+
+	if (lastX < 0.0f || lastY < 0.0f || firstX > _width - 1.0f || firstY > _height - 1.0f || firstX > lastX || firstY > lastY)
+	{
+		return;
+	}
+
+	Triangle triangle;
+	triangle.minX = static_cast<unsigned int>(std::max(firstX, 0.0f));
+	triangle.minY = static_cast<unsigned int>(std::max(firstY, 0.0f));
+	triangle.maxX = static_cast<unsigned int>(std::min(lastX, _width - 1.0f));
+	triangle.maxY = static_cast<unsigned int>(std::min(lastY, _height - 1.0f));
+
+	// Inside is where A * x + B * y + C >= 0 for every edge, solved for x along each row.
+	for (int i = 0; i < 3; i++)
+	{
+		const auto& from = p[i];
+		const auto& to = p[(i + 1) % 3];
+
+		float a = from.y - to.y;
+		float b = to.x - from.x;
+		float c = -(a * from.x + b * from.y);
+
+		auto& edge = triangle.edges[i];
+		if (fabsf(a) < MIN_EDGE_HEIGHT)
+		{
+			edge = { b, c, 0 };
+		}
+		else
+		{
+			edge = { -b / a, -c / a, a > 0.0f ? 1 : -1 };
+		}
+	}
+
+	float dz1 = p[1].z - p[0].z;
+	float dz2 = p[2].z - p[0].z;
+	triangle.x0 = p[0].x;
+	triangle.y0 = p[0].y;
+	triangle.z0 = p[0].z;
+	triangle.dzdx = (dz1 * (p[2].y - p[0].y) - dz2 * (p[1].y - p[0].y)) / area;
+	triangle.dzdy = (dz2 * (p[1].x - p[0].x) - dz1 * (p[2].x - p[0].x)) / area;
+	triangle.minZ = std::min({ p[0].z, p[1].z, p[2].z });
+	triangle.maxZ = std::max({ p[0].z, p[1].z, p[2].z });
+
+	_triangles.push_back(triangle);
+	_stats.rasterized++;
+}
+
+void OcclusionCuller::RasterizeRow(unsigned int tileY)
+{
+	uint32_t coverage[TILE_HEIGHT];
+	float top = static_cast<float>(tileY * TILE_HEIGHT);
+
+	for (auto index : _bins[tileY])
+	{
+		const auto& triangle = _triangles[index];
+
+		for (unsigned int tileX = triangle.minX / TILE_WIDTH; tileX <= triangle.maxX / TILE_WIDTH; tileX++)
+		{
+			ComputeCoverage(triangle, tileX, tileY, coverage);
+
+			uint32_t any = 0;
+			for (auto row : coverage)
+			{
+				any |= row;
+			}
+
+			if (!any)
+			{
+				continue;
+			}
+
+			// Farthest the triangle's plane gets over the tile's pixel centers, which is never nearer than any pixel it covers.
+			float left = static_cast<float>(tileX * TILE_WIDTH);
+			float z = triangle.z0
+				+ std::max(triangle.dzdx * ((left + 0.5f) - triangle.x0), triangle.dzdx * ((left + (TILE_WIDTH - 0.5f)) - triangle.x0))
+				+ std::max(triangle.dzdy * ((top + 0.5f) - triangle.y0), triangle.dzdy * ((top + (TILE_HEIGHT - 0.5f)) - triangle.y0));
+			z = std::min(std::max(z, triangle.minZ), triangle.maxZ);
+
+			UpdateTile(_tiles[tileY * _tilesX + tileX], coverage, z);
+		}
+	}
+}
+
+void OcclusionCuller::ComputeCoverage(const Triangle& triangle, unsigned int tileX, unsigned int tileY, uint32_t* mask) const
+{
+	// Each edge covers a run of pixels at one end of each row: those from the first whose center is right of it,
+	// or those up to the last whose center is left of it. Both paths do the same float operations, so they agree.
+	float left = static_cast<float>(tileX * TILE_WIDTH);
+	float top = static_cast<float>(tileY * TILE_HEIGHT);
+
+#ifdef TINY_ENGINE_AVX2
+	if (_avx2)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 width = _mm256_set1_ps(static_cast<float>(TILE_WIDTH));
+		const __m256i ones = _mm256_set1_epi32(-1);
+
+		__m256 y = _mm256_add_ps(_mm256_set1_ps(top), _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f));
+		__m256i covered = ones;
+
+		for (const auto& edge : triangle.edges)
+		{
+			__m256 t = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(edge.slope), y), _mm256_set1_ps(edge.offset));
+
+			__m256i rows;
+			if (edge.side == 0)
+			{
+				rows = _mm256_castps_si256(_mm256_cmp_ps(t, zero, _CMP_GE_OQ));
+			}
+			else
+			{
+				__m256 x = _mm256_sub_ps(_mm256_sub_ps(t, _mm256_set1_ps(left)), _mm256_set1_ps(0.5f));
+				if (edge.side > 0)
+				{
+					__m256 first = _mm256_min_ps(_mm256_max_ps(_mm256_ceil_ps(x), zero), width);
+					rows = _mm256_sllv_epi32(ones, _mm256_cvttps_epi32(first));
+				}
+				else
+				{
+					__m256 count = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(_mm256_floor_ps(x), _mm256_set1_ps(1.0f)), zero), width);
+					rows = _mm256_andnot_si256(_mm256_sllv_epi32(ones, _mm256_cvttps_epi32(count)), ones);
+				}
+			}
+
+			covered = _mm256_and_si256(covered, rows);
+		}
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(mask), covered);
+		return;
+	}
+#endif
+
+	for (unsigned int row = 0; row < TILE_HEIGHT; row++)
+	{
+		float y = top + (row + 0.5f);
+		uint32_t covered = ~0u;
+
+		for (const auto& edge : triangle.edges)
+		{
+			float t = edge.slope * y + edge.offset;
+
+			if (edge.side == 0)
+			{
+				covered &= t >= 0.0f ? ~0u : 0u;
+			}
+			else
+			{
+				float x = (t - left) - 0.5f;
+				if (edge.side > 0)
+				{
+					auto first = static_cast<unsigned int>(std::min(std::max(ceilf(x), 0.0f), static_cast<float>(TILE_WIDTH)));
+					covered &= first >= 32 ? 0u : ~0u << first;
+				}
+				else
+				{
+					auto count = static_cast<unsigned int>(std::min(std::max(floorf(x) + 1.0f, 0.0f), static_cast<float>(TILE_WIDTH)));
+					covered &= count >= 32 ? ~0u : ~(~0u << count);
+				}
+			}
+		}
+
+		mask[row] = covered;
+	}
+}
+
+void OcclusionCuller::UpdateTile(Tile& tile, const uint32_t* coverage, float z)
+{
+	// Behind everything the tile already has.
+	if (z >= tile.zMax0)
+	{
+		return;
+	}
+
+	bool empty = true;
+	for (unsigned int row = 0; row < TILE_HEIGHT; row++)
+	{
+		empty = empty && tile.mask[row] == 0;
+	}
+
+	// A triangle much nearer than the working layer is worth more than the layer, which is dropped.
+	if (!empty && tile.zMax1 - z > tile.zMax0 - tile.zMax1)
+	{
+		std::fill(std::begin(tile.mask), std::end(tile.mask), 0u);
+		empty = true;
+	}
+
+	tile.zMax1 = empty ? z : std::max(tile.zMax1, z);
+
+	bool full = true;
+	for (unsigned int row = 0; row < TILE_HEIGHT; row++)
+	{
+		tile.mask[row] |= coverage[row];
+		full = full && tile.mask[row] == ~0u;
+	}
+
+	// Once the working layer covers the tile it is all the tile needs.
+	if (full)
+	{
+		tile.zMax0 = tile.zMax1;
+		tile.zMax1 = 0.0f;
+		std::fill(std::begin(tile.mask), std::end(tile.mask), 0u);
+	}
+}
+
+int OcclusionCuller::ProjectBounds(const Bounds& bounds, unsigned int& minX, unsigned int& minY, unsigned int& maxX, unsigned int& maxY, float& zNear) const
+{
+	XMMATRIX viewProjection = XMLoadFloat4x4(&_viewProjection);
+	XMVECTOR center = XMLoadFloat3(&bounds.center);
+	XMVECTOR extents = XMLoadFloat3(&bounds.extents);
+
+	float left = FLT_MAX;
+	float right = -FLT_MAX;
+	float top = FLT_MAX;
+	float bottom = -FLT_MAX;
+	zNear = FLT_MAX;
+
+	for (int corner = 0; corner < 8; corner++)
+	{
+		XMVECTOR sign = XMVectorSet(corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, corner & 4 ? 1.0f : -1.0f, 0.0f);
+
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector3Transform(center + sign * extents, viewProjection));
+
+		// Any corner behind the near plane and the box may cover the whole screen.
+		if (clip.z < 0.0f || clip.w <= 0.0f)
+		{
+			return 1;
+		}
+
+		float inverseW = 1.0f / clip.w;
+		float x = (clip.x * inverseW * 0.5f + 0.5f) * _width;
+		float y = (0.5f - clip.y * inverseW * 0.5f) * _height;
+
+		left = std::min(left, x);
+		right = std::max(right, x);
+		top = std::min(top, y);
+		bottom = std::max(bottom, y);
+		zNear = std::min(zNear, clip.z * inverseW);
+	}
+
+	// Every pixel the box touches, not just those whose centers it covers, as it may be seen at a higher resolution.
+	if (right < 0.0f || bottom < 0.0f || left >= _width || top >= _height)
+	{
+		return -1;
+	}
+
+	minX = static_cast<unsigned int>(std::max(floorf(left), 0.0f));
+	minY = static_cast<unsigned int>(std::max(floorf(top), 0.0f));
+	maxX = static_cast<unsigned int>(std::min(floorf(right), _width - 1.0f));
+	maxY = static_cast<unsigned int>(std::min(floorf(bottom), _height - 1.0f));
+
+	return 0;
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+#include "FrustumCulling.h"
+
+namespace TinyEngine
+{
+	class ThreadPool;
+
+	// What an OcclusionCuller rasterized since it was last cleared.
+	struct OcclusionStats
+	{
+		// Occluder triangles added, and those left after clipping and back face culling.
+		unsigned int triangles = 0;
+		unsigned int rasterized = 0;
+	};
+
+	// Hides bounds behind designated occluders by rasterizing them on the CPU into a small masked depth buffer,
+	// in the style of Masked Software Occlusion Culling (Andersson et al., Intel 2015).
+	//
+	// The screen is split into 32x8 pixel tiles. A tile holds no depth per pixel, only two layers: a depth
+	// every pixel is at least as near as, and a working layer of a coverage mask, one bit per pixel, with the
+	// depth its pixels are at least as near as. Triangles add their coverage and farthest depth over the tile
+	// to the working layer, which replaces the first once it covers the whole tile, or is dropped if a triangle
+	// much nearer arrives. Coverage of a tile's 8 rows is a handful of shifts per edge, done for all rows at once
+	// with AVX2 where the CPU has it, or row by row otherwise.
+	//
+	// Pixels are sampled at their centers, so everything is conservative against what the same triangles
+	// rasterize to, see RasterizeReference. Tile rows are rasterized in parallel, each by one thread.
+	// Doesn't touch any device, so it can be used and tested on its own.
+	class OcclusionCuller
+	{
+	public:
+		static const unsigned int TILE_WIDTH = 32;
+		static const unsigned int TILE_HEIGHT = 8;
+
+	private:
+		struct Tile
+		{
+			// Pixels of the working layer, bit x of row y.
+			uint32_t mask[TILE_HEIGHT];
+			// Farthest depth of the whole tile, and of the working layer's pixels.
+			float zMax0;
+			float zMax1;
+		};
+
+		// Where a triangle's edge crosses each row, and which side of it is inside.
+		struct Edge
+		{
+			// The edge crosses row y at x = slope * y + offset. Edges along a row are inside when slope * y + offset >= 0.
+			float slope;
+			float offset;
+			// 1 if the inside is right of the edge, -1 if left, 0 along a row.
+			int side;
+		};
+
+		// A triangle in pixels, ready to rasterize.
+		struct Triangle
+		{
+			Edge edges[3];
+			// Pixel bounds, clamped to the screen.
+			unsigned int minX;
+			unsigned int minY;
+			unsigned int maxX;
+			unsigned int maxY;
+			// Depth at (x0, y0) and its gradient, clamped to the vertices' range.
+			float x0;
+			float y0;
+			float z0;
+			float dzdx;
+			float dzdy;
+			float minZ;
+			float maxZ;
+		};
+
+		unsigned int _width;
+		unsigned int _height;
+		unsigned int _tilesX;
+		unsigned int _tilesY;
+		// Compute coverage with AVX2, see HasAvx2.
+		bool _avx2;
+
+		DirectX::XMFLOAT4X4 _viewProjection;
+
+		std::vector<Tile> _tiles;
+		std::vector<Triangle> _triangles;
+		// Triangles overlapping each row of tiles.
+		std::vector<std::vector<unsigned int>> _bins;
+		// Clip space vertices of the occluder being added.
+		std::vector<DirectX::XMFLOAT4> _clipVertices;
+
+		OcclusionStats _stats;
+
+	public:
+		// Construct an OcclusionCuller.
+		//	unsigned int width: Width of the depth buffer in pixels, rounded up to whole tiles
+		//	unsigned int height: Height of the depth buffer in pixels, rounded up to whole tiles
+		OcclusionCuller(unsigned int width = 640, unsigned int height = 360);
+		~OcclusionCuller() = default;
+
+		OcclusionCuller(const OcclusionCuller&) = delete;
+
+		// Empty the depth buffer and drop every occluder added.
+		void Clear();
+
+		// Set the camera occluders are added and bounds are tested with.
+		//	DirectX::FXMMATRIX viewProjection: View matrix times projection matrix
+		void SetViewProjection(DirectX::FXMMATRIX viewProjection);
+
+		// Add an occluder's triangles, which are clipped to the near plane and set up, but not rasterized until RenderOccluders.
+		//	const DirectX::XMFLOAT3* positions: Object space positions
+		//	unsigned int vertexCount: Number of positions
+		//	const unsigned int* indices: Triangle list
+		//	unsigned int indexCount: Number of indices
+		//	DirectX::FXMMATRIX world: World matrix of the occluder
+		//	bool cullBackFaces: Skip triangles facing away, whose front faces are clockwise. Keep them for open meshes
+		void AddOccluder(const DirectX::XMFLOAT3* positions, unsigned int vertexCount, const unsigned int* indices, unsigned int indexCount,
+			DirectX::FXMMATRIX world, bool cullBackFaces = true);
+
+		// Rasterize every occluder added, each row of tiles on its own thread.
+		//	ThreadPool* threadPool: Pool to rasterize on. nullptr rasterizes on the calling thread
+		void RenderOccluders(ThreadPool* threadPool = nullptr);
+
+		// Could any of a box be seen past the occluders? Safe to call from several threads at once.
+		//	const Bounds& bounds: World space bounds, only the box is tested
+		//	returns: false if every pixel it covers is behind the occluders or it is off screen, true if any may be visible
+		//		or it crosses the near plane
+		bool TestBounds(const Bounds& bounds) const;
+
+		// Rasterize the occluders added with a depth for every pixel, sampling coverage exactly as RenderOccluders does.
+		// Used to check the masked buffer never hides what this one shows.
+		//	std::vector<float>& depth: Receives width * height depths, rows top to bottom, FLT_MAX where nothing was drawn
+		void RasterizeReference(std::vector<float>& depth) const;
+
+		// Test bounds against a buffer from RasterizeReference.
+		//	const Bounds& bounds: See TestBounds
+		//	const std::vector<float>& depth: From RasterizeReference
+		bool TestBoundsReference(const Bounds& bounds, const std::vector<float>& depth) const;
+
+		// Depth of every pixel as far as the masked buffer knows, always at least the reference depth.
+		//	std::vector<float>& depth: Receives width * height depths, rows top to bottom, FLT_MAX where nothing was drawn
+		void GetDepth(std::vector<float>& depth) const;
+
+		unsigned int GetWidth() const;
+		unsigned int GetHeight() const;
+
+		const OcclusionStats& GetStats() const;
+
+	private:
+		// Clip a clip space triangle to the near plane, then set up what is left.
+		void AddTriangle(const DirectX::XMFLOAT4& a, const DirectX::XMFLOAT4& b, const DirectX::XMFLOAT4& c, bool cullBackFaces);
+
+		// Set up a triangle in front of the near plane.
+		void SetupTriangle(const DirectX::XMFLOAT4* vertices, bool cullBackFaces);
+
+		void RasterizeRow(unsigned int tileY);
+
+		// Coverage of one tile's rows by a triangle.
+		void ComputeCoverage(const Triangle& triangle, unsigned int tileX, unsigned int tileY, uint32_t* mask) const;
+
+		// Fold a triangle's coverage of a tile into it.
+		static void UpdateTile(Tile& tile, const uint32_t* coverage, float z);
+
+		// Project a box to the pixels it may cover and its nearest depth.
+		//	returns: -1 if off screen, 1 if it crosses the near plane, 0 if the pixels and depth were set
+		int ProjectBounds(const Bounds& bounds, unsigned int& minX, unsigned int& minY, unsigned int& maxX, unsigned int& maxY, float& zNear) const;
+	};
+}
@@ -0,0 +1,140 @@
+#include "PngFile.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace TinyEngine;
+
+using std::cout;
+using std::endl;
+using std::vector;
+
+namespace
+{
+	// Deflate's stored blocks hold at most this many bytes.
+	const size_t MAX_STORED_BLOCK = 65535;
+
+	uint32_t Crc32(const unsigned char* data, size_t size, uint32_t crc = 0)
+	{
+		static const auto table = []()
+		{
+			std::array<uint32_t, 256> entries;
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t c = i;
+				for (int bit = 0; bit < 8; bit++)
+				{
+					c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+				}
+
+				entries[i] = c;
+			}
+
+			return entries;
+		}();
+
+		crc = ~crc;
+		for (size_t i = 0; i < size; i++)
+		{
+			crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+		}
+
+		return ~crc;
+	}
+
+	uint32_t Adler32(const unsigned char* data, size_t size)
+	{
+		uint32_t a = 1;
+		uint32_t b = 0;
+		for (size_t i = 0; i < size; i++)
+		{
+			a = (a + data[i]) % 65521;
+			b = (b + a) % 65521;
+		}
+
+		return (b << 16) | a;
+	}
+
+	void PutBigEndian(vector<unsigned char>& out, uint32_t value)
+	{
+		out.insert(out.end(), { static_cast<unsigned char>(value >> 24), static_cast<unsigned char>(value >> 16),
+			static_cast<unsigned char>(value >> 8), static_cast<unsigned char>(value) });
+	}
+
+	// A chunk is its length, type, data and the CRC of the type and data.
+	void PutChunk(vector<unsigned char>& out, const char* type, const vector<unsigned char>& data)
+	{
+		PutBigEndian(out, static_cast<uint32_t>(data.size()));
+
+		size_t typeStart = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data.begin(), data.end());
+
+		PutBigEndian(out, Crc32(out.data() + typeStart, out.size() - typeStart));
+	}
+}
+
+bool TinyEngine::WritePng(const char* path, const unsigned char* rgba, int width, int height)
+{
+	if (width <= 0 || height <= 0)
+	{
+		cout << "Can't write an empty image: " << path << endl;
+		return false;
+	}
+
+	// Every row starts with its filter, 0 for none.
+	size_t rowSize = static_cast<size_t>(width) * 4;
+	vector<unsigned char> rows;
+	rows.reserve((rowSize + 1) * height);
+	for (int y = 0; y < height; y++)
+	{
+		rows.push_back(0);
+		rows.insert(rows.end(), rgba + y * rowSize, rgba + (y + 1) * rowSize);
+	}
+
+	vector<unsigned char> header;
+	PutBigEndian(header, static_cast<uint32_t>(width));
+	PutBigEndian(header, static_cast<uint32_t>(height));
+	// 8 bits per channel, RGBA, deflate, adaptive filtering, no interlacing.
+	header.insert(header.end(), { 8, 6, 0, 0, 0 });
+
+	// A zlib stream of stored deflate blocks.
+	vector<unsigned char> image = { 0x78, 0x01 };
+	for (size_t start = 0; start < rows.size(); start += MAX_STORED_BLOCK)
+	{
+		size_t size = std::min(MAX_STORED_BLOCK, rows.size() - start);
+		bool last = start + size == rows.size();
+
+		image.push_back(last ? 1 : 0);
+		image.insert(image.end(), { static_cast<unsigned char>(size), static_cast<unsigned char>(size >> 8),
+			static_cast<unsigned char>(~size), static_cast<unsigned char>(~size >> 8) });
+		image.insert(image.end(), rows.begin() + start, rows.begin() + start + size);
+	}
+
+	PutBigEndian(image, Adler32(rows.data(), rows.size()));
+
+	vector<unsigned char> file = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	PutChunk(file, "IHDR", header);
+	PutChunk(file, "IDAT", image);
+	PutChunk(file, "IEND", {});
+
+	std::ofstream stream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!stream.is_open())
+	{
+		cout << "Could not open image file for writing: " << path << endl;
+		return false;
+	}
+
+	stream.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+
+	if (!stream.good())
+	{
+		cout << "Failed to write image file: " << path << endl;
+		return false;
+	}
+
+	return true;
+}
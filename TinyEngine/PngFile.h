@@ -0,0 +1,13 @@
+#pragma once
+
+namespace TinyEngine
+{
+	// Write an image to a .png file. Its pixels are stored without compression, which keeps the writer small
+	// and its output the same byte for byte for the same pixels, at the cost of larger files.
+	//	const char* path: Path to write to
+	//	const unsigned char* rgba: Pixels, RGBA unorm, rows top to bottom
+	//	int width: Width of the image
+	//	int height: Height of the image
+	//	returns: false if the file could not be written
+	bool WritePng(const char* path, const unsigned char* rgba, int width, int height);
+}
@@ -0,0 +1,218 @@
+#include "RangeAllocator.h"
+#include <algorithm>
+#include <iostream>
+
+using namespace TinyEngine;
+
+using std::cout;
+using std::endl;
+using std::vector;
+
+RangeAllocator::RangeAllocator(unsigned int capacity) : _capacity(0), _allocatedSize(0)
+{
+	Grow(capacity);
+}
+
+unsigned int RangeAllocator::Allocate(unsigned int size)
+{
+	unsigned int offset = 0;
+
+	if (size > 0)
+	{
+		auto fit = _freeBySize.lower_bound(size);
+		if (fit == _freeBySize.end())
+		{
+			return INVALID_HANDLE;
+		}
+
+		offset = fit->second;
+		unsigned int rangeSize = fit->first;
+
+		RemoveFreeRange(_freeByOffset.find(offset));
+
+		if (rangeSize > size)
+		{
+			AddFreeRange(offset + size, rangeSize - size);
+		}
+	}
+
+	_allocatedSize += size;
+
+	unsigned int handle;
+	if (!_freeHandles.empty())
+	{
+		handle = _freeHandles.back();
+		_freeHandles.pop_back();
+		_allocations[handle] = { offset, size, true };
+	}
+	else
+	{
+		handle = static_cast<unsigned int>(_allocations.size());
+		_allocations.push_back({ offset, size, true });
+	}
+
+	return handle;
+}
+
+void RangeAllocator::Free(unsigned int handle)
+{
+	if (handle >= _allocations.size() || !_allocations[handle].live)
+	{
+		cout << "RangeAllocator: Freeing an invalid handle " << handle << "." << endl;
+		return;
+	}
+
+	auto& allocation = _allocations[handle];
+	allocation.live = false;
+	_freeHandles.push_back(handle);
+	_allocatedSize -= allocation.size;
+
+	if (allocation.size == 0)
+	{
+		return;
+	}
+
+	unsigned int offset = allocation.offset;
+	unsigned int size = allocation.size;
+
+	// Merge with the free ranges either side.
+	auto next = _freeByOffset.lower_bound(offset);
+	if (next != _freeByOffset.end() && next->first == offset + size)
+	{
+		size += next->second;
+		auto merged = next++;
+		RemoveFreeRange(merged);
+	}
+
+	if (next != _freeByOffset.begin())
+	{
+		auto previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			RemoveFreeRange(previous);
+		}
+	}
+
+	AddFreeRange(offset, size);
+}
+
+unsigned int RangeAllocator::GetOffset(unsigned int handle) const
+{
+	return _allocations[handle].offset;
+}
+
+unsigned int RangeAllocator::GetSize(unsigned int handle) const
+{
+	return _allocations[handle].size;
+}
+
+void RangeAllocator::Grow(unsigned int capacity)
+{
+	if (capacity <= _capacity)
+	{
+		return;
+	}
+
+	unsigned int offset = _capacity;
+	unsigned int size = capacity - _capacity;
+	_capacity = capacity;
+
+	// Extend the free range at the end if there is one.
+	if (!_freeByOffset.empty())
+	{
+		auto last = std::prev(_freeByOffset.end());
+		if (last->first + last->second == offset)
+		{
+			offset = last->first;
+			size += last->second;
+			RemoveFreeRange(last);
+		}
+	}
+
+	AddFreeRange(offset, size);
+}
+
+void RangeAllocator::Defragment(vector<RangeMove>& moves)
+{
+	moves.clear();
+
+	for (unsigned int handle = 0; handle < _allocations.size(); handle++)
+	{
+		const auto& allocation = _allocations[handle];
+		if (allocation.live && allocation.size > 0)
+		{
+			moves.push_back({ handle, allocation.offset, 0, allocation.size });
+		}
+	}
+
+	std::sort(moves.begin(), moves.end(), [](const RangeMove& a, const RangeMove& b) { return a.from < b.from; });
+
+	unsigned int offset = 0;
+	for (auto& move : moves)
+	{
+		move.to = offset;
+		_allocations[move.handle].offset = offset;
+		offset += move.size;
+	}
+
+	_freeByOffset.clear();
+	_freeBySize.clear();
+
+	if (offset < _capacity)
+	{
+		AddFreeRange(offset, _capacity - offset);
+	}
+}
+
+unsigned int RangeAllocator::GetCapacity() const
+{
+	return _capacity;
+}
+
+unsigned int RangeAllocator::GetAllocatedSize() const
+{
+	return _allocatedSize;
+}
+
+unsigned int RangeAllocator::GetFreeSize() const
+{
+	return _capacity - _allocatedSize;
+}
+
+unsigned int RangeAllocator::GetLargestFreeRange() const
+{
+	return _freeBySize.empty() ? 0 : std::prev(_freeBySize.end())->first;
+}
+
+unsigned int RangeAllocator::GetFreeRangeCount() const
+{
+	return static_cast<unsigned int>(_freeByOffset.size());
+}
+
+unsigned int RangeAllocator::GetAllocationCount() const
+{
+	return static_cast<unsigned int>(_allocations.size() - _freeHandles.size());
+}
+
+void RangeAllocator::AddFreeRange(unsigned int offset, unsigned int size)
+{
+	_freeByOffset.emplace(offset, size);
+	_freeBySize.emplace(size, offset);
+}
+
+void RangeAllocator::RemoveFreeRange(std::map<unsigned int, unsigned int>::iterator range)
+{
+	auto sizes = _freeBySize.equal_range(range->second);
+	for (auto it = sizes.first; it != sizes.second; ++it)
+	{
+		if (it->second == range->first)
+		{
+			_freeBySize.erase(it);
+			break;
+		}
+	}
+
+	_freeByOffset.erase(range);
+}
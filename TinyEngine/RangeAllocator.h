@@ -0,0 +1,87 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+namespace TinyEngine
+{
+	// Where Defragment moved an allocation, in the allocator's units.
+	struct RangeMove
+	{
+		unsigned int handle;
+		unsigned int from;
+		unsigned int to;
+		unsigned int size;
+	};
+
+	// Hands out ranges of a linear space, such as elements of a buffer, and tracks them by handle.
+	// Free ranges are kept merged and allocations take the smallest free range which fits.
+	// Doesn't own any memory, so it can be used and tested without a device.
+	class RangeAllocator
+	{
+	private:
+		struct Allocation
+		{
+			unsigned int offset;
+			unsigned int size;
+			bool live;
+		};
+
+		unsigned int _capacity;
+		unsigned int _allocatedSize;
+
+		// Free ranges by offset, and the same ranges by size for best fit.
+		std::map<unsigned int, unsigned int> _freeByOffset;
+		std::multimap<unsigned int, unsigned int> _freeBySize;
+
+		std::vector<Allocation> _allocations;
+		std::vector<unsigned int> _freeHandles;
+
+	public:
+		static const unsigned int INVALID_HANDLE = ~0u;
+
+		// Construct a RangeAllocator.
+		//	unsigned int capacity: Size of the space, which starts out free
+		RangeAllocator(unsigned int capacity = 0);
+		~RangeAllocator() = default;
+
+		// Allocate a range.
+		//	unsigned int size: Size of the range. Empty ranges are allowed and take no space
+		//	returns: Handle of the range, INVALID_HANDLE if no free range is large enough
+		unsigned int Allocate(unsigned int size);
+
+		// Return a range to the free space, merging it with its free neighbours.
+		//	unsigned int handle: Range to free, from Allocate
+		void Free(unsigned int handle);
+
+		unsigned int GetOffset(unsigned int handle) const;
+		unsigned int GetSize(unsigned int handle) const;
+
+		// Extend the space, the added size is free. Capacity can't shrink.
+		//	unsigned int capacity: New size of the space
+		void Grow(unsigned int capacity);
+
+		// Pack every allocation to the start of the space in offset order, leaving one free range at the end.
+		// Handles stay valid, only their offsets change.
+		//	std::vector<RangeMove>& moves: Receives every live allocation's old and new offset, including
+		//		those which didn't move, so the owner can copy its data. Cleared first
+		void Defragment(std::vector<RangeMove>& moves);
+
+		unsigned int GetCapacity() const;
+		unsigned int GetAllocatedSize() const;
+		unsigned int GetFreeSize() const;
+
+		// The largest allocation which would currently succeed.
+		unsigned int GetLargestFreeRange() const;
+
+		// Number of separate free ranges, 1 or 0 when there is no fragmentation.
+		unsigned int GetFreeRangeCount() const;
+
+		// Number of live allocations.
+		unsigned int GetAllocationCount() const;
+
+	private:
+		void AddFreeRange(unsigned int offset, unsigned int size);
+		void RemoveFreeRange(std::map<unsigned int, unsigned int>::iterator range);
+	};
+}
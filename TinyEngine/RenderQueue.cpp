@@ -0,0 +1,300 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace TinyEngine;
+using namespace DirectX;
+
+void RenderBackend::Prepare(const RenderBatch*, size_t, const XMFLOAT4X4*)
+{
+}
+
+void RecordingRenderBackend::Draw(const RenderObject&, const RenderDraw& draw, const XMFLOAT4X4*, unsigned int instanceCount)
+{
+	draws.push_back({ draw, instanceCount });
+}
+
+RenderQueue::RenderQueue() : _sorted(true)
+{
+}
+
+unsigned int RenderQueue::AddObject(Mesh* mesh, FXMMATRIX world, CXMMATRIX view, CXMMATRIX projection, XMFLOAT3 eyePosition, unsigned int lod)
+{
+	XMFLOAT4X4 instance;
+	XMStoreFloat4x4(&instance, world);
+
+	return AddInstancedObject(mesh, &instance, 1, view, projection, eyePosition, lod);
+}
+
+unsigned int RenderQueue::AddInstancedObject(Mesh* mesh, const XMFLOAT4X4* worlds, unsigned int instanceCount, CXMMATRIX view,
+	CXMMATRIX projection, XMFLOAT3 eyePosition, unsigned int lod)
+{
+	RenderObject object;
+	XMStoreFloat4x4(&object.view, view);
+	XMStoreFloat4x4(&object.projection, projection);
+	object.eyePosition = eyePosition;
+	object.lod = lod;
+	object.mesh = mesh;
+	object.instanceStart = static_cast<unsigned int>(_instances.size());
+	object.instanceCount = instanceCount;
+
+	_instances.insert(_instances.end(), worlds, worlds + instanceCount);
+	_objects.push_back(object);
+
+	return static_cast<unsigned int>(_objects.size() - 1);
+}
+
+void RenderQueue::AddDraw(unsigned int object, unsigned int part, Material* material, Shader* shader, RenderPass pass, float depth)
+{
+	uint32_t shaderId = GetId(_shaderIds, shader, SHADER_BITS);
+	uint32_t materialId = GetId(_materialIds, material, MATERIAL_BITS);
+	uint32_t meshId = GetId(_meshIds, _objects[object].mesh, MESH_BITS);
+
+	uint64_t key = MakeKey(pass, shaderId, materialId, meshId, depth);
+
+	_packets.push_back({ key, static_cast<unsigned int>(_draws.size()) });
+	_draws.push_back({ key, object, part, material, shader });
+	_sorted = false;
+}
+
+void RenderQueue::Sort()
+{
+	if (_sorted)
+	{
+		return;
+	}
+
+	// Least significant digit radix sort, a byte at a time. Every histogram is built in one pass and bytes
+	// which are the same for every key are skipped, which is most of them for a small scene.
+	const unsigned int DIGITS = sizeof(uint64_t);
+	size_t counts[DIGITS][256] = {};
+	for (const auto& packet : _packets)
+	{
+		for (unsigned int digit = 0; digit < DIGITS; digit++)
+		{
+			counts[digit][(packet.key >> (digit * 8)) & 0xFF]++;
+		}
+	}
+
+	_scratch.resize(_packets.size());
+
+	for (unsigned int digit = 0; digit < DIGITS; digit++)
+	{
+		auto& count = counts[digit];
+		if (_packets.empty() || count[(_packets[0].key >> (digit * 8)) & 0xFF] == _packets.size())
+		{
+			continue;
+		}
+
+		size_t offsets[256];
+		size_t offset = 0;
+		for (unsigned int bucket = 0; bucket < 256; bucket++)
+		{
+			offsets[bucket] = offset;
+			offset += count[bucket];
+		}
+
+		for (const auto& packet : _packets)
+		{
+			_scratch[offsets[(packet.key >> (digit * 8)) & 0xFF]++] = packet;
+		}
+
+		_packets.swap(_scratch);
+	}
+
+	_sorted = true;
+}
+
+void RenderQueue::Submit(RenderBackend& backend, bool batchInstances)
+{
+	Sort();
+
+	if (batchInstances)
+	{
+		GroupParts();
+	}
+
+	// Every part of an object draws all of its instances, batched or not.
+	size_t worldCount = 0;
+	for (const auto& draw : _draws)
+	{
+		worldCount += _objects[draw.object].instanceCount;
+	}
+
+	_batchWorlds.resize(worldCount);
+	_batches.clear();
+
+	unsigned int instanceStart = 0;
+	for (size_t i = 0; i < _packets.size();)
+	{
+		const auto& draw = _draws[_packets[i].draw];
+
+		// Gather the instances of this draw and every following draw which can join it.
+		unsigned int instanceCount = 0;
+		size_t end = i;
+		do
+		{
+			const auto& object = _objects[_draws[_packets[end].draw].object];
+			memcpy(&_batchWorlds[instanceStart + instanceCount], &_instances[object.instanceStart], object.instanceCount * sizeof(XMFLOAT4X4));
+			instanceCount += object.instanceCount;
+			end++;
+		} while (batchInstances && end < _packets.size() && CanBatch(draw, _draws[_packets[end].draw]));
+
+		_batches.push_back({ &_objects[draw.object], &draw, instanceStart, instanceCount });
+
+		instanceStart += instanceCount;
+		i = end;
+	}
+
+	backend.Prepare(_batches.data(), _batches.size(), _batchWorlds.data());
+
+	for (const auto& batch : _batches)
+	{
+		backend.Draw(*batch.object, *batch.draw, &_batchWorlds[batch.instanceStart], batch.instanceCount);
+	}
+
+	Clear();
+}
+
+void RenderQueue::Clear()
+{
+	_objects.clear();
+	_instances.clear();
+	_draws.clear();
+	_batches.clear();
+	_packets.clear();
+	_sorted = true;
+}
+
+size_t RenderQueue::GetDrawCount() const
+{
+	return _draws.size();
+}
+
+size_t RenderQueue::GetObjectCount() const
+{
+	return _objects.size();
+}
+
+size_t RenderQueue::GetInstanceCount() const
+{
+	return _instances.size();
+}
+
+const RenderDraw& RenderQueue::GetSortedDraw(size_t index) const
+{
+	return _draws[_packets[index].draw];
+}
+
+uint64_t RenderQueue::MakeKey(RenderPass pass, uint32_t shader, uint32_t material, uint32_t mesh, float depth)
+{
+	const uint64_t SHADER_MASK = (1ull << SHADER_BITS) - 1;
+	const uint64_t MATERIAL_MASK = (1ull << MATERIAL_BITS) - 1;
+	const uint64_t MESH_MASK = (1ull << MESH_BITS) - 1;
+	const uint64_t DEPTH_MASK = (1ull << DEPTH_BITS) - 1;
+
+	uint64_t state = ((shader & SHADER_MASK) << (MATERIAL_BITS + MESH_BITS))
+		| ((material & MATERIAL_MASK) << MESH_BITS)
+		| (mesh & MESH_MASK);
+	uint64_t quantized = QuantizeDepth(depth);
+
+	uint64_t key = static_cast<uint64_t>(pass) << (64 - PASS_BITS);
+	if (pass == RenderPass::TRANSPARENT_PASS)
+	{
+		key |= ((DEPTH_MASK - quantized) << (SHADER_BITS + MATERIAL_BITS + MESH_BITS)) | state;
+	}
+	else
+	{
+		key |= (state << DEPTH_BITS) | quantized;
+	}
+
+	return key;
+}
+
+uint32_t RenderQueue::QuantizeDepth(float depth)
+{
+	// Positive floats order the same as their bits. NaN fails the comparison and is treated as 0 too.
+	if (!(depth > 0.0f))
+	{
+		return 0;
+	}
+
+	uint32_t bits;
+	memcpy(&bits, &depth, sizeof(bits));
+
+	return bits >> (31 - DEPTH_BITS);
+}
+
+void RenderQueue::GroupParts()
+{
+	// Opaque draws with the same state differ only by depth, part and object. The key has no room for the
+	// part, so the parts of one mesh which share a material are interleaved by depth until they're grouped.
+	for (size_t start = 0; start < _packets.size();)
+	{
+		uint64_t state = _packets[start].key >> DEPTH_BITS;
+		if (static_cast<RenderPass>(_packets[start].key >> (64 - PASS_BITS)) != RenderPass::OPAQUE_PASS)
+		{
+			// Transparent draws come last and have to stay back to front.
+			break;
+		}
+
+		size_t end = start + 1;
+		while (end < _packets.size() && (_packets[end].key >> DEPTH_BITS) == state)
+		{
+			end++;
+		}
+
+		if (end - start > 1)
+		{
+			// Stable, so each part stays front to back.
+			std::stable_sort(_packets.begin() + start, _packets.begin() + end, [this](const Packet& a, const Packet& b)
+			{
+				const auto& drawA = _draws[a.draw];
+				const auto& drawB = _draws[b.draw];
+				unsigned int lodA = _objects[drawA.object].lod;
+				unsigned int lodB = _objects[drawB.object].lod;
+
+				return drawA.part < drawB.part || (drawA.part == drawB.part && lodA < lodB);
+			});
+		}
+
+		start = end;
+	}
+}
+
+bool RenderQueue::CanBatch(const RenderDraw& first, const RenderDraw& next) const
+{
+	// The key holds the pass, so draws in different passes never match.
+	if (first.part != next.part || first.material != next.material || first.shader != next.shader
+		|| (first.key >> (64 - PASS_BITS)) != (next.key >> (64 - PASS_BITS)))
+	{
+		return false;
+	}
+
+	const auto& a = _objects[first.object];
+	const auto& b = _objects[next.object];
+
+	return a.mesh == b.mesh && a.lod == b.lod
+		&& memcmp(&a.view, &b.view, sizeof(a.view)) == 0
+		&& memcmp(&a.projection, &b.projection, sizeof(a.projection)) == 0
+		&& memcmp(&a.eyePosition, &b.eyePosition, sizeof(a.eyePosition)) == 0;
+}
+
+uint32_t RenderQueue::GetId(std::unordered_map<const void*, uint32_t>& ids, const void* object, unsigned int bits)
+{
+	auto found = ids.find(object);
+	if (found != ids.end())
+	{
+		return found->second;
+	}
+
+	if (ids.size() >= (1u << bits))
+	{
+		ids.clear();
+	}
+
+	auto id = static_cast<uint32_t>(ids.size());
+	ids.emplace(object, id);
+
+	return id;
+}
@@ -0,0 +1,217 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace TinyEngine
+{
+	class Mesh;
+	class Shader;
+	struct Material;
+
+	// Draws are submitted pass by pass, in this order.
+	enum class RenderPass : uint8_t
+	{
+		// Sorted by state, then front to back.
+		OPAQUE_PASS = 0,
+		// Sorted back to front, then by state.
+		TRANSPARENT_PASS = 1
+	};
+
+	// A mesh drawn this frame, once or as several instances, and everything its parts' draws share.
+	struct RenderObject
+	{
+		DirectX::XMFLOAT4X4 view;
+		DirectX::XMFLOAT4X4 projection;
+		DirectX::XMFLOAT3 eyePosition;
+		// Level of detail to draw, see Renderer::DrawMesh.
+		unsigned int lod;
+		Mesh* mesh;
+		// World matrices of the object's instances, in the queue's instance array.
+		unsigned int instanceStart;
+		unsigned int instanceCount;
+	};
+
+	// One part of a RenderObject with the material and shader to draw it with.
+	struct RenderDraw
+	{
+		uint64_t key;
+		unsigned int object;
+		unsigned int part;
+		Material* material;
+		Shader* shader;
+	};
+
+	// A draw as it is submitted, with the instances of every draw batched into it.
+	struct RenderBatch
+	{
+		// The first object and draw of the batch.
+		const RenderObject* object;
+		const RenderDraw* draw;
+		// Instances in the world matrices passed to RenderBackend::Prepare.
+		unsigned int instanceStart;
+		unsigned int instanceCount;
+	};
+
+	// Receives the draws of a RenderQueue in sorted order.
+	class RenderBackend
+	{
+	public:
+		virtual ~RenderBackend() = default;
+
+		// Called once per Submit before any draw, with every batch that is about to be drawn, so their
+		// data can be uploaded at once. Does nothing unless overridden.
+		//	const RenderBatch* batches: Batches in the order they are drawn
+		//	size_t batchCount: Number of batches
+		//	const DirectX::XMFLOAT4X4* worlds: World matrix of every instance of every batch
+		virtual void Prepare(const RenderBatch* batches, size_t batchCount, const DirectX::XMFLOAT4X4* worlds);
+
+		// Draw one part, once for each instance.
+		//	const RenderObject& object: Object the part belongs to, the first of the batch if several were batched
+		//	const RenderDraw& draw: Part to draw
+		//	const DirectX::XMFLOAT4X4* worlds: World matrix of each instance, the batch's instances of the array
+		//		passed to Prepare
+		//	unsigned int instanceCount: Number of instances, at least 1
+		virtual void Draw(const RenderObject& object, const RenderDraw& draw, const DirectX::XMFLOAT4X4* worlds, unsigned int instanceCount) = 0;
+	};
+
+	// Keeps the draws it is given, in order, without touching any of them.
+	class RecordingRenderBackend :
+		public RenderBackend
+	{
+	public:
+		struct Record
+		{
+			RenderDraw draw;
+			unsigned int instanceCount;
+		};
+
+		std::vector<Record> draws;
+
+		virtual void Draw(const RenderObject& object, const RenderDraw& draw, const DirectX::XMFLOAT4X4* worlds, unsigned int instanceCount) override;
+	};
+
+	// Collects a frame's draws as compact packets, then sorts them by a 64 bit key and submits them to a backend.
+	//
+	// Key layout, most significant bits first:
+	//	Opaque:			pass (2) | shader (10) | material (16) | mesh (16) | depth (20)
+	//	Transparent:	pass (2) | inverted depth (20) | shader (10) | material (16) | mesh (16)
+	// Shaders, materials and meshes are given ids in the order they are first queued. Once a field runs
+	// out of ids they are all given out again, which only shuffles the grouping. Depth is the top 20 bits
+	// of the float, which orders any positive distance.
+	//
+	// Submit can batch instances: sorted draws next to each other with the same mesh, part, material,
+	// shader, level of detail and camera are passed to the backend as one draw of all their instances.
+	// Opaque draws with the same state are grouped by part and level of detail first, so objects which
+	// share a mesh and materials are batched however they were queued, at the cost of ordering each
+	// group front to back on its own.
+	class RenderQueue
+	{
+	private:
+		// What is sorted, a key and the draw it belongs to.
+		struct Packet
+		{
+			uint64_t key;
+			unsigned int draw;
+		};
+
+		std::vector<RenderObject> _objects;
+		std::vector<DirectX::XMFLOAT4X4> _instances;
+		std::vector<RenderDraw> _draws;
+		std::vector<Packet> _packets;
+		std::vector<Packet> _scratch;
+		// What is submitted, and the world matrices of each batch one after the other.
+		std::vector<RenderBatch> _batches;
+		std::vector<DirectX::XMFLOAT4X4> _batchWorlds;
+		bool _sorted;
+
+		std::unordered_map<const void*, uint32_t> _shaderIds;
+		std::unordered_map<const void*, uint32_t> _materialIds;
+		std::unordered_map<const void*, uint32_t> _meshIds;
+
+	public:
+		static const unsigned int PASS_BITS = 2;
+		static const unsigned int SHADER_BITS = 10;
+		static const unsigned int MATERIAL_BITS = 16;
+		static const unsigned int MESH_BITS = 16;
+		static const unsigned int DEPTH_BITS = 20;
+
+		RenderQueue();
+		~RenderQueue() = default;
+
+		RenderQueue(const RenderQueue&) = delete;
+
+		// Add a mesh whose parts are about to be queued.
+		//	Mesh* mesh: Mesh to draw
+		//	DirectX::FXMMATRIX world: World matrix of the mesh
+		//	DirectX::CXMMATRIX view: View matrix of the camera
+		//	DirectX::CXMMATRIX projection: Projection matrix of the camera
+		//	DirectX::XMFLOAT3 eyePosition: Position of the camera
+		//	unsigned int lod: Level of detail to draw
+		//	returns: Index of the object, to queue its parts with
+		unsigned int AddObject(Mesh* mesh, DirectX::FXMMATRIX world, DirectX::CXMMATRIX view, DirectX::CXMMATRIX projection,
+			DirectX::XMFLOAT3 eyePosition, unsigned int lod);
+
+		// Add a mesh drawn several times, whose parts are about to be queued.
+		//	Mesh* mesh: Mesh to draw
+		//	const DirectX::XMFLOAT4X4* worlds: World matrix of each instance, copied
+		//	unsigned int instanceCount: Number of instances, at least 1
+		//	DirectX::CXMMATRIX view: View matrix of the camera
+		//	DirectX::CXMMATRIX projection: Projection matrix of the camera
+		//	DirectX::XMFLOAT3 eyePosition: Position of the camera
+		//	unsigned int lod: Level of detail to draw
+		//	returns: Index of the object, to queue its parts with
+		unsigned int AddInstancedObject(Mesh* mesh, const DirectX::XMFLOAT4X4* worlds, unsigned int instanceCount, DirectX::CXMMATRIX view,
+			DirectX::CXMMATRIX projection, DirectX::XMFLOAT3 eyePosition, unsigned int lod);
+
+		// Queue a part of an object.
+		//	unsigned int object: From AddObject
+		//	unsigned int part: Part of the object's mesh
+		//	Material* material: Material to draw with
+		//	Shader* shader: Shader to draw with
+		//	RenderPass pass: Pass the draw belongs to
+		//	float depth: View space distance, eg. of the object's bounds
+		void AddDraw(unsigned int object, unsigned int part, Material* material, Shader* shader, RenderPass pass, float depth);
+
+		// Sort the queued draws by key. Draws with equal keys keep the order they were queued in.
+		void Sort();
+
+		// Sort the queued draws if they aren't already, prepare the backend with every batch, pass them to it
+		// in order, then clear the queue.
+		//	RenderBackend& backend: Backend to draw with
+		//	bool batchInstances: Pass runs of draws which only differ by world matrix as one draw
+		void Submit(RenderBackend& backend, bool batchInstances = true);
+
+		// Drop every queued draw and object. Ids are kept so keys stay the same from frame to frame.
+		void Clear();
+
+		size_t GetDrawCount() const;
+		size_t GetObjectCount() const;
+		size_t GetInstanceCount() const;
+
+		// The draws in the order they are submitted in, once sorted.
+		const RenderDraw& GetSortedDraw(size_t index) const;
+
+		// Build a key from its fields, which are masked to their widths.
+		//	RenderPass pass: Pass of the draw
+		//	uint32_t shader: Id of the draw's shader
+		//	uint32_t material: Id of the draw's material
+		//	uint32_t mesh: Id of the draw's mesh
+		//	float depth: View space distance of the draw, negative is treated as 0
+		static uint64_t MakeKey(RenderPass pass, uint32_t shader, uint32_t material, uint32_t mesh, float depth);
+
+		// Quantize a distance to DEPTH_BITS, larger distances give larger values.
+		static uint32_t QuantizeDepth(float depth);
+
+	private:
+		// Reorder opaque draws with the same state so those of each part and level of detail are next to each other.
+		void GroupParts();
+
+		// Can two sorted draws be passed to the backend as one?
+		bool CanBatch(const RenderDraw& first, const RenderDraw& next) const;
+
+		static uint32_t GetId(std::unordered_map<const void*, uint32_t>& ids, const void* object, unsigned int bits);
+	};
+}
@@ -6,7 +6,10 @@
 #include "Renderer.h"
 #include "EngineEventType.h"
 #include <DirectXMath.h>
+#include <algorithm>
+#include <cfloat>
 #include <iostream>
+#include <thread>
 #include <comdef.h>
 
 using Microsoft::WRL::ComPtr;
@@ -18,15 +21,25 @@ using std::endl;
 
 #define CHECK_HR(hr, message) if (FAILED(hr)) {_com_error err(hr); cout << message << "\n\t" << err.ErrorMessage() << std::endl; }
 
-TinyEngine::Renderer::Renderer(int width, int height, Window& window)
+namespace
 {
-	UINT createDeviceFlags = {};
-	createDeviceFlags |= D3D11_CREATE_DEVICE_SINGLETHREADED;
+	UINT GetCreateDeviceFlags()
+	{
+		UINT createDeviceFlags = {};
+		createDeviceFlags |= D3D11_CREATE_DEVICE_SINGLETHREADED;
 
 #if DEBUG || _DEBUG
-	createDeviceFlags |= D3D11_CREATE_DEVICE_DEBUG;
+		createDeviceFlags |= D3D11_CREATE_DEVICE_DEBUG;
 #endif
 
+		return createDeviceFlags;
+	}
+}
+
+TinyEngine::Renderer::Renderer(int width, int height, Window& window)
+{
+	UINT createDeviceFlags = GetCreateDeviceFlags();
+
 	D3D_FEATURE_LEVEL featureLevels[] = {
 		D3D_FEATURE_LEVEL_11_1
 	};
@@ -72,6 +85,71 @@ TinyEngine::Renderer::Renderer(int width, int height, Window& window)
 
 	BindCurrentBackBufferView();
 
+	Initialize(width, height);
+}
+
+TinyEngine::Renderer::Renderer(int width, int height)
+{
+	UINT createDeviceFlags = GetCreateDeviceFlags();
+
+	D3D_FEATURE_LEVEL featureLevels[] = {
+		D3D_FEATURE_LEVEL_11_1
+	};
+
+	HRESULT hr;
+
+	hr = D3D11CreateDevice(
+		nullptr,
+		D3D_DRIVER_TYPE_HARDWARE,
+		nullptr,
+		createDeviceFlags,
+		featureLevels, 1,
+		D3D11_SDK_VERSION,
+		&_device,
+		nullptr,
+		&_immediateContext);
+
+	// Machines without a GPU, such as build machines, can still draw with the WARP software device.
+	if (FAILED(hr))
+	{
+		hr = D3D11CreateDevice(
+			nullptr,
+			D3D_DRIVER_TYPE_WARP,
+			nullptr,
+			createDeviceFlags,
+			featureLevels, 1,
+			D3D11_SDK_VERSION,
+			&_device,
+			nullptr,
+			&_immediateContext);
+	}
+
+	if (FAILED(hr))
+	{
+		cout << "Failed to create Device." << endl;
+	}
+
+	CreateOffscreenTarget(width, height);
+
+	_frameQueries.resize(FRAMES_IN_FLIGHT);
+	for (auto& query : _frameQueries)
+	{
+		D3D11_QUERY_DESC qd = {};
+		qd.Query = D3D11_QUERY_EVENT;
+
+		hr = _device->CreateQuery(&qd, &query);
+		CHECK_HR(hr, "Failed to create frame query.");
+	}
+
+	Initialize(width, height);
+}
+
+void TinyEngine::Renderer::Initialize(int width, int height)
+{
+	_frameIndex = 0;
+
+	HRESULT hr;
+
 	D3D11_TEXTURE2D_DESC dstd = {};
 	dstd.Width = width;
 	dstd.Height = height;
@@ -137,27 +215,99 @@ TinyEngine::Renderer::Renderer(int width, int height, Window& window)
 	UpdateViewport(0, 0, width, height);
 
 	D3D11_INPUT_ELEMENT_DESC inputDescs[3] = {
-		{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA},
-		{"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA},
-		{"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA}
+		{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+		{"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+		{"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0}
+	};
+
+	_shaders = new ShaderLibrary(this, SHADER_BUNDLE_PATH, SHADER_DIRECTORY);
+
+	_defaultShader = _shaders->GetShader("DefaultVertexShader", "DefaultPixelShader", inputDescs, 3);
+
+	D3D11_INPUT_ELEMENT_DESC packedInputDescs[3] = {
+		{"POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+		{"NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0},
+		{"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_VERTEX_DATA, 0}
+	};
+
+	// Shares the pixel shader with the default shader.
+	_defaultPackedShader = _shaders->GetShader("DefaultPackedVertexShader", "DefaultPixelShader", packedInputDescs, 3);
+
+	// The instanced variants take the vertex elements from slot 0 and InstanceData from slot 1.
+	D3D11_INPUT_ELEMENT_DESC instanceDescs[8] = {
+		{"WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+		{"WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+		{"WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+		{"WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+		{"WORLDINVERSETRANSPOSE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+		{"WORLDINVERSETRANSPOSE", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+		{"WORLDINVERSETRANSPOSE", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+		{"WORLDINVERSETRANSPOSE", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, D3D11_APPEND_ALIGNED_ELEMENT, D3D11_INPUT_PER_INSTANCE_DATA, 1}
 	};
 
-	_defaultShader = new Shader(this, "./assets/shader/defaultVertexShader.cso", "./assets/shader/defaultPixelShader.cso", inputDescs, 3);
+	D3D11_INPUT_ELEMENT_DESC instancedInputDescs[11];
+	std::copy(inputDescs, inputDescs + 3, instancedInputDescs);
+	std::copy(instanceDescs, instanceDescs + 8, instancedInputDescs + 3);
+
+	_defaultInstancedShader = _shaders->GetShader("DefaultInstancedVertexShader", "DefaultPixelShader", instancedInputDescs, 11);
+
+	std::copy(packedInputDescs, packedInputDescs + 3, instancedInputDescs);
+
+	_defaultPackedInstancedShader = _shaders->GetShader("DefaultPackedInstancedVertexShader", "DefaultPixelShader", instancedInputDescs, 11);
 	
-	_perObjectCB = new ConstantBuffer<PerObjectCBData>(this);
-	_perMaterialCB = new ConstantBuffer<PerMaterialCBData>(this);
+	// Constant buffer offsets are required by 11.1, mapping them without discarding isn't.
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+	hr = _device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+	CHECK_HR(hr, "Failed to check D3D11.1 options.");
+
+	if (!options.ConstantBufferOffsetting)
+	{
+		cout << "Constant buffer offsets are not supported, objects will not draw correctly." << endl;
+	}
+
+	_constantRingNoOverwrite = options.MapNoOverwriteOnDynamicConstantBuffer;
+	_preparedWorlds = nullptr;
+	_prepared = false;
+
+	CreateConstantRing(CONSTANT_RING_SIZE);
+
+	D3D11_BUFFER_DESC ibd = {};
+	ibd.ByteWidth = INSTANCE_BUFFER_CAPACITY * sizeof(InstanceData);
+	ibd.Usage = D3D11_USAGE_DYNAMIC;
+	ibd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	ibd.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	hr = _device->CreateBuffer(&ibd, nullptr, &_instanceBuffer);
+	CHECK_HR(hr, "Failed to create instance buffer.");
+
+	// Full, so the first batch discards it.
+	_instanceBufferUsed = INSTANCE_BUFFER_CAPACITY;
+
+	_geometryArena = new GeometryArena(this);
+
+	_queue = new RenderQueue();
+	_state = new StateCache(_immediateContext);
+	_cullBlock = ~0u;
 }
 
 TinyEngine::Renderer::~Renderer()
 {
-	delete _perMaterialCB;
-	_perMaterialCB = nullptr;
+	delete _state;
+	_state = nullptr;
+
+	delete _queue;
+	_queue = nullptr;
 
-	delete _perObjectCB;
-	_perObjectCB = nullptr;
+	delete _geometryArena;
+	_geometryArena = nullptr;
 
-	delete _defaultShader;
 	_defaultShader = nullptr;
+	_defaultPackedShader = nullptr;
+	_defaultInstancedShader = nullptr;
+	_defaultPackedInstancedShader = nullptr;
+
+	delete _shaders;
+	_shaders = nullptr;
 }
 
 void TinyEngine::Renderer::SetClearColor(DirectX::XMFLOAT4 color)
@@ -169,110 +319,544 @@ void TinyEngine::Renderer::Clear()
 {
 	_immediateContext->ClearDepthStencilView(_depthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 	_immediateContext->ClearRenderTargetView(_backBufferView.Get(), reinterpret_cast<float*>(&_clearColor));
+
+	_meshletStats = MeshletCullStats();
+}
+
+TinyEngine::ShaderLibrary* TinyEngine::Renderer::GetShaders() const
+{
+	return _shaders;
+}
+
+TinyEngine::GeometryArenaStats TinyEngine::Renderer::GetGeometryStats() const
+{
+	return _geometryArena->GetStats();
+}
+
+const TinyEngine::MeshletCullStats& TinyEngine::Renderer::GetMeshletStats() const
+{
+	return _meshletStats;
+}
+
+const TinyEngine::StateCacheStats& TinyEngine::Renderer::GetStateStats() const
+{
+	return _state->GetStats();
 }
 
 void TinyEngine::Renderer::SwapBuffers()
 {
-	_swapChain->Present(0, 0);
+	Submit();
+
+	if (_swapChain)
+	{
+		_swapChain->Present(0, 0);
+	}
+	else
+	{
+		WaitForFrame();
+	}
+
+	// Constant blocks of frames the GPU has finished with can be reused.
+	_constantAllocator.EndFrame();
 
 	BindCurrentBackBufferView();
 
 	_immediateContext->OMSetRenderTargets(1, _backBufferView.GetAddressOf(), _depthStencilView.Get());
 }
 
-void TinyEngine::Renderer::DrawMesh(Mesh* mesh, std::vector<Material*> materials, ICamera* camera, DirectX::XMMATRIX world)
+void TinyEngine::Renderer::DrawMesh(Mesh* mesh, std::vector<Material*> materials, ICamera* camera, DirectX::XMMATRIX world, unsigned int lod)
 {
-	// TODO WT: Dont draw here, build a batch that's sorted by shader and vertex buffer to optimize drawing.
-	// Let shaders deal with uploading the data they need.
-	auto context = _immediateContext;
+	if (mesh->GetNumMeshParts() == 0)
+	{
+		cout << __FILE__ << ":" << __LINE__ << "Drawing just a vertex buffer is not currently supported, Dont do it." << endl;
+		return;
+	}
+
+	auto view = camera->GetView();
+	unsigned int object = _queue->AddObject(mesh, world, view, camera->GetProjection(), camera->GetEyePosition(), lod);
+
+	// Every part is sorted by the depth of the mesh's bounds.
+	auto center = mesh->GetBoundsCenter();
+	float depth = XMVectorGetZ(XMVector3TransformCoord(XMVector3TransformCoord(XMLoadFloat3(&center), world), view));
+
+	QueueParts(mesh, materials, object, depth);
+}
+
+void TinyEngine::Renderer::DrawMeshInstanced(Mesh* mesh, std::vector<Material*> materials, ICamera* camera, const DirectX::XMFLOAT4X4* worlds,
+	unsigned int instanceCount, unsigned int lod)
+{
+	if (mesh->GetNumMeshParts() == 0)
+	{
+		cout << __FILE__ << ":" << __LINE__ << "Drawing just a vertex buffer is not currently supported, Dont do it." << endl;
+		return;
+	}
+
+	if (instanceCount == 0)
+	{
+		return;
+	}
+
+	auto view = camera->GetView();
+	unsigned int object = _queue->AddInstancedObject(mesh, worlds, instanceCount, view, camera->GetProjection(), camera->GetEyePosition(), lod);
+
+	auto boundsCenter = mesh->GetBoundsCenter();
+	auto center = XMLoadFloat3(&boundsCenter);
+	float depth = FLT_MAX;
+	for (unsigned int i = 0; i < instanceCount; i++)
+	{
+		auto viewCenter = XMVector3TransformCoord(XMVector3TransformCoord(center, XMLoadFloat4x4(&worlds[i])), view);
+		depth = std::min(depth, XMVectorGetZ(viewCenter));
+	}
+
+	QueueParts(mesh, materials, object, depth);
+}
+
+void TinyEngine::Renderer::QueueParts(Mesh* mesh, const std::vector<Material*>& materials, unsigned int object, float depth)
+{
+	auto* defaultShader = mesh->GetVertexFormat() == VertexFormat::PACKED ? _defaultPackedShader : _defaultShader;
+
+	auto* material = materials[0];
+	for (int i = 0; i < mesh->GetNumMeshParts(); i++)
+	{
+		if (i < materials.size())
+		{
+			material = materials[i];
+		}
 
-	const unsigned int stride = sizeof(VertexStandard);
-	const unsigned int offset = 0;
+		auto shader = material->shader;
+		if (!shader)
+		{
+			shader = defaultShader;
+		}
 
-	auto vertexBuffer = mesh->GetVertexBuffer();
+		// The default shaders are missing if their bytecode couldn't be found.
+		if (!shader)
+		{
+			continue;
+		}
 
-	context->IASetVertexBuffers(0, 1, vertexBuffer.GetAddressOf(), &stride, &offset);
-	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		auto pass = material->transparency > 0.0f ? RenderPass::TRANSPARENT_PASS : RenderPass::OPAQUE_PASS;
+		_queue->AddDraw(object, i, material, shader, pass, depth);
+	}
+}
 
-	context->PSSetSamplers(0, 1, _defaultSamplerState.GetAddressOf());
+void TinyEngine::Renderer::Submit()
+{
+	// Nothing to draw, which keeps the stats of the last submit that drew something.
+	if (_queue->GetDrawCount() == 0)
+	{
+		_queue->Clear();
+		return;
+	}
 
-	// TODO: CBuffers
-	PerObjectCBData objCb;
+	// Anything may have been bound since the last submit.
+	_state->Invalidate();
+	_state->ResetStats();
+	_cullBlock = ~0u;
 
-	memcpy(objCb.lights, lights, sizeof(lights));
+	// Every part's indices are in the arena's index buffer, so it is bound once.
+	_state->SetIndexBuffer(_geometryArena->GetIndexBuffer().Get());
+	_state->SetTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	_state->SetPSSamplers(0, 1, _defaultSamplerState.GetAddressOf());
 
-	objCb.ambientLight = ambientLight;
-	objCb.world = XMMatrixTranspose(world);
+	_queue->Submit(*this, batchInstances);
+}
 
-	auto det = XMMatrixDeterminant(world);
-	objCb.worldInverseTranspose = XMMatrixInverse(&det, world);
+bool TinyEngine::Renderer::CullsMeshlets(const RenderObject& object, const RenderDraw& draw) const
+{
+	const auto& part = object.mesh->GetMeshPart(draw.part);
+	return cullMeshlets && !part.meshlets.empty() && (object.lod == 0 || part.lods.size() <= 1);
+}
 
-	objCb.view = XMMatrixTranspose(camera->GetView());
-	objCb.projection = XMMatrixTranspose(camera->GetProjection());
-	objCb.eyePosW = camera->GetEyePosition();
+TinyEngine::Shader* TinyEngine::Renderer::GetInstancedShader(const RenderObject& object, const RenderDraw& draw, unsigned int instanceCount) const
+{
+	// Meshlets are culled against each instance, so their parts are drawn an instance at a time.
+	if (instanceCount <= 1 || CullsMeshlets(object, draw))
+	{
+		return nullptr;
+	}
 
-	_perObjectCB->Upload(objCb);
+	if (draw.shader == _defaultShader)
+	{
+		return _defaultInstancedShader;
+	}
 
+	if (draw.shader == _defaultPackedShader)
 	{
-		auto buffer = _perObjectCB->GetBuffer();
-		context->VSSetConstantBuffers(0, 1, buffer.GetAddressOf());
-		context->PSSetConstantBuffers(0, 1, buffer.GetAddressOf());
+		return _defaultPackedInstancedShader;
 	}
 
-	auto* material = materials[0];
-	if (mesh->GetNumMeshParts() > 0)
+	return draw.material->instancedShader;
+}
+
+void TinyEngine::Renderer::UpdateMaterialConstants(Material* material)
+{
+	PerMaterialCBData matCb;
+	matCb.mat.diffuse = material->diffuse;
+	matCb.mat.ambient = material->ambient;
+	matCb.mat.specular = material->specular;
+	matCb.mat.specularExponent = material->specularExponent;
+	matCb.mat.transparency = material->transparency;
+
+	// Materials rarely change, so they are kept in default memory and updated in place when they do.
+	if (material->_constants)
+	{
+		_immediateContext->UpdateSubresource(material->_constants.Get(), 0, nullptr, &matCb, 0, 0);
+	}
+	else
+	{
+		D3D11_BUFFER_DESC desc = {};
+		desc.ByteWidth = sizeof(PerMaterialCBData);
+		desc.Usage = D3D11_USAGE_DEFAULT;
+		desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+		D3D11_SUBRESOURCE_DATA initialData = {};
+		initialData.pSysMem = &matCb;
+
+		HRESULT hr = _device->CreateBuffer(&desc, &initialData, &material->_constants);
+		CHECK_HR(hr, "Failed to create material constants.");
+	}
+
+	_state->CountUpload();
+	material->dirty = false;
+}
+
+bool TinyEngine::Renderer::CreateConstantRing(unsigned int size)
+{
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = size;
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	ComPtr<ID3D11Buffer> buffer;
+	HRESULT hr = _device->CreateBuffer(&desc, nullptr, &buffer);
+	CHECK_HR(hr, "Failed to create constant ring.");
+
+	if (FAILED(hr))
+	{
+		return false;
+	}
+
+	_constantRing = buffer;
+	_constantAllocator = RingAllocator(size, FRAMES_IN_FLIGHT);
+	// Nothing was written yet, so the first map discards.
+	_constantRingHead = ~0u;
+
+	return true;
+}
+
+void TinyEngine::Renderer::Prepare(const RenderBatch* batches, size_t batchCount, const XMFLOAT4X4* worlds)
+{
+	const unsigned int NO_BLOCK = ~0u;
+	const unsigned int COUNTED = NO_BLOCK - 1;
+	const unsigned int BLOCK_SIZE = StateCache::CONSTANT_BLOCK_SIZE;
+
+	static_assert(sizeof(PerFrameCBData) <= StateCache::CONSTANT_BLOCK_SIZE, "Per frame constants must fit a block");
+	static_assert(sizeof(PerViewCBData) <= StateCache::CONSTANT_BLOCK_SIZE, "Per view constants must fit a block");
+	static_assert(sizeof(PerObjectCBData) <= StateCache::CONSTANT_BLOCK_SIZE, "Per object constants must fit a block");
+
+	auto sameView = [](const RenderObject& a, const RenderObject& b)
+	{
+		return memcmp(&a.view, &b.view, sizeof(a.view)) == 0 && memcmp(&a.projection, &b.projection, sizeof(a.projection)) == 0
+			&& memcmp(&a.eyePosition, &b.eyePosition, sizeof(a.eyePosition)) == 0;
+	};
+
+	// Objects with one instance share a block between their parts.
+	auto isSingle = [](const RenderBatch& batch)
+	{
+		return batch.instanceCount == 1 && batch.object->instanceCount == 1;
+	};
+
+	_prepared = false;
+	_preparedWorlds = worlds;
+	_drawConstants.resize(batchCount > 0 ? batches[batchCount - 1].instanceStart + batches[batchCount - 1].instanceCount : 0);
+	_objectConstants.assign(_queue->GetObjectCount(), NO_BLOCK);
+
+	// Count the blocks first, so they can be allocated at once. The frame has one, then each change of camera
+	// and each object.
+	unsigned int blockCount = 1;
+	for (size_t i = 0; i < batchCount; i++)
 	{
-		for (int i = 0; i < mesh->GetNumMeshParts(); i++)
+		const auto& batch = batches[i];
+		if (i == 0 || !sameView(*batches[i - 1].object, *batch.object))
+		{
+			blockCount++;
+		}
+
+		if (GetInstancedShader(*batch.object, *batch.draw, batch.instanceCount))
+		{
+			blockCount++;
+		}
+		else if (isSingle(batch))
 		{
-			auto part = mesh->GetMeshPart(i);
-			if (i < materials.size())
+			auto& block = _objectConstants[batch.draw->object];
+			if (block == NO_BLOCK)
 			{
-				material = materials[i];
+				block = COUNTED;
+				blockCount++;
 			}
+		}
+		else
+		{
+			blockCount += batch.instanceCount;
+		}
+	}
+
+	unsigned int size = blockCount * BLOCK_SIZE;
+	unsigned int offset = _constantAllocator.Allocate(size, BLOCK_SIZE);
+	if (offset == RingAllocator::INVALID_OFFSET)
+	{
+		// Room for a few frames this size.
+		unsigned int capacity = _constantAllocator.GetCapacity();
+		while (capacity < size * (FRAMES_IN_FLIGHT + 1))
+		{
+			capacity *= 2;
+		}
+
+		if (!CreateConstantRing(capacity))
+		{
+			return;
+		}
+
+		offset = _constantAllocator.Allocate(size, BLOCK_SIZE);
+	}
+
+	auto context = _immediateContext;
 
-			auto shader = material->shader;
-			if (!shader)
+	auto mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+	if (!_constantRingNoOverwrite || offset < _constantRingHead || _constantRingHead == ~0u)
+	{
+		mapType = D3D11_MAP_WRITE_DISCARD;
+	}
+
+	_constantRingHead = offset + size;
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	HRESULT hr = context->Map(_constantRing.Get(), 0, mapType, 0, &mapped);
+	if (FAILED(hr))
+	{
+		CHECK_HR(hr, "Failed to map constant ring.");
+		return;
+	}
+
+	auto* data = static_cast<uint8_t*>(mapped.pData);
+	unsigned int next = offset;
+
+	// Write a block, returning its first constant to bind it with.
+	auto write = [&](const void* constants, size_t constantsSize)
+	{
+		memcpy(data + next, constants, constantsSize);
+		unsigned int firstConstant = next / 16;
+		next += BLOCK_SIZE;
+
+		return firstConstant;
+	};
+
+	auto writeObject = [&](const RenderObject& object, FXMMATRIX world)
+	{
+		PerObjectCBData objCb;
+		objCb.world = XMMatrixTranspose(world);
+
+		auto det = XMMatrixDeterminant(world);
+		objCb.worldInverseTranspose = XMMatrixInverse(&det, world);
+
+		const auto& quantization = object.mesh->GetQuantization();
+		objCb.positionScale = XMFLOAT4(quantization.scale.x, quantization.scale.y, quantization.scale.z, 0.0f);
+		objCb.positionOffset = XMFLOAT4(quantization.offset.x, quantization.offset.y, quantization.offset.z, 0.0f);
+
+		return write(&objCb, sizeof(objCb));
+	};
+
+	PerFrameCBData frameCb;
+	memcpy(frameCb.lights, lights, sizeof(lights));
+	frameCb.ambientLight = ambientLight;
+
+	unsigned int frameConstants = write(&frameCb, sizeof(frameCb));
+
+	unsigned int viewConstants = 0;
+	for (size_t i = 0; i < batchCount; i++)
+	{
+		const auto& batch = batches[i];
+		const auto& object = *batch.object;
+		auto* constants = &_drawConstants[batch.instanceStart];
+
+		if (i == 0 || !sameView(*batches[i - 1].object, object))
+		{
+			PerViewCBData viewCb;
+			viewCb.view = XMMatrixTranspose(XMLoadFloat4x4(&object.view));
+			viewCb.projection = XMMatrixTranspose(XMLoadFloat4x4(&object.projection));
+			viewCb.eyePosW = object.eyePosition;
+
+			viewConstants = write(&viewCb, sizeof(viewCb));
+		}
+
+		if (GetInstancedShader(object, *batch.draw, batch.instanceCount))
+		{
+			// The instanced shaders take world matrices from the instance buffer, the rest of the block is shared.
+			constants[0] = { writeObject(object, XMMatrixIdentity()), viewConstants };
+		}
+		else if (isSingle(batch))
+		{
+			auto& block = _objectConstants[batch.draw->object];
+			if (block == COUNTED)
 			{
-				shader = _defaultShader;
+				block = writeObject(object, XMLoadFloat4x4(&worlds[batch.instanceStart]));
 			}
 
-			context->IASetInputLayout(shader->GetInputLayout().Get());
-			context->VSSetShader(shader->GetVertexShader().Get(), nullptr, 0);
-			context->PSSetShader(shader->GetPixelShader().Get(), nullptr, 0);
+			constants[0] = { block, viewConstants };
+		}
+		else
+		{
+			for (unsigned int j = 0; j < batch.instanceCount; j++)
+			{
+				constants[j] = { writeObject(object, XMLoadFloat4x4(&worlds[batch.instanceStart + j])), viewConstants };
+			}
+		}
+	}
+
+	context->Unmap(_constantRing.Get(), 0);
+
+	_state->SetConstantBuffer(2, _constantRing.Get(), frameConstants);
+	_prepared = true;
+}
 
-			PerMaterialCBData matCb;
-			matCb.mat.diffuse = material->diffuse;
-			matCb.mat.ambient = material->ambient;
-			matCb.mat.specular = material->specular;
-			matCb.mat.specularExponent = material->specularExponent;
-			matCb.mat.transparency = material->transparency;
+void TinyEngine::Renderer::Draw(const RenderObject& object, const RenderDraw& draw, const XMFLOAT4X4* worlds, unsigned int instanceCount)
+{
+	// Nothing is drawn without its constants.
+	if (!_prepared)
+	{
+		return;
+	}
 
-			_perMaterialCB->Upload(matCb);
+	auto* mesh = object.mesh;
+	auto* material = draw.material;
 
-			// set textures from material
-			ID3D11ShaderResourceView* textureViews[3] = {
-				material->ambientTexture->GetTextureView().Get(),
-				material->diffuseTexture->GetTextureView().Get(),
-				material->specularTexture->GetTextureView().Get()
-			};
+	_state->SetVertexBuffer(0, mesh->GetVertexBuffer().Get(), mesh->GetVertexStride(), 0);
 
-			context->PSSetShaderResources(0, 3, textureViews);
+	const auto* constants = &_drawConstants[worlds - _preparedWorlds];
+	_state->SetConstantBuffer(3, _constantRing.Get(), constants[0].view);
 
+	if (material->dirty || !material->_constants)
+	{
+		UpdateMaterialConstants(material);
+	}
+
+	// Each material has its own constants, so binding it is all that is needed.
+	_state->SetConstantBuffer(1, material->_constants.Get());
+
+	// set textures from material
+	ID3D11ShaderResourceView* textureViews[3] = {
+		material->ambientTexture->GetTextureView().Get(),
+		material->diffuseTexture->GetTextureView().Get(),
+		material->specularTexture->GetTextureView().Get()
+	};
+
+	_state->SetPSShaderResources(0, 3, textureViews);
+
+	auto context = _immediateContext;
+
+	const auto& part = mesh->GetMeshPart(draw.part);
+	const unsigned int indexOffset = mesh->GetIndexOffset(draw.part);
+	const unsigned int baseVertex = mesh->GetVertexOffset() + part.baseVertex;
+	const unsigned int lod = object.lod;
+
+	unsigned int indexStart = 0;
+	unsigned int indexCount = part.size;
+	if (!part.lods.empty())
+	{
+		const auto& range = part.lods[std::min<size_t>(lod, part.lods.size() - 1)];
+		indexStart = range.start;
+		indexCount = range.size;
+	}
+
+	auto* instancedShader = GetInstancedShader(object, draw, instanceCount);
+	if (instancedShader)
+	{
+		_state->SetConstantBuffer(0, _constantRing.Get(), constants[0].object);
+
+		_state->SetInputLayout(instancedShader->GetInputLayout().Get());
+		_state->SetVertexShader(instancedShader->GetVertexShader().Get());
+		_state->SetPixelShader(instancedShader->GetPixelShader().Get());
+
+		for (unsigned int first = 0; first < instanceCount;)
+		{
+			unsigned int count = std::min(instanceCount - first, INSTANCE_BUFFER_CAPACITY);
+
+			// Append after what earlier draws may still be reading, or start again once it is full.
+			auto mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+			if (_instanceBufferUsed + count > INSTANCE_BUFFER_CAPACITY)
 			{
-				auto buffer = _perMaterialCB->GetBuffer();
-				context->PSSetConstantBuffers(1, 1, buffer.GetAddressOf());
-				context->VSSetConstantBuffers(1, 1, buffer.GetAddressOf());
+				mapType = D3D11_MAP_WRITE_DISCARD;
+				_instanceBufferUsed = 0;
 			}
 
-			context->IASetIndexBuffer(part.indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
+			D3D11_MAPPED_SUBRESOURCE mapped;
+			HRESULT hr = context->Map(_instanceBuffer.Get(), 0, mapType, 0, &mapped);
+			if (FAILED(hr))
+			{
+				CHECK_HR(hr, "Failed to map instance buffer.");
+				return;
+			}
 
-			context->DrawIndexed(part.size, 0, part.baseVertex);
+			auto* instances = static_cast<InstanceData*>(mapped.pData) + _instanceBufferUsed;
+			for (unsigned int i = 0; i < count; i++)
+			{
+				auto world = XMLoadFloat4x4(&worlds[first + i]);
+				auto det = XMMatrixDeterminant(world);
+
+				instances[i].world = worlds[first + i];
+				XMStoreFloat4x4(&instances[i].worldInverseTranspose, XMMatrixTranspose(XMMatrixInverse(&det, world)));
+			}
+
+			context->Unmap(_instanceBuffer.Get(), 0);
+
+			_state->SetVertexBuffer(1, _instanceBuffer.Get(), sizeof(InstanceData), 0);
+			context->DrawIndexedInstanced(indexCount, count, indexOffset + indexStart, baseVertex, _instanceBufferUsed);
+			_state->CountDraw(count);
+
+			_instanceBufferUsed += count;
+			first += count;
 		}
+
+		return;
 	}
-	else
+
+	auto* shader = draw.shader;
+	_state->SetInputLayout(shader->GetInputLayout().Get());
+	_state->SetVertexShader(shader->GetVertexShader().Get());
+	_state->SetPixelShader(shader->GetPixelShader().Get());
+
+	bool cullingMeshlets = CullsMeshlets(object, draw);
+	for (unsigned int i = 0; i < instanceCount; i++)
 	{
-		cout << __FILE__ << ":" << __LINE__ << "Drawing just a vertex buffer is not currently supported, Dont do it." << endl;
-		context->Draw(mesh->GetNumVertices(), 0);
+		// Parts of an object with one instance share its block, so the bind is dropped when they are drawn in a row.
+		_state->SetConstantBuffer(0, _constantRing.Get(), constants[i].object);
+
+		if (cullingMeshlets)
+		{
+			// Only built if a part has meshlets to cull, and once for the parts of an object.
+			if (_cullBlock != constants[i].object)
+			{
+				_cullView = MakeMeshletCullView(XMLoadFloat4x4(&worlds[i]), XMLoadFloat4x4(&object.view), XMLoadFloat4x4(&object.projection), object.eyePosition);
+				_cullBlock = constants[i].object;
+			}
+
+			MeshletCullStats stats;
+			CullMeshlets(_cullView, part.meshlets.data(), static_cast<unsigned int>(part.meshlets.size()), _visibleMeshlets, &stats);
+			_meshletStats.Add(stats);
+
+			for (const auto& range : _visibleMeshlets)
+			{
+				context->DrawIndexed(range.indexCount, indexOffset + range.indexStart, baseVertex);
+				_state->CountDraw();
+			}
+		}
+		else
+		{
+			context->DrawIndexed(indexCount, indexOffset + indexStart, baseVertex);
+			_state->CountDraw();
+		}
 	}
 }
 
@@ -304,6 +888,12 @@ void TinyEngine::Renderer::OnNotify(const Event& event)
 
 void TinyEngine::Renderer::BindCurrentBackBufferView()
 {
+	// Without a swap chain the offscreen target is drawn to every frame.
+	if (!_swapChain)
+	{
+		return;
+	}
+
 	ID3D11Texture2D* backBuffer = nullptr;
 
 	HRESULT hr;
@@ -338,11 +928,18 @@ void TinyEngine::Renderer::UpdateViewport(int x, int y, int width, int height)
 
 void TinyEngine::Renderer::OnResize(int width, int height)
 {
-	DXGI_SWAP_CHAIN_DESC scd = {};
-	_swapChain->GetDesc(&scd);
-	_swapChain->ResizeBuffers(2, width, height, scd.BufferDesc.Format, NULL);
+	if (_swapChain)
+	{
+		DXGI_SWAP_CHAIN_DESC scd = {};
+		_swapChain->GetDesc(&scd);
+		_swapChain->ResizeBuffers(2, width, height, scd.BufferDesc.Format, NULL);
 
-	BindCurrentBackBufferView();
+		BindCurrentBackBufferView();
+	}
+	else
+	{
+		CreateOffscreenTarget(width, height);
+	}
 
 	D3D11_TEXTURE2D_DESC dstd = {};
 	dstd.Width = width;
@@ -370,3 +967,56 @@ void TinyEngine::Renderer::OnResize(int width, int height)
 
 	UpdateViewport(0, 0, width, height);
 }
+
+void TinyEngine::Renderer::CreateOffscreenTarget(int width, int height)
+{
+	D3D11_TEXTURE2D_DESC td = {};
+	td.Width = width;
+	td.Height = height;
+	td.MipLevels = 1;
+	td.ArraySize = 1;
+	td.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	td.SampleDesc.Count = 1;
+	td.SampleDesc.Quality = 0;
+	td.BindFlags = D3D11_BIND_RENDER_TARGET;
+
+	ComPtr<ID3D11Texture2D> target;
+
+	HRESULT hr;
+	hr = _device->CreateTexture2D(&td, nullptr, &target);
+	CHECK_HR(hr, "Failed to create offscreen target.");
+
+	if (!target)
+	{
+		cout << __FILE__ << "(" << __LINE__ << ") " << "Offscreen target was nullptr" << endl;
+		return;
+	}
+
+	hr = _device->CreateRenderTargetView(target.Get(), NULL, &_backBufferView);
+	CHECK_HR(hr, "Failed to create render target view to offscreen target.");
+}
+
+void TinyEngine::Renderer::WaitForFrame()
+{
+	auto* query = _frameQueries[_frameIndex % FRAMES_IN_FLIGHT].Get();
+
+	if (!query)
+	{
+		_immediateContext->Flush();
+		return;
+	}
+
+	// The query was last ended FRAMES_IN_FLIGHT frames ago, once the GPU has passed it that frame is finished.
+	if (_frameIndex >= FRAMES_IN_FLIGHT)
+	{
+		while (_immediateContext->GetData(query, nullptr, 0, 0) == S_FALSE)
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	_immediateContext->End(query);
+	_immediateContext->Flush();
+
+	_frameIndex++;
+}
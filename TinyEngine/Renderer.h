@@ -2,36 +2,47 @@
 #include <d3d11.h>
 #include <dxgi.h>
 #include "Subject.h"
+#include "DirectionLight.h"
 #include "Window.h"
 #include "Mesh.h"
 #include "Shader.h"
+#include "ShaderLibrary.h"
 #include "IRenderer.h"
 #include "ConstantBuffer.h"
+#include "GeometryArena.h"
+#include "RenderQueue.h"
+#include "RingAllocator.h"
+#include "StateCache.h"
 #include "ICamera.h"
 #include <wrl\client.h>
 
 namespace TinyEngine
 {
-	// Represents a light source at infinity. Behaves like the sun.
-	struct DirectionLight
+	// Internal, constants which change once a frame.
+	struct PerFrameCBData
 	{
-		DirectX::XMFLOAT4 color;
-		DirectX::XMFLOAT3 direction;
-		float _pad;
+		DirectionLight lights[3];
+		DirectX::XMFLOAT4 ambientLight;
+	};
+
+	// Internal, constants of the camera an object is drawn with.
+	struct PerViewCBData
+	{
+		DirectX::XMMATRIX view;
+		DirectX::XMMATRIX projection;
+		DirectX::XMFLOAT3 eyePosW;
+		float _pad = 0.0f;
 	};
 
 	// Internal
 	struct PerObjectCBData
 	{
 	public:
-		DirectionLight lights[3];
-		DirectX::XMFLOAT4 ambientLight;
 		DirectX::XMMATRIX world;
 		DirectX::XMMATRIX worldInverseTranspose;
-		DirectX::XMMATRIX view;
-		DirectX::XMMATRIX projection;
-		DirectX::XMFLOAT3 eyePosW;
-		float _pad = 0.0f;
+		// Decodes VertexPacked positions: offset + unorm * scale.
+		DirectX::XMFLOAT4 positionScale;
+		DirectX::XMFLOAT4 positionOffset;
 	};
 
 	// Internal
@@ -48,9 +59,17 @@ namespace TinyEngine
 		float _pad = 0.0f;
 	};
 
+	// Internal, one element of the instance buffer. Both matrices are stored as the shader reads them,
+	// a row per WORLD/WORLDINVERSETRANSPOSE element.
+	struct InstanceData
+	{
+		DirectX::XMFLOAT4X4 world;
+		DirectX::XMFLOAT4X4 worldInverseTranspose;
+	};
+
 	// 3D Renderer. Draws things on the screen.
 	class Renderer : 
-		public IObserver, public IRenderer
+		public IObserver, public IRenderer, private RenderBackend
 	{
 	public:
 		// Lights which will be used when drawing the scene.
@@ -59,6 +78,12 @@ namespace TinyEngine
 		// Ambient light color.
 		DirectX::XMFLOAT4 ambientLight;
 
+		// Draw only the visible meshlets of parts which have them.
+		bool cullMeshlets = true;
+
+		// Draw meshes which share a mesh, material and camera with one instanced draw, see RenderQueue.
+		bool batchInstances = true;
+
 	private:
 		Microsoft::WRL::ComPtr<ID3D11Device> _device;
 		Microsoft::WRL::ComPtr<ID3D11DeviceContext> _immediateContext;
@@ -68,19 +93,93 @@ namespace TinyEngine
 		Microsoft::WRL::ComPtr<ID3D11RenderTargetView> _backBufferView;
 		Microsoft::WRL::ComPtr<ID3D11DepthStencilView> _depthStencilView;
 
+		// Without a swap chain, nothing limits how far the CPU gets ahead of the GPU. SwapBuffers ends one of
+		// these each frame and waits for the one ended FRAMES_IN_FLIGHT frames before, as Present would.
+		std::vector<Microsoft::WRL::ComPtr<ID3D11Query>> _frameQueries;
+		unsigned int _frameIndex;
+
 		Microsoft::WRL::ComPtr<ID3D11RasterizerState> _defaultRasterizerState;
 
 		Microsoft::WRL::ComPtr<ID3D11SamplerState> _defaultSamplerState;
 
+		// Owns every shader, including the defaults.
+		ShaderLibrary* _shaders;
+
 		Shader* _defaultShader;
+		// Default shader for meshes with VertexPacked vertices.
+		Shader* _defaultPackedShader;
+		// Instanced variants of the default shaders.
+		Shader* _defaultInstancedShader;
+		Shader* _defaultPackedInstancedShader;
+
+		// Per frame, per view and per object constants, a 256 byte block each. Every block a submit needs is
+		// allocated and written with one Map, then bound by offset.
+		Microsoft::WRL::ComPtr<ID3D11Buffer> _constantRing;
+		RingAllocator _constantAllocator;
+		// End of the last frame's blocks, a frame starting before it has wrapped around and discards the buffer.
+		unsigned int _constantRingHead;
+		// Whether the ring can be mapped without discarding it, which 11.1 drivers may not support.
+		bool _constantRingNoOverwrite;
+
+		// Blocks of each instance of the batches being submitted, see Prepare.
+		struct DrawConstants
+		{
+			unsigned int object;
+			unsigned int view;
+		};
 
-		ConstantBuffer<PerObjectCBData>* _perObjectCB;
-		ConstantBuffer<PerMaterialCBData>* _perMaterialCB;
+		std::vector<DrawConstants> _drawConstants;
+		// Block of each object with one instance, so its parts share it.
+		std::vector<unsigned int> _objectConstants;
+		const DirectX::XMFLOAT4X4* _preparedWorlds;
+		bool _prepared;
+
+		// Per instance vertex buffer, written front to back and discarded once full.
+		Microsoft::WRL::ComPtr<ID3D11Buffer> _instanceBuffer;
+		unsigned int _instanceBufferUsed;
+
+		// Holds the vertices and indices of every Mesh.
+		GeometryArena* _geometryArena;
 
 		DirectX::XMFLOAT4 _clearColor;
 
+		std::vector<MeshletRange> _visibleMeshlets;
+		MeshletCullStats _meshletStats;
+
+		// Draws since the last Submit.
+		RenderQueue* _queue;
+		// Drops binds which wouldn't change anything while submitting.
+		StateCache* _state;
+		// Object constant block the meshlet culling view was made for, while submitting.
+		unsigned int _cullBlock;
+		MeshletCullView _cullView;
+
 	public:
+		// Bundle of every compiled shader, written by TinyEngineCooker. Shaders it doesn't have are read from
+		// their .cso files in SHADER_DIRECTORY.
+		static constexpr const char* SHADER_BUNDLE_PATH = "./assets/shader/shaders.tsb";
+		static constexpr const char* SHADER_DIRECTORY = "./assets/shader";
+
+		// Instances the instance buffer holds. Larger batches are split into several draws.
+		static const unsigned int INSTANCE_BUFFER_CAPACITY = 4096;
+
+		// Initial size of the constant ring, which grows when a frame needs more. Frames are assumed to be read
+		// by the GPU within FRAMES_IN_FLIGHT frames, DXGI's default maximum frame latency.
+		static const unsigned int CONSTANT_RING_SIZE = 1 << 20;
+		static const unsigned int FRAMES_IN_FLIGHT = 3;
+
+		// Construct a Renderer which draws to a window's swap chain.
+		//	int width: Width of the back buffer
+		//	int height: Height of the back buffer
+		//	Window& window: Window to present to
 		Renderer(int width, int height, Window& window);
+
+		// Construct a Renderer with no window, which draws to a texture and never presents, for running headless.
+		// Falls back to the WARP software device when there is no hardware device.
+		//	int width: Width of the texture
+		//	int height: Height of the texture
+		Renderer(int width, int height);
+
 		virtual ~Renderer();
 
 		Renderer(const Renderer&) = delete;
@@ -91,17 +190,48 @@ namespace TinyEngine
 		// Clear the screen.
 		void Clear();
 
-		// Swap the back and front buffer.
+		// Swap the back and front buffer, submitting anything still queued first. Without a window it only
+		// waits for the GPU to be within FRAMES_IN_FLIGHT frames.
 		void SwapBuffers();
 
-		// Draw a mesh.
+		// Draw everything queued since the last submit, sorted by the queue.
+		void Submit();
+
+		// How much of the shared geometry buffers is in use.
+		GeometryArenaStats GetGeometryStats() const;
+
+		// Get the shaders, to create materials' shaders with.
+		ShaderLibrary* GetShaders() const;
+
+		// What meshlet culling rejected since the last Clear.
+		const MeshletCullStats& GetMeshletStats() const;
+
+		// Binds issued and dropped as redundant by the last Submit which drew anything, usually the whole of the last frame.
+		const StateCacheStats& GetStateStats() const;
+
+		// Draw a mesh. Its parts are queued and drawn by the next Submit, ordered by pass, shader,
+		// material, mesh and depth. Parts whose material has any transparency are drawn after
+		// every opaque part, back to front.
 		//	Mesh* mesh: Mesh to draw
 		//	std::vector<Material*> materials: Materials to draw the mesh with.
 		//		Min 1. One material per parts in the mesh.
 		//		If there are too few it will re use the last material in the array.
 		//	ICamera* camera: Camera to draw the mesh with.
 		//	DirectX::XMMATRIX world: World matrix of the mesh.
-		void DrawMesh(Mesh* mesh, std::vector<Material*> materials, ICamera* camera, DirectX::XMMATRIX world);
+		//	unsigned int lod: Level of detail to draw, 0 is full detail. Clamped to the levels each part has.
+		void DrawMesh(Mesh* mesh, std::vector<Material*> materials, ICamera* camera, DirectX::XMMATRIX world, unsigned int lod = 0);
+
+		// Draw several instances of a mesh. Each part is drawn with one instanced draw, unless its material
+		// has a shader without an instancedShader or its meshlets are culled, which draw each instance in turn.
+		// Parts are sorted by the depth of the nearest instance.
+		//	Mesh* mesh: Mesh to draw
+		//	std::vector<Material*> materials: Materials to draw the mesh with, as for DrawMesh
+		//	ICamera* camera: Camera to draw the mesh with.
+		//	const DirectX::XMFLOAT4X4* worlds: World matrix of each instance.
+		//	unsigned int instanceCount: Number of instances.
+		//	unsigned int lod: Level of detail to draw, 0 is full detail. Clamped to the levels each part has.
+		void DrawMeshInstanced(Mesh* mesh, std::vector<Material*> materials, ICamera* camera, const DirectX::XMFLOAT4X4* worlds,
+			unsigned int instanceCount, unsigned int lod = 0);
 
 		// Inherited via IObserver
 		virtual void OnNotify(const Event& event) override;
@@ -116,12 +246,48 @@ namespace TinyEngine
 		{
 			return _immediateContext;
 		}
+
+		GeometryArena* GetGeometryArena() const
+		{
+			return _geometryArena;
+		}
 #endif
 
 	private:
+		// Create everything but the device, swap chain and back buffer view.
+		void Initialize(int width, int height);
+
 		void BindCurrentBackBufferView();
 		void UpdateViewport(int x, int y, int width, int height);
 
+		// Create the texture drawn to without a swap chain, and make it the back buffer view.
+		void CreateOffscreenTarget(int width, int height);
+
+		// End the frame without a swap chain, see _frameQueries.
+		void WaitForFrame();
+
 		void OnResize(int width, int height);
+
+		// Queue every part of a mesh added to the queue.
+		void QueueParts(Mesh* mesh, const std::vector<Material*>& materials, unsigned int object, float depth);
+
+		// Are a part's meshlets culled rather than drawing the whole part?
+		bool CullsMeshlets(const RenderObject& object, const RenderDraw& draw) const;
+
+		// Shader to draw several instances of a draw at once with, nullptr if they have to be drawn one at a time.
+		Shader* GetInstancedShader(const RenderObject& object, const RenderDraw& draw, unsigned int instanceCount) const;
+
+		// Create a material's constants the first time it is drawn, and upload them again whenever it is dirty.
+		void UpdateMaterialConstants(Material* material);
+
+		// Create the constant ring, replacing any current one.
+		//	returns: false if the buffer couldn't be created
+		bool CreateConstantRing(unsigned int size);
+
+		// Inherited via RenderBackend, writes the constant blocks of every batch.
+		virtual void Prepare(const RenderBatch* batches, size_t batchCount, const DirectX::XMFLOAT4X4* worlds) override;
+
+		// Inherited via RenderBackend, issues the D3D calls for a queued draw.
+		virtual void Draw(const RenderObject& object, const RenderDraw& draw, const DirectX::XMFLOAT4X4* worlds, unsigned int instanceCount) override;
 	};
 }
@@ -0,0 +1,108 @@
+#include "RingAllocator.h"
+
+using namespace TinyEngine;
+
+RingAllocator::RingAllocator(unsigned int capacity, unsigned int framesInFlight) : _capacity(capacity), _framesInFlight(framesInFlight)
+{
+	Reset();
+}
+
+unsigned int RingAllocator::Allocate(unsigned int size, unsigned int alignment)
+{
+	if (alignment == 0)
+	{
+		alignment = 1;
+	}
+
+	// Start from 0 whenever nothing is allocated, so the largest possible range fits. Frames still queued are
+	// all empty then, and end where the head now is, so the tail doesn't jump back to the old head when they retire.
+	if (_allocatedSize == 0)
+	{
+		_head = 0;
+		_tail = 0;
+
+		for (auto& frame : _frames)
+		{
+			frame.end = 0;
+		}
+	}
+
+	unsigned int offset = INVALID_OFFSET;
+	unsigned int skipped = 0;
+
+	unsigned int aligned = (_head + alignment - 1) / alignment * alignment;
+	if (_head >= _tail && _allocatedSize < _capacity)
+	{
+		// Free from the head to the end, and from 0 to the tail.
+		if (aligned >= _head && aligned <= _capacity && size <= _capacity - aligned)
+		{
+			offset = aligned;
+			skipped = aligned - _head;
+		}
+		else if (size <= _tail)
+		{
+			offset = 0;
+			skipped = _capacity - _head;
+		}
+	}
+	else if (_head < _tail && aligned <= _tail && size <= _tail - aligned)
+	{
+		// Free from the head to the tail.
+		offset = aligned;
+		skipped = aligned - _head;
+	}
+
+	if (offset == INVALID_OFFSET)
+	{
+		return INVALID_OFFSET;
+	}
+
+	_head = offset + size;
+	_allocatedSize += skipped + size;
+	_frameSize += skipped + size;
+
+	return offset;
+}
+
+void RingAllocator::EndFrame()
+{
+	_frames.push_back({ _head, _frameSize });
+	_frameSize = 0;
+
+	while (_frames.size() > _framesInFlight)
+	{
+		const auto& frame = _frames.front();
+		_tail = frame.end;
+		_allocatedSize -= frame.size;
+		_frames.pop_front();
+	}
+}
+
+void RingAllocator::Reset()
+{
+	_head = 0;
+	_tail = 0;
+	_allocatedSize = 0;
+	_frameSize = 0;
+	_frames.clear();
+}
+
+unsigned int RingAllocator::GetCapacity() const
+{
+	return _capacity;
+}
+
+unsigned int RingAllocator::GetFramesInFlight() const
+{
+	return _framesInFlight;
+}
+
+unsigned int RingAllocator::GetAllocatedSize() const
+{
+	return _allocatedSize;
+}
+
+unsigned int RingAllocator::GetFreeSize() const
+{
+	return _capacity - _allocatedSize;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <deque>
+
+namespace TinyEngine
+{
+	// Hands out ranges of a linear space front to back, wrapping around at the end, for data which is
+	// written once and only read until a few frames later, such as per draw constants.
+	// Ranges aren't freed one by one. Everything allocated during a frame is freed together once
+	// framesInFlight more frames have ended, by which time the GPU has finished reading it.
+	// Doesn't own any memory, so it can be used and tested without a device.
+	class RingAllocator
+	{
+	private:
+		// The space a frame took, freed once it is old enough.
+		struct Frame
+		{
+			unsigned int end;
+			unsigned int size;
+		};
+
+		unsigned int _capacity;
+		unsigned int _framesInFlight;
+
+		// Allocations are made at the head and freed from the tail.
+		unsigned int _head;
+		unsigned int _tail;
+		unsigned int _allocatedSize;
+		unsigned int _frameSize;
+
+		std::deque<Frame> _frames;
+
+	public:
+		static const unsigned int INVALID_OFFSET = ~0u;
+
+		// Construct a RingAllocator.
+		//	unsigned int capacity: Size of the space, which starts out free
+		//	unsigned int framesInFlight: Frames which may still be reading their ranges after they end
+		RingAllocator(unsigned int capacity = 0, unsigned int framesInFlight = 2);
+		~RingAllocator() = default;
+
+		// Allocate a range. Ranges never straddle the end of the space, if it doesn't fit before the end
+		// the rest of the space is skipped and the range starts again from 0.
+		//	unsigned int size: Size of the range. Empty ranges are allowed and take no space
+		//	unsigned int alignment: Multiple the offset is rounded up to, at least 1
+		//	returns: Offset of the range, INVALID_OFFSET if there isn't enough free space
+		unsigned int Allocate(unsigned int size, unsigned int alignment = 1);
+
+		// End the current frame, freeing the ranges of the frame framesInFlight frames before it.
+		void EndFrame();
+
+		// Free everything, including frames still in flight.
+		void Reset();
+
+		unsigned int GetCapacity() const;
+		unsigned int GetFramesInFlight() const;
+
+		// Size of every range which isn't free yet, including space skipped by wrapping and alignment.
+		unsigned int GetAllocatedSize() const;
+		unsigned int GetFreeSize() const;
+	};
+}
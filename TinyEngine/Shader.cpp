@@ -2,116 +2,69 @@
 #include "Renderer.h"
 
 #include "Shader.h"
+#include "MappedFile.h"
 
 #include <iostream>
-#include <fstream>
 
 using std::cout;
 using std::endl;
-using std::ifstream;
+using Microsoft::WRL::ComPtr;
 
 TinyEngine::Shader::Shader(Renderer* renderer, const char* vSBytecode, size_t vSSize, const char* pSBytecode, size_t pSSize, D3D11_INPUT_ELEMENT_DESC* inputDescs, unsigned int inputDescCount):
 	_renderer(renderer)
 {
-	auto device = _renderer->GetDevice();
-
-	// TODO: Helper methods to create from compiled source to remove this duplication
-	HRESULT hr;
-	hr = device->CreateVertexShader(vSBytecode, vSSize, nullptr, &_vertexShader);
-	if (FAILED(hr))
-	{
-		cout << "Failed to create Vertex Shader." << endl;
-		return;
-	}
-
-	hr = device->CreatePixelShader(pSBytecode, pSSize, nullptr, &_pixelShader);
-	if (FAILED(hr))
-	{
-		cout << "Failed to create Pixel Shader." << endl;
-		return;
-	}
-
-	hr = device->CreateInputLayout(inputDescs, inputDescCount, vSBytecode, vSSize, &_inputLayout);
-	if (FAILED(hr))
-	{
-		cout << "Failed to create Input Layout." << endl;
-		return;
-	}
+	Create(vSBytecode, vSSize, pSBytecode, pSSize, inputDescs, inputDescCount);
 }
 
 TinyEngine::Shader::Shader(Renderer* renderer, const char* vertexPath, const char* pixelPath, D3D11_INPUT_ELEMENT_DESC* inputDescs, unsigned int inputDescCount) :
 	_renderer(renderer)
 {
-	auto device = _renderer->GetDevice();
-
-	size_t vsLength = 0, psLength = 0;
-	char* vsBytes = nullptr;
-	char* psBytes = nullptr;
-
-	const auto openFlags = std::ios::in | std::ios::binary | std::ios::ate;
-
-	ifstream file(vertexPath, openFlags);
-
-	if (file.is_open())
-	{
-		auto size = file.tellg();
-
-		vsLength = static_cast<size_t>(size);
-		vsBytes = new char[vsLength];
-
-		file.seekg(0, std::ios::beg);
-		file.read(vsBytes, size);
-
-		file.close();
-	}
-	else
+	// The files are only mapped while the objects are created, and unmapped on every path out.
+	MappedFile vertexFile;
+	if (!vertexFile.Open(vertexPath))
 	{
 		cout << "Could not open Vertex Shader at: " << vertexPath << endl;
+		return;
 	}
 
-	file.open(pixelPath, openFlags);
-
-	if (file.is_open())
-	{
-		auto size = file.tellg();
-
-		psLength = static_cast<size_t>(size);
-		psBytes = new char[psLength];
-
-		file.seekg(0, std::ios::beg);
-		file.read(psBytes, size);
-
-		file.close();
-	}
-	else
+	MappedFile pixelFile;
+	if (!pixelFile.Open(pixelPath))
 	{
 		cout << "Could not open Pixel Shader at: " << pixelPath << endl;
+		return;
 	}
 
+	Create(vertexFile.GetData(), vertexFile.GetSize(), pixelFile.GetData(), pixelFile.GetSize(), inputDescs, inputDescCount);
+}
+
+TinyEngine::Shader::Shader(Renderer* renderer, ComPtr<ID3D11VertexShader> vertexShader, ComPtr<ID3D11PixelShader> pixelShader, ComPtr<ID3D11InputLayout> inputLayout) :
+	_renderer(renderer), _vertexShader(vertexShader), _pixelShader(pixelShader), _inputLayout(inputLayout)
+{
+}
+
+void TinyEngine::Shader::Create(const char* vSBytecode, size_t vSSize, const char* pSBytecode, size_t pSSize, D3D11_INPUT_ELEMENT_DESC* inputDescs, unsigned int inputDescCount)
+{
+	auto device = _renderer->GetDevice();
 
-	// TODO: Helper methods to create from compiled source to remove this duplication
 	HRESULT hr;
-	hr = device->CreateVertexShader(vsBytes, vsLength, nullptr, &_vertexShader);
+	hr = device->CreateVertexShader(vSBytecode, vSSize, nullptr, &_vertexShader);
 	if (FAILED(hr))
 	{
 		cout << "Failed to create Vertex Shader." << endl;
 		return;
 	}
 
-	hr = device->CreatePixelShader(psBytes, psLength, nullptr, &_pixelShader);
+	hr = device->CreatePixelShader(pSBytecode, pSSize, nullptr, &_pixelShader);
 	if (FAILED(hr))
 	{
 		cout << "Failed to create Pixel Shader." << endl;
 		return;
 	}
 
-	hr = device->CreateInputLayout(inputDescs, inputDescCount, vsBytes, vsLength, &_inputLayout);
+	hr = device->CreateInputLayout(inputDescs, inputDescCount, vSBytecode, vSSize, &_inputLayout);
 	if (FAILED(hr))
 	{
 		cout << "Failed to create Input Layout." << endl;
 		return;
 	}
-
-	delete[] vsBytes;
-	delete[] psBytes;
 }
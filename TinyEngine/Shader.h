@@ -19,7 +19,13 @@ namespace TinyEngine
 
 	public:
 		// Construct a shader from pre compiled bytecode.
-		// Too long, CBA. Not used at the moment anyway.
+		//	Renderer* renderer: Renderer to create internal objects with
+		//	const char* vSBytecode: Compiled vertex shader
+		//	size_t vSSize: Size of the vertex shader in bytes
+		//	const char* pSBytecode: Compiled pixel shader
+		//	size_t pSSize: Size of the pixel shader in bytes
+		//	D3D11_INPUT_ELEMENT_DESC* inputDescs: Array of input descriptions for the vertex shader
+		//	unsigned int inputDescCount: Number of elements in the inputDescs array
 		Shader(Renderer* renderer, const char* vSBytecode, size_t vSSize, const char* pSBytecode, size_t pSSize, D3D11_INPUT_ELEMENT_DESC* inputDescs, unsigned int inputDescCount);
 
 		// Construct a shader from a precompiled shader binary.
@@ -29,6 +35,11 @@ namespace TinyEngine
 		//	D3D11_INPUT_ELEMENT_DESC* inputDescs: Array of input descriptions for the vertex shader
 		//	unsigned int inputDescCount: Number of elements in the inputDescs array
 		Shader(Renderer* renderer, const char* vertexPath, const char* pixelPath, D3D11_INPUT_ELEMENT_DESC* inputDescs, unsigned int inputDescCount);
+
+		// Construct a shader from objects which have already been created, which it shares. See ShaderLibrary.
+		//	Renderer* renderer: Renderer which the objects belong to
+		Shader(Renderer* renderer, Microsoft::WRL::ComPtr<ID3D11VertexShader> vertexShader, Microsoft::WRL::ComPtr<ID3D11PixelShader> pixelShader,
+			Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout);
 		~Shader() = default;
 
 		Shader(const Shader&) = delete;
@@ -49,5 +60,9 @@ namespace TinyEngine
 			return _inputLayout;
 		}
 #endif
+
+	private:
+		// Create every object from the bytecode, stopping at the first which fails.
+		void Create(const char* vSBytecode, size_t vSSize, const char* pSBytecode, size_t pSSize, D3D11_INPUT_ELEMENT_DESC* inputDescs, unsigned int inputDescCount);
 	};
 }
@@ -0,0 +1,232 @@
+#include "ShaderBundle.h"
+#include "DerivedDataCache.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+using namespace TinyEngine;
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+namespace
+{
+	const uint64_t BLOB_ALIGNMENT = 16;
+
+	inline uint64_t AlignUp(uint64_t offset)
+	{
+		return (offset + BLOB_ALIGNMENT - 1) & ~(BLOB_ALIGNMENT - 1);
+	}
+
+	const ShaderBundleEntry* GetEntries(const ShaderBundleHeader* header)
+	{
+		return reinterpret_cast<const ShaderBundleEntry*>(header + 1);
+	}
+
+	const ShaderBundleBlob* GetBlobs(const ShaderBundleHeader* header)
+	{
+		return reinterpret_cast<const ShaderBundleBlob*>(GetEntries(header) + header->entryCount);
+	}
+}
+
+string TinyEngine::GetShaderName(const char* path)
+{
+	auto name = std::filesystem::path(path).stem().string();
+	std::transform(name.begin(), name.end(), name.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+
+	return name;
+}
+
+ShaderBundle::ShaderBundle() : _header(nullptr)
+{
+}
+
+bool ShaderBundle::Open(const char* path)
+{
+	_header = nullptr;
+
+	if (!_file.Open(path))
+	{
+		return false;
+	}
+
+	uint64_t fileSize = _file.GetSize();
+	const auto* header = reinterpret_cast<const ShaderBundleHeader*>(_file.GetData());
+
+	if (fileSize < sizeof(ShaderBundleHeader) || header->magic != ShaderBundleHeader::MAGIC || header->version != ShaderBundleHeader::VERSION)
+	{
+		cout << "Shader bundle is not a compatible .tsb: " << path << endl;
+		_file.Close();
+		return false;
+	}
+
+	uint64_t tableSize = sizeof(ShaderBundleHeader) + static_cast<uint64_t>(header->entryCount) * sizeof(ShaderBundleEntry)
+		+ static_cast<uint64_t>(header->blobCount) * sizeof(ShaderBundleBlob);
+	bool valid = tableSize <= fileSize;
+
+	for (uint32_t i = 0; valid && i < header->entryCount; i++)
+	{
+		const auto& entry = GetEntries(header)[i];
+		valid = entry.blob < header->blobCount && memchr(entry.name, 0, sizeof(entry.name)) != nullptr;
+	}
+
+	for (uint32_t i = 0; valid && i < header->blobCount; i++)
+	{
+		const auto& blob = GetBlobs(header)[i];
+		valid = blob.offset >= tableSize && blob.offset <= fileSize && blob.size <= fileSize - blob.offset;
+	}
+
+	if (!valid)
+	{
+		cout << "Shader bundle is corrupt: " << path << endl;
+		_file.Close();
+		return false;
+	}
+
+	_header = header;
+
+	return true;
+}
+
+bool ShaderBundle::IsOpen() const
+{
+	return _header != nullptr;
+}
+
+bool ShaderBundle::Find(const char* name, ShaderBytecode& bytecode) const
+{
+	if (!_header)
+	{
+		return false;
+	}
+
+	auto key = GetShaderName(name);
+
+	const auto* begin = GetEntries(_header);
+	const auto* end = begin + _header->entryCount;
+	const auto* entry = std::lower_bound(begin, end, key, [](const ShaderBundleEntry& e, const string& k) { return strcmp(e.name, k.c_str()) < 0; });
+	if (entry == end || key != entry->name)
+	{
+		return false;
+	}
+
+	const auto& blob = GetBlobs(_header)[entry->blob];
+	bytecode.data = _file.GetData() + blob.offset;
+	bytecode.size = static_cast<size_t>(blob.size);
+	bytecode.hash = blob.hash;
+
+	return true;
+}
+
+unsigned int ShaderBundle::GetBlobCount() const
+{
+	return _header ? _header->blobCount : 0;
+}
+
+unsigned int ShaderBundle::GetEntryCount() const
+{
+	return _header ? _header->entryCount : 0;
+}
+
+bool ShaderBundle::Write(const char* path, const vector<ShaderBundleSource>& shaders)
+{
+	vector<ShaderBundleEntry> entries;
+	vector<ShaderBundleBlob> blobs;
+	vector<const ShaderBundleSource*> blobSources;
+
+	// Blobs by the hash of their bytecode, compared in full in case of a collision.
+	std::unordered_multimap<uint64_t, uint32_t> blobsByHash;
+
+	for (const auto& shader : shaders)
+	{
+		auto name = GetShaderName(shader.name.c_str());
+		if (name.empty() || name.size() >= ShaderBundleEntry::MAX_NAME)
+		{
+			cout << "Shader name must be 1 to " << ShaderBundleEntry::MAX_NAME - 1 << " characters: " << shader.name << endl;
+			return false;
+		}
+
+		uint64_t hash = HashBytes(shader.bytecode.data(), shader.bytecode.size());
+
+		uint32_t blob = static_cast<uint32_t>(blobs.size());
+		auto range = blobsByHash.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it)
+		{
+			if (blobSources[it->second]->bytecode == shader.bytecode)
+			{
+				blob = it->second;
+				break;
+			}
+		}
+
+		if (blob == blobs.size())
+		{
+			blobs.push_back({ hash, 0, shader.bytecode.size(), 0 });
+			blobSources.push_back(&shader);
+			blobsByHash.emplace(hash, blob);
+		}
+
+		ShaderBundleEntry entry = {};
+		memcpy(entry.name, name.c_str(), name.size());
+		entry.blob = blob;
+		entries.push_back(entry);
+	}
+
+	// Sorted so Find can binary search.
+	std::sort(entries.begin(), entries.end(), [](const ShaderBundleEntry& a, const ShaderBundleEntry& b) { return strcmp(a.name, b.name) < 0; });
+	for (size_t i = 1; i < entries.size(); i++)
+	{
+		if (strcmp(entries[i - 1].name, entries[i].name) == 0)
+		{
+			cout << "Shader bundle has two shaders named " << entries[i].name << endl;
+			return false;
+		}
+	}
+
+	ShaderBundleHeader header = {};
+	header.magic = ShaderBundleHeader::MAGIC;
+	header.version = ShaderBundleHeader::VERSION;
+	header.entryCount = static_cast<uint32_t>(entries.size());
+	header.blobCount = static_cast<uint32_t>(blobs.size());
+
+	uint64_t offset = sizeof(header) + entries.size() * sizeof(ShaderBundleEntry) + blobs.size() * sizeof(ShaderBundleBlob);
+	for (auto& blob : blobs)
+	{
+		blob.offset = AlignUp(offset);
+		offset = blob.offset + blob.size;
+	}
+
+	std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		cout << "Could not open shader bundle for writing: " << path << endl;
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(ShaderBundleEntry)));
+	file.write(reinterpret_cast<const char*>(blobs.data()), static_cast<std::streamsize>(blobs.size() * sizeof(ShaderBundleBlob)));
+
+	uint64_t written = sizeof(header) + entries.size() * sizeof(ShaderBundleEntry) + blobs.size() * sizeof(ShaderBundleBlob);
+	for (size_t i = 0; i < blobs.size(); i++)
+	{
+		static const char padding[BLOB_ALIGNMENT] = {};
+		file.write(padding, static_cast<std::streamsize>(blobs[i].offset - written));
+		file.write(blobSources[i]->bytecode.data(), static_cast<std::streamsize>(blobs[i].size));
+		written = blobs[i].offset + blobs[i].size;
+	}
+
+	if (!file.good())
+	{
+		cout << "Failed to write shader bundle: " << path << endl;
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+namespace TinyEngine
+{
+	// Every compiled shader in one file (.tsb), written by TinyEngineCooker.
+	// Shaders are found by name, the .cso file name without its extension. Shaders with identical
+	// bytecode share one blob, which is stored on a 16 byte boundary so it can be used in place.
+	//
+	// Layout:
+	//	ShaderBundleHeader
+	//	ShaderBundleEntry[entryCount] - sorted by name
+	//	ShaderBundleBlob[blobCount]
+	//	char[] - the blobs' bytecode
+	struct ShaderBundleHeader
+	{
+		static const uint32_t MAGIC = 0x42485354; // "TSHB"
+		static const uint32_t VERSION = 1;
+
+		uint32_t magic;
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t blobCount;
+	};
+
+	struct ShaderBundleEntry
+	{
+		static const uint32_t MAX_NAME = 60;
+
+		// Lower case and null terminated.
+		char name[MAX_NAME];
+		uint32_t blob;
+	};
+
+	struct ShaderBundleBlob
+	{
+		// HashBytes of the bytecode.
+		uint64_t hash;
+		uint64_t offset;
+		uint64_t size;
+		uint64_t _pad;
+	};
+
+	// Compiled bytecode of a shader, either in a bundle or a loose .cso.
+	struct ShaderBytecode
+	{
+		const char* data = nullptr;
+		size_t size = 0;
+		// HashBytes of the bytecode, equal bytecode has an equal hash.
+		uint64_t hash = 0;
+	};
+
+	// A shader to write into a bundle.
+	struct ShaderBundleSource
+	{
+		std::string name;
+		std::vector<char> bytecode;
+	};
+
+	// A .tsb file mapped into memory.
+	class ShaderBundle
+	{
+	private:
+		MappedFile _file;
+		const ShaderBundleHeader* _header;
+
+	public:
+		ShaderBundle();
+		~ShaderBundle() = default;
+
+		ShaderBundle(const ShaderBundle&) = delete;
+
+		// Map and validate a .tsb file.
+		//	const char* path: Path to the file
+		//	returns: false if the file could not be opened or is not a valid .tsb
+		bool Open(const char* path);
+
+		bool IsOpen() const;
+
+		// Find a shader's bytecode, which stays valid while the bundle is open.
+		//	const char* name: Name of the shader, compared ignoring case
+		//	ShaderBytecode& bytecode: Set to the shader's bytecode if it is found
+		//	returns: false if the bundle has no shader with that name
+		bool Find(const char* name, ShaderBytecode& bytecode) const;
+
+		// Unique blobs in the bundle, fewer than its entries if any share bytecode.
+		unsigned int GetBlobCount() const;
+		unsigned int GetEntryCount() const;
+
+		// Write shaders to a .tsb file, storing identical bytecode once.
+		//	const char* path: Path to write to
+		//	const std::vector<ShaderBundleSource>& shaders: Shaders to write, names must be unique ignoring case
+		//	returns: false if a name is too long or repeated, or the file could not be written
+		static bool Write(const char* path, const std::vector<ShaderBundleSource>& shaders);
+	};
+
+	// Get the name a shader is found by, the file name of a .cso without its extension in lower case.
+	//	const char* path: Path or name of the shader
+	std::string GetShaderName(const char* path);
+}
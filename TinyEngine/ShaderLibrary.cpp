@@ -0,0 +1,165 @@
+#define TINY_ENGINE_EXPOSE_NATIVE
+#include "Renderer.h"
+
+#include "ShaderLibrary.h"
+#include "DerivedDataCache.h"
+
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+using namespace TinyEngine;
+
+using std::cout;
+using std::endl;
+using std::string;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	// Every field of every element, so equal keys create identical layouts. Semantics ignore case.
+	string GetInputLayoutKey(const D3D11_INPUT_ELEMENT_DESC* inputDescs, unsigned int inputDescCount)
+	{
+		string key;
+		for (unsigned int i = 0; i < inputDescCount; i++)
+		{
+			const auto& desc = inputDescs[i];
+			for (const char* c = desc.SemanticName; *c; c++)
+			{
+				key += static_cast<char>(std::toupper(static_cast<unsigned char>(*c)));
+			}
+
+			key += ':' + std::to_string(desc.SemanticIndex) + ':' + std::to_string(desc.Format) + ':' + std::to_string(desc.InputSlot)
+				+ ':' + std::to_string(desc.AlignedByteOffset) + ':' + std::to_string(desc.InputSlotClass) + ':' + std::to_string(desc.InstanceDataStepRate) + ';';
+		}
+
+		return key;
+	}
+}
+
+ShaderLibrary::ShaderLibrary(Renderer* renderer, const char* bundlePath, const char* directory) :
+	_renderer(renderer), _directory(directory)
+{
+	if (_bundle.Open(bundlePath))
+	{
+		std::error_code error;
+		_bundleTime = std::filesystem::last_write_time(bundlePath, error);
+		_stats.filesOpened++;
+	}
+}
+
+Shader* ShaderLibrary::GetShader(const char* vertexName, const char* pixelName, const D3D11_INPUT_ELEMENT_DESC* inputDescs, unsigned int inputDescCount)
+{
+	_stats.requests++;
+
+	auto layoutKey = GetInputLayoutKey(inputDescs, inputDescCount);
+	auto shaderKey = GetShaderName(vertexName) + '|' + GetShaderName(pixelName) + '|' + layoutKey;
+
+	auto existing = _shaders.find(shaderKey);
+	if (existing != _shaders.end())
+	{
+		_stats.reused++;
+		return existing->second.get();
+	}
+
+	auto device = _renderer->GetDevice();
+
+	// Loose files stay mapped until the objects are created.
+	MappedFile vertexFile, pixelFile;
+	ShaderBytecode vertexBytecode, pixelBytecode;
+	if (!FindBytecode(vertexName, vertexBytecode, vertexFile) || !FindBytecode(pixelName, pixelBytecode, pixelFile))
+	{
+		return nullptr;
+	}
+
+	auto& vertexShader = _vertexShaders[vertexBytecode.hash];
+	if (vertexShader)
+	{
+		_stats.objectsShared++;
+	}
+	else if (SUCCEEDED(device->CreateVertexShader(vertexBytecode.data, vertexBytecode.size, nullptr, &vertexShader)))
+	{
+		_stats.vertexShadersCreated++;
+	}
+	else
+	{
+		cout << "Failed to create Vertex Shader " << vertexName << endl;
+		_vertexShaders.erase(vertexBytecode.hash);
+		return nullptr;
+	}
+
+	auto& pixelShader = _pixelShaders[pixelBytecode.hash];
+	if (pixelShader)
+	{
+		_stats.objectsShared++;
+	}
+	else if (SUCCEEDED(device->CreatePixelShader(pixelBytecode.data, pixelBytecode.size, nullptr, &pixelShader)))
+	{
+		_stats.pixelShadersCreated++;
+	}
+	else
+	{
+		cout << "Failed to create Pixel Shader " << pixelName << endl;
+		_pixelShaders.erase(pixelBytecode.hash);
+		return nullptr;
+	}
+
+	// Validated against the input signature of the first vertex shader to use the layout. Later ones are
+	// given the same elements, so any which compiled against them accept it.
+	auto& inputLayout = _inputLayouts[layoutKey];
+	if (inputLayout)
+	{
+		_stats.objectsShared++;
+	}
+	else if (SUCCEEDED(device->CreateInputLayout(inputDescs, inputDescCount, vertexBytecode.data, vertexBytecode.size, &inputLayout)))
+	{
+		_stats.inputLayoutsCreated++;
+	}
+	else
+	{
+		cout << "Failed to create Input Layout for " << vertexName << endl;
+		_inputLayouts.erase(layoutKey);
+		return nullptr;
+	}
+
+	auto* shader = new Shader(_renderer, vertexShader, pixelShader, inputLayout);
+	_shaders.emplace(shaderKey, std::unique_ptr<Shader>(shader));
+
+	return shader;
+}
+
+ShaderLibraryStats ShaderLibrary::GetStats() const
+{
+	return _stats;
+}
+
+bool ShaderLibrary::FindBytecode(const char* name, ShaderBytecode& bytecode, MappedFile& file)
+{
+	auto path = (std::filesystem::path(_directory) / (string(name) + ".cso")).string();
+
+	// Only the time of the .cso is checked, it isn't opened unless it is used.
+	if (_bundle.Find(name, bytecode))
+	{
+		std::error_code error;
+		auto looseTime = std::filesystem::last_write_time(path, error);
+		if (error || looseTime <= _bundleTime)
+		{
+			return true;
+		}
+	}
+
+	if (!file.Open(path.c_str()))
+	{
+		cout << "Could not find shader " << name << " in the shader bundle or at: " << path << endl;
+		return false;
+	}
+
+	_stats.filesOpened++;
+
+	bytecode.data = file.GetData();
+	bytecode.size = file.GetSize();
+	bytecode.hash = HashBytes(bytecode.data, bytecode.size);
+
+	return true;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "Shader.h"
+#include "ShaderBundle.h"
+
+namespace TinyEngine
+{
+	class Renderer;
+
+	// What a ShaderLibrary has loaded and created.
+	struct ShaderLibraryStats
+	{
+		// Calls to GetShader, and how many returned a Shader which already existed.
+		unsigned int requests = 0;
+		unsigned int reused = 0;
+		// The bundle and any loose .cso files mapped.
+		unsigned int filesOpened = 0;
+		// Driver objects created, and how many more there would have been without sharing them.
+		unsigned int vertexShadersCreated = 0;
+		unsigned int pixelShadersCreated = 0;
+		unsigned int inputLayoutsCreated = 0;
+		unsigned int objectsShared = 0;
+	};
+
+	// Owns every Shader and the driver objects behind them.
+	// Bytecode comes from a mapped ShaderBundle, or from loose .cso files for shaders which aren't in it
+	// or have been compiled since it was written.
+	// Vertex and pixel shaders are created once per unique bytecode and input layouts once per unique
+	// set of D3D11_INPUT_ELEMENT_DESCs, however many Shaders use them.
+	class ShaderLibrary
+	{
+	private:
+		Renderer* _renderer;
+		ShaderBundle _bundle;
+		std::filesystem::file_time_type _bundleTime;
+		std::string _directory;
+
+		// By the hash of their bytecode.
+		std::unordered_map<uint64_t, Microsoft::WRL::ComPtr<ID3D11VertexShader>> _vertexShaders;
+		std::unordered_map<uint64_t, Microsoft::WRL::ComPtr<ID3D11PixelShader>> _pixelShaders;
+		// By the element descriptions, see GetInputLayoutKey.
+		std::unordered_map<std::string, Microsoft::WRL::ComPtr<ID3D11InputLayout>> _inputLayouts;
+
+		// By shader names and input layout.
+		std::unordered_map<std::string, std::unique_ptr<Shader>> _shaders;
+
+		ShaderLibraryStats _stats;
+
+	public:
+		// Construct a ShaderLibrary, mapping the bundle if there is one.
+		//	Renderer* renderer: Renderer to create shaders with
+		//	const char* bundlePath: .tsb written by TinyEngineCooker
+		//	const char* directory: Where the .cso files of shaders which aren't in the bundle are
+		ShaderLibrary(Renderer* renderer, const char* bundlePath, const char* directory);
+		~ShaderLibrary() = default;
+
+		ShaderLibrary(const ShaderLibrary&) = delete;
+
+		// Get a shader, creating it the first time it is requested.
+		//	const char* vertexName: Vertex shader, the name of its .cso without the extension
+		//	const char* pixelName: Pixel shader, the name of its .cso without the extension
+		//	const D3D11_INPUT_ELEMENT_DESC* inputDescs: Array of input descriptions for the vertex shader
+		//	unsigned int inputDescCount: Number of elements in the inputDescs array
+		//	returns: The shader, owned by the library. nullptr if its bytecode couldn't be found or its objects couldn't be created
+		Shader* GetShader(const char* vertexName, const char* pixelName, const D3D11_INPUT_ELEMENT_DESC* inputDescs, unsigned int inputDescCount);
+
+		ShaderLibraryStats GetStats() const;
+
+	private:
+		// Find a shader's bytecode in the bundle, or map its .cso into file if it isn't there or is newer.
+		bool FindBytecode(const char* name, ShaderBytecode& bytecode, MappedFile& file);
+	};
+}
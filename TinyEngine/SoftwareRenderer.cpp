@@ -0,0 +1,743 @@
+#include "SoftwareRenderer.h"
+#include "CpuFeatures.h"
+#include "PngFile.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <immintrin.h>
+#include <iostream>
+
+using namespace TinyEngine;
+using namespace DirectX;
+
+using std::cout;
+using std::endl;
+using std::vector;
+
+namespace
+{
+	// Vertices transformed at once, the width of an AVX register.
+	const unsigned int BATCH_SIZE = 8;
+
+	// Components of the vertices going in, position and normal, and coming out, clip space position,
+	// world position and world normal.
+	const unsigned int INPUT_COMPONENTS = 6;
+	const unsigned int OUTPUT_COMPONENTS = 10;
+
+	// How far past the screen, in screen sizes from its center, triangles are kept before being clipped.
+	// Keeps fixed point positions small while clipping few triangles.
+	const float GUARD_BAND = 2.0f;
+
+	// Planes triangles are clipped to, the near plane first.
+	const int CLIP_PLANES = 5;
+
+	float ClipDistance(const XMFLOAT4& position, int plane)
+	{
+		switch (plane)
+		{
+		case 0:
+			return position.z;
+		case 1:
+			return GUARD_BAND * position.w - position.x;
+		case 2:
+			return GUARD_BAND * position.w + position.x;
+		case 3:
+			return GUARD_BAND * position.w - position.y;
+		default:
+			return GUARD_BAND * position.w + position.y;
+		}
+	}
+
+	inline int64_t FloorDivide(int64_t a, int64_t b)
+	{
+		return a >= 0 ? a / b : -((-a + b - 1) / b);
+	}
+
+	inline float Saturate(float value)
+	{
+		return std::min(std::max(value, 0.0f), 1.0f);
+	}
+
+	inline float Dot(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	inline XMFLOAT3 Normalize(const XMFLOAT3& v)
+	{
+		float inverseLength = 1.0f / sqrtf(Dot(v, v));
+		return XMFLOAT3(v.x * inverseLength, v.y * inverseLength, v.z * inverseLength);
+	}
+
+	inline int Wrap(int i, int size)
+	{
+		i %= size;
+		return i < 0 ? i + size : i;
+	}
+
+	void SampleBilinear(const MipChain& chain, unsigned int level, float u, float v, float* texel)
+	{
+		const auto& mip = chain.levels[level];
+		const auto* data = chain.GetLevelData(level);
+
+		float x = (u - floorf(u)) * mip.width - 0.5f;
+		float y = (v - floorf(v)) * mip.height - 0.5f;
+		float left = floorf(x);
+		float top = floorf(y);
+		float tx = x - left;
+		float ty = y - top;
+
+		int x0 = Wrap(static_cast<int>(left), mip.width);
+		int y0 = Wrap(static_cast<int>(top), mip.height);
+		int x1 = Wrap(x0 + 1, mip.width);
+		int y1 = Wrap(y0 + 1, mip.height);
+
+		const auto* t00 = data + (static_cast<size_t>(y0) * mip.width + x0) * 4;
+		const auto* t10 = data + (static_cast<size_t>(y0) * mip.width + x1) * 4;
+		const auto* t01 = data + (static_cast<size_t>(y1) * mip.width + x0) * 4;
+		const auto* t11 = data + (static_cast<size_t>(y1) * mip.width + x1) * 4;
+
+		for (int c = 0; c < 4; c++)
+		{
+			float topRow = t00[c] + (t10[c] - t00[c]) * tx;
+			float bottomRow = t01[c] + (t11[c] - t01[c]) * tx;
+			texel[c] = (topRow + (bottomRow - topRow) * ty) * (1.0f / 255.0f);
+		}
+	}
+
+	// Sample a texture as a MIN_MAG_MIP_LINEAR, wrapping sampler does, picking the level from how far
+	// the texture coordinate moves to the next pixel across and down.
+	XMFLOAT4 Sample(const MipChain* chain, XMFLOAT2 texcoord, XMFLOAT2 dx, XMFLOAT2 dy)
+	{
+		if (!chain || chain->levels.empty())
+		{
+			return XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+		}
+
+		float width = static_cast<float>(chain->levels[0].width);
+		float height = static_cast<float>(chain->levels[0].height);
+		float lengthX = sqrtf(dx.x * width * dx.x * width + dx.y * height * dx.y * height);
+		float lengthY = sqrtf(dy.x * width * dy.x * width + dy.y * height * dy.y * height);
+		float rho = std::max(lengthX, lengthY);
+
+		float lastLevel = static_cast<float>(chain->levels.size() - 1);
+		float lod = rho > 1.0f ? std::min(log2f(rho), lastLevel) : 0.0f;
+		auto level = static_cast<unsigned int>(lod);
+		float blend = lod - level;
+
+		float texel[4];
+		SampleBilinear(*chain, level, texcoord.x, texcoord.y, texel);
+
+		if (blend > 0.0f && level + 1 < chain->levels.size())
+		{
+			float next[4];
+			SampleBilinear(*chain, level + 1, texcoord.x, texcoord.y, next);
+
+			for (int c = 0; c < 4; c++)
+			{
+				texel[c] += (next[c] - texel[c]) * blend;
+			}
+		}
+
+		return XMFLOAT4(texel[0], texel[1], texel[2], texel[3]);
+	}
+}
+
+SoftwareRenderer::SoftwareRenderer(unsigned int width, unsigned int height) : _width(std::max(width, 1u)), _height(std::max(height, 1u)),
+	_clearColor(0.0f, 0.0f, 0.0f, 1.0f)
+{
+	for (auto& light : lights)
+	{
+		light = {};
+	}
+
+	ambientLight = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+
+	_tilesX = (_width + TILE_SIZE - 1) / TILE_SIZE;
+	_tilesY = (_height + TILE_SIZE - 1) / TILE_SIZE;
+	_bins.resize(static_cast<size_t>(_tilesX) * _tilesY);
+
+	Clear();
+}
+
+void SoftwareRenderer::SetClearColor(XMFLOAT4 color)
+{
+	_clearColor = color;
+}
+
+void SoftwareRenderer::Clear()
+{
+	unsigned char clear[4] = {
+		static_cast<unsigned char>(Saturate(_clearColor.x) * 255.0f + 0.5f),
+		static_cast<unsigned char>(Saturate(_clearColor.y) * 255.0f + 0.5f),
+		static_cast<unsigned char>(Saturate(_clearColor.z) * 255.0f + 0.5f),
+		static_cast<unsigned char>(Saturate(_clearColor.w) * 255.0f + 0.5f)
+	};
+
+	size_t pixelCount = static_cast<size_t>(_width) * _height;
+	_pixels.resize(pixelCount * 4);
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		std::copy(clear, clear + 4, _pixels.begin() + i * 4);
+	}
+
+	_depth.assign(pixelCount, 1.0f);
+
+	_draws.clear();
+	_triangles.clear();
+	_stats = SoftwareRenderStats();
+}
+
+void SoftwareRenderer::DrawMesh(const MeshData& mesh, const vector<const SoftwareMaterial*>& materials, ICamera* camera, FXMMATRIX world, unsigned int lod)
+{
+	if (materials.empty())
+	{
+		cout << "Can't draw a mesh without materials." << endl;
+		return;
+	}
+
+	XMMATRIX worldViewProjection = world * camera->GetView() * camera->GetProjection();
+	auto det = XMMatrixDeterminant(world);
+	XMMATRIX worldInverseTranspose = XMMatrixTranspose(XMMatrixInverse(&det, world));
+	XMFLOAT3 eyePosition = camera->GetEyePosition();
+
+	const auto* material = materials[0];
+	for (size_t p = 0; p < mesh.parts.size(); p++)
+	{
+		const auto& part = mesh.parts[p];
+		if (p < materials.size())
+		{
+			material = materials[p];
+		}
+
+		unsigned int indexStart = part.indexStart;
+		unsigned int indexCount = part.indexCount;
+		if (lod > 0 && !part.lods.empty())
+		{
+			const auto& level = part.lods[std::min(static_cast<size_t>(lod), part.lods.size()) - 1];
+			indexStart = level.indexStart;
+			indexCount = level.indexCount;
+		}
+
+		if (part.baseVertex >= mesh.vertices.size() || static_cast<size_t>(indexStart) + indexCount > mesh.indices.size())
+		{
+			continue;
+		}
+
+		// Parts which don't say how many vertices they own may use any after their first.
+		auto available = static_cast<unsigned int>(mesh.vertices.size() - part.baseVertex);
+		unsigned int vertexCount = part.vertexCount > 0 ? std::min(part.vertexCount, available) : available;
+		const auto* vertices = mesh.vertices.data() + part.baseVertex;
+
+		size_t padded = (static_cast<size_t>(vertexCount) + BATCH_SIZE - 1) / BATCH_SIZE * BATCH_SIZE;
+		_vertexIn.assign(INPUT_COMPONENTS * padded, 0.0f);
+		_vertexOut.resize(OUTPUT_COMPONENTS * padded);
+
+		for (unsigned int i = 0; i < vertexCount; i++)
+		{
+			const auto& vertex = vertices[i];
+			_vertexIn[0 * padded + i] = vertex.position.x;
+			_vertexIn[1 * padded + i] = vertex.position.y;
+			_vertexIn[2 * padded + i] = vertex.position.z;
+			_vertexIn[3 * padded + i] = vertex.normal.x;
+			_vertexIn[4 * padded + i] = vertex.normal.y;
+			_vertexIn[5 * padded + i] = vertex.normal.z;
+		}
+
+		TransformVertices(vertexCount, world, worldViewProjection, worldInverseTranspose);
+
+		auto draw = static_cast<unsigned int>(_draws.size());
+		_draws.push_back({ material, eyePosition });
+		_stats.draws++;
+
+		auto clipVertex = [&](unsigned int i)
+		{
+			const float* out = _vertexOut.data() + i;
+			ClipVertex vertex;
+			vertex.position = XMFLOAT4(out[0 * padded], out[1 * padded], out[2 * padded], out[3 * padded]);
+			vertex.world = XMFLOAT3(out[4 * padded], out[5 * padded], out[6 * padded]);
+			vertex.normal = XMFLOAT3(out[7 * padded], out[8 * padded], out[9 * padded]);
+			vertex.texcoord = vertices[i].texcoord;
+			return vertex;
+		};
+
+		const auto* indices = mesh.indices.data() + indexStart;
+		for (unsigned int i = 0; i + 2 < indexCount; i += 3)
+		{
+			_stats.triangles++;
+
+			if (indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount)
+			{
+				continue;
+			}
+
+			AddTriangle(clipVertex(indices[i]), clipVertex(indices[i + 1]), clipVertex(indices[i + 2]), draw);
+		}
+	}
+}
+
+void SoftwareRenderer::Render(ThreadPool* threadPool)
+{
+	for (auto& bin : _bins)
+	{
+		bin.clear();
+	}
+
+	for (unsigned int i = 0; i < _triangles.size(); i++)
+	{
+		const auto& triangle = _triangles[i];
+		for (unsigned int tileY = triangle.minY / TILE_SIZE; tileY <= triangle.maxY / TILE_SIZE; tileY++)
+		{
+			for (unsigned int tileX = triangle.minX / TILE_SIZE; tileX <= triangle.maxX / TILE_SIZE; tileX++)
+			{
+				_bins[tileY * _tilesX + tileX].push_back(i);
+			}
+		}
+	}
+
+	// Tiles share no pixels, so they need nothing to keep them apart.
+	vector<unsigned int> shaded(_bins.size());
+	if (threadPool)
+	{
+		threadPool->ParallelFor(_bins.size(), [this, &shaded](size_t tile) { shaded[tile] = RenderTile(static_cast<unsigned int>(tile)); });
+	}
+	else
+	{
+		for (unsigned int tile = 0; tile < _bins.size(); tile++)
+		{
+			shaded[tile] = RenderTile(tile);
+		}
+	}
+
+	for (auto pixels : shaded)
+	{
+		_stats.pixelsShaded += pixels;
+	}
+}
+
+const vector<unsigned char>& SoftwareRenderer::GetPixels() const
+{
+	return _pixels;
+}
+
+const vector<float>& SoftwareRenderer::GetDepth() const
+{
+	return _depth;
+}
+
+bool SoftwareRenderer::WritePng(const char* path) const
+{
+	return TinyEngine::WritePng(path, _pixels.data(), static_cast<int>(_width), static_cast<int>(_height));
+}
+
+unsigned int SoftwareRenderer::GetWidth() const
+{
+	return _width;
+}
+
+unsigned int SoftwareRenderer::GetHeight() const
+{
+	return _height;
+}
+
+const SoftwareRenderStats& SoftwareRenderer::GetStats() const
+{
+	return _stats;
+}
+
+void SoftwareRenderer::TransformVertices(unsigned int count, FXMMATRIX world, CXMMATRIX worldViewProjection, CXMMATRIX worldInverseTranspose)
+{
+	XMFLOAT4X4 clip;
+	XMFLOAT4X4 position;
+	XMFLOAT4X4 normal;
+	XMStoreFloat4x4(&clip, worldViewProjection);
+	XMStoreFloat4x4(&position, world);
+	XMStoreFloat4x4(&normal, worldInverseTranspose);
+
+	size_t padded = (static_cast<size_t>(count) + BATCH_SIZE - 1) / BATCH_SIZE * BATCH_SIZE;
+	const float* in = _vertexIn.data();
+	float* out = _vertexOut.data();
+
+	// Row vectors times the matrices, as the shaders do. Normals are transformed with w = 1 like
+	// DefaultShader's TransformVertex, which adds nothing for affine world matrices.
+	// Both paths do the same operations in the same order, so they give the same results.
+#ifdef TINY_ENGINE_AVX2
+	bool avx2 = HasAvx2();
+#endif
+
+	for (size_t first = 0; first < padded; first += BATCH_SIZE)
+	{
+#ifdef TINY_ENGINE_AVX2
+		if (avx2)
+		{
+			auto transform = [](const XMFLOAT4X4& m, int column, __m256 x, __m256 y, __m256 z)
+			{
+				return _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(x, _mm256_set1_ps(m.m[0][column])),
+					_mm256_mul_ps(y, _mm256_set1_ps(m.m[1][column]))),
+					_mm256_mul_ps(z, _mm256_set1_ps(m.m[2][column]))),
+					_mm256_set1_ps(m.m[3][column]));
+			};
+
+			__m256 px = _mm256_loadu_ps(in + 0 * padded + first);
+			__m256 py = _mm256_loadu_ps(in + 1 * padded + first);
+			__m256 pz = _mm256_loadu_ps(in + 2 * padded + first);
+			__m256 nx = _mm256_loadu_ps(in + 3 * padded + first);
+			__m256 ny = _mm256_loadu_ps(in + 4 * padded + first);
+			__m256 nz = _mm256_loadu_ps(in + 5 * padded + first);
+
+			for (int column = 0; column < 4; column++)
+			{
+				_mm256_storeu_ps(out + column * padded + first, transform(clip, column, px, py, pz));
+			}
+
+			for (int column = 0; column < 3; column++)
+			{
+				_mm256_storeu_ps(out + (4 + column) * padded + first, transform(position, column, px, py, pz));
+				_mm256_storeu_ps(out + (7 + column) * padded + first, transform(normal, column, nx, ny, nz));
+			}
+		}
+		else
+#endif
+		{
+			auto transform = [](const XMFLOAT4X4& m, int column, __m128 x, __m128 y, __m128 z)
+			{
+				return _mm_add_ps(_mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(x, _mm_set1_ps(m.m[0][column])),
+					_mm_mul_ps(y, _mm_set1_ps(m.m[1][column]))),
+					_mm_mul_ps(z, _mm_set1_ps(m.m[2][column]))),
+					_mm_set1_ps(m.m[3][column]));
+			};
+
+			for (size_t half = first; half < first + BATCH_SIZE; half += 4)
+			{
+				__m128 px = _mm_loadu_ps(in + 0 * padded + half);
+				__m128 py = _mm_loadu_ps(in + 1 * padded + half);
+				__m128 pz = _mm_loadu_ps(in + 2 * padded + half);
+				__m128 nx = _mm_loadu_ps(in + 3 * padded + half);
+				__m128 ny = _mm_loadu_ps(in + 4 * padded + half);
+				__m128 nz = _mm_loadu_ps(in + 5 * padded + half);
+
+				for (int column = 0; column < 4; column++)
+				{
+					_mm_storeu_ps(out + column * padded + half, transform(clip, column, px, py, pz));
+				}
+
+				for (int column = 0; column < 3; column++)
+				{
+					_mm_storeu_ps(out + (4 + column) * padded + half, transform(position, column, px, py, pz));
+					_mm_storeu_ps(out + (7 + column) * padded + half, transform(normal, column, nx, ny, nz));
+				}
+			}
+		}
+	}
+}
+
+void SoftwareRenderer::AddTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, unsigned int draw)
+{
+	// Most triangles are inside every plane and skip clipping altogether.
+	bool inside = true;
+	for (int plane = 0; plane < CLIP_PLANES; plane++)
+	{
+		inside = inside && ClipDistance(a.position, plane) >= 0.0f && ClipDistance(b.position, plane) >= 0.0f && ClipDistance(c.position, plane) >= 0.0f;
+	}
+
+	if (inside)
+	{
+		ClipVertex vertices[3] = { a, b, c };
+		SetupTriangle(vertices, draw);
+		return;
+	}
+
+	// Each plane adds at most one vertex.
+	ClipVertex polygons[2][3 + CLIP_PLANES] = { { a, b, c } };
+	unsigned int count = 3;
+	int current = 0;
+
+	for (int plane = 0; plane < CLIP_PLANES && count >= 3; plane++)
+	{
+		const auto* input = polygons[current];
+		auto* output = polygons[1 - current];
+		unsigned int outputCount = 0;
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const auto& from = input[i];
+			const auto& to = input[(i + 1) % count];
+			float fromDistance = ClipDistance(from.position, plane);
+			float toDistance = ClipDistance(to.position, plane);
+
+			if (fromDistance >= 0.0f)
+			{
+				output[outputCount++] = from;
+			}
+
+			if ((fromDistance >= 0.0f) != (toDistance >= 0.0f))
+			{
+				// Everything is linear in clip space.
+				float t = fromDistance / (fromDistance - toDistance);
+				auto& vertex = output[outputCount++];
+				XMStoreFloat4(&vertex.position, XMVectorLerp(XMLoadFloat4(&from.position), XMLoadFloat4(&to.position), t));
+				XMStoreFloat3(&vertex.world, XMVectorLerp(XMLoadFloat3(&from.world), XMLoadFloat3(&to.world), t));
+				XMStoreFloat3(&vertex.normal, XMVectorLerp(XMLoadFloat3(&from.normal), XMLoadFloat3(&to.normal), t));
+				XMStoreFloat2(&vertex.texcoord, XMVectorLerp(XMLoadFloat2(&from.texcoord), XMLoadFloat2(&to.texcoord), t));
+			}
+		}
+
+		count = outputCount;
+		current = 1 - current;
+	}
+
+	// A convex polygon, drawn as a fan.
+	const auto* polygon = polygons[current];
+	for (unsigned int i = 1; i + 1 < count; i++)
+	{
+		ClipVertex vertices[3] = { polygon[0], polygon[i], polygon[i + 1] };
+		SetupTriangle(vertices, draw);
+	}
+}
+
+void SoftwareRenderer::SetupTriangle(const ClipVertex* vertices, unsigned int draw)
+{
+	Triangle triangle;
+	triangle.draw = draw;
+
+	const float subpixels = static_cast<float>(1 << SUBPIXEL_BITS);
+	for (int i = 0; i < 3; i++)
+	{
+		const auto& vertex = vertices[i];
+		if (vertex.position.w <= 0.0f)
+		{
+			return;
+		}
+
+		float inverseW = 1.0f / vertex.position.w;
+		float x = (vertex.position.x * inverseW * 0.5f + 0.5f) * _width;
+		float y = (0.5f - vertex.position.y * inverseW * 0.5f) * _height;
+
+		triangle.x[i] = static_cast<int>(floorf(x * subpixels + 0.5f));
+		triangle.y[i] = static_cast<int>(floorf(y * subpixels + 0.5f));
+		triangle.z[i] = vertex.position.z * inverseW;
+		triangle.inverseW[i] = inverseW;
+
+		const float attributes[ATTRIBUTE_COUNT] = { vertex.world.x, vertex.world.y, vertex.world.z,
+			vertex.normal.x, vertex.normal.y, vertex.normal.z, vertex.texcoord.x, vertex.texcoord.y };
+		for (unsigned int a = 0; a < ATTRIBUTE_COUNT; a++)
+		{
+			triangle.attributes[i][a] = attributes[a] * inverseW;
+		}
+	}
+
+	// Clockwise on screen, with y down, is positive. Counter clockwise triangles are back faces and culled,
+	// as are those which snapped to nothing.
+	int64_t area = static_cast<int64_t>(triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0])
+		- static_cast<int64_t>(triangle.y[1] - triangle.y[0]) * (triangle.x[2] - triangle.x[0]);
+	if (area <= 0)
+	{
+		return;
+	}
+
+	triangle.inverseArea = 1.0f / static_cast<float>(area);
+
+	// Pixels whose centers are inside the triangle's bounds.
+	const int64_t half = 1 << (SUBPIXEL_BITS - 1);
+	const int64_t pixel = 1 << SUBPIXEL_BITS;
+	int64_t minX = std::min({ triangle.x[0], triangle.x[1], triangle.x[2] });
+	int64_t maxX = std::max({ triangle.x[0], triangle.x[1], triangle.x[2] });
+	int64_t minY = std::min({ triangle.y[0], triangle.y[1], triangle.y[2] });
+	int64_t maxY = std::max({ triangle.y[0], triangle.y[1], triangle.y[2] });
+
+	int64_t firstX = -FloorDivide(half - minX, pixel);
+	int64_t lastX = FloorDivide(maxX - half, pixel);
+	int64_t firstY = -FloorDivide(half - minY, pixel);
+	int64_t lastY = FloorDivide(maxY - half, pixel);
+
+	firstX = std::max<int64_t>(firstX, 0);
+	firstY = std::max<int64_t>(firstY, 0);
+	lastX = std::min<int64_t>(lastX, _width - 1);
+	lastY = std::min<int64_t>(lastY, _height - 1);
+
+	if (firstX > lastX || firstY > lastY)
+	{
+		return;
+	}
+
+	triangle.minX = static_cast<int>(firstX);
+	triangle.minY = static_cast<int>(firstY);
+	triangle.maxX = static_cast<int>(lastX);
+	triangle.maxY = static_cast<int>(lastY);
+
+	// With y down and clockwise winding, left edges go up and top edges go right along a row.
+	for (int i = 0; i < 3; i++)
+	{
+		int from = (i + 1) % 3;
+		int to = (i + 2) % 3;
+		int dx = triangle.x[to] - triangle.x[from];
+		int dy = triangle.y[to] - triangle.y[from];
+
+		triangle.topLeft[i] = dy < 0 || (dy == 0 && dx > 0);
+	}
+
+	_triangles.push_back(triangle);
+	_stats.rasterized++;
+}
+
+unsigned int SoftwareRenderer::RenderTile(unsigned int tile)
+{
+	int tileLeft = static_cast<int>((tile % _tilesX) * TILE_SIZE);
+	int tileTop = static_cast<int>((tile / _tilesX) * TILE_SIZE);
+	int tileRight = std::min(tileLeft + static_cast<int>(TILE_SIZE), static_cast<int>(_width)) - 1;
+	int tileBottom = std::min(tileTop + static_cast<int>(TILE_SIZE), static_cast<int>(_height)) - 1;
+
+	const int64_t half = 1 << (SUBPIXEL_BITS - 1);
+	const int64_t pixel = 1 << SUBPIXEL_BITS;
+
+	unsigned int shaded = 0;
+	float attributes[ATTRIBUTE_COUNT];
+
+	for (auto index : _bins[tile])
+	{
+		const auto& triangle = _triangles[index];
+		const auto& draw = _draws[triangle.draw];
+
+		int left = std::max(triangle.minX, tileLeft);
+		int top = std::max(triangle.minY, tileTop);
+		int right = std::min(triangle.maxX, tileRight);
+		int bottom = std::min(triangle.maxY, tileBottom);
+
+		// Edge functions are twice the area of the triangle a pixel center makes with each edge, exact in
+		// fixed point, so they step from pixel to pixel without drifting.
+		int64_t stepX[3];
+		int64_t stepY[3];
+		int64_t rowStart[3];
+		int64_t threshold[3];
+
+		int64_t startX = left * pixel + half;
+		int64_t startY = top * pixel + half;
+
+		for (int i = 0; i < 3; i++)
+		{
+			int from = (i + 1) % 3;
+			int to = (i + 2) % 3;
+			int64_t dx = triangle.x[to] - triangle.x[from];
+			int64_t dy = triangle.y[to] - triangle.y[from];
+
+			stepX[i] = -dy * pixel;
+			stepY[i] = dx * pixel;
+			rowStart[i] = dx * (startY - triangle.y[from]) - dy * (startX - triangle.x[from]);
+			// Pixels exactly on an edge belong to it only if it is a top or left edge.
+			threshold[i] = triangle.topLeft[i] ? 0 : 1;
+		}
+
+		for (int y = top; y <= bottom; y++)
+		{
+			int64_t w[3] = { rowStart[0], rowStart[1], rowStart[2] };
+
+			for (int x = left; x <= right; x++)
+			{
+				if (w[0] >= threshold[0] && w[1] >= threshold[1] && w[2] >= threshold[2])
+				{
+					float b0 = static_cast<float>(w[0]) * triangle.inverseArea;
+					float b1 = static_cast<float>(w[1]) * triangle.inverseArea;
+					float b2 = static_cast<float>(w[2]) * triangle.inverseArea;
+
+					float z = b0 * triangle.z[0] + b1 * triangle.z[1] + b2 * triangle.z[2];
+					size_t offset = static_cast<size_t>(y) * _width + x;
+
+					if (z < _depth[offset])
+					{
+						// Attributes over w and 1 / w are linear on screen, dividing one by the other corrects for perspective.
+						float pixelW = 1.0f / (b0 * triangle.inverseW[0] + b1 * triangle.inverseW[1] + b2 * triangle.inverseW[2]);
+						for (unsigned int a = 0; a < ATTRIBUTE_COUNT; a++)
+						{
+							attributes[a] = (b0 * triangle.attributes[0][a] + b1 * triangle.attributes[1][a] + b2 * triangle.attributes[2][a]) * pixelW;
+						}
+
+						// The texture coordinate one pixel across and down picks the texture level.
+						auto texcoordAt = [&triangle](int64_t e0, int64_t e1, int64_t e2)
+						{
+							float c0 = static_cast<float>(e0) * triangle.inverseArea;
+							float c1 = static_cast<float>(e1) * triangle.inverseArea;
+							float c2 = static_cast<float>(e2) * triangle.inverseArea;
+							float neighbourW = 1.0f / (c0 * triangle.inverseW[0] + c1 * triangle.inverseW[1] + c2 * triangle.inverseW[2]);
+							return XMFLOAT2(
+								(c0 * triangle.attributes[0][6] + c1 * triangle.attributes[1][6] + c2 * triangle.attributes[2][6]) * neighbourW,
+								(c0 * triangle.attributes[0][7] + c1 * triangle.attributes[1][7] + c2 * triangle.attributes[2][7]) * neighbourW);
+						};
+
+						auto across = texcoordAt(w[0] + stepX[0], w[1] + stepX[1], w[2] + stepX[2]);
+						auto down = texcoordAt(w[0] + stepY[0], w[1] + stepY[1], w[2] + stepY[2]);
+						XMFLOAT2 dx(across.x - attributes[6], across.y - attributes[7]);
+						XMFLOAT2 dy(down.x - attributes[6], down.y - attributes[7]);
+
+						auto color = Shade(draw, attributes, dx, dy);
+
+						auto* out = _pixels.data() + offset * 4;
+						out[0] = static_cast<unsigned char>(color.x * 255.0f + 0.5f);
+						out[1] = static_cast<unsigned char>(color.y * 255.0f + 0.5f);
+						out[2] = static_cast<unsigned char>(color.z * 255.0f + 0.5f);
+						out[3] = static_cast<unsigned char>(color.w * 255.0f + 0.5f);
+
+						_depth[offset] = z;
+						shaded++;
+					}
+				}
+
+				for (int i = 0; i < 3; i++)
+				{
+					w[i] += stepX[i];
+				}
+			}
+
+			for (int i = 0; i < 3; i++)
+			{
+				rowStart[i] += stepY[i];
+			}
+		}
+	}
+
+	return shaded;
+}
+
+XMFLOAT4 SoftwareRenderer::Shade(const Draw& draw, const float* attributes, XMFLOAT2 texcoordDx, XMFLOAT2 texcoordDy) const
+{
+	const auto& material = *draw.material;
+	XMFLOAT2 texcoord(attributes[6], attributes[7]);
+
+	auto ambientTexture = Sample(material.ambientTexture, texcoord, texcoordDx, texcoordDy);
+	auto diffuseTexture = Sample(material.diffuseTexture, texcoord, texcoordDx, texcoordDy);
+	auto specularTexture = Sample(material.specularTexture, texcoord, texcoordDx, texcoordDy);
+
+	XMFLOAT3 ambient(material.ambient.x + ambientTexture.x, material.ambient.y + ambientTexture.y, material.ambient.z + ambientTexture.z);
+	XMFLOAT3 diffuse(material.diffuse.x + diffuseTexture.x, material.diffuse.y + diffuseTexture.y, material.diffuse.z + diffuseTexture.z);
+	XMFLOAT3 specular(material.specular.x + specularTexture.x, material.specular.y + specularTexture.y, material.specular.z + specularTexture.z);
+	float specularExponent = material.specularExponent + specularTexture.w * 1000.0f;
+
+	XMFLOAT3 position(attributes[0], attributes[1], attributes[2]);
+	XMFLOAT3 normal = Normalize(XMFLOAT3(attributes[3], attributes[4], attributes[5]));
+	XMFLOAT3 toEye = Normalize(XMFLOAT3(draw.eyePosition.x - position.x, draw.eyePosition.y - position.y, draw.eyePosition.z - position.z));
+
+	XMFLOAT3 color(0.0f, 0.0f, 0.0f);
+	for (const auto& light : lights)
+	{
+		XMFLOAT3 direction = Normalize(light.direction);
+		XMFLOAT3 toLight(-direction.x, -direction.y, -direction.z);
+		XMFLOAT3 lightColor(light.color.x * light.color.w, light.color.y * light.color.w, light.color.z * light.color.w);
+
+		float diffuseFactor = Saturate(Dot(normal, toLight));
+
+		XMFLOAT3 halfway = Normalize(XMFLOAT3(toLight.x + toEye.x, toLight.y + toEye.y, toLight.z + toEye.z));
+		float specularFactor = powf(Saturate(Dot(normal, halfway)), specularExponent);
+
+		color.x += (diffuseFactor * diffuse.x + specularFactor * specular.x) * lightColor.x;
+		color.y += (diffuseFactor * diffuse.y + specularFactor * specular.y) * lightColor.y;
+		color.z += (diffuseFactor * diffuse.z + specularFactor * specular.z) * lightColor.z;
+	}
+
+	color.x += ambient.x * ambientLight.x * ambientLight.w;
+	color.y += ambient.y * ambientLight.y * ambientLight.w;
+	color.z += ambient.z * ambientLight.z * ambientLight.w;
+
+	return XMFLOAT4(Saturate(color.x), Saturate(color.y), Saturate(color.z), 1.0f);
+}
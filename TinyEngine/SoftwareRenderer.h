@@ -0,0 +1,197 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+#include "DirectionLight.h"
+#include "ICamera.h"
+#include "MeshData.h"
+#include "MipGenerator.h"
+
+namespace TinyEngine
+{
+	class ThreadPool;
+
+	// The colors and textures of a Material, as the SoftwareRenderer shades them. Textures are RGBA unorm mip
+	// chains, such as GenerateMipChain makes, and sample as 0 when missing just as the renderer's null textures do.
+	struct SoftwareMaterial
+	{
+		DirectX::XMFLOAT3 ambient = {};
+		const MipChain* ambientTexture = nullptr;
+
+		DirectX::XMFLOAT3 diffuse = {};
+		const MipChain* diffuseTexture = nullptr;
+
+		DirectX::XMFLOAT3 specular = {};
+		float specularExponent = 0.0f;
+		// RGB = specular, A = specular exponent.
+		const MipChain* specularTexture = nullptr;
+	};
+
+	// What a SoftwareRenderer drew since it was last cleared.
+	struct SoftwareRenderStats
+	{
+		// Parts drawn, each with its own material.
+		unsigned int draws = 0;
+		// Triangles drawn, those left after clipping and back face culling, and the pixels which passed the depth test.
+		unsigned int triangles = 0;
+		unsigned int rasterized = 0;
+		unsigned int pixelsShaded = 0;
+	};
+
+	// Draws meshes on the CPU the way the Renderer's default shaders do, for rendering where there is no
+	// device, such as headless tests and benchmarks. The same build always draws the same image.
+	//
+	// Mesh and Texture only keep their data on the device, so it draws the CPU side data they are made from:
+	// MeshData and mip chains. Vertices are transformed 8 at a time with AVX on CPUs which support AVX2,
+	// otherwise 4 at a time with SSE, to the same results. Triangles are clipped
+	// to the near plane and a guard band, culled as the Renderer's rasterizer state does, snapped to fixed
+	// point and binned to square tiles. Render then shades the tiles in parallel with Blinn-Phong
+	// lighting from three DirectionLights, as DefaultPixelShader does, sampling textures trilinearly with
+	// wrapping as the default sampler does.
+	// Each tile is drawn by one thread in the order its triangles were drawn, so the image is the same
+	// whatever the number of threads. Materials' shaders and transparency are ignored.
+	// Doesn't touch any device, so it can be used and tested on its own.
+	class SoftwareRenderer
+	{
+	public:
+		static const unsigned int TILE_SIZE = 64;
+
+		// Lights shaded with, read by Render.
+		DirectionLight lights[3];
+
+		// Ambient light color.
+		DirectX::XMFLOAT4 ambientLight;
+
+	private:
+		// A vertex in clip space with what is interpolated over its triangles.
+		struct ClipVertex
+		{
+			DirectX::XMFLOAT4 position;
+			DirectX::XMFLOAT3 world;
+			DirectX::XMFLOAT3 normal;
+			DirectX::XMFLOAT2 texcoord;
+		};
+
+		// Number of floats interpolated, world position, normal and texture coordinate.
+		static const unsigned int ATTRIBUTE_COUNT = 8;
+
+		// Fractional bits of the fixed point positions triangles are snapped to, as hardware does.
+		static const int SUBPIXEL_BITS = 8;
+
+		// A triangle in pixels, ready to rasterize.
+		struct Triangle
+		{
+			// Positions in fixed point, which keeps edge functions exact, so of two triangles sharing an edge
+			// exactly one draws each pixel on it.
+			int x[3];
+			int y[3];
+			// Depth and 1 / w at each vertex, which are interpolated linearly on screen.
+			float z[3];
+			float inverseW[3];
+			// Each vertex's attributes over w, which are also linear on screen.
+			float attributes[3][ATTRIBUTE_COUNT];
+			// One over the edge functions' sum, twice the area in fixed point.
+			float inverseArea;
+			// Pixel bounds, clamped to the screen.
+			int minX;
+			int minY;
+			int maxX;
+			int maxY;
+			// Whether the edge opposite each vertex is a top or left edge, which own the pixels exactly on them.
+			bool topLeft[3];
+			unsigned int draw;
+		};
+
+		// What a draw's triangles are shaded with.
+		struct Draw
+		{
+			const SoftwareMaterial* material;
+			DirectX::XMFLOAT3 eyePosition;
+		};
+
+		unsigned int _width;
+		unsigned int _height;
+		unsigned int _tilesX;
+		unsigned int _tilesY;
+
+		DirectX::XMFLOAT4 _clearColor;
+
+		std::vector<unsigned char> _pixels;
+		std::vector<float> _depth;
+
+		std::vector<Draw> _draws;
+		std::vector<Triangle> _triangles;
+		// Triangles overlapping each tile, in the order they were drawn.
+		std::vector<std::vector<unsigned int>> _bins;
+
+		// Vertices of the part being drawn, component by component, padded to a whole number of batches.
+		std::vector<float> _vertexIn;
+		std::vector<float> _vertexOut;
+
+		SoftwareRenderStats _stats;
+
+	public:
+		// Construct a SoftwareRenderer.
+		//	unsigned int width: Width of the image in pixels
+		//	unsigned int height: Height of the image in pixels
+		SoftwareRenderer(unsigned int width, unsigned int height);
+		~SoftwareRenderer() = default;
+
+		SoftwareRenderer(const SoftwareRenderer&) = delete;
+
+		// Set the color the image is cleared to.
+		//	DirectX::XMFLOAT4 color: RGBA color
+		void SetClearColor(DirectX::XMFLOAT4 color);
+
+		// Clear the image and depth, and drop everything drawn.
+		void Clear();
+
+		// Draw a mesh. Its triangles are transformed and binned now, and shaded by Render.
+		//	const MeshData& mesh: Mesh to draw
+		//	const std::vector<const SoftwareMaterial*>& materials: Materials to draw the mesh with, one per part.
+		//		If there are too few it will re use the last material in the array, as Renderer::DrawMesh does. Kept until Render
+		//	ICamera* camera: Camera to draw the mesh with
+		//	DirectX::FXMMATRIX world: World matrix of the mesh
+		//	unsigned int lod: Level of detail to draw, 0 is full detail. Clamped to the levels each part has
+		void DrawMesh(const MeshData& mesh, const std::vector<const SoftwareMaterial*>& materials, ICamera* camera, DirectX::FXMMATRIX world, unsigned int lod = 0);
+
+		// Shade everything drawn since the last Clear, each tile on its own thread.
+		//	ThreadPool* threadPool: Pool to shade on. nullptr shades on the calling thread
+		void Render(ThreadPool* threadPool = nullptr);
+
+		// The image, RGBA unorm, rows top to bottom.
+		const std::vector<unsigned char>& GetPixels() const;
+
+		// Depth of every pixel, 1 where nothing was drawn.
+		const std::vector<float>& GetDepth() const;
+
+		// Write the image to a .png file.
+		//	const char* path: Path to write to
+		//	returns: false if the file could not be written
+		bool WritePng(const char* path) const;
+
+		unsigned int GetWidth() const;
+		unsigned int GetHeight() const;
+
+		const SoftwareRenderStats& GetStats() const;
+
+	private:
+		// Transform the vertices in _vertexIn to _vertexOut, a batch at a time.
+		//	unsigned int count: Number of vertices
+		void TransformVertices(unsigned int count, DirectX::FXMMATRIX world, DirectX::CXMMATRIX worldViewProjection, DirectX::CXMMATRIX worldInverseTranspose);
+
+		// Clip a triangle to the near plane and a guard band around the screen, then set up what is left.
+		void AddTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, unsigned int draw);
+
+		// Set up a triangle inside the clip planes.
+		void SetupTriangle(const ClipVertex* vertices, unsigned int draw);
+
+		// Rasterize and shade one tile's triangles.
+		//	returns: Number of pixels shaded
+		unsigned int RenderTile(unsigned int tile);
+
+		// Light a pixel as DefaultPixelShader does.
+		//	returns: RGBA color, saturated
+		DirectX::XMFLOAT4 Shade(const Draw& draw, const float* attributes, DirectX::XMFLOAT2 texcoordDx, DirectX::XMFLOAT2 texcoordDy) const;
+	};
+}
@@ -0,0 +1,213 @@
+#include "StateCache.h"
+#include <cstdint>
+#include <cstring>
+
+using namespace TinyEngine;
+
+unsigned int StateCacheStats::GetIssued() const
+{
+	unsigned int total = 0;
+	for (auto count : issued)
+	{
+		total += count;
+	}
+
+	return total;
+}
+
+unsigned int StateCacheStats::GetElided() const
+{
+	unsigned int total = 0;
+	for (auto count : elided)
+	{
+		total += count;
+	}
+
+	return total;
+}
+
+StateCache::StateCache(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context) : _context(context)
+{
+	// Always there on the 11.1 devices the renderer creates.
+	_context.As(&_context1);
+
+	Invalidate();
+}
+
+void StateCache::Invalidate()
+{
+	// Nothing real is ever bound at ~0, so every first bind is issued. nullptr can't be used as it is a valid bind.
+	auto* invalid = reinterpret_cast<void*>(~static_cast<uintptr_t>(0));
+
+	_inputLayout = static_cast<ID3D11InputLayout*>(invalid);
+	_vertexShader = static_cast<ID3D11VertexShader*>(invalid);
+	_pixelShader = static_cast<ID3D11PixelShader*>(invalid);
+	for (unsigned int i = 0; i < MAX_VERTEX_BUFFERS; i++)
+	{
+		_vertexBuffers[i] = static_cast<ID3D11Buffer*>(invalid);
+		_vertexStrides[i] = 0;
+		_vertexOffsets[i] = 0;
+	}
+
+	_indexBuffer = static_cast<ID3D11Buffer*>(invalid);
+	_topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+
+	for (auto& sampler : _psSamplers)
+	{
+		sampler = static_cast<ID3D11SamplerState*>(invalid);
+	}
+
+	for (auto& view : _psShaderResources)
+	{
+		view = static_cast<ID3D11ShaderResourceView*>(invalid);
+	}
+
+	for (unsigned int i = 0; i < MAX_CONSTANT_BUFFERS; i++)
+	{
+		_vsConstantBuffers[i] = static_cast<ID3D11Buffer*>(invalid);
+		_psConstantBuffers[i] = static_cast<ID3D11Buffer*>(invalid);
+		_constantOffsets[i] = WHOLE_BUFFER;
+	}
+}
+
+void StateCache::SetInputLayout(ID3D11InputLayout* inputLayout)
+{
+	if (Changed(StateBind::INPUT_LAYOUT, inputLayout != _inputLayout))
+	{
+		_inputLayout = inputLayout;
+		_context->IASetInputLayout(inputLayout);
+	}
+}
+
+void StateCache::SetVertexShader(ID3D11VertexShader* vertexShader)
+{
+	if (Changed(StateBind::VERTEX_SHADER, vertexShader != _vertexShader))
+	{
+		_vertexShader = vertexShader;
+		_context->VSSetShader(vertexShader, nullptr, 0);
+	}
+}
+
+void StateCache::SetPixelShader(ID3D11PixelShader* pixelShader)
+{
+	if (Changed(StateBind::PIXEL_SHADER, pixelShader != _pixelShader))
+	{
+		_pixelShader = pixelShader;
+		_context->PSSetShader(pixelShader, nullptr, 0);
+	}
+}
+
+void StateCache::SetVertexBuffer(UINT slot, ID3D11Buffer* buffer, UINT stride, UINT offset)
+{
+	if (Changed(StateBind::VERTEX_BUFFER, buffer != _vertexBuffers[slot] || stride != _vertexStrides[slot] || offset != _vertexOffsets[slot]))
+	{
+		_vertexBuffers[slot] = buffer;
+		_vertexStrides[slot] = stride;
+		_vertexOffsets[slot] = offset;
+		_context->IASetVertexBuffers(slot, 1, &buffer, &stride, &offset);
+	}
+}
+
+void StateCache::SetIndexBuffer(ID3D11Buffer* buffer)
+{
+	if (Changed(StateBind::INDEX_BUFFER, buffer != _indexBuffer))
+	{
+		_indexBuffer = buffer;
+		_context->IASetIndexBuffer(buffer, DXGI_FORMAT_R32_UINT, 0);
+	}
+}
+
+void StateCache::SetTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	if (Changed(StateBind::TOPOLOGY, topology != _topology))
+	{
+		_topology = topology;
+		_context->IASetPrimitiveTopology(topology);
+	}
+}
+
+void StateCache::SetPSSamplers(UINT slot, UINT count, ID3D11SamplerState* const* samplers)
+{
+	bool changed = memcmp(&_psSamplers[slot], samplers, count * sizeof(*samplers)) != 0;
+	if (Changed(StateBind::SAMPLER, changed))
+	{
+		memcpy(&_psSamplers[slot], samplers, count * sizeof(*samplers));
+		_context->PSSetSamplers(slot, count, samplers);
+	}
+}
+
+void StateCache::SetPSShaderResources(UINT slot, UINT count, ID3D11ShaderResourceView* const* views)
+{
+	bool changed = memcmp(&_psShaderResources[slot], views, count * sizeof(*views)) != 0;
+	if (Changed(StateBind::SHADER_RESOURCE, changed))
+	{
+		memcpy(&_psShaderResources[slot], views, count * sizeof(*views));
+		_context->PSSetShaderResources(slot, count, views);
+	}
+}
+
+void StateCache::SetConstantBuffer(UINT slot, ID3D11Buffer* buffer)
+{
+	bool offset = _constantOffsets[slot] != WHOLE_BUFFER;
+	_constantOffsets[slot] = WHOLE_BUFFER;
+
+	if (Changed(StateBind::CONSTANT_BUFFER, buffer != _vsConstantBuffers[slot] || offset))
+	{
+		_vsConstantBuffers[slot] = buffer;
+		_context->VSSetConstantBuffers(slot, 1, &buffer);
+	}
+
+	if (Changed(StateBind::CONSTANT_BUFFER, buffer != _psConstantBuffers[slot] || offset))
+	{
+		_psConstantBuffers[slot] = buffer;
+		_context->PSSetConstantBuffers(slot, 1, &buffer);
+	}
+}
+
+void StateCache::SetConstantBuffer(UINT slot, ID3D11Buffer* buffer, UINT firstConstant)
+{
+	UINT numConstants = CONSTANT_BLOCK_CONSTANTS;
+	bool offset = firstConstant != _constantOffsets[slot];
+	_constantOffsets[slot] = firstConstant;
+
+	if (Changed(StateBind::CONSTANT_BUFFER, buffer != _vsConstantBuffers[slot] || offset))
+	{
+		_vsConstantBuffers[slot] = buffer;
+		_context1->VSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &numConstants);
+	}
+
+	if (Changed(StateBind::CONSTANT_BUFFER, buffer != _psConstantBuffers[slot] || offset))
+	{
+		_psConstantBuffers[slot] = buffer;
+		_context1->PSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &numConstants);
+	}
+}
+
+void StateCache::CountUpload()
+{
+	Changed(StateBind::CONSTANT_UPLOAD, true);
+}
+
+void StateCache::CountDraw(unsigned int instances)
+{
+	_stats.draws++;
+	_stats.instances += instances;
+}
+
+const StateCacheStats& StateCache::GetStats() const
+{
+	return _stats;
+}
+
+void StateCache::ResetStats()
+{
+	_stats = StateCacheStats();
+}
+
+bool StateCache::Changed(StateBind bind, bool changed)
+{
+	auto& count = changed ? _stats.issued[static_cast<int>(bind)] : _stats.elided[static_cast<int>(bind)];
+	count++;
+
+	return changed;
+}
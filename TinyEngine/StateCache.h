@@ -0,0 +1,132 @@
+#pragma once
+
+#include <d3d11.h>
+#include <d3d11_1.h>
+#include <wrl/client.h>
+
+namespace TinyEngine
+{
+	// Binds counted by a StateCache.
+	enum class StateBind
+	{
+		INPUT_LAYOUT,
+		VERTEX_SHADER,
+		PIXEL_SHADER,
+		VERTEX_BUFFER,
+		INDEX_BUFFER,
+		TOPOLOGY,
+		SAMPLER,
+		SHADER_RESOURCE,
+		CONSTANT_BUFFER,
+		// Constant buffer contents, uploaded by the caller when they changed.
+		CONSTANT_UPLOAD,
+		COUNT
+	};
+
+	// Calls made and dropped by a StateCache since it was last reset.
+	struct StateCacheStats
+	{
+		unsigned int issued[static_cast<int>(StateBind::COUNT)] = {};
+		unsigned int elided[static_cast<int>(StateBind::COUNT)] = {};
+		unsigned int draws = 0;
+		// Instances drawn by those draws, more than draws if any were instanced.
+		unsigned int instances = 0;
+
+		unsigned int GetIssued() const;
+		unsigned int GetElided() const;
+	};
+
+	// Shadows what is bound to a device context and drops binds which wouldn't change anything.
+	// Objects are compared by address without being referenced, so nothing bound may be released while
+	// the cache is in use. Call Invalidate whenever anything else may have bound state to the context.
+	class StateCache
+	{
+	private:
+		static const unsigned int MAX_SHADER_RESOURCES = 8;
+		static const unsigned int MAX_CONSTANT_BUFFERS = 4;
+		static const unsigned int MAX_SAMPLERS = 4;
+		static const unsigned int MAX_VERTEX_BUFFERS = 2;
+		// Offset of a constant buffer bound without one.
+		static const UINT WHOLE_BUFFER = ~0u;
+
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext> _context;
+		// Binds constant buffers at offsets.
+		Microsoft::WRL::ComPtr<ID3D11DeviceContext1> _context1;
+
+		ID3D11InputLayout* _inputLayout;
+		ID3D11VertexShader* _vertexShader;
+		ID3D11PixelShader* _pixelShader;
+		ID3D11Buffer* _vertexBuffers[MAX_VERTEX_BUFFERS];
+		UINT _vertexStrides[MAX_VERTEX_BUFFERS];
+		UINT _vertexOffsets[MAX_VERTEX_BUFFERS];
+		ID3D11Buffer* _indexBuffer;
+		D3D11_PRIMITIVE_TOPOLOGY _topology;
+		ID3D11SamplerState* _psSamplers[MAX_SAMPLERS];
+		ID3D11ShaderResourceView* _psShaderResources[MAX_SHADER_RESOURCES];
+		ID3D11Buffer* _vsConstantBuffers[MAX_CONSTANT_BUFFERS];
+		ID3D11Buffer* _psConstantBuffers[MAX_CONSTANT_BUFFERS];
+		// First constant each buffer is bound at, for both shaders. Every range is bound with the same size.
+		UINT _constantOffsets[MAX_CONSTANT_BUFFERS];
+
+		StateCacheStats _stats;
+
+	public:
+		// Constants bound by SetConstantBuffer with an offset, the size of a 256 byte block which offsets must be aligned to.
+		static const UINT CONSTANT_BLOCK_CONSTANTS = 16;
+		static const UINT CONSTANT_BLOCK_SIZE = CONSTANT_BLOCK_CONSTANTS * 16;
+
+		// Construct a StateCache, which assumes nothing is bound.
+		//	Microsoft::WRL::ComPtr<ID3D11DeviceContext> context: Context to bind state to
+		StateCache(Microsoft::WRL::ComPtr<ID3D11DeviceContext> context);
+		~StateCache() = default;
+
+		StateCache(const StateCache&) = delete;
+
+		// Forget what is bound, so the next bind of everything is issued.
+		void Invalidate();
+
+		void SetInputLayout(ID3D11InputLayout* inputLayout);
+		void SetVertexShader(ID3D11VertexShader* vertexShader);
+		void SetPixelShader(ID3D11PixelShader* pixelShader);
+		void SetVertexBuffer(UINT slot, ID3D11Buffer* buffer, UINT stride, UINT offset);
+		void SetIndexBuffer(ID3D11Buffer* buffer);
+		void SetTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+
+		// Bind pixel shader samplers, only issuing the call if any of them changed.
+		//	UINT slot: First slot to bind
+		//	UINT count: Number of samplers
+		//	ID3D11SamplerState* const* samplers: Samplers to bind
+		void SetPSSamplers(UINT slot, UINT count, ID3D11SamplerState* const* samplers);
+
+		// Bind pixel shader resources, only issuing the call if any of them changed.
+		//	UINT slot: First slot to bind
+		//	UINT count: Number of views
+		//	ID3D11ShaderResourceView* const* views: Views to bind
+		void SetPSShaderResources(UINT slot, UINT count, ID3D11ShaderResourceView* const* views);
+
+		// Bind a constant buffer to a slot of both the vertex and pixel shader.
+		//	UINT slot: Slot to bind to
+		//	ID3D11Buffer* buffer: Buffer to bind
+		void SetConstantBuffer(UINT slot, ID3D11Buffer* buffer);
+
+		// Bind part of a constant buffer to a slot of both the vertex and pixel shader.
+		//	UINT slot: Slot to bind to
+		//	ID3D11Buffer* buffer: Buffer to bind
+		//	UINT firstConstant: Offset in 16 byte constants, a multiple of CONSTANT_BLOCK_CONSTANTS
+		void SetConstantBuffer(UINT slot, ID3D11Buffer* buffer, UINT firstConstant);
+
+		// Count a constant buffer upload, which callers only make when the contents changed.
+		void CountUpload();
+
+		// Count a draw call, so the binds per draw can be reported.
+		//	unsigned int instances: Instances it draws
+		void CountDraw(unsigned int instances = 1);
+
+		const StateCacheStats& GetStats() const;
+		void ResetStats();
+
+	private:
+		// Count a bind and say whether it should be issued.
+		bool Changed(StateBind bind, bool changed);
+	};
+}
@@ -12,50 +12,137 @@ TinyEngine::Texture::Texture(IRenderer* renderer): _renderer(renderer)
 }
 
 TinyEngine::Texture::Texture(IRenderer* renderer, const unsigned char* data, int width, int height) : _renderer(renderer)
+{
+	Load(data, width, height);
+}
+
+TinyEngine::Texture::Texture(IRenderer* renderer, const MipChain& mips) : _renderer(renderer)
+{
+	Load(mips);
+}
+
+TinyEngine::Texture::Texture(IRenderer* renderer, const TextureData& texture) : _renderer(renderer)
+{
+	Load(texture);
+}
+
+bool TinyEngine::Texture::Load(const unsigned char* data, int width, int height)
+{
+	MipChain mips;
+	GenerateMipChain(data, width, height, MipSettings(), mips);
+
+	return Load(mips);
+}
+
+bool TinyEngine::Texture::Load(const MipChain& mips)
+{
+	if (mips.levels.empty() || mips.levels.size() > D3D11_REQ_MIP_LEVELS)
+	{
+		cout << "Can't create a Texture2D with " << mips.levels.size() << " mip levels." << endl;
+
+		return false;
+	}
+
+	// Every level is uploaded as the texture is created, the GPU doesn't filter anything.
+	D3D11_SUBRESOURCE_DATA levels[D3D11_REQ_MIP_LEVELS] = {};
+	for (size_t level = 0; level < mips.levels.size(); level++)
+	{
+		levels[level].pSysMem = mips.GetLevelData(static_cast<unsigned int>(level));
+		levels[level].SysMemPitch = mips.levels[level].width * 4 * sizeof(unsigned char);
+	}
+
+	return CreateResource(DXGI_FORMAT_R8G8B8A8_UNORM, levels, static_cast<UINT>(mips.levels.size()), mips.levels[0].width, mips.levels[0].height);
+}
+
+bool TinyEngine::Texture::Load(const TextureData& texture)
+{
+	if (texture.levels.empty() || texture.levels.size() > D3D11_REQ_MIP_LEVELS)
+	{
+		cout << "Can't create a Texture2D with " << texture.levels.size() << " mip levels." << endl;
+
+		return false;
+	}
+
+	DXGI_FORMAT format;
+	switch (texture.format)
+	{
+	case TextureFormat::BC1:
+		format = DXGI_FORMAT_BC1_UNORM;
+		break;
+	case TextureFormat::BC3:
+		format = DXGI_FORMAT_BC3_UNORM;
+		break;
+	case TextureFormat::BC5:
+		format = DXGI_FORMAT_BC5_UNORM;
+		break;
+	case TextureFormat::BC7:
+		format = DXGI_FORMAT_BC7_UNORM;
+		break;
+	default:
+		format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		break;
+	}
+
+	// Compressed levels are pitched by rows of blocks rather than rows of texels.
+	D3D11_SUBRESOURCE_DATA levels[D3D11_REQ_MIP_LEVELS] = {};
+	for (size_t level = 0; level < texture.levels.size(); level++)
+	{
+		levels[level].pSysMem = texture.GetLevelData(static_cast<unsigned int>(level));
+		levels[level].SysMemPitch = static_cast<UINT>(GetRowPitch(texture.format, texture.levels[level].width));
+	}
+
+	return CreateResource(format, levels, static_cast<UINT>(texture.levels.size()), texture.levels[0].width, texture.levels[0].height);
+}
+
+bool TinyEngine::Texture::CreateResource(DXGI_FORMAT format, const D3D11_SUBRESOURCE_DATA* levels, UINT levelCount, UINT width, UINT height)
 {
 	D3D11_TEXTURE2D_DESC desc = {};
 	desc.Width = width;
 	desc.Height = height;
-	desc.MipLevels = 0;
+	desc.MipLevels = levelCount;
 	desc.ArraySize = 1;
-	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.Format = format;
 	desc.SampleDesc.Count = 1;
 	desc.SampleDesc.Quality = 0;
-	desc.Usage = D3D11_USAGE_DEFAULT;
-	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 	desc.CPUAccessFlags = DXGI_CPU_ACCESS_NONE;
-	desc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS;
+	desc.MiscFlags = 0;
 
 	auto device = _renderer->GetDevice();
-	auto context = _renderer->GetImmediateContext();
 
 	ComPtr<ID3D11Texture2D> texture;
 
-	HRESULT hr = device->CreateTexture2D(&desc, nullptr, &texture);
+	HRESULT hr = device->CreateTexture2D(&desc, levels, &texture);
 	if (FAILED(hr) || !texture)
 	{
 		cout << "Failed to Create Texture2D" << endl;
 
-		return;
+		return false;
 	}
 
-	unsigned int rowPitch = width * 4 * sizeof(unsigned char);
-
-	context->UpdateSubresource(texture.Get(), 0, nullptr, data, rowPitch, 0);
-
 	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
 	srvDesc.Format = desc.Format;
 	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
 	srvDesc.Texture2D.MostDetailedMip = 0;
 	srvDesc.Texture2D.MipLevels = -1;
 
-	hr = device->CreateShaderResourceView(texture.Get(), &srvDesc, &_textureView);
-	if (FAILED(hr) || !_textureView)
+	ComPtr<ID3D11ShaderResourceView> textureView;
+
+	hr = device->CreateShaderResourceView(texture.Get(), &srvDesc, &textureView);
+	if (FAILED(hr) || !textureView)
 	{
 		cout << "Failed to Create view to Texture2D" << endl;
 
-		return;
+		return false;
 	}
 
-	context->GenerateMips(_textureView.Get());
+	_textureView = textureView;
+
+	return true;
+}
+
+void TinyEngine::Texture::SetPlaceholder(const Texture& placeholder)
+{
+	_textureView = placeholder._textureView;
 }
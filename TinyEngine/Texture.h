@@ -4,6 +4,8 @@
 #include <dxgi.h>
 #include <wrl/client.h>
 #include "IRenderer.h"
+#include "MipGenerator.h"
+#include "TextureData.h"
 
 namespace TinyEngine
 {
@@ -19,21 +21,56 @@ namespace TinyEngine
 		//	IRenderer* renderer: Renderer which this Texture belongs to
 		Texture(IRenderer* renderer);
 
-		// Construct a Texture with initial data.
+		// Construct a Texture with initial data. Its mips are generated on the calling thread with the default MipSettings.
 		//	IRenderer* renderer: Renderer which this Texture belongs to
 		//	const unsigned char* data: Texture data. RGBA unorm
 		//  int width: Width of this texture
 		//	int height: Height of this texture
 		Texture(IRenderer* renderer, const unsigned char* data, int width, int height);
 
+		// Construct a Texture from a precomputed mip chain.
+		//	IRenderer* renderer: Renderer which this Texture belongs to
+		//	const MipChain& mips: Every level to upload, from GenerateMipChain
+		Texture(IRenderer* renderer, const MipChain& mips);
+
+		// Construct a Texture from levels which are already in their final format, eg. block compressed by the cooker.
+		//	IRenderer* renderer: Renderer which this Texture belongs to
+		//	const TextureData& texture: Every level to upload, from ReadDds or CompressTexture
+		Texture(IRenderer* renderer, const TextureData& texture);
+
 		Texture(const Texture&) = delete;
 		~Texture() = default;
 
+		// Replace this texture's data, creating a new resource. Its mips are generated on the calling thread.
+		//	const unsigned char* data: Texture data. RGBA unorm
+		//	int width: Width of the data
+		//	int height: Height of the data
+		//	returns: false if the resource couldn't be created, the old data is kept
+		bool Load(const unsigned char* data, int width, int height);
+
+		// Replace this texture's data with a precomputed mip chain, creating a new immutable resource.
+		//	const MipChain& mips: Every level to upload. RGBA unorm
+		//	returns: false if the resource couldn't be created, the old data is kept
+		bool Load(const MipChain& mips);
+
+		// Replace this texture's data with levels in any TextureFormat, uploading them as they are.
+		//	const TextureData& texture: Every level to upload
+		//	returns: false if the resource couldn't be created, the old data is kept
+		bool Load(const TextureData& texture);
+
+		// Show another texture's data until this one is loaded.
+		//	const Texture& placeholder: Texture to share, later changes to it aren't followed
+		void SetPlaceholder(const Texture& placeholder);
+
 #ifdef TINY_ENGINE_EXPOSE_NATIVE
 		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> GetTextureView() const
 		{
 			return _textureView;
 		}
 #endif
+
+	private:
+		// Create an immutable resource and view holding every level, replacing the current view if both succeed.
+		bool CreateResource(DXGI_FORMAT format, const D3D11_SUBRESOURCE_DATA* levels, UINT levelCount, UINT width, UINT height);
 	};
 }
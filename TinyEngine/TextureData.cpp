@@ -0,0 +1,92 @@
+#include "TextureData.h"
+#include <algorithm>
+
+using namespace TinyEngine;
+
+bool TinyEngine::IsBlockCompressed(TextureFormat format)
+{
+	return format != TextureFormat::RGBA8;
+}
+
+unsigned int TinyEngine::GetBlockBytes(TextureFormat format)
+{
+	switch (format)
+	{
+	case TextureFormat::BC1:
+		return 8;
+	case TextureFormat::BC3:
+	case TextureFormat::BC5:
+	case TextureFormat::BC7:
+		return 16;
+	default:
+		return 4;
+	}
+}
+
+size_t TinyEngine::GetRowPitch(TextureFormat format, int width)
+{
+	size_t units = IsBlockCompressed(format) ? (width + 3) / 4 : width;
+	return units * GetBlockBytes(format);
+}
+
+size_t TinyEngine::GetLevelSize(TextureFormat format, int width, int height)
+{
+	size_t rows = IsBlockCompressed(format) ? (height + 3) / 4 : height;
+	return rows * GetRowPitch(format, width);
+}
+
+void TinyEngine::AllocateTextureLevels(TextureData& texture, int width, int height, unsigned int levelCount)
+{
+	texture.data.resize(LayoutTextureLevels(texture, width, height, levelCount));
+}
+
+size_t TinyEngine::LayoutTextureLevels(TextureData& texture, int width, int height, unsigned int levelCount)
+{
+	texture.levels.clear();
+
+	size_t offset = 0;
+	for (unsigned int level = 0; level < levelCount; level++)
+	{
+		int levelWidth = std::max(width >> level, 1);
+		int levelHeight = std::max(height >> level, 1);
+		size_t size = GetLevelSize(texture.format, levelWidth, levelHeight);
+
+		texture.levels.push_back({ levelWidth, levelHeight, offset, size });
+		offset += size;
+	}
+
+	return offset;
+}
+
+void TinyEngine::DropLevels(TextureData& texture, unsigned int firstLevel)
+{
+	if (firstLevel == 0 || firstLevel >= texture.levels.size())
+	{
+		return;
+	}
+
+	size_t offset = texture.levels[firstLevel].offset;
+
+	texture.data.erase(texture.data.begin(), texture.data.begin() + offset);
+	texture.data.shrink_to_fit();
+	texture.levels.erase(texture.levels.begin(), texture.levels.begin() + firstLevel);
+
+	for (auto& level : texture.levels)
+	{
+		level.offset -= offset;
+	}
+}
+
+void TinyEngine::MoveMipChain(MipChain&& mips, TextureData& texture)
+{
+	texture.format = TextureFormat::RGBA8;
+	texture.levels.clear();
+
+	for (const auto& level : mips.levels)
+	{
+		texture.levels.push_back({ level.width, level.height, level.offset, static_cast<size_t>(level.width) * level.height * 4 });
+	}
+
+	texture.data = std::move(mips.data);
+	mips.levels.clear();
+}
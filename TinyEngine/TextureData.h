@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "MipGenerator.h"
+
+namespace TinyEngine
+{
+	enum class TextureFormat
+	{
+		// 8 bits per channel, 4 bytes a texel.
+		RGBA8,
+		// 4x4 blocks of 8 bytes, RGB with no alpha.
+		BC1,
+		// 4x4 blocks of 16 bytes, BC1 color with separate 8 bit interpolated alpha.
+		BC3,
+		// 4x4 blocks of 16 bytes, two independent channels, for normal maps and other two channel data.
+		BC5,
+		// 4x4 blocks of 16 bytes, high quality RGBA.
+		BC7
+	};
+
+	struct TextureLevel
+	{
+		int width;
+		int height;
+		// Where the level starts in TextureData::data and how many bytes it takes.
+		size_t offset;
+		size_t size;
+	};
+
+	// Every level of a texture in a format which can be uploaded as it is, largest first.
+	struct TextureData
+	{
+		TextureFormat format = TextureFormat::RGBA8;
+		std::vector<unsigned char> data;
+		std::vector<TextureLevel> levels;
+
+		const unsigned char* GetLevelData(unsigned int level) const
+		{
+			return data.data() + levels[level].offset;
+		}
+	};
+
+	// Is the format made of 4x4 blocks?
+	bool IsBlockCompressed(TextureFormat format);
+
+	// Bytes in a 4x4 block, or in a texel for uncompressed formats.
+	unsigned int GetBlockBytes(TextureFormat format);
+
+	// Bytes in a row of texels, or a row of blocks for compressed formats.
+	size_t GetRowPitch(TextureFormat format, int width);
+
+	// Bytes in a whole level.
+	size_t GetLevelSize(TextureFormat format, int width, int height);
+
+	// Lay out levels for a texture, sizing data to hold them. Levels halve down to 1x1.
+	//	TextureData& texture: Texture to lay out, its format must already be set
+	//	int width: Width of the first level
+	//	int height: Height of the first level
+	//	unsigned int levelCount: Number of levels
+	void AllocateTextureLevels(TextureData& texture, int width, int height, unsigned int levelCount);
+
+	// Lay out levels like AllocateTextureLevels without touching data.
+	//	returns: Bytes the levels take
+	size_t LayoutTextureLevels(TextureData& texture, int width, int height, unsigned int levelCount);
+
+	// Remove a texture's largest levels, so it starts at firstLevel.
+	//	TextureData& texture: Texture to shrink in place
+	//	unsigned int firstLevel: Level which becomes level 0, nothing happens if it is 0 or past the last level
+	void DropLevels(TextureData& texture, unsigned int firstLevel);
+
+	// Take an RGBA8 mip chain's texels without copying them.
+	//	MipChain&& mips: Chain to take from, left empty
+	//	TextureData& texture: Receives the levels
+	void MoveMipChain(MipChain&& mips, TextureData& texture);
+}
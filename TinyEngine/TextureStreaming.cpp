@@ -0,0 +1,260 @@
+#include "TextureStreaming.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace TinyEngine;
+using namespace DirectX;
+
+TextureDemand TinyEngine::ComputeTextureDemand(float uvDensity, XMFLOAT3 center, float radius,
+	FXMMATRIX world, CXMMATRIX view, CXMMATRIX projection, float screenHeight)
+{
+	TextureDemand demand;
+
+	// Texture coordinates and the radius scale with the largest axis of the world matrix.
+	float scale = std::max(std::max(
+		XMVectorGetX(XMVector3Length(world.r[0])),
+		XMVectorGetX(XMVector3Length(world.r[1]))),
+		XMVectorGetX(XMVector3Length(world.r[2])));
+
+	float worldRadius = radius * scale;
+
+	XMVECTOR centerView = XMVector3TransformCoord(XMVector3TransformCoord(XMLoadFloat3(&center), world), view);
+	if (XMVectorGetZ(centerView) < -worldRadius)
+	{
+		return demand;
+	}
+
+	float centerDistance = XMVectorGetX(XMVector3Length(centerView));
+	float projectionYScale = XMVectorGetY(projection.r[1]);
+
+	// The nearest point of the bounding sphere sets the finest level, so nothing inside it is ever blurry.
+	float distance = std::max(centerDistance - worldRadius, 1e-4f);
+	float worldPerPixel = 2.0f * distance / (projectionYScale * screenHeight);
+	demand.uvPerPixel = uvDensity / std::max(scale, 1e-6f) * worldPerPixel;
+
+	float projectedRadius = centerDistance > worldRadius
+		? worldRadius * projectionYScale / centerDistance * screenHeight * 0.5f
+		: screenHeight;
+	demand.screenArea = XM_PI * projectedRadius * projectedRadius;
+
+	return demand;
+}
+
+unsigned int TinyEngine::GetAlwaysResidentLevel(const TextureData& layout)
+{
+	unsigned int level = 0;
+	while (level + 1 < layout.levels.size()
+		&& std::max(layout.levels[level].width, layout.levels[level].height) > TextureResidency::ALWAYS_RESIDENT_SIZE)
+	{
+		level++;
+	}
+
+	// Block compressed textures must start at a level of whole blocks. Every level finer than one which is
+	// also is, so the tail moves up to the first that is and any target level can start the texture.
+	if (IsBlockCompressed(layout.format))
+	{
+		while (level > 0 && (layout.levels[level].width % 4 != 0 || layout.levels[level].height % 4 != 0))
+		{
+			level--;
+		}
+	}
+
+	return level;
+}
+
+TextureResidency::TextureResidency(uint64_t budget) : _budget(budget), _levelsLoaded(0), _levelsEvicted(0)
+{
+}
+
+unsigned int TextureResidency::Add(const TextureData& layout)
+{
+	Entry entry;
+	entry.size = layout.levels.empty() ? 1 : std::max(layout.levels[0].width, layout.levels[0].height);
+	entry.tailLevel = GetAlwaysResidentLevel(layout);
+	for (const auto& level : layout.levels)
+	{
+		entry.levelBytes.push_back(level.size);
+	}
+
+	entry.wantedLevel = entry.tailLevel;
+	entry.targetLevel = entry.tailLevel;
+	entry.importance = 0.0f;
+	entry.requested = false;
+	entry.frameWantedLevel = entry.tailLevel;
+	entry.frameScreenArea = 0.0f;
+
+	_entries.push_back(std::move(entry));
+
+	return static_cast<unsigned int>(_entries.size() - 1);
+}
+
+void TextureResidency::Request(unsigned int id, const TextureDemand& demand)
+{
+	auto& entry = _entries[id];
+
+	if (demand.screenArea <= 0.0f)
+	{
+		return;
+	}
+
+	// One texel per pixel, rounding towards the finer level.
+	float texelsPerPixel = demand.uvPerPixel * entry.size;
+	unsigned int level = texelsPerPixel > 1.0f ? static_cast<unsigned int>(log2f(texelsPerPixel)) : 0;
+
+	entry.requested = true;
+	entry.frameWantedLevel = std::min(entry.frameWantedLevel, std::min(level, entry.tailLevel));
+	entry.frameScreenArea = std::max(entry.frameScreenArea, demand.screenArea);
+}
+
+void TextureResidency::Update()
+{
+	uint64_t used = 0;
+	_candidates.clear();
+
+	for (unsigned int i = 0; i < _entries.size(); i++)
+	{
+		auto& entry = _entries[i];
+
+		if (entry.requested)
+		{
+			entry.wantedLevel = entry.frameWantedLevel;
+			entry.importance = std::max(entry.frameScreenArea, entry.importance * IMPORTANCE_DECAY);
+		}
+		else
+		{
+			entry.importance *= IMPORTANCE_DECAY;
+		}
+
+		entry.requested = false;
+		entry.frameWantedLevel = entry.tailLevel;
+		entry.frameScreenArea = 0.0f;
+
+		used += GetBytesFrom(i, entry.tailLevel);
+
+		// Each step coarser than wanted serves a quarter of the texels per pixel, so it matters four times as much.
+		// Targeted levels finer than wanted aren't needed but are kept while there is room.
+		unsigned int finest = std::min(entry.wantedLevel, entry.targetLevel);
+		for (unsigned int level = finest; level < entry.tailLevel; level++)
+		{
+			float priority = entry.importance * powf(4.0f, static_cast<float>(level) - entry.wantedLevel);
+			float bonus = level >= entry.targetLevel ? TARGETED_BONUS : 1.0f;
+			_candidates.push_back({ priority * bonus, i, level, level >= entry.wantedLevel });
+		}
+	}
+
+	// Needed levels before kept ones, then coarser levels first on ties so every texture's levels are reached in order.
+	std::sort(_candidates.begin(), _candidates.end(), [](const Candidate& a, const Candidate& b)
+	{
+		if (a.needed != b.needed)
+		{
+			return a.needed;
+		}
+
+		return a.priority != b.priority ? a.priority > b.priority : a.level > b.level;
+	});
+
+	// Start from the tails and add levels in order of priority while they fit. Once a texture's next level
+	// doesn't fit, none of its finer levels are added either.
+	std::vector<unsigned int> targets(_entries.size());
+	std::vector<bool> closed(_entries.size(), false);
+	for (unsigned int i = 0; i < _entries.size(); i++)
+	{
+		targets[i] = _entries[i].tailLevel;
+	}
+
+	for (const auto& candidate : _candidates)
+	{
+		auto& target = targets[candidate.entry];
+		if (closed[candidate.entry] || candidate.level + 1 != target)
+		{
+			continue;
+		}
+
+		uint64_t bytes = _entries[candidate.entry].levelBytes[candidate.level];
+		if (used + bytes > _budget)
+		{
+			closed[candidate.entry] = true;
+			continue;
+		}
+
+		used += bytes;
+		target = candidate.level;
+	}
+
+	for (unsigned int i = 0; i < _entries.size(); i++)
+	{
+		auto& entry = _entries[i];
+
+		if (targets[i] < entry.targetLevel)
+		{
+			_levelsLoaded += entry.targetLevel - targets[i];
+		}
+		else
+		{
+			_levelsEvicted += targets[i] - entry.targetLevel;
+		}
+
+		entry.targetLevel = targets[i];
+	}
+}
+
+unsigned int TextureResidency::GetTargetLevel(unsigned int id) const
+{
+	return _entries[id].targetLevel;
+}
+
+unsigned int TextureResidency::GetWantedLevel(unsigned int id) const
+{
+	return _entries[id].wantedLevel;
+}
+
+unsigned int TextureResidency::GetTailLevel(unsigned int id) const
+{
+	return _entries[id].tailLevel;
+}
+
+uint64_t TextureResidency::GetBytesFrom(unsigned int id, unsigned int level) const
+{
+	const auto& levelBytes = _entries[id].levelBytes;
+
+	uint64_t bytes = 0;
+	for (size_t i = level; i < levelBytes.size(); i++)
+	{
+		bytes += levelBytes[i];
+	}
+
+	return bytes;
+}
+
+uint64_t TextureResidency::GetBudget() const
+{
+	return _budget;
+}
+
+void TextureResidency::SetBudget(uint64_t budget)
+{
+	_budget = budget;
+}
+
+TextureResidencyStats TextureResidency::GetStats() const
+{
+	TextureResidencyStats stats;
+	stats.textures = static_cast<unsigned int>(_entries.size());
+	stats.levelsLoaded = _levelsLoaded;
+	stats.levelsEvicted = _levelsEvicted;
+
+	for (unsigned int i = 0; i < _entries.size(); i++)
+	{
+		const auto& entry = _entries[i];
+
+		stats.targetBytes += GetBytesFrom(i, entry.targetLevel);
+		stats.wantedBytes += GetBytesFrom(i, entry.wantedLevel);
+		if (entry.targetLevel > entry.wantedLevel)
+		{
+			stats.missingLevels += entry.targetLevel - entry.wantedLevel;
+		}
+	}
+
+	return stats;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+#include "TextureData.h"
+
+namespace TinyEngine
+{
+	// How finely a mesh's textures are seen this frame, independent of the textures' sizes.
+	struct TextureDemand
+	{
+		// Texture coordinate units covered by one pixel at the nearest point of the mesh. A texture wants
+		// the level with about one texel per pixel, log2(uvPerPixel * its size in texels).
+		float uvPerPixel = FLT_MAX;
+		// Pixels covered by the mesh's bounding sphere, how much its textures matter.
+		float screenArea = 0.0f;
+	};
+
+	// Estimate how finely a mesh's textures are seen, on the CPU from its bounds and texture coordinate density.
+	// A mesh entirely behind the camera has no demand.
+	//	float uvDensity: Texture coordinate units per object space unit, see ComputeUvDensity
+	//	DirectX::XMFLOAT3 center: Object space centre of the mesh's bounding sphere
+	//	float radius: Object space radius of the mesh's bounding sphere
+	//	DirectX::FXMMATRIX world: World matrix of the mesh
+	//	DirectX::CXMMATRIX view: View matrix of the camera
+	//	DirectX::CXMMATRIX projection: Projection matrix of the camera
+	//	float screenHeight: Height of the viewport in pixels
+	TextureDemand ComputeTextureDemand(float uvDensity, DirectX::XMFLOAT3 center, float radius,
+		DirectX::FXMMATRIX world, DirectX::CXMMATRIX view, DirectX::CXMMATRIX projection, float screenHeight);
+
+	// First of the levels which stay resident however little a texture is needed, see TextureResidency::ALWAYS_RESIDENT_SIZE.
+	// Block compressed textures keep finer levels resident when the smaller ones aren't multiples of 4 texels,
+	// as a texture can't be created starting from them.
+	//	const TextureData& layout: Format and levels of the whole texture, its data isn't used
+	unsigned int GetAlwaysResidentLevel(const TextureData& layout);
+
+	struct TextureResidencyStats
+	{
+		unsigned int textures = 0;
+		// Bytes of every texture's target levels, always within the budget unless the tails alone exceed it.
+		uint64_t targetBytes = 0;
+		// Bytes if every texture had the levels it wants.
+		uint64_t wantedBytes = 0;
+		// Levels short of what is wanted, summed over the textures.
+		unsigned int missingLevels = 0;
+		// Levels added to and dropped from targets over every update.
+		unsigned int levelsLoaded = 0;
+		unsigned int levelsEvicted = 0;
+	};
+
+	// Decides which levels of streamed textures should be resident, without loading anything itself.
+	// Each frame textures are requested with the demand of the meshes using them, then Update picks a
+	// target level for each: the finest level it wants if the budget allows. Otherwise levels are
+	// ranked by the screen area they serve, a level coarser than wanted counting four times as much
+	// per step since it is needed before the finer ones, and the least needed levels are dropped.
+	// Levels finer than wanted are kept while there is room, and textures which are no longer requested
+	// lose priority as their last demand fades. The smallest levels are always resident.
+	class TextureResidency
+	{
+	private:
+		struct Entry
+		{
+			std::vector<uint64_t> levelBytes;
+			// Larger side of level 0 in texels.
+			int size;
+			// Levels from here on are always resident.
+			unsigned int tailLevel;
+			unsigned int wantedLevel;
+			unsigned int targetLevel;
+			float importance;
+
+			// Demand since the last update.
+			bool requested;
+			unsigned int frameWantedLevel;
+			float frameScreenArea;
+		};
+
+		struct Candidate
+		{
+			float priority;
+			unsigned int entry;
+			unsigned int level;
+			// Is the level at or coarser than the one wanted? Otherwise it's only kept if there is room.
+			bool needed;
+		};
+
+		std::vector<Entry> _entries;
+		std::vector<Candidate> _candidates;
+		uint64_t _budget;
+		unsigned int _levelsLoaded;
+		unsigned int _levelsEvicted;
+
+	public:
+		// Levels whose larger side is at most this many texels are always resident.
+		static const int ALWAYS_RESIDENT_SIZE = 64;
+		// Fraction of a texture's importance kept by each update it isn't requested in.
+		static constexpr float IMPORTANCE_DECAY = 0.95f;
+		// Weight of levels which are already targeted, so textures don't swap levels back and forth.
+		static constexpr float TARGETED_BONUS = 1.5f;
+
+		// Construct a TextureResidency.
+		//	uint64_t budget: Bytes the targeted levels of every texture are kept under
+		TextureResidency(uint64_t budget);
+		~TextureResidency() = default;
+
+		TextureResidency(const TextureResidency&) = delete;
+
+		// Add a texture, targeting only its always resident levels until it is requested.
+		//	const TextureData& layout: Format and levels of the whole texture, its data isn't used
+		//	returns: Id of the texture
+		unsigned int Add(const TextureData& layout);
+
+		// Report that a texture is used this frame. Several requests keep the finest level and largest area.
+		//	unsigned int id: Texture from Add
+		//	const TextureDemand& demand: Demand of a mesh using the texture
+		void Request(unsigned int id, const TextureDemand& demand);
+
+		// Pick every texture's target level from the requests since the last update.
+		void Update();
+
+		// Finest level a texture should have resident, every coarser level should be too.
+		unsigned int GetTargetLevel(unsigned int id) const;
+
+		// Finest level a texture wants, the last time it was requested.
+		unsigned int GetWantedLevel(unsigned int id) const;
+
+		// First of a texture's always resident levels.
+		unsigned int GetTailLevel(unsigned int id) const;
+
+		// Bytes of a texture's levels from level on.
+		uint64_t GetBytesFrom(unsigned int id, unsigned int level) const;
+
+		uint64_t GetBudget() const;
+		void SetBudget(uint64_t budget);
+
+		TextureResidencyStats GetStats() const;
+	};
+}
@@ -0,0 +1,128 @@
+#include "ThreadPool.h"
+#include <atomic>
+#include <memory>
+
+using namespace TinyEngine;
+
+ThreadPool::ThreadPool(unsigned int threadCount) : _stopping(false)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+	}
+
+	if (threadCount == 0)
+	{
+		threadCount = 1;
+	}
+
+	for (unsigned int i = 0; i < threadCount; i++)
+	{
+		_threads.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+
+	_jobAdded.notify_all();
+
+	for (auto& thread : _threads)
+	{
+		thread.join();
+	}
+}
+
+unsigned int ThreadPool::GetThreadCount() const
+{
+	return static_cast<unsigned int>(_threads.size());
+}
+
+void ThreadPool::Enqueue(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobs.push_back(std::move(job));
+	}
+
+	_jobAdded.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	if (count == 1)
+	{
+		body(0);
+		return;
+	}
+
+	// Shared with the helper jobs, which may only get to run after every index has been taken.
+	struct State
+	{
+		std::atomic<size_t> next = 0;
+		std::atomic<size_t> finished = 0;
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+
+	auto state = std::make_shared<State>();
+	const auto* bodyPtr = &body;
+
+	auto run = [state, bodyPtr, count]()
+	{
+		size_t index;
+		while ((index = state->next++) < count)
+		{
+			(*bodyPtr)(index);
+
+			if (++state->finished == count)
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->done.notify_all();
+			}
+		}
+	};
+
+	size_t helpers = count - 1 < _threads.size() ? count - 1 : _threads.size();
+	for (size_t i = 0; i < helpers; i++)
+	{
+		Enqueue(run);
+	}
+
+	run();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->done.wait(lock, [&state, count]() { return state->finished == count; });
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_jobAdded.wait(lock, [this]() { return _stopping || !_jobs.empty(); });
+
+			if (_jobs.empty())
+			{
+				return;
+			}
+
+			job = std::move(_jobs.front());
+			_jobs.pop_front();
+		}
+
+		job();
+	}
+}
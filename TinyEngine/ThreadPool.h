@@ -0,0 +1,50 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace TinyEngine
+{
+	// A fixed set of worker threads which run queued jobs.
+	class ThreadPool
+	{
+	private:
+		std::vector<std::thread> _threads;
+
+		std::deque<std::function<void()>> _jobs;
+		std::mutex _mutex;
+		std::condition_variable _jobAdded;
+
+		bool _stopping;
+
+	public:
+		// Construct a ThreadPool and start its workers.
+		//	unsigned int threadCount: Number of worker threads. 0 uses one per hardware thread
+		ThreadPool(unsigned int threadCount = 0);
+
+		// Finishes any queued jobs then joins the workers.
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+
+		// Get the number of worker threads.
+		unsigned int GetThreadCount() const;
+
+		// Queue a job to be run on a worker thread.
+		//	std::function<void()> job: Job to run
+		void Enqueue(std::function<void()> job);
+
+		// Run body once for every index in [0, count) across the workers and the calling thread.
+		// Returns once every call has finished.
+		//	size_t count: Number of indices
+		//	const std::function<void(size_t)>& body: Called with each index
+		void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+	private:
+		void WorkerLoop();
+	};
+}
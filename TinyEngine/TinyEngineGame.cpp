@@ -13,6 +13,9 @@ TinyEngineGame::TinyEngineGame(int width, int height, const char* title) :
 {
 	_window = new Window(width, height, title);
 	_renderer = new Renderer(width, height, *_window);
+	_threadPool = new ThreadPool();
+	_cache = new DerivedDataCache(DERIVED_DATA_DIRECTORY);
+	_assets = new AssetManager(_renderer, _threadPool, _cache);
 
 	_window->AddObserver(*this);
 	_window->AddObserver(*_renderer);
@@ -20,8 +23,30 @@ TinyEngineGame::TinyEngineGame(int width, int height, const char* title) :
 	_input = &_nullInput;
 }
 
+TinyEngineGame::TinyEngineGame(int width, int height) :
+	_width(width), _height(height), _input(nullptr), _isRunning(false)
+{
+	_window = nullptr;
+	_renderer = new Renderer(width, height);
+	_threadPool = new ThreadPool();
+	_cache = new DerivedDataCache(DERIVED_DATA_DIRECTORY);
+	_assets = new AssetManager(_renderer, _threadPool, _cache);
+
+	_input = &_nullInput;
+}
+
 TinyEngineGame::~TinyEngineGame()
 {
+	// Assets are decoded by the thread pool and uploaded to the renderer, so they go first.
+	delete _assets;
+	_assets = nullptr;
+
+	delete _cache;
+	_cache = nullptr;
+
+	delete _threadPool;
+	_threadPool = nullptr;
+
 	delete _window;
 	_window = nullptr;
 
@@ -40,7 +65,10 @@ void TinyEngineGame::Run()
 
 	while (_isRunning)
 	{
-		_window->PeekMessages();
+		if (_window)
+		{
+			_window->PeekMessages();
+		}
 
 		auto thisTime = high_resolution_clock::now();
 
@@ -52,27 +80,81 @@ void TinyEngineGame::Run()
 			continue;
 		}
 
-		_renderer->Clear();
+		RunFrame(elapsed, delta, nullptr);
+
+		lastTime = thisTime;
+	}
+}
 
-		_input->OnUpdate();
+FrameTimings TinyEngineGame::RunFrames(unsigned int frames, float delta)
+{
+	FrameTimings timings;
 
-		OnUpdate(elapsed, delta);
+	_isRunning = true;
 
-		lastTime = thisTime;
+	_startTime = high_resolution_clock::now();
+
+	OnInit();
+
+	for (unsigned int i = 0; i < frames && _isRunning; i++)
+	{
+		if (_window)
+		{
+			_window->PeekMessages();
+		}
 
-		_renderer->SwapBuffers();
+		RunFrame(static_cast<float>(i + 1) * delta, delta, &timings);
+	}
+
+	return timings;
+}
+
+void TinyEngineGame::RunFrame(float elapsed, float delta, FrameTimings* timings)
+{
+	auto start = high_resolution_clock::now();
+
+	_assets->Update();
+
+	auto uploaded = high_resolution_clock::now();
+
+	_renderer->Clear();
+
+	auto cleared = high_resolution_clock::now();
+
+	_input->OnUpdate();
+
+	OnUpdate(elapsed, delta);
+
+	auto updated = high_resolution_clock::now();
+
+	// SwapBuffers would submit anyway, submitting first times it apart from presenting.
+	_renderer->Submit();
+
+	auto submitted = high_resolution_clock::now();
+
+	_renderer->SwapBuffers();
+
+	if (timings)
+	{
+		auto presented = high_resolution_clock::now();
+
+		auto seconds = [](high_resolution_clock::duration time) { return duration_cast<duration<float>>(time).count(); };
+		timings->AddFrame(seconds(uploaded - start) + seconds(updated - cleared), seconds(cleared - uploaded) + seconds(submitted - updated),
+			seconds(presented - submitted), seconds(presented - start));
 	}
 }
 
 void TinyEngineGame::SetInputHandler(BaseInput* input)
 {
-	if (_input) {
+	if (_input && _window) {
 		_window->RemoveObserver(*_input);
 	}
 
 	_input = input;
 
-	_window->AddObserver(*_input);
+	if (_window) {
+		_window->AddObserver(*_input);
+	}
 }
 
 int TinyEngineGame::GetWidth() const
@@ -119,12 +201,22 @@ Window* TinyEngine::TinyEngineGame::GetWindow() const
 	return _window;
 }
 
+ThreadPool* TinyEngine::TinyEngineGame::GetThreadPool() const
+{
+	return _threadPool;
+}
+
+AssetManager* TinyEngine::TinyEngineGame::GetAssets() const
+{
+	return _assets;
+}
+
 BaseInput* TinyEngine::TinyEngineGame::GetInput() const
 {
 	return _input;
 }
 
-void TinyEngine::TinyEngineGame::OnResize(int width, int height)
+void TinyEngine::TinyEngineGame::OnResize(int, int)
 {
 
 }
@@ -3,6 +3,10 @@
 #include "Renderer.h"
 #include "Window.h"
 #include "BaseInput.h"
+#include "ThreadPool.h"
+#include "AssetManager.h"
+#include "DerivedDataCache.h"
+#include "FrameTimings.h"
 #include <chrono>
 
 namespace TinyEngine
@@ -24,17 +28,29 @@ namespace TinyEngine
 		Window* _window;
 		BaseInput* _input;
 		Renderer* _renderer;
+		ThreadPool* _threadPool;
+		DerivedDataCache* _cache;
+		AssetManager* _assets;
 
 		BaseInput _nullInput;
 
 		std::chrono::high_resolution_clock::time_point _startTime;
 
 	public:
+		// Directory, relative to the working directory, which decoded and imported assets are cached in.
+		static constexpr const char* DERIVED_DATA_DIRECTORY = "DerivedDataCache";
+
 		// Construct a new Game.
 		//	int width: Game window's initial width
 		//	int height: Game window's initial height
 		//	const char* title: Game window's title text
 		TinyEngineGame(int width, int height, const char* title);
+
+		// Construct a new Game with no window, drawing to a texture, for running headless with RunFrames.
+		//	int width: Width drawn to
+		//	int height: Height drawn to
+		TinyEngineGame(int width, int height);
+
 		~TinyEngineGame();
 
 		TinyEngineGame(const TinyEngineGame& game) = delete;
@@ -48,14 +64,27 @@ namespace TinyEngine
 		// Run the game. Starts the game loop.
 		void Run();
 
+		// Run the game for a number of frames as fast as it can, each a fixed time step after the last, instead of
+		// following the clock. Frames are the same as Run's, timing each phase, so the same frames always update
+		// the game the same way.
+		//	unsigned int frames: Number of frames to run, fewer if the game stops running first
+		//	float delta: Seconds each frame advances the game by
+		//	returns: Time each phase of every frame took
+		FrameTimings RunFrames(unsigned int frames, float delta);
+
+		// Get the game's assets. Decoded assets are uploaded at the start of every frame.
+		AssetManager* GetAssets() const;
+
 	protected:
 		// Set the input handler and configure internal components.
 		void SetInputHandler(BaseInput* input);
 
 		// Get the game's Renderer.
 		Renderer* GetRenderer() const;
-		// Get the game's Window.
+		// Get the game's Window, nullptr if it is headless.
 		Window* GetWindow() const;
+		// Get the game's worker threads, used for loading and other parallel work.
+		ThreadPool* GetThreadPool() const;
 
 		// Get the current input handler.
 		virtual BaseInput* GetInput() const;
@@ -72,6 +101,10 @@ namespace TinyEngine
 		virtual void OnNotify(const Event& event) override;
 
 	private:
+		// Run one frame.
+		//	FrameTimings* timings: Receives the time each phase took, nullptr to not time it
+		void RunFrame(float elapsed, float delta, FrameTimings* timings);
+
 		void OnResize(int width, int height);
 	};
 }
@@ -0,0 +1,386 @@
+#include "VertexPacked.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define TINY_ENGINE_SSE2
+#include <emmintrin.h>
+#endif
+
+using namespace TinyEngine;
+using namespace DirectX;
+
+namespace
+{
+	const float POSITION_RANGE = 65535.0f;
+	const float NORMAL_RANGE = 32767.0f;
+	// Keeps zero length normals from dividing by zero, they encode as +z.
+	const float MIN_NORMAL_LENGTH = 1e-20f;
+
+	inline uint32_t FloatBits(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(bits));
+		return bits;
+	}
+
+	inline float BitsFloat(uint32_t bits)
+	{
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	// Multiplier taking a position relative to the quantization offset to 0 - POSITION_RANGE.
+	inline float InverseScale(float scale)
+	{
+		return scale > 0.0f ? POSITION_RANGE / scale : 0.0f;
+	}
+
+	inline uint16_t QuantizePosition(float value, float offset, float inverseScale)
+	{
+		float q = std::min(std::max((value - offset) * inverseScale, 0.0f), POSITION_RANGE);
+		return static_cast<uint16_t>(lrintf(q));
+	}
+
+	inline int16_t QuantizeSnorm(float value)
+	{
+		float q = std::min(std::max(value, -1.0f), 1.0f) * NORMAL_RANGE;
+		return static_cast<int16_t>(lrintf(q));
+	}
+
+	// Project a normal onto the octahedron and fold the lower half over the upper.
+	inline void EncodeOctahedral(XMFLOAT3 normal, float& u, float& v)
+	{
+		float length = std::max(fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z), MIN_NORMAL_LENGTH);
+
+		float x = normal.x / length;
+		float y = normal.y / length;
+		float z = normal.z / length;
+
+		if (z < 0.0f)
+		{
+			u = (1.0f - fabsf(y)) * copysignf(1.0f, x);
+			v = (1.0f - fabsf(x)) * copysignf(1.0f, y);
+		}
+		else
+		{
+			u = x;
+			v = y;
+		}
+	}
+
+	inline XMFLOAT3 DecodeOctahedral(float u, float v)
+	{
+		XMFLOAT3 n(u, v, 1.0f - fabsf(u) - fabsf(v));
+
+		float t = std::max(-n.z, 0.0f);
+		n.x += n.x >= 0.0f ? -t : t;
+		n.y += n.y >= 0.0f ? -t : t;
+
+		float length = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+		return XMFLOAT3(n.x / length, n.y / length, n.z / length);
+	}
+
+#ifdef TINY_ENGINE_SSE2
+	// Four floats to halves, in the low 16 bits of each lane. Matches FloatToHalf.
+	inline __m128i FloatToHalf4(__m128 value)
+	{
+		const __m128i signMask = _mm_set1_epi32(0x80000000);
+		const __m128i halfMax = _mm_set1_epi32((127 + 16) << 23);
+		const __m128i minNormal = _mm_set1_epi32((127 - 14) << 23);
+		const __m128i subnormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+		const __m128i normalBias = _mm_set1_epi32(0xfff - ((127 - 15) << 23));
+
+		__m128i bits = _mm_castps_si128(value);
+		__m128i sign = _mm_and_si128(bits, signMask);
+		__m128i absolute = _mm_xor_si128(bits, sign);
+
+		__m128i isNan = _mm_castps_si128(_mm_cmpunord_ps(_mm_castsi128_ps(absolute), _mm_castsi128_ps(absolute)));
+		__m128i isRegular = _mm_cmpgt_epi32(halfMax, absolute);
+		__m128i special = _mm_or_si128(_mm_and_si128(isNan, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7c00));
+
+		__m128i isSubnormal = _mm_cmpgt_epi32(minNormal, absolute);
+		__m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(absolute), _mm_castsi128_ps(subnormalMagic))), subnormalMagic);
+
+		__m128i mantissaOdd = _mm_srai_epi32(_mm_slli_epi32(absolute, 31 - 13), 31);
+		__m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absolute, normalBias), mantissaOdd), 13);
+
+		__m128i finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+		__m128i result = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, special));
+
+		return _mm_or_si128(result, _mm_srli_epi32(sign, 16));
+	}
+
+	// Narrow four 16 bit values held in 32 bit lanes to the low four words.
+	inline __m128i Narrow16(__m128i value)
+	{
+		// Sign extend so the saturating pack keeps the bit pattern.
+		value = _mm_srai_epi32(_mm_slli_epi32(value, 16), 16);
+		return _mm_packs_epi32(value, value);
+	}
+
+	inline __m128i QuantizePosition4(__m128 value, float offset, float inverseScale)
+	{
+		__m128 q = _mm_mul_ps(_mm_sub_ps(value, _mm_set1_ps(offset)), _mm_set1_ps(inverseScale));
+		q = _mm_min_ps(_mm_max_ps(q, _mm_setzero_ps()), _mm_set1_ps(POSITION_RANGE));
+		return Narrow16(_mm_cvtps_epi32(q));
+	}
+
+	inline __m128i QuantizeSnorm4(__m128 value)
+	{
+		__m128 q = _mm_min_ps(_mm_max_ps(value, _mm_set1_ps(-1.0f)), _mm_set1_ps(1.0f));
+		return Narrow16(_mm_cvtps_epi32(_mm_mul_ps(q, _mm_set1_ps(NORMAL_RANGE))));
+	}
+
+	inline void EncodeOctahedral4(__m128 x, __m128 y, __m128 z, __m128& u, __m128& v)
+	{
+		const __m128 signMask = _mm_set1_ps(-0.0f);
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		__m128 length = _mm_add_ps(_mm_add_ps(_mm_andnot_ps(signMask, x), _mm_andnot_ps(signMask, y)), _mm_andnot_ps(signMask, z));
+		length = _mm_max_ps(length, _mm_set1_ps(MIN_NORMAL_LENGTH));
+
+		x = _mm_div_ps(x, length);
+		y = _mm_div_ps(y, length);
+		z = _mm_div_ps(z, length);
+
+		__m128 foldedU = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, y)), _mm_or_ps(_mm_and_ps(x, signMask), one));
+		__m128 foldedV = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, x)), _mm_or_ps(_mm_and_ps(y, signMask), one));
+
+		__m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+		u = _mm_or_ps(_mm_and_ps(lower, foldedU), _mm_andnot_ps(lower, x));
+		v = _mm_or_ps(_mm_and_ps(lower, foldedV), _mm_andnot_ps(lower, y));
+	}
+
+	// Pack four vertices. VertexStandard is two rows of four floats, transposing each
+	// half of four vertices gives every component in its own register.
+	inline void PackVertices4(const VertexStandard* in, const VertexQuantization& quantization, const float* inverseScale, VertexPacked* out)
+	{
+		static_assert(sizeof(VertexStandard) == 8 * sizeof(float), "VertexStandard is expected to be 8 tightly packed floats.");
+		static_assert(sizeof(VertexPacked) == 16, "VertexPacked is expected to be 16 bytes.");
+
+		const float* source = &in->position.x;
+
+		__m128 px = _mm_loadu_ps(source + 0);
+		__m128 py = _mm_loadu_ps(source + 8);
+		__m128 pz = _mm_loadu_ps(source + 16);
+		__m128 tu = _mm_loadu_ps(source + 24);
+		_MM_TRANSPOSE4_PS(px, py, pz, tu);
+
+		__m128 tv = _mm_loadu_ps(source + 4);
+		__m128 nx = _mm_loadu_ps(source + 12);
+		__m128 ny = _mm_loadu_ps(source + 20);
+		__m128 nz = _mm_loadu_ps(source + 28);
+		_MM_TRANSPOSE4_PS(tv, nx, ny, nz);
+
+		__m128i qx = QuantizePosition4(px, quantization.offset.x, inverseScale[0]);
+		__m128i qy = QuantizePosition4(py, quantization.offset.y, inverseScale[1]);
+		__m128i qz = QuantizePosition4(pz, quantization.offset.z, inverseScale[2]);
+
+		__m128 octU, octV;
+		EncodeOctahedral4(nx, ny, nz, octU, octV);
+		__m128i qu = QuantizeSnorm4(octU);
+		__m128i qv = QuantizeSnorm4(octV);
+
+		__m128i hu = Narrow16(FloatToHalf4(tu));
+		__m128i hv = Narrow16(FloatToHalf4(tv));
+
+		// Interleave to px py pz 0 nu nv tu tv per vertex.
+		__m128i positionXY = _mm_unpacklo_epi16(qx, qy);
+		__m128i positionZW = _mm_unpacklo_epi16(qz, _mm_setzero_si128());
+		__m128i position01 = _mm_unpacklo_epi32(positionXY, positionZW);
+		__m128i position23 = _mm_unpackhi_epi32(positionXY, positionZW);
+
+		__m128i normal = _mm_unpacklo_epi16(qu, qv);
+		__m128i texcoord = _mm_unpacklo_epi16(hu, hv);
+		__m128i attributes01 = _mm_unpacklo_epi32(normal, texcoord);
+		__m128i attributes23 = _mm_unpackhi_epi32(normal, texcoord);
+
+		auto* destination = reinterpret_cast<__m128i*>(out);
+		_mm_storeu_si128(destination + 0, _mm_unpacklo_epi64(position01, attributes01));
+		_mm_storeu_si128(destination + 1, _mm_unpackhi_epi64(position01, attributes01));
+		_mm_storeu_si128(destination + 2, _mm_unpacklo_epi64(position23, attributes23));
+		_mm_storeu_si128(destination + 3, _mm_unpackhi_epi64(position23, attributes23));
+	}
+#endif
+
+	inline void PackVertex(const VertexStandard& in, const VertexQuantization& quantization, const float* inverseScale, VertexPacked& out)
+	{
+		out.position[0] = QuantizePosition(in.position.x, quantization.offset.x, inverseScale[0]);
+		out.position[1] = QuantizePosition(in.position.y, quantization.offset.y, inverseScale[1]);
+		out.position[2] = QuantizePosition(in.position.z, quantization.offset.z, inverseScale[2]);
+		out.position[3] = 0;
+
+		float u, v;
+		EncodeOctahedral(in.normal, u, v);
+		out.normal[0] = QuantizeSnorm(u);
+		out.normal[1] = QuantizeSnorm(v);
+
+		out.texcoord[0] = FloatToHalf(in.texcoord.x);
+		out.texcoord[1] = FloatToHalf(in.texcoord.y);
+	}
+}
+
+uint16_t TinyEngine::FloatToHalf(float value)
+{
+	uint32_t bits = FloatBits(value);
+	uint32_t sign = bits & 0x80000000u;
+	bits ^= sign;
+
+	uint32_t half;
+	if (bits >= (127 + 16) << 23)
+	{
+		// Too large for a half, or already inf or NaN.
+		half = bits > 0x7f800000u ? 0x7e00 : 0x7c00;
+	}
+	else if (bits < (127 - 14) << 23)
+	{
+		// Subnormal, let float addition do the rounding.
+		const uint32_t magic = ((127 - 15) + (23 - 10) + 1) << 23;
+		half = FloatBits(BitsFloat(bits) + BitsFloat(magic)) - magic;
+	}
+	else
+	{
+		uint32_t mantissaOdd = (bits >> 13) & 1;
+		bits += 0xfff - ((127 - 15) << 23);
+		bits += mantissaOdd;
+		half = bits >> 13;
+	}
+
+	return static_cast<uint16_t>(half | (sign >> 16));
+}
+
+float TinyEngine::HalfToFloat(uint16_t value)
+{
+	uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x3ff;
+
+	if (exponent == 0)
+	{
+		// Zero or subnormal.
+		return BitsFloat(sign | FloatBits(static_cast<float>(mantissa) * (1.0f / 16777216.0f)));
+	}
+
+	if (exponent == 0x1f)
+	{
+		return BitsFloat(sign | 0x7f800000u | (mantissa << 13));
+	}
+
+	return BitsFloat(sign | ((exponent + 127 - 15) << 23) | (mantissa << 13));
+}
+
+VertexQuantization TinyEngine::ComputeVertexQuantization(const VertexStandard* vertices, unsigned int count)
+{
+	VertexQuantization quantization;
+	if (count == 0)
+	{
+		return quantization;
+	}
+
+	XMFLOAT3 minimum(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 maximum(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const auto& p = vertices[i].position;
+		minimum = XMFLOAT3(std::min(minimum.x, p.x), std::min(minimum.y, p.y), std::min(minimum.z, p.z));
+		maximum = XMFLOAT3(std::max(maximum.x, p.x), std::max(maximum.y, p.y), std::max(maximum.z, p.z));
+	}
+
+	quantization.offset = minimum;
+	quantization.scale = XMFLOAT3(maximum.x - minimum.x, maximum.y - minimum.y, maximum.z - minimum.z);
+
+	return quantization;
+}
+
+void TinyEngine::PackVertices(const VertexStandard* in, unsigned int count, const VertexQuantization& quantization, VertexPacked* out)
+{
+	const float inverseScale[3] = { InverseScale(quantization.scale.x), InverseScale(quantization.scale.y), InverseScale(quantization.scale.z) };
+
+	unsigned int i = 0;
+
+#ifdef TINY_ENGINE_SSE2
+	for (; i + 4 <= count; i += 4)
+	{
+		PackVertices4(in + i, quantization, inverseScale, out + i);
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		PackVertex(in[i], quantization, inverseScale, out[i]);
+	}
+}
+
+void TinyEngine::PackVerticesReference(const VertexStandard* in, unsigned int count, const VertexQuantization& quantization, VertexPacked* out)
+{
+	const float inverseScale[3] = { InverseScale(quantization.scale.x), InverseScale(quantization.scale.y), InverseScale(quantization.scale.z) };
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		PackVertex(in[i], quantization, inverseScale, out[i]);
+	}
+}
+
+VertexStandard TinyEngine::UnpackVertex(const VertexPacked& vertex, const VertexQuantization& quantization)
+{
+	VertexStandard result;
+
+	result.position = XMFLOAT3(
+		quantization.offset.x + vertex.position[0] / POSITION_RANGE * quantization.scale.x,
+		quantization.offset.y + vertex.position[1] / POSITION_RANGE * quantization.scale.y,
+		quantization.offset.z + vertex.position[2] / POSITION_RANGE * quantization.scale.z);
+
+	// SNORM decode clamps -32768 to -1, as the input assembler does.
+	float u = std::max(vertex.normal[0] / NORMAL_RANGE, -1.0f);
+	float v = std::max(vertex.normal[1] / NORMAL_RANGE, -1.0f);
+	result.normal = DecodeOctahedral(u, v);
+
+	result.texcoord = XMFLOAT2(HalfToFloat(vertex.texcoord[0]), HalfToFloat(vertex.texcoord[1]));
+
+	return result;
+}
+
+VertexPackingError TinyEngine::MeasurePackingError(const VertexStandard* original, const VertexPacked* packed, unsigned int count, const VertexQuantization& quantization)
+{
+	VertexPackingError error;
+
+	double sumSquaredPosition = 0.0;
+	float minNormalCos = 1.0f;
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const auto& a = original[i];
+		auto b = UnpackVertex(packed[i], quantization);
+
+		float dx = a.position.x - b.position.x;
+		float dy = a.position.y - b.position.y;
+		float dz = a.position.z - b.position.z;
+		float squared = dx * dx + dy * dy + dz * dz;
+
+		sumSquaredPosition += squared;
+		error.maxPosition = std::max(error.maxPosition, sqrtf(squared));
+
+		float length = sqrtf(a.normal.x * a.normal.x + a.normal.y * a.normal.y + a.normal.z * a.normal.z);
+		if (length > 0.0f)
+		{
+			float cosine = (a.normal.x * b.normal.x + a.normal.y * b.normal.y + a.normal.z * b.normal.z) / length;
+			minNormalCos = std::min(minNormalCos, cosine);
+		}
+
+		error.maxTexcoord = std::max(error.maxTexcoord, std::max(fabsf(a.texcoord.x - b.texcoord.x), fabsf(a.texcoord.y - b.texcoord.y)));
+	}
+
+	if (count > 0)
+	{
+		error.rmsPosition = static_cast<float>(sqrt(sumSquaredPosition / count));
+	}
+
+	error.maxNormalDegrees = acosf(std::min(std::max(minNormalCos, -1.0f), 1.0f)) * (180.0f / XM_PI);
+
+	return error;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include "VertexStandard.h"
+
+namespace TinyEngine
+{
+	// Compact 16 byte vertex, decoded by DefaultPackedVertexShader.hlsl.
+	//	position: R16G16B16A16_UNORM, relative to the mesh's VertexQuantization. w is unused
+	//	normal: R16G16_SNORM, octahedral encoded
+	//	texcoord: R16G16_FLOAT
+	struct VertexPacked
+	{
+		uint16_t position[4];
+		int16_t normal[2];
+		uint16_t texcoord[2];
+	};
+
+	// Maps a VertexPacked's unorm position back to object space:
+	//	position = offset + unorm * scale
+	struct VertexQuantization
+	{
+		DirectX::XMFLOAT3 offset = { 0.0f, 0.0f, 0.0f };
+		DirectX::XMFLOAT3 scale = { 1.0f, 1.0f, 1.0f };
+	};
+
+	// How far packed vertices are from the vertices they were packed from.
+	struct VertexPackingError
+	{
+		// Largest and root mean square distance between positions, in object space units.
+		float maxPosition = 0.0f;
+		float rmsPosition = 0.0f;
+		// Largest angle between normals, in degrees.
+		float maxNormalDegrees = 0.0f;
+		// Largest difference in any texcoord component.
+		float maxTexcoord = 0.0f;
+	};
+
+	// Find the quantization which covers the bounds of some vertices.
+	//	const VertexStandard* vertices: Vertices to cover
+	//	unsigned int count: Number of vertices
+	VertexQuantization ComputeVertexQuantization(const VertexStandard* vertices, unsigned int count);
+
+	// Pack vertices, four at a time with SSE2 where it is available.
+	//	const VertexStandard* in: Vertices to pack
+	//	unsigned int count: Number of vertices
+	//	const VertexQuantization& quantization: Bounds the positions are quantized to
+	//	VertexPacked* out: Receives count packed vertices
+	void PackVertices(const VertexStandard* in, unsigned int count, const VertexQuantization& quantization, VertexPacked* out);
+
+	// Scalar version of PackVertices, produces identical output. Used to check the SIMD path.
+	void PackVerticesReference(const VertexStandard* in, unsigned int count, const VertexQuantization& quantization, VertexPacked* out);
+
+	// Decode a packed vertex the same way the shader does.
+	VertexStandard UnpackVertex(const VertexPacked& vertex, const VertexQuantization& quantization);
+
+	// Compare packed vertices with the originals.
+	VertexPackingError MeasurePackingError(const VertexStandard* original, const VertexPacked* packed, unsigned int count, const VertexQuantization& quantization);
+
+	// IEEE half conversions, rounding to nearest even.
+	uint16_t FloatToHalf(float value);
+	float HalfToFloat(uint16_t value);
+}
@@ -12,6 +12,7 @@ namespace TinyEngine
 		DirectX::XMFLOAT3 normal;
 
 	public:
+		VertexStandard() = default;
 		VertexStandard(DirectX::XMFLOAT3 position, DirectX::XMFLOAT2 texcoord, DirectX::XMFLOAT3 normal);
 	};
 }
\ No newline at end of file
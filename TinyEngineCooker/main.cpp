@@ -0,0 +1,365 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "BlockCompression.h"
+#include "DdsFile.h"
+#include "MeshFile.h"
+#include "MeshImport.h"
+#include "ObjParser.h"
+#include "ShaderBundle.h"
+#include "ThreadPool.h"
+#include "vendor/stb_image.h"
+
+// Converts source assets into the engine's runtime formats.
+
+using std::string;
+using std::cout;
+using std::endl;
+
+using namespace TinyEngine;
+
+void PrintUsage()
+{
+	cout << "Usage:" << endl;
+	cout << "\tTinyEngineCooker mesh <in.obj> <out.tmesh> [/weld-epsilon <e>] [/no-weld] [/no-optimize] [/pack-vertices] [/lods <n>] [/meshlets]" << endl;
+	cout << "\tTinyEngineCooker texture <in.img> <out.dds> [/format bc1|bc3|bc5|bc7|rgba8] [/filter box|kaiser] [/linear]" << endl;
+	cout << "\tTinyEngineCooker shaders <out.tsb> <in.cso|directory>..." << endl;
+}
+
+// Cook an .obj file into a .tmesh.
+//	returns: process exit code
+int CookMesh(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const char* inPath = argv[2];
+	const char* outPath = argv[3];
+
+	MeshImportSettings settings;
+	for (auto i = 4; i < argc; i++)
+	{
+		auto arg = string(argv[i]);
+
+		if (arg == "/weld-epsilon" && i + 1 < argc)
+		{
+			settings.weldEpsilon = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (arg == "/no-weld")
+		{
+			settings.weldVertices = false;
+		}
+		else if (arg == "/no-optimize")
+		{
+			settings.optimizeVertexCache = false;
+			settings.optimizeVertexFetch = false;
+		}
+		else if (arg == "/lods" && i + 1 < argc)
+		{
+			// The file holds the full detail level as well.
+			settings.lodCount = std::min(static_cast<unsigned int>(std::atoi(argv[++i])), MeshFileHeader::MAX_LODS - 1);
+		}
+		else if (arg == "/meshlets")
+		{
+			settings.buildMeshlets = true;
+		}
+		else if (arg == "/pack-vertices")
+		{
+			settings.packVertices = true;
+		}
+		else
+		{
+			cout << "Unknown option: " << arg << endl;
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	ThreadPool threadPool;
+	ObjParser parser;
+	parser.SetThreadPool(&threadPool);
+
+	ObjModel model;
+	if (!parser.Load(inPath, model))
+	{
+		cout << "Could not load mesh: " << inPath << endl;
+		return 1;
+	}
+
+	auto report = ImportMesh(model.mesh, settings);
+
+	if (!MeshFile::Write(outPath, model.mesh, model.materials))
+	{
+		return 1;
+	}
+
+	auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	cout << "Cooked " << inPath << " -> " << outPath << " in " << seconds << "s" << endl;
+	cout << "\tvertices: " << report.verticesBefore << " -> " << report.verticesAfter
+		<< " (" << report.bytesSaved / 1024 << " KB saved)" << endl;
+	cout << "\tACMR: " << report.cacheBefore.acmr << " -> " << report.cacheAfter.acmr
+		<< ", ATVR: " << report.cacheBefore.atvr << " -> " << report.cacheAfter.atvr << endl;
+	if (settings.packVertices)
+	{
+		const auto& error = report.packingError;
+		cout << "\tpacked vertices: position error max " << error.maxPosition << " rms " << error.rmsPosition
+			<< ", normal error max " << error.maxNormalDegrees << " degrees, texcoord error max " << error.maxTexcoord << endl;
+	}
+	const auto& lodErrors = model.mesh.lodErrors;
+	for (size_t level = 1; level < lodErrors.size(); level++)
+	{
+		unsigned int levelIndices = 0;
+		for (const auto& part : model.mesh.parts)
+		{
+			levelIndices += part.lods[level - 1].indexCount;
+		}
+
+		cout << "\tlod " << level << ": " << levelIndices / 3 << " triangles, error " << lodErrors[level] << endl;
+	}
+	if (settings.buildMeshlets)
+	{
+		cout << "\tmeshlets: " << report.meshletCount << endl;
+	}
+	cout << "\tindices: " << model.mesh.indices.size() << ", parts: " << model.mesh.parts.size()
+		<< ", materials: " << model.materials.size() << endl;
+
+	return 0;
+}
+
+// Cook an image into a .dds with a full mip chain, block compressed unless /format rgba8 is given.
+//	returns: process exit code
+int CookTexture(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const char* inPath = argv[2];
+	const char* outPath = argv[3];
+
+	TextureFormat format = TextureFormat::BC7;
+	MipSettings settings;
+	for (auto i = 4; i < argc; i++)
+	{
+		auto arg = string(argv[i]);
+
+		if (arg == "/format" && i + 1 < argc)
+		{
+			auto name = string(argv[++i]);
+			if (name == "bc1")
+			{
+				format = TextureFormat::BC1;
+			}
+			else if (name == "bc3")
+			{
+				format = TextureFormat::BC3;
+			}
+			else if (name == "bc5")
+			{
+				format = TextureFormat::BC5;
+			}
+			else if (name == "bc7")
+			{
+				format = TextureFormat::BC7;
+			}
+			else if (name == "rgba8")
+			{
+				format = TextureFormat::RGBA8;
+			}
+			else
+			{
+				cout << "Unknown format: " << name << endl;
+				PrintUsage();
+				return 1;
+			}
+		}
+		else if (arg == "/filter" && i + 1 < argc)
+		{
+			auto name = string(argv[++i]);
+			settings.filter = name == "kaiser" ? MipFilter::KAISER : MipFilter::BOX;
+		}
+		else if (arg == "/linear")
+		{
+			// Normal maps and other data which isn't color are filtered as stored.
+			settings.srgb = false;
+		}
+		else
+		{
+			cout << "Unknown option: " << arg << endl;
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	int width, height, bpp;
+	unsigned char* pixels = stbi_load(inPath, &width, &height, &bpp, STBI_rgb_alpha);
+	if (!pixels)
+	{
+		cout << "Could not load image: " << inPath << endl;
+		return 1;
+	}
+
+	ThreadPool threadPool;
+
+	MipChain mips;
+	GenerateMipChain(pixels, width, height, settings, mips, &threadPool);
+	stbi_image_free(pixels);
+
+	size_t sourceBytes = mips.data.size();
+	auto mipSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	TextureData texture;
+	if (IsBlockCompressed(format))
+	{
+		if (!CompressTexture(mips, format, texture, &threadPool))
+		{
+			return 1;
+		}
+	}
+	else
+	{
+		MoveMipChain(std::move(mips), texture);
+	}
+
+	auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	float psnr = 99.0f;
+	if (IsBlockCompressed(format))
+	{
+		std::vector<unsigned char> decoded;
+		DecompressLevel(texture, 0, decoded);
+		psnr = ComputePsnr(mips.GetLevelData(0), decoded.data(), static_cast<size_t>(width) * height, GetPsnrChannels(format));
+	}
+
+	if (!WriteDds(outPath, texture))
+	{
+		return 1;
+	}
+
+	cout << "Cooked " << inPath << " -> " << outPath << " in " << seconds << "s (mips " << mipSeconds << "s)" << endl;
+	cout << "\tsize: " << width << "x" << height << ", " << texture.levels.size() << " levels" << endl;
+	cout << "\tbytes: " << sourceBytes / 1024 << " KB -> " << texture.data.size() / 1024 << " KB" << endl;
+	if (IsBlockCompressed(format))
+	{
+		cout << "\tPSNR of the first level: " << psnr << " dB" << endl;
+	}
+
+	return 0;
+}
+
+// Bundle compiled shaders into a .tsb. Directories add every .cso in them.
+//	returns: process exit code
+int CookShaders(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const char* outPath = argv[2];
+
+	std::vector<std::filesystem::path> paths;
+	for (auto i = 3; i < argc; i++)
+	{
+		std::error_code error;
+		if (std::filesystem::is_directory(argv[i], error))
+		{
+			for (const auto& file : std::filesystem::directory_iterator(argv[i], error))
+			{
+				if (file.path().extension() == ".cso")
+				{
+					paths.push_back(file.path());
+				}
+			}
+		}
+		else
+		{
+			paths.push_back(argv[i]);
+		}
+	}
+
+	std::vector<ShaderBundleSource> shaders;
+	size_t sourceBytes = 0;
+	for (const auto& path : paths)
+	{
+		std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+		{
+			cout << "Could not open shader: " << path.string() << endl;
+			return 1;
+		}
+
+		ShaderBundleSource shader;
+		shader.name = path.string();
+		shader.bytecode.resize(static_cast<size_t>(file.tellg()));
+		file.seekg(0, std::ios::beg);
+		file.read(shader.bytecode.data(), static_cast<std::streamsize>(shader.bytecode.size()));
+
+		sourceBytes += shader.bytecode.size();
+		shaders.push_back(std::move(shader));
+	}
+
+	if (!ShaderBundle::Write(outPath, shaders))
+	{
+		return 1;
+	}
+
+	ShaderBundle bundle;
+	if (!bundle.Open(outPath))
+	{
+		return 1;
+	}
+
+	std::error_code error;
+	cout << "Cooked " << shaders.size() << " shaders -> " << outPath << endl;
+	cout << "\tunique bytecode: " << bundle.GetBlobCount() << " of " << bundle.GetEntryCount() << endl;
+	cout << "\tbytes: " << sourceBytes / 1024 << " KB -> " << std::filesystem::file_size(outPath, error) / 1024 << " KB" << endl;
+
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	auto command = string(argv[1]);
+
+	if (command == "mesh")
+	{
+		return CookMesh(argc, argv);
+	}
+
+	if (command == "texture")
+	{
+		return CookTexture(argc, argv);
+	}
+
+	if (command == "shaders")
+	{
+		return CookShaders(argc, argv);
+	}
+
+	cout << "Unknown command: " << command << endl;
+	PrintUsage();
+	return 1;
+}
@@ -0,0 +1,2471 @@
+#include "Benchmarks.h"
+#include "BlockCompression.h"
+#include "BoundingVolumeHierarchy.h"
+#include "CpuFeatures.h"
+#include "DdsFile.h"
+#include "DerivedDataCache.h"
+#include "FrustumCulling.h"
+#include "Game.h"
+#include "MeshImport.h"
+#include "MeshLod.h"
+#include "Meshlet.h"
+#include "MipGenerator.h"
+#include "OcclusionCulling.h"
+#include "ObjParser.h"
+#include "RangeAllocator.h"
+#include "RenderQueue.h"
+#include "RingAllocator.h"
+#include "SoftwareRenderer.h"
+#include "TextureStreaming.h"
+#include "ThreadPool.h"
+#include "vendor/stb_image.h"
+
+#pragma warning(disable: 4067 4244)
+#include "vendor/OBJ_Loader.h"
+#pragma warning(default: 4067 4244)
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+
+using namespace DirectX;
+using namespace TinyEngine;
+
+using std::cout;
+using std::endl;
+using std::string;
+using std::vector;
+
+using Clock = std::chrono::high_resolution_clock;
+
+namespace
+{
+	double SecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	void PrintResult(const char* name, double seconds, int iterations, double megabytes, size_t triangles)
+	{
+		double perLoad = seconds / iterations;
+
+		cout << name << ": " << perLoad * 1000.0 << " ms/load, "
+			<< megabytes / perLoad << " MB/s, "
+			<< triangles / perLoad / 1000000.0 << " Mtri/s" << endl;
+	}
+
+	// Are two loads of an .obj identical, down to the bits of every vertex?
+	bool SameObjModel(const ObjModel& a, const ObjModel& b)
+	{
+		if (a.mesh.vertices.size() != b.mesh.vertices.size() || a.mesh.indices != b.mesh.indices
+			|| a.mesh.parts.size() != b.mesh.parts.size() || a.materials.size() != b.materials.size())
+		{
+			return false;
+		}
+
+		if (!a.mesh.vertices.empty() && memcmp(a.mesh.vertices.data(), b.mesh.vertices.data(), a.mesh.vertices.size() * sizeof(VertexStandard)) != 0)
+		{
+			return false;
+		}
+
+		for (size_t i = 0; i < a.mesh.parts.size(); i++)
+		{
+			const auto& partA = a.mesh.parts[i];
+			const auto& partB = b.mesh.parts[i];
+			if (std::tie(partA.indexStart, partA.indexCount, partA.baseVertex, partA.vertexCount, partA.material)
+				!= std::tie(partB.indexStart, partB.indexCount, partB.baseVertex, partB.vertexCount, partB.material))
+			{
+				return false;
+			}
+		}
+
+		for (size_t i = 0; i < a.materials.size(); i++)
+		{
+			const auto& materialA = a.materials[i];
+			const auto& materialB = b.materials[i];
+			if (std::tie(materialA.name, materialA.ambientMap, materialA.diffuseMap, materialA.specularMap, materialA.specularExponent, materialA.dissolve)
+				!= std::tie(materialB.name, materialB.ambientMap, materialB.diffuseMap, materialB.specularMap, materialB.specularExponent, materialB.dissolve)
+				|| memcmp(&materialA.ambient, &materialB.ambient, sizeof(XMFLOAT3)) != 0
+				|| memcmp(&materialA.diffuse, &materialB.diffuse, sizeof(XMFLOAT3)) != 0
+				|| memcmp(&materialA.specular, &materialB.specular, sizeof(XMFLOAT3)) != 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+bool Benchmarks::RunObjLoad(const char* path, int iterations)
+{
+	std::error_code error;
+	auto fileSize = std::filesystem::file_size(path, error);
+	if (error)
+	{
+		cout << "Could not find benchmark file: " << path << endl;
+		return false;
+	}
+
+	double megabytes = static_cast<double>(fileSize) / (1024.0 * 1024.0);
+	cout << "Loading " << path << " (" << megabytes << " MB) " << iterations << " times." << endl;
+
+	size_t triangles = 0;
+	ObjModel serialModel;
+
+	{
+		ObjParser parser;
+
+		auto start = Clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			if (!parser.Load(path, serialModel))
+			{
+				cout << "ObjParser failed to load the benchmark file." << endl;
+				return false;
+			}
+		}
+		double seconds = SecondsSince(start);
+
+		triangles = serialModel.mesh.indices.size() / 3;
+		PrintResult("TinyEngine::ObjParser", seconds, iterations, megabytes, triangles);
+	}
+
+	// Every thread count must load exactly what the serial parser did.
+	bool identical = true;
+	for (unsigned int threads = 2; threads <= std::thread::hardware_concurrency(); threads *= 2)
+	{
+		ThreadPool pool(threads);
+
+		ObjParser parser;
+		parser.SetThreadPool(&pool);
+		ObjModel model;
+
+		auto start = Clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			if (!parser.Load(path, model))
+			{
+				cout << "ObjParser failed to load the benchmark file on " << threads << " threads." << endl;
+				return false;
+			}
+		}
+		double seconds = SecondsSince(start);
+
+		auto name = "TinyEngine::ObjParser " + std::to_string(threads) + " threads";
+		PrintResult(name.c_str(), seconds, iterations, megabytes, triangles);
+
+		if (!SameObjModel(model, serialModel))
+		{
+			cout << "ObjParser on " << threads << " threads loaded a different model than on one." << endl;
+			identical = false;
+		}
+	}
+
+	{
+		auto start = Clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			objl::Loader loader;
+			if (!loader.LoadFile(path))
+			{
+				cout << "objl failed to load the benchmark file." << endl;
+				return false;
+			}
+		}
+		double seconds = SecondsSince(start);
+
+		PrintResult("objl::Loader", seconds, iterations, megabytes, triangles);
+	}
+
+	return identical;
+}
+
+bool Benchmarks::RunLodSelection(int views)
+{
+	// Ascending errors as the simplifier gives them, lodErrors[0] is full detail.
+	const float LOD_ERRORS[] = { 0.0f, 0.002f, 0.01f, 0.04f, 0.15f };
+	const unsigned int LOD_COUNT = 5;
+	const XMFLOAT3 CENTER(0.5f, -0.25f, 1.0f);
+	const float RADIUS = 1.5f;
+	const float MAX_DISTANCE = 2000.0f;
+	const int STEPS = 256;
+
+	uint32_t seed = 12345;
+	auto random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / static_cast<float>(1 << 24);
+	};
+
+	auto projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 5000.0f);
+	float projectionYScale = XMVectorGetY(projection.r[1]);
+
+	bool deterministic = true;
+	bool monotonic = true;
+	bool withinError = true;
+	bool coarsest = true;
+	bool insideFull = true;
+	unsigned int levels[LOD_COUNT] = {};
+	unsigned int selections = 0;
+	double seconds = 0.0;
+
+	for (int view = 0; view < views; view++)
+	{
+		// A randomly placed, turned and scaled mesh, approached along a random direction.
+		float scale = 0.25f + random() * 4.0f;
+		auto world = XMMatrixScaling(scale, scale, scale) * XMMatrixRotationY(random() * XM_2PI)
+			* XMMatrixTranslation(random() * 200.0f - 100.0f, random() * 200.0f - 100.0f, random() * 200.0f - 100.0f);
+		XMVECTOR center = XMVector3TransformCoord(XMLoadFloat3(&CENTER), world);
+		float angle = random() * XM_2PI;
+		XMVECTOR away = XMVector3Normalize(XMVectorSet(cosf(angle), random() - 0.5f, sinf(angle), 0.0f));
+		float worldRadius = RADIUS * scale;
+
+		unsigned int previous = 0;
+		for (int step = 0; step <= STEPS; step++)
+		{
+			// From the centre out, closer together near the mesh where the levels change fastest.
+			float t = static_cast<float>(step) / STEPS;
+			float centerDistance = t * t * MAX_DISTANCE;
+			XMVECTOR eye = center + away * centerDistance;
+			auto viewMatrix = XMMatrixLookToLH(eye, -away, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+
+			auto start = Clock::now();
+			unsigned int lod = SelectLod(LOD_ERRORS, LOD_COUNT, CENTER, RADIUS, world, viewMatrix, projection);
+			seconds += SecondsSince(start);
+			selections++;
+			levels[lod]++;
+
+			deterministic = deterministic && lod < LOD_COUNT
+				&& SelectLod(LOD_ERRORS, LOD_COUNT, CENTER, RADIUS, world, viewMatrix, projection) == lod;
+			monotonic = monotonic && lod >= previous;
+			previous = lod;
+
+			// Against the error projected from the nearest point of the sphere, worked out here on its own.
+			float nearest = centerDistance - worldRadius;
+			if (nearest <= 0.0f)
+			{
+				insideFull = insideFull && lod == 0;
+				continue;
+			}
+
+			float projected = LOD_ERRORS[lod] * scale * projectionYScale / nearest;
+			float next = lod + 1 < LOD_COUNT ? LOD_ERRORS[lod + 1] * scale * projectionYScale / nearest : FLT_MAX;
+
+			// The slack covers rounding where a level's error is right on the threshold.
+			withinError = withinError && projected <= DEFAULT_MAX_SCREEN_ERROR * 1.001f;
+			coarsest = coarsest && next >= DEFAULT_MAX_SCREEN_ERROR * 0.999f;
+		}
+	}
+
+	// A single level, and an eye exactly at the centre, are always full detail.
+	auto identity = XMMatrixIdentity();
+	insideFull = insideFull && SelectLod(LOD_ERRORS, 1, CENTER, RADIUS, identity, identity, projection) == 0
+		&& SelectLod(LOD_ERRORS, LOD_COUNT, XMFLOAT3(0.0f, 0.0f, 0.0f), RADIUS, identity, identity, projection) == 0;
+
+	cout << "Level of detail selection from " << views << " meshes, " << STEPS + 1 << " distances each up to " << MAX_DISTANCE << " units:" << endl;
+	cout << "	" << seconds / selections * 1e9 << " ns per selection, levels chosen";
+	for (unsigned int lod = 0; lod < LOD_COUNT; lod++)
+	{
+		cout << " " << lod << ": " << levels[lod];
+	}
+	cout << endl;
+
+	if (!deterministic)
+	{
+		cout << "	The same view selected different levels." << endl;
+	}
+
+	if (!monotonic)
+	{
+		cout << "	Moving away selected a finer level." << endl;
+	}
+
+	if (!withinError || !coarsest)
+	{
+		cout << "	A level's projected error broke the threshold, or a coarser level was within it." << endl;
+	}
+
+	if (!insideFull)
+	{
+		cout << "	A camera inside the bounding sphere didn't get full detail." << endl;
+	}
+
+	bool correct = deterministic && monotonic && withinError && coarsest && insideFull;
+	cout << "	" << (correct ? "every selection is within the error and the coarsest that is" : "selections are WRONG") << endl;
+
+	return correct;
+}
+
+bool Benchmarks::RunMeshletCulling(const char* path, int iterations)
+{
+	ObjParser parser;
+	ObjModel model;
+	if (!parser.Load(path, model))
+	{
+		cout << "Could not load benchmark file: " << path << endl;
+		return false;
+	}
+
+	auto& mesh = model.mesh;
+
+	MeshImportSettings settings;
+	settings.lodCount = 0;
+	ImportMesh(mesh, settings);
+
+	unsigned int meshletCount = 0;
+
+	auto buildStart = Clock::now();
+	for (auto& part : mesh.parts)
+	{
+		BuildMeshlets(mesh.indices.data() + part.indexStart, part.indexCount, mesh.vertices.data() + part.baseVertex, part.vertexCount, part.meshlets);
+		meshletCount += static_cast<unsigned int>(part.meshlets.size());
+	}
+	double buildSeconds = SecondsSince(buildStart);
+
+	if (meshletCount == 0)
+	{
+		cout << "The benchmark file has no triangles." << endl;
+		return false;
+	}
+
+	auto triangles = mesh.indices.size() / 3;
+	cout << "Built " << meshletCount << " meshlets from " << triangles << " triangles in " << buildSeconds * 1000.0 << " ms, "
+		<< static_cast<double>(triangles) / meshletCount << " triangles per meshlet." << endl;
+
+	XMVECTOR minimum = XMVectorReplicate(FLT_MAX);
+	XMVECTOR maximum = XMVectorReplicate(-FLT_MAX);
+	for (const auto& vertex : mesh.vertices)
+	{
+		minimum = XMVectorMin(minimum, XMLoadFloat3(&vertex.position));
+		maximum = XMVectorMax(maximum, XMLoadFloat3(&vertex.position));
+	}
+
+	XMVECTOR center = (minimum + maximum) * 0.5f;
+	float radius = std::max(XMVectorGetX(XMVector3Length(maximum - minimum)) * 0.5f, 0.001f);
+
+	// Cameras orbiting the mesh looking at it, which only the normal cones can cull,
+	// and cameras skimming its surface, which the frustum culls most of.
+	const int ORBIT_STEPS = 16;
+	vector<MeshletCullView> views;
+	auto projection = XMMatrixPerspectiveFovLH(XM_PI / 3.0f, 16.0f / 9.0f, 0.01f * radius, 100.0f * radius);
+
+	for (int step = 0; step < ORBIT_STEPS; step++)
+	{
+		float angle = XM_2PI * step / ORBIT_STEPS;
+		XMVECTOR around = XMVectorSet(cosf(angle), 0.3f, sinf(angle), 0.0f);
+
+		for (float distance : { 2.0f, 4.0f })
+		{
+			XMVECTOR eye = center + XMVector3Normalize(around) * (distance * radius);
+			XMFLOAT3 eyePosition;
+			XMStoreFloat3(&eyePosition, eye);
+
+			auto view = XMMatrixLookAtLH(eye, center, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+			views.push_back(MakeMeshletCullView(XMMatrixIdentity(), view, projection, eyePosition));
+		}
+
+		{
+			XMVECTOR eye = center + XMVector3Normalize(around) * (1.2f * radius);
+			XMFLOAT3 eyePosition;
+			XMStoreFloat3(&eyePosition, eye);
+
+			XMVECTOR tangent = XMVectorSet(-sinf(angle), 0.0f, cosf(angle), 0.0f);
+			auto view = XMMatrixLookToLH(eye, tangent, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+			views.push_back(MakeMeshletCullView(XMMatrixIdentity(), view, projection, eyePosition));
+		}
+	}
+
+	vector<MeshletRange> visible;
+	MeshletCullStats total;
+	size_t ranges = 0;
+
+	// Every triangle drawing the whole part could show, front facing and not entirely outside a frustum plane,
+	// must be in a range CullMeshlets kept.
+	bool correct = true;
+	size_t frontTriangles = 0;
+	size_t lostTriangles = 0;
+	vector<bool> kept;
+
+	for (const auto& view : views)
+	{
+		for (const auto& part : mesh.parts)
+		{
+			CullMeshlets(view, part.meshlets.data(), static_cast<unsigned int>(part.meshlets.size()), visible);
+
+			kept.assign(part.indexCount / 3, false);
+			unsigned int end = 0;
+			for (const auto& range : visible)
+			{
+				correct = correct && range.indexStart >= end && range.indexStart % 3 == 0 && range.indexCount % 3 == 0
+					&& range.indexStart + range.indexCount <= part.indexCount;
+				end = range.indexStart + range.indexCount;
+
+				for (unsigned int i = range.indexStart; i < end && correct; i += 3)
+				{
+					kept[i / 3] = true;
+				}
+			}
+
+			const unsigned int* indices = mesh.indices.data() + part.indexStart;
+			const VertexStandard* vertices = mesh.vertices.data() + part.baseVertex;
+			XMVECTOR eye = XMLoadFloat3(&view.eyePosition);
+
+			for (unsigned int i = 0; i + 2 < part.indexCount; i += 3)
+			{
+				XMVECTOR a = XMLoadFloat3(&vertices[indices[i]].position);
+				XMVECTOR b = XMLoadFloat3(&vertices[indices[i + 1]].position);
+				XMVECTOR c = XMLoadFloat3(&vertices[indices[i + 2]].position);
+
+				// Front faces are clockwise, see BuildMeshlets.
+				if (XMVectorGetX(XMVector3Dot(XMVector3Cross(b - a, c - a), a - eye)) >= 0.0f)
+				{
+					continue;
+				}
+
+				bool inside = true;
+				for (int p = 0; p < 6 && inside; p++)
+				{
+					XMVECTOR plane = XMLoadFloat4(&view.planes[p]);
+					inside = XMVectorGetX(XMPlaneDotCoord(plane, a)) >= 0.0f || XMVectorGetX(XMPlaneDotCoord(plane, b)) >= 0.0f
+						|| XMVectorGetX(XMPlaneDotCoord(plane, c)) >= 0.0f;
+				}
+
+				if (inside)
+				{
+					frontTriangles++;
+					lostTriangles += kept[i / 3] ? 0 : 1;
+				}
+			}
+		}
+	}
+
+	correct = correct && lostTriangles == 0;
+
+	auto start = Clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		for (const auto& view : views)
+		{
+			for (const auto& part : mesh.parts)
+			{
+				MeshletCullStats stats;
+				CullMeshlets(view, part.meshlets.data(), static_cast<unsigned int>(part.meshlets.size()), visible, &stats);
+
+				total.Add(stats);
+				ranges += visible.size();
+			}
+		}
+	}
+	double seconds = SecondsSince(start);
+
+	double culls = static_cast<double>(views.size()) * iterations;
+	auto percent = [](double part, double whole) { return whole > 0.0 ? part * 100.0 / whole : 0.0; };
+
+	cout << views.size() << " cameras, " << iterations << " iterations:" << endl;
+	cout << "\tcull cost: " << seconds * 1000.0 / culls << " ms/mesh, " << seconds * 1e9 / total.tested << " ns/meshlet" << endl;
+	cout << "\tmeshlets culled: " << percent(total.frustumCulled, total.tested) << "% by frustum, "
+		<< percent(total.coneCulled, total.tested) << "% by normal cone, "
+		<< percent(total.visible, total.tested) << "% visible" << endl;
+	cout << "\ttriangles culled: " << percent(total.totalTriangles - total.visibleTriangles, total.totalTriangles) << "%, "
+		<< ranges / culls << " draws/mesh after merging adjacent meshlets" << endl;
+	cout << "\ttriangles which can be seen: " << percent(static_cast<double>(frontTriangles), static_cast<double>(triangles) * views.size()) << "%, "
+		<< lostTriangles << " culled" << endl;
+	cout << "\t" << (correct ? "every triangle which can be seen is drawn" : "culling is WRONG") << endl;
+
+	return correct;
+}
+
+bool Benchmarks::RunRangeAllocator(int operations)
+{
+	const unsigned int INITIAL_CAPACITY = 4096;
+	const unsigned int MAX_CAPACITY = 1 << 16;
+	const unsigned int MAX_SIZE = 512;
+	const int DEFRAGMENT_INTERVAL = 1000;
+	const int CHECK_INTERVAL = 256;
+	const unsigned int FREE = ~0u;
+
+	struct Range
+	{
+		unsigned int handle;
+		unsigned int size;
+		unsigned int tag;
+	};
+
+	uint32_t seed = 12345;
+	auto random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return seed >> 8;
+	};
+
+	// A quarter of the allocations are tiny and some are empty, the rest up to MAX_SIZE.
+	auto allocationSize = [&random]()
+	{
+		unsigned int kind = random() % 16;
+		return kind == 0 ? 0 : kind < 4 ? 1 + random() % 4 : 1 + random() % MAX_SIZE;
+	};
+
+	RangeAllocator allocator(INITIAL_CAPACITY);
+
+	// The owner of every unit of the space, and a buffer the allocations are stored in,
+	// each unit holding its allocation's tag so Defragment's moves can be checked.
+	vector<unsigned int> owners(INITIAL_CAPACITY, FREE);
+	vector<unsigned int> contents(INITIAL_CAPACITY, 0);
+	vector<Range> live;
+	unsigned int liveSize = 0;
+	unsigned int nextTag = 0;
+
+	unsigned int allocations = 0;
+	unsigned int failures = 0;
+	unsigned int grows = 0;
+	unsigned int defragments = 0;
+	unsigned int movedSize = 0;
+
+	bool overlapping = false;
+	bool coalesced = true;
+	bool failedWrongly = false;
+	bool movedWrongly = false;
+
+	// The free ranges must be exactly the runs of free units, which is only true if neighbours are merged.
+	auto checkFreeRanges = [&]()
+	{
+		unsigned int runs = 0;
+		unsigned int largest = 0;
+		unsigned int run = 0;
+		for (unsigned int owner : owners)
+		{
+			run = owner == FREE ? run + 1 : 0;
+			runs += run == 1;
+			largest = std::max(largest, run);
+		}
+
+		coalesced = coalesced && allocator.GetFreeRangeCount() == runs && allocator.GetLargestFreeRange() == largest
+			&& allocator.GetFreeSize() == allocator.GetCapacity() - liveSize;
+		return largest;
+	};
+
+	auto allocate = [&](unsigned int size)
+	{
+		unsigned int handle = allocator.Allocate(size);
+		if (handle == RangeAllocator::INVALID_HANDLE)
+		{
+			return false;
+		}
+
+		unsigned int offset = allocator.GetOffset(handle);
+		overlapping = overlapping || allocator.GetSize(handle) != size || offset + size > allocator.GetCapacity();
+		for (unsigned int i = offset; i < offset + size && !overlapping; i++)
+		{
+			overlapping = owners[i] != FREE;
+			owners[i] = handle;
+			contents[i] = nextTag;
+		}
+
+		live.push_back({ handle, size, nextTag++ });
+		liveSize += size;
+		allocations++;
+		return true;
+	};
+
+	for (int operation = 0; operation < operations && !overlapping && coalesced && !failedWrongly && !movedWrongly; operation++)
+	{
+		if (operation % DEFRAGMENT_INTERVAL == DEFRAGMENT_INTERVAL - 1)
+		{
+			// Copy every move out of the old contents, as the owner of a buffer would.
+			vector<RangeMove> moves;
+			allocator.Defragment(moves);
+			defragments++;
+
+			vector<unsigned int> moved(contents.size(), 0);
+			std::fill(owners.begin(), owners.end(), FREE);
+			unsigned int movesSize = 0;
+			for (const auto& move : moves)
+			{
+				std::copy(contents.begin() + move.from, contents.begin() + move.from + move.size, moved.begin() + move.to);
+				std::fill(owners.begin() + move.to, owners.begin() + move.to + move.size, move.handle);
+				movedWrongly = movedWrongly || allocator.GetOffset(move.handle) != move.to || allocator.GetSize(move.handle) != move.size;
+				movesSize += move.size;
+				movedSize += move.from != move.to ? move.size : 0;
+			}
+
+			contents.swap(moved);
+
+			// Every live allocation kept its contents, and the free space is one range at the end.
+			for (const auto& range : live)
+			{
+				unsigned int offset = allocator.GetOffset(range.handle);
+				for (unsigned int i = offset; i < offset + range.size; i++)
+				{
+					movedWrongly = movedWrongly || contents[i] != range.tag || owners[i] != range.handle;
+				}
+			}
+
+			movedWrongly = movedWrongly || movesSize != liveSize || allocator.GetFreeRangeCount() > 1;
+			checkFreeRanges();
+			continue;
+		}
+
+		if (random() % 100 < 45 && !live.empty())
+		{
+			size_t index = random() % live.size();
+			Range range = live[index];
+			live[index] = live.back();
+			live.pop_back();
+
+			unsigned int offset = allocator.GetOffset(range.handle);
+			std::fill(owners.begin() + offset, owners.begin() + offset + range.size, FREE);
+			liveSize -= range.size;
+			allocator.Free(range.handle);
+		}
+		else
+		{
+			unsigned int size = allocationSize();
+			if (!allocate(size))
+			{
+				// Only fail when no free run fits, then grow if there is room to.
+				failedWrongly = failedWrongly || checkFreeRanges() >= size;
+
+				if (allocator.GetCapacity() < MAX_CAPACITY)
+				{
+					unsigned int capacity = allocator.GetCapacity() * 2;
+					allocator.Grow(capacity);
+					owners.resize(capacity, FREE);
+					contents.resize(capacity, 0);
+					grows++;
+
+					failedWrongly = failedWrongly || allocator.GetCapacity() != capacity || !allocate(size);
+				}
+				else
+				{
+					failures++;
+				}
+			}
+		}
+
+		coalesced = coalesced && allocator.GetAllocatedSize() == liveSize && allocator.GetAllocationCount() == live.size();
+		if (operation % CHECK_INTERVAL == 0)
+		{
+			checkFreeRanges();
+		}
+	}
+
+	checkFreeRanges();
+
+	// Freeing the middle of three ranges after the outer two leaves one range, and growing extends the free range at the end.
+	RangeAllocator small(30);
+	unsigned int first = small.Allocate(10);
+	unsigned int middle = small.Allocate(10);
+	unsigned int last = small.Allocate(10);
+	small.Free(first);
+	small.Free(last);
+	coalesced = coalesced && small.GetFreeRangeCount() == 2 && small.GetLargestFreeRange() == 10;
+	small.Free(middle);
+	coalesced = coalesced && small.GetFreeRangeCount() == 1 && small.GetLargestFreeRange() == 30;
+	unsigned int front = small.Allocate(25);
+	small.Grow(50);
+	small.Grow(40);
+	coalesced = coalesced && small.GetCapacity() == 50 && small.GetFreeRangeCount() == 1 && small.GetLargestFreeRange() == 25
+		&& small.GetOffset(small.Allocate(25)) == 25 && small.GetOffset(front) == 0 && small.Allocate(1) == RangeAllocator::INVALID_HANDLE;
+
+	// The same operations again without checking them, to time the allocator alone. It should end up the same.
+	// Skipped once a check has failed, as the allocator's state can't be trusted.
+	bool checked = !overlapping && coalesced && !failedWrongly && !movedWrongly;
+	RangeAllocator timed(INITIAL_CAPACITY);
+	vector<unsigned int> handles;
+	vector<RangeMove> moves;
+	seed = 12345;
+
+	auto start = Clock::now();
+	for (int operation = 0; operation < operations && checked; operation++)
+	{
+		if (operation % DEFRAGMENT_INTERVAL == DEFRAGMENT_INTERVAL - 1)
+		{
+			timed.Defragment(moves);
+			continue;
+		}
+
+		if (random() % 100 < 45 && !handles.empty())
+		{
+			size_t index = random() % handles.size();
+			timed.Free(handles[index]);
+			handles[index] = handles.back();
+			handles.pop_back();
+		}
+		else
+		{
+			unsigned int size = allocationSize();
+			unsigned int handle = timed.Allocate(size);
+			if (handle == RangeAllocator::INVALID_HANDLE && timed.GetCapacity() < MAX_CAPACITY)
+			{
+				timed.Grow(timed.GetCapacity() * 2);
+				handle = timed.Allocate(size);
+			}
+
+			if (handle != RangeAllocator::INVALID_HANDLE)
+			{
+				handles.push_back(handle);
+			}
+		}
+	}
+
+	double seconds = SecondsSince(start);
+	bool repeatable = timed.GetCapacity() == allocator.GetCapacity() && timed.GetAllocatedSize() == allocator.GetAllocatedSize()
+		&& timed.GetFreeRangeCount() == allocator.GetFreeRangeCount();
+
+	cout << "Range allocator growing from " << INITIAL_CAPACITY << " to at most " << MAX_CAPACITY << " units, " << operations << " operations:" << endl;
+	cout << "	" << allocations << " allocations, " << failures << " failed for lack of space, " << grows << " grows, "
+		<< seconds / operations * 1e9 << " ns per operation" << endl;
+	cout << "	" << defragments << " defragments moved " << movedSize << " units, " << allocator.GetFreeRangeCount() << " free ranges at the end" << endl;
+
+	if (overlapping)
+	{
+		cout << "	An allocation overlapped a live one or the end of the space." << endl;
+	}
+
+	if (!coalesced)
+	{
+		cout << "	The free ranges or sizes don't match the free space." << endl;
+	}
+
+	if (failedWrongly)
+	{
+		cout << "	An allocation failed although a free range fitted it, or growing didn't make room." << endl;
+	}
+
+	if (movedWrongly)
+	{
+		cout << "	Defragmenting lost an allocation's contents." << endl;
+	}
+
+	bool correct = checked && repeatable;
+	cout << "	" << (correct ? "no live ranges overlap and the free space is merged" : "ranges are WRONG") << endl;
+
+	return correct;
+}
+
+bool Benchmarks::RunMipGeneration(const char* path, int iterations)
+{
+	int width, height, bpp;
+	unsigned char* pixels = stbi_load(path, &width, &height, &bpp, STBI_rgb_alpha);
+	if (!pixels)
+	{
+		cout << "Could not load benchmark file: " << path << endl;
+		return false;
+	}
+
+	cout << "Generating mips for " << path << " (" << width << "x" << height << ") " << iterations << " times." << endl;
+
+	ThreadPool threadPool;
+	bool agree = true;
+
+	for (auto filter : { MipFilter::BOX, MipFilter::KAISER })
+	{
+		MipSettings settings;
+		settings.filter = filter;
+
+		MipChain reference;
+		auto referenceStart = Clock::now();
+		GenerateMipChainReference(pixels, width, height, settings, reference);
+		double referenceSeconds = SecondsSince(referenceStart);
+
+		MipChain chain;
+		auto serialStart = Clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			GenerateMipChain(pixels, width, height, settings, chain);
+		}
+		double serialSeconds = SecondsSince(serialStart) / iterations;
+
+		auto parallelStart = Clock::now();
+		for (int i = 0; i < iterations; i++)
+		{
+			GenerateMipChain(pixels, width, height, settings, chain, &threadPool);
+		}
+		double parallelSeconds = SecondsSince(parallelStart) / iterations;
+
+		int maxDifference = 0;
+		size_t differences = 0;
+		for (size_t i = 0; i < chain.data.size(); i++)
+		{
+			int difference = std::abs(chain.data[i] - reference.data[i]);
+			maxDifference = std::max(maxDifference, difference);
+			differences += difference > 0;
+		}
+
+		agree = agree && chain.data.size() == reference.data.size() && maxDifference <= 1;
+
+		cout << (filter == MipFilter::BOX ? "Box" : "Kaiser") << ", " << chain.levels.size() << " levels:" << endl;
+		cout << "	reference " << referenceSeconds * 1000.0 << " ms, SIMD " << serialSeconds * 1000.0 << " ms, SIMD on "
+			<< threadPool.GetThreadCount() << " threads " << parallelSeconds * 1000.0 << " ms" << endl;
+		cout << "	largest difference from the reference " << maxDifference << ", "
+			<< differences * 100.0 / chain.data.size() << "% of channels differ" << endl;
+	}
+
+	stbi_image_free(pixels);
+
+	cout << (agree ? "The SIMD generator matches the reference." : "The SIMD generator does NOT match the reference.") << endl;
+
+	return agree;
+}
+
+bool Benchmarks::RunBlockCompression(const char* path, int iterations)
+{
+	int width, height, bpp;
+	unsigned char* pixels = stbi_load(path, &width, &height, &bpp, STBI_rgb_alpha);
+	if (!pixels)
+	{
+		cout << "Could not load benchmark file: " << path << endl;
+		return false;
+	}
+
+	cout << "Block compressing " << path << " (" << width << "x" << height << ") " << iterations << " times." << endl;
+
+	ThreadPool threadPool;
+
+	MipChain mips;
+	GenerateMipChain(pixels, width, height, MipSettings(), mips, &threadPool);
+	stbi_image_free(pixels);
+
+	double megabytes = mips.data.size() / (1024.0 * 1024.0);
+	bool compressed = true;
+
+	for (auto format : { TextureFormat::BC1, TextureFormat::BC3, TextureFormat::BC5, TextureFormat::BC7 })
+	{
+		static const char* NAMES[] = { "RGBA8", "BC1", "BC3", "BC5", "BC7" };
+
+		TextureData texture;
+		auto start = Clock::now();
+		for (int i = 0; i < iterations && compressed; i++)
+		{
+			compressed = CompressTexture(mips, format, texture, &threadPool);
+		}
+		double seconds = SecondsSince(start) / iterations;
+
+		if (!compressed)
+		{
+			break;
+		}
+
+		vector<unsigned char> decoded;
+		DecompressLevel(texture, 0, decoded);
+		float psnr = ComputePsnr(mips.GetLevelData(0), decoded.data(), static_cast<size_t>(width) * height, GetPsnrChannels(format));
+
+		cout << NAMES[static_cast<int>(format)] << ": " << seconds * 1000.0 << " ms, " << megabytes / seconds << " MB/s on "
+			<< threadPool.GetThreadCount() << " threads, " << static_cast<double>(mips.data.size()) / texture.data.size() << ":1, PSNR " << psnr << " dB" << endl;
+	}
+
+	return compressed;
+}
+
+bool Benchmarks::RunDerivedDataCache(const char* path, int iterations)
+{
+	auto directory = (std::filesystem::temp_directory_path() / "TinyEngineBenchDDC").string();
+	std::error_code error;
+	std::filesystem::remove_all(directory, error);
+
+	ThreadPool threadPool;
+	DerivedDataCache cache(directory.c_str());
+
+	uint64_t key;
+	if (!HashFile(path, key))
+	{
+		cout << "Could not load benchmark file: " << path << endl;
+		return false;
+	}
+
+	// Cold, decode and store as AssetManager does on a miss.
+	auto coldStart = Clock::now();
+
+	int width, height, bpp;
+	unsigned char* pixels = stbi_load(path, &width, &height, &bpp, STBI_rgb_alpha);
+	if (!pixels)
+	{
+		cout << "Could not load benchmark file: " << path << endl;
+		return false;
+	}
+
+	MipChain mips;
+	GenerateMipChain(pixels, width, height, MipSettings(), mips, &threadPool);
+	stbi_image_free(pixels);
+
+	TextureData decoded;
+	MoveMipChain(std::move(mips), decoded);
+
+	string cachedPath;
+	cache.Find(key, cachedPath);
+	auto writePath = cache.GetWritePath(key);
+	bool stored = WriteDds(writePath.c_str(), decoded) && cache.Commit(key, writePath);
+
+	double coldSeconds = SecondsSince(coldStart);
+
+	// Warm, hash the source and read the entry back.
+	bool matches = stored;
+	auto warmStart = Clock::now();
+	for (int i = 0; i < iterations && matches; i++)
+	{
+		uint64_t warmKey;
+		TextureData texture;
+		matches = HashFile(path, warmKey) && cache.Find(warmKey, cachedPath) && ReadDds(cachedPath.c_str(), texture) && texture.data == decoded.data;
+	}
+	double warmSeconds = SecondsSince(warmStart) / iterations;
+
+	// The floor for a warm load, reading the bytes with nothing else.
+	auto readStart = Clock::now();
+	for (int i = 0; i < iterations && matches; i++)
+	{
+		std::ifstream file(cachedPath, std::ios::binary);
+		vector<char> bytes(static_cast<size_t>(std::filesystem::file_size(cachedPath, error)));
+		file.read(bytes.data(), bytes.size());
+	}
+	double readSeconds = SecondsSince(readStart) / iterations;
+
+	auto stats = cache.GetStats();
+	cout << "Derived data cache for " << path << " (" << width << "x" << height << "), " << stats.bytes / 1024 << " KB entry:" << endl;
+	cout << "	cold " << coldSeconds * 1000.0 << " ms, warm " << warmSeconds * 1000.0 << " ms, reading the entry alone "
+		<< readSeconds * 1000.0 << " ms" << endl;
+
+	// Shrinking the limit below two entries evicts the least recently used one.
+	uint64_t otherKey = key + 1;
+	auto otherPath = cache.GetWritePath(otherKey);
+	bool evicted = WriteDds(otherPath.c_str(), decoded) && cache.Commit(otherKey, otherPath);
+	cache.Find(key, cachedPath);
+	cache.SetMaxBytes(stats.bytes * 3 / 2);
+	evicted = evicted && cache.Find(key, cachedPath) && !cache.Find(otherKey, cachedPath);
+
+	stats = cache.GetStats();
+	cout << "	" << stats.hits << " hits, " << stats.misses << " misses, " << stats.stores << " stores, " << stats.evictions << " evictions, "
+		<< (evicted ? "least recently used entry evicted" : "eviction did NOT follow use order") << endl;
+
+	std::filesystem::remove_all(directory, error);
+
+	if (!matches)
+	{
+		cout << "The cached texture does NOT match the decoded one." << endl;
+	}
+
+	return matches && evicted;
+}
+
+bool Benchmarks::RunTextureStreaming(int textures, int frames)
+{
+	const float SPACING = 4.0f;
+	const float SCREEN_HEIGHT = 1080.0f;
+	const uint64_t BUDGET = 128ull * 1024 * 1024;
+	const unsigned int READS_PER_FRAME = 4;
+
+	TextureData layout;
+	layout.format = TextureFormat::BC7;
+	LayoutTextureLevels(layout, 2048, 2048, 12);
+
+	TextureResidency residency(BUDGET);
+
+	// Unit spheres on a square grid, texture coordinates spanning about half a unit per unit.
+	int side = static_cast<int>(ceil(sqrt(static_cast<double>(textures))));
+	vector<XMFLOAT3> positions;
+	vector<unsigned int> ids;
+	vector<unsigned int> resident;
+	for (int i = 0; i < textures; i++)
+	{
+		positions.push_back({ (i % side) * SPACING, 0.0f, (i / side) * SPACING });
+		ids.push_back(residency.Add(layout));
+		resident.push_back(residency.GetTailLevel(ids.back()));
+	}
+
+	float extent = (side - 1) * SPACING;
+	auto projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 1000.0f);
+
+	uint64_t peakTarget = 0;
+	uint64_t peakResident = 0;
+	double missingWanted = 0.0;
+	double missingResident = 0.0;
+	unsigned int reads = 0;
+	double updateSeconds = 0.0;
+
+	for (int frame = 0; frame < frames; frame++)
+	{
+		// Circle the field low enough to pass close by the objects on one side and see far ones on the other.
+		float t = static_cast<float>(frame) / frames * XM_2PI;
+		XMVECTOR eye = XMVectorSet(extent * 0.5f + cosf(t) * extent * 0.45f, 1.5f + sinf(t * 3.0f), extent * 0.5f + sinf(t) * extent * 0.45f, 1.0f);
+		XMVECTOR at = XMVectorSet(extent * 0.5f + cosf(t + 0.6f) * extent * 0.45f, 0.0f, extent * 0.5f + sinf(t + 0.6f) * extent * 0.45f, 1.0f);
+		auto view = XMMatrixLookAtLH(eye, at, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+
+		auto start = Clock::now();
+
+		for (int i = 0; i < textures; i++)
+		{
+			auto world = XMMatrixTranslation(positions[i].x, positions[i].y, positions[i].z);
+			auto demand = ComputeTextureDemand(0.5f, { 0.0f, 0.0f, 0.0f }, 1.0f, world, view, projection, SCREEN_HEIGHT);
+			if (demand.screenArea > 0.0f)
+			{
+				residency.Request(ids[i], demand);
+			}
+		}
+
+		residency.Update();
+
+		updateSeconds += SecondsSince(start);
+
+		// Move the resident levels towards their targets a few reads a frame, one read can span any number of levels.
+		// Like AssetManager, reads which drop levels go first and reads which add them wait until they fit.
+		uint64_t residentBytes = 0;
+		for (int i = 0; i < textures; i++)
+		{
+			residentBytes += residency.GetBytesFrom(ids[i], resident[i]);
+		}
+
+		unsigned int frameReads = 0;
+		for (bool adding : { false, true })
+		{
+			for (int i = 0; i < textures && frameReads < READS_PER_FRAME; i++)
+			{
+				unsigned int target = residency.GetTargetLevel(ids[i]);
+				if (target == resident[i] || (target < resident[i]) != adding)
+				{
+					continue;
+				}
+
+				uint64_t bytes = residentBytes - residency.GetBytesFrom(ids[i], resident[i]) + residency.GetBytesFrom(ids[i], target);
+				if (adding && bytes > BUDGET)
+				{
+					continue;
+				}
+
+				residentBytes = bytes;
+				resident[i] = target;
+				frameReads++;
+			}
+		}
+
+		for (int i = 0; i < textures; i++)
+		{
+			unsigned int wanted = residency.GetWantedLevel(ids[i]);
+			missingResident += resident[i] > wanted ? resident[i] - wanted : 0;
+		}
+		reads += frameReads;
+
+		auto stats = residency.GetStats();
+		peakTarget = std::max(peakTarget, stats.targetBytes);
+		peakResident = std::max(peakResident, residentBytes);
+		missingWanted += stats.missingLevels;
+	}
+
+	auto stats = residency.GetStats();
+	uint64_t fullBytes = residency.GetBytesFrom(ids.empty() ? 0 : ids[0], 0) * textures;
+
+	cout << "Texture streaming for " << textures << " 2048x2048 BC7 textures (" << fullBytes / (1024 * 1024) << " MB in full) over "
+		<< frames << " frames, " << BUDGET / (1024 * 1024) << " MB budget:" << endl;
+	cout << "	peak targeted " << peakTarget / (1024 * 1024) << " MB, peak resident " << peakResident / (1024 * 1024) << " MB, last frame wanted "
+		<< stats.wantedBytes / (1024 * 1024) << " MB" << endl;
+	cout << "	" << missingWanted / frames / textures << " levels short of wanted by the budget, "
+		<< missingResident / frames / textures << " short once resident, per texture per frame" << endl;
+	cout << "	" << stats.levelsLoaded << " levels targeted, " << stats.levelsEvicted << " evicted, " << reads << " reads, "
+		<< updateSeconds / frames * 1000.0 << " ms/update" << endl;
+
+	bool withinBudget = peakTarget <= BUDGET && peakResident <= BUDGET;
+	if (!withinBudget)
+	{
+		cout << "The targeted or resident levels exceeded the budget." << endl;
+	}
+
+	// Block compressed textures can only start at levels of whole blocks, however thin or oddly sized.
+	bool wholeBlocks = true;
+	const int sizes[][2] = { { 2048, 2048 }, { 2048, 64 }, { 4096, 8 }, { 1000, 1000 }, { 12, 4 } };
+	for (const auto& size : sizes)
+	{
+		TextureData thin;
+		thin.format = TextureFormat::BC1;
+		LayoutTextureLevels(thin, size[0], size[1], 1 + static_cast<unsigned int>(log2(std::max(size[0], size[1]))));
+
+		const auto& tail = thin.levels[GetAlwaysResidentLevel(thin)];
+		if (tail.width % 4 != 0 || tail.height % 4 != 0)
+		{
+			cout << "The always resident levels of a " << size[0] << "x" << size[1] << " BC1 texture start at " << tail.width << "x" << tail.height << "." << endl;
+			wholeBlocks = false;
+		}
+	}
+
+	return withinBudget && wholeBlocks;
+}
+
+bool Benchmarks::RunRenderQueue(int draws, int iterations)
+{
+	const int SHADERS = 8;
+	const int MATERIALS = 256;
+	const int MESHES = 1024;
+	const int PARTS = 4;
+
+	// The queue never looks at what its pointers point to, so these only need to be distinct.
+	vector<char> identities(SHADERS + MATERIALS + MESHES);
+	auto shader = [&identities](int i) { return reinterpret_cast<Shader*>(&identities[i]); };
+	auto material = [&identities](int i) { return reinterpret_cast<Material*>(&identities[SHADERS + i]); };
+	auto mesh = [&identities](int i) { return reinterpret_cast<Mesh*>(&identities[SHADERS + MATERIALS + i]); };
+
+	struct Draw
+	{
+		int mesh;
+		int material;
+		int shader;
+		float depth;
+		bool transparent;
+	};
+
+	uint32_t seed = 12345;
+	auto random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return seed >> 8;
+	};
+
+	vector<Draw> source;
+	for (int i = 0; i < draws; i++)
+	{
+		Draw draw;
+		draw.mesh = random() % MESHES;
+		draw.material = random() % MATERIALS;
+		// Materials use one shader each, as they would in a scene.
+		draw.shader = draw.material % SHADERS;
+		draw.depth = 0.5f + (random() % 100000) * 0.01f;
+		draw.transparent = random() % 5 == 0;
+		source.push_back(draw);
+	}
+
+	auto queue = [&](RenderQueue& renderQueue)
+	{
+		for (int i = 0; i < draws; i += PARTS)
+		{
+			auto object = renderQueue.AddObject(mesh(source[i].mesh), XMMatrixIdentity(), XMMatrixIdentity(), XMMatrixIdentity(), { 0.0f, 0.0f, 0.0f }, 0);
+			for (int part = 0; part < PARTS && i + part < draws; part++)
+			{
+				const auto& draw = source[i + part];
+				auto pass = draw.transparent ? RenderPass::TRANSPARENT_PASS : RenderPass::OPAQUE_PASS;
+				renderQueue.AddDraw(object, part, material(draw.material), shader(draw.shader), pass, draw.depth);
+			}
+		}
+	};
+
+	RenderQueue renderQueue;
+	double queueSeconds = 0.0;
+	double sortSeconds = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		renderQueue.Clear();
+
+		auto start = Clock::now();
+		queue(renderQueue);
+		queueSeconds += SecondsSince(start);
+
+		start = Clock::now();
+		renderQueue.Sort();
+		sortSeconds += SecondsSince(start);
+	}
+
+	// The same keys through a comparison sort, for reference.
+	vector<uint64_t> keys;
+	for (size_t i = 0; i < renderQueue.GetDrawCount(); i++)
+	{
+		keys.push_back(renderQueue.GetSortedDraw(i).key);
+	}
+
+	double stableSortSeconds = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		vector<uint64_t> shuffled(keys.rbegin(), keys.rend());
+		for (size_t k = shuffled.size(); k > 1; k--)
+		{
+			std::swap(shuffled[k - 1], shuffled[random() % k]);
+		}
+
+		auto start = Clock::now();
+		std::stable_sort(shuffled.begin(), shuffled.end());
+		stableSortSeconds += SecondsSince(start);
+	}
+
+	// Unbatched, so every draw can be checked.
+	RecordingRenderBackend backend;
+	renderQueue.Submit(backend, false);
+
+	// Check the order against the draws themselves rather than their keys.
+	bool ordered = backend.draws.size() == static_cast<size_t>(draws) && renderQueue.GetDrawCount() == 0;
+	unsigned int stateChanges = 0;
+	for (size_t i = 1; ordered && i < backend.draws.size(); i++)
+	{
+		const auto& a = backend.draws[i - 1].draw;
+		const auto& b = backend.draws[i].draw;
+		bool aTransparent = (a.key >> 62) != 0;
+		bool bTransparent = (b.key >> 62) != 0;
+
+		ordered = a.key <= b.key && (!aTransparent || bTransparent);
+
+		// Depths which quantize the same are ordered by state instead.
+		auto depth = [&source](const RenderDraw& draw)
+		{
+			return RenderQueue::QuantizeDepth(source[draw.object * PARTS + draw.part].depth);
+		};
+
+		if (ordered && aTransparent && bTransparent)
+		{
+			ordered = depth(a) >= depth(b);
+		}
+		else if (ordered && !aTransparent && !bTransparent && a.shader == b.shader && a.material == b.material
+			&& source[a.object * PARTS].mesh == source[b.object * PARTS].mesh)
+		{
+			ordered = depth(a) <= depth(b);
+		}
+
+		if (a.shader != b.shader || a.material != b.material)
+		{
+			stateChanges++;
+		}
+	}
+
+	cout << "Render queue of " << draws << " draws, " << SHADERS << " shaders, " << MATERIALS << " materials and " << MESHES << " meshes:" << endl;
+	cout << "	queue " << queueSeconds / iterations * 1000.0 << " ms, radix sort " << sortSeconds / iterations * 1000.0
+		<< " ms, std::stable_sort " << stableSortSeconds / iterations * 1000.0 << " ms" << endl;
+	cout << "	" << stateChanges << " shader or material changes submitted, " << (ordered ? "order is correct" : "order is WRONG") << endl;
+
+	return ordered;
+}
+
+namespace
+{
+	// Counts what it is submitted, and sums the instances' translations to check none are lost or repeated.
+	class CountingRenderBackend :
+		public RenderBackend
+	{
+	public:
+		unsigned int draws = 0;
+		unsigned int instances = 0;
+		double translationSum = 0.0;
+
+		virtual void Draw(const RenderObject&, const RenderDraw&, const XMFLOAT4X4* worlds, unsigned int instanceCount) override
+		{
+			draws++;
+			instances += instanceCount;
+
+			for (unsigned int i = 0; i < instanceCount; i++)
+			{
+				translationSum += worlds[i]._41 + worlds[i]._42 + worlds[i]._43;
+			}
+		}
+	};
+}
+
+bool Benchmarks::RunInstancing(int objects, int iterations)
+{
+	const int MESHES = 4;
+	const int MATERIALS = 8;
+	const int PARTS = 2;
+	const int INSTANCED = 1000;
+
+	// As in RunRenderQueue, only the pointers' identities matter.
+	vector<char> identities(MESHES + MATERIALS + 1);
+	auto mesh = [&identities](int i) { return reinterpret_cast<Mesh*>(&identities[i]); };
+	auto material = [&identities](int i) { return reinterpret_cast<Material*>(&identities[MESHES + i]); };
+	auto* shader = reinterpret_cast<Shader*>(&identities[MESHES + MATERIALS]);
+
+	struct Actor
+	{
+		int mesh;
+		int materials[PARTS];
+		XMFLOAT4X4 world;
+	};
+
+	uint32_t seed = 12345;
+	auto random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return seed >> 8;
+	};
+
+	// Each actor draws a mesh with a material per part, the last material is transparent.
+	vector<Actor> actors;
+	for (int i = 0; i < objects; i++)
+	{
+		Actor actor;
+		actor.mesh = random() % MESHES;
+		for (auto& part : actor.materials)
+		{
+			part = random() % MATERIALS;
+		}
+
+		XMStoreFloat4x4(&actor.world, XMMatrixTranslation((random() % 2000) * 0.1f - 100.0f, (random() % 2000) * 0.1f - 100.0f, 1.0f + (random() % 10000) * 0.1f));
+		actors.push_back(actor);
+	}
+
+	// One mesh drawn through AddInstancedObject too, as DrawMeshInstanced does, which batches with the actors like it.
+	vector<XMFLOAT4X4> instanced(INSTANCED);
+	for (auto& world : instanced)
+	{
+		XMStoreFloat4x4(&world, XMMatrixTranslation((random() % 2000) * 0.1f, 0.0f, 1.0f + (random() % 10000) * 0.1f));
+	}
+
+	auto queue = [&](RenderQueue& renderQueue)
+	{
+		auto addParts = [&](unsigned int object, const int* materials, float depth)
+		{
+			for (int part = 0; part < PARTS; part++)
+			{
+				auto pass = materials[part] == MATERIALS - 1 ? RenderPass::TRANSPARENT_PASS : RenderPass::OPAQUE_PASS;
+				renderQueue.AddDraw(object, part, material(materials[part]), shader, pass, depth);
+			}
+		};
+
+		for (const auto& actor : actors)
+		{
+			auto object = renderQueue.AddObject(mesh(actor.mesh), XMLoadFloat4x4(&actor.world), XMMatrixIdentity(), XMMatrixIdentity(), { 0.0f, 0.0f, 0.0f }, 0);
+			addParts(object, actor.materials, actor.world._43);
+		}
+
+		int materials[PARTS] = { 0, 1 };
+		auto object = renderQueue.AddInstancedObject(mesh(0), instanced.data(), INSTANCED, XMMatrixIdentity(), XMMatrixIdentity(), { 0.0f, 0.0f, 0.0f }, 0);
+		addParts(object, materials, 1.0f);
+	};
+
+	// Opaque draws of a mesh, part and material are sorted next to each other, so they should make one draw each.
+	std::set<std::tuple<int, int, int>> opaqueGroups = { { 0, 0, 0 }, { 0, 1, 1 } };
+	unsigned int transparentParts = 0;
+	for (const auto& actor : actors)
+	{
+		for (int part = 0; part < PARTS; part++)
+		{
+			if (actor.materials[part] == MATERIALS - 1)
+			{
+				transparentParts++;
+			}
+			else
+			{
+				opaqueGroups.insert({ actor.mesh, part, actor.materials[part] });
+			}
+		}
+	}
+
+	RenderQueue renderQueue;
+	CountingRenderBackend unbatched, batched;
+	double unbatchedSeconds = 0.0;
+	double batchedSeconds = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		unbatched = CountingRenderBackend();
+		auto start = Clock::now();
+		queue(renderQueue);
+		renderQueue.Submit(unbatched, false);
+		unbatchedSeconds += SecondsSince(start);
+
+		batched = CountingRenderBackend();
+		start = Clock::now();
+		queue(renderQueue);
+		renderQueue.Submit(batched, true);
+		batchedSeconds += SecondsSince(start);
+	}
+
+	const unsigned int parts = static_cast<unsigned int>(actors.size() + 1) * PARTS;
+	const unsigned int instances = static_cast<unsigned int>(actors.size() + INSTANCED) * PARTS;
+
+	// Transparent draws are sorted back to front, so they only batch when neighbours happen to match.
+	bool correct = unbatched.draws == parts && unbatched.instances == instances
+		&& batched.instances == instances && batched.translationSum == unbatched.translationSum
+		&& batched.draws >= opaqueGroups.size() && batched.draws - opaqueGroups.size() <= transparentParts;
+
+	// Record the batched submit again to count its opaque draws.
+	RecordingRenderBackend recording;
+	queue(renderQueue);
+	renderQueue.Submit(recording, true);
+
+	size_t opaqueDraws = 0;
+	for (const auto& record : recording.draws)
+	{
+		if (static_cast<RenderPass>(record.draw.key >> (64 - RenderQueue::PASS_BITS)) == RenderPass::OPAQUE_PASS)
+		{
+			opaqueDraws++;
+		}
+	}
+
+	correct = correct && opaqueDraws == opaqueGroups.size();
+
+	cout << "Instancing " << objects << " objects of " << PARTS << " parts over " << MESHES << " meshes and " << MATERIALS
+		<< " materials, plus " << INSTANCED << " instances of one mesh:" << endl;
+	cout << "	unbatched: " << unbatched.draws << " draws of " << unbatched.instances << " instances, queue and submit "
+		<< unbatchedSeconds / iterations * 1000.0 << " ms" << endl;
+	cout << "	batched: " << batched.draws << " draws (" << opaqueDraws << " opaque, " << opaqueGroups.size() << " mesh, part and material groups) of "
+		<< batched.instances << " instances, queue and submit " << batchedSeconds / iterations * 1000.0 << " ms" << endl;
+	cout << "	" << (correct ? "batching is correct" : "batching is WRONG") << endl;
+
+	return correct;
+}
+
+bool Benchmarks::RunRingAllocator(int frames)
+{
+	const unsigned int CAPACITY = 1 << 16;
+	const unsigned int FRAMES_IN_FLIGHT = 3;
+
+	struct Range
+	{
+		unsigned int offset;
+		unsigned int size;
+	};
+
+	uint32_t seed = 12345;
+	auto random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return seed >> 8;
+	};
+
+	// Frames vary from empty or nearly empty to more than the ring can hold alongside the frames in flight.
+	// Empty frames retire while the ring is empty, which mustn't move the tail back over later frames.
+	auto frameCount = [&random]()
+	{
+		unsigned int kind = random() % 8;
+		return kind == 0 ? 0 : kind == 1 ? 1 + random() % 2 : 1 + random() % 64;
+	};
+
+	RingAllocator allocator(CAPACITY, FRAMES_IN_FLIGHT);
+
+	// Ranges of the current frame and those still in flight, which no allocation may overlap.
+	std::deque<vector<Range>> live(1);
+	unsigned int allocations = 0;
+	unsigned int failures = 0;
+	unsigned int wraps = 0;
+	unsigned int last = 0;
+	bool correct = allocator.Allocate(0) == 0 && allocator.GetAllocatedSize() == 0;
+
+	for (int frame = 0; frame < frames && correct; frame++)
+	{
+		unsigned int count = frameCount();
+		for (unsigned int i = 0; i < count && correct; i++)
+		{
+			unsigned int size = 16 + random() % 1024;
+			unsigned int alignment = random() % 2 ? 256 : 16;
+			unsigned int offset = allocator.Allocate(size, alignment);
+			if (offset == RingAllocator::INVALID_OFFSET)
+			{
+				failures++;
+				continue;
+			}
+
+			allocations++;
+			if (offset < last)
+			{
+				wraps++;
+			}
+
+			last = offset + size;
+
+			correct = offset % alignment == 0 && offset + size <= CAPACITY;
+			for (const auto& ranges : live)
+			{
+				for (const auto& range : ranges)
+				{
+					correct = correct && (offset + size <= range.offset || range.offset + range.size <= offset);
+				}
+			}
+
+			live.back().push_back({ offset, size });
+		}
+
+		allocator.EndFrame();
+		live.emplace_back();
+		if (live.size() > FRAMES_IN_FLIGHT + 1)
+		{
+			live.pop_front();
+		}
+
+		unsigned int liveSize = 0;
+		for (const auto& ranges : live)
+		{
+			for (const auto& range : ranges)
+			{
+				liveSize += range.size;
+			}
+		}
+
+		correct = correct && allocator.GetAllocatedSize() >= liveSize && allocator.GetAllocatedSize() <= CAPACITY;
+	}
+
+	// The same frames again without checking them, to time the allocator alone. It should fail the same allocations.
+	RingAllocator timed(CAPACITY, FRAMES_IN_FLIGHT);
+	seed = 12345;
+	unsigned int timedFailures = 0;
+
+	auto start = Clock::now();
+	for (int frame = 0; frame < frames; frame++)
+	{
+		unsigned int count = frameCount();
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int size = 16 + random() % 1024;
+			if (timed.Allocate(size, random() % 2 ? 256 : 16) == RingAllocator::INVALID_OFFSET)
+			{
+				timedFailures++;
+			}
+		}
+
+		timed.EndFrame();
+	}
+
+	double seconds = SecondsSince(start);
+	correct = correct && timedFailures == failures;
+
+	// Once every frame has retired the whole ring is free again.
+	for (unsigned int i = 0; i <= FRAMES_IN_FLIGHT; i++)
+	{
+		allocator.EndFrame();
+	}
+
+	correct = correct && allocator.GetAllocatedSize() == 0 && allocator.Allocate(CAPACITY, 256) == 0 && allocator.Allocate(1) == RingAllocator::INVALID_OFFSET;
+
+	allocator.Reset();
+	correct = correct && allocator.GetFreeSize() == CAPACITY;
+
+	// A frame which empties the ring, then an empty frame retiring after the ring starts again from 0.
+	// The range from 0 is still in flight, so nothing else fits.
+	RingAllocator small(100, 1);
+	correct = correct && small.Allocate(80) == 0;
+	small.EndFrame();
+	small.EndFrame();
+	correct = correct && small.Allocate(90) == 0;
+	small.EndFrame();
+	correct = correct && small.Allocate(30) == RingAllocator::INVALID_OFFSET && small.GetAllocatedSize() == 90;
+
+	cout << "Ring allocator of " << CAPACITY << " bytes, " << FRAMES_IN_FLIGHT << " frames in flight, " << frames << " frames:" << endl;
+	cout << "	" << allocations << " allocations, " << wraps << " wraps, " << failures << " failed for lack of space, "
+		<< seconds / (allocations + failures) * 1e9 << " ns per allocation" << endl;
+	cout << "	" << (correct ? "no live ranges overlap" : "ranges are WRONG") << endl;
+
+	return correct;
+}
+
+bool Benchmarks::RunFrustumCulling(int boxes, int iterations)
+{
+	uint32_t seed = 12345;
+	auto random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / static_cast<float>(1 << 24);
+	};
+
+	// A camera at the origin of a field of boxes, so about a twentieth of them are in view.
+	auto view = XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	auto projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 500.0f);
+
+	auto start = Clock::now();
+	auto frustum = MakeFrustum(view * projection);
+	double frustumSeconds = SecondsSince(start);
+
+	vector<Bounds> bounds(boxes);
+	for (auto& box : bounds)
+	{
+		box.center = XMFLOAT3(random() * 1000.0f - 500.0f, random() * 1000.0f - 500.0f, random() * 1000.0f - 500.0f);
+		box.extents = XMFLOAT3(0.1f + random() * 5.0f, 0.1f + random() * 5.0f, 0.1f + random() * 5.0f);
+		box.radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&box.extents)));
+	}
+
+	FrustumCuller culler;
+	culler.Reserve(boxes);
+
+	start = Clock::now();
+	for (const auto& box : bounds)
+	{
+		culler.Add(box);
+	}
+
+	double addSeconds = SecondsSince(start);
+
+	vector<unsigned int> visible;
+	vector<unsigned int> reference;
+	visible.reserve(boxes);
+	reference.reserve(boxes);
+
+	start = Clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		culler.Cull(frustum, visible);
+	}
+
+	double simdSeconds = SecondsSince(start) / iterations;
+
+	start = Clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		culler.CullReference(frustum, reference);
+	}
+
+	double referenceSeconds = SecondsSince(start) / iterations;
+
+	bool correct = visible == reference;
+
+	// A box whose center is inside can never be culled.
+	unsigned int centersInside = 0;
+	for (int i = 0; i < boxes; i++)
+	{
+		auto center = XMVectorSetW(XMLoadFloat3(&bounds[i].center), 1.0f);
+
+		bool inside = true;
+		for (const auto& plane : frustum.planes)
+		{
+			inside = inside && XMVectorGetX(XMVector4Dot(XMLoadFloat4(&plane), center)) >= 0.0f;
+		}
+
+		if (inside)
+		{
+			centersInside++;
+			correct = correct && std::binary_search(visible.begin(), visible.end(), static_cast<unsigned int>(i));
+		}
+	}
+
+	const char* path = HasAvx2() ? "AVX" : "SSE";
+
+	cout << "Frustum culling " << boxes << " boxes, " << iterations << " iterations, " << visible.size() << " in view, "
+		<< centersInside << " of them with their center inside:" << endl;
+	cout << "	Frustum made in " << frustumSeconds * 1e6 << " us, boxes added in " << addSeconds * 1000.0 << " ms" << endl;
+	cout << "	" << path << ": " << simdSeconds * 1000.0 << " ms, " << simdSeconds / boxes * 1e9 << " ns per box" << endl;
+	cout << "	Scalar: " << referenceSeconds * 1000.0 << " ms, " << referenceSeconds / boxes * 1e9 << " ns per box, "
+		<< referenceSeconds / simdSeconds << "x slower" << endl;
+	cout << "	" << (correct ? "both find the same boxes" : "visible boxes are WRONG") << endl;
+
+	return correct;
+}
+
+bool Benchmarks::RunBoundingVolumeHierarchy(int objects, int queries)
+{
+	uint32_t seed = 12345;
+	auto random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / static_cast<float>(1 << 24);
+	};
+
+	auto randomBounds = [&random]()
+	{
+		Bounds bounds;
+		bounds.center = XMFLOAT3(random() * 1000.0f - 500.0f, random() * 1000.0f - 500.0f, random() * 1000.0f - 500.0f);
+		bounds.extents = XMFLOAT3(0.5f + random() * 4.5f, 0.5f + random() * 4.5f, 0.5f + random() * 4.5f);
+		bounds.radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.extents)));
+		return bounds;
+	};
+
+	auto distanceSq = [](const Bounds& bounds, XMFLOAT3 point)
+	{
+		auto offset = XMVectorAbs(XMLoadFloat3(&point) - XMLoadFloat3(&bounds.center)) - XMLoadFloat3(&bounds.extents);
+		return XMVectorGetX(XMVector3LengthSq(XMVectorMax(offset, XMVectorZero())));
+	};
+
+	BoundingVolumeHierarchy tree;
+
+	// Objects by handle, to check every query against a scan of all of them.
+	vector<Bounds> bounds(objects);
+	vector<unsigned int> handles(objects);
+	vector<bool> live(objects, true);
+
+	auto start = Clock::now();
+	for (int i = 0; i < objects; i++)
+	{
+		bounds[i] = randomBounds();
+		handles[i] = tree.Insert(bounds[i], reinterpret_cast<void*>(static_cast<uintptr_t>(i)));
+	}
+
+	double insertSeconds = SecondsSince(start);
+	bool correct = tree.Validate() && tree.GetCount() == static_cast<unsigned int>(objects);
+	float insertedCost = tree.GetCost();
+	int insertedHeight = tree.GetHeight();
+
+	auto objectOf = [&tree](unsigned int handle)
+	{
+		return static_cast<int>(reinterpret_cast<uintptr_t>(tree.GetUserData(handle)));
+	};
+
+	auto sortedObjects = [&objectOf](const vector<unsigned int>& found)
+	{
+		vector<int> result;
+		for (auto handle : found)
+		{
+			result.push_back(objectOf(handle));
+		}
+
+		std::sort(result.begin(), result.end());
+		return result;
+	};
+
+	// Moving a tenth of them a frame: most stay inside their margins, a few stray past and one in a hundred jumps away.
+	start = Clock::now();
+	unsigned int moves = 0;
+	for (int frame = 0; frame < 60; frame++)
+	{
+		for (int i = frame % 10; i < objects; i += 10)
+		{
+			auto& object = bounds[i];
+			if (random() < 0.01f)
+			{
+				object.center = randomBounds().center;
+			}
+			else
+			{
+				object.center.x += random() * 0.2f - 0.1f;
+				object.center.y += random() * 0.2f - 0.1f;
+				object.center.z += random() * 0.2f - 0.1f;
+			}
+
+			tree.Update(handles[i], object);
+			moves++;
+		}
+	}
+
+	double moveSeconds = SecondsSince(start);
+	correct = correct && tree.Validate();
+	float movedCost = tree.GetCost();
+
+	start = Clock::now();
+	tree.Rebuild();
+	double rebuildSeconds = SecondsSince(start);
+	correct = correct && tree.Validate() && !tree.RebuildIfDegraded();
+	float rebuiltCost = tree.GetCost();
+
+	// Remove every third object.
+	for (int i = 0; i < objects; i += 3)
+	{
+		tree.Remove(handles[i]);
+		live[i] = false;
+	}
+
+	correct = correct && tree.Validate();
+
+	// Distance to the nearest live object along a ray, FLT_MAX if it hits none.
+	auto scanRay = [&](XMFLOAT3 point, XMFLOAT3 direction, float maxDistance)
+	{
+		float nearest = FLT_MAX;
+		for (int i = 0; i < objects; i++)
+		{
+			if (!live[i])
+			{
+				continue;
+			}
+
+			auto origin = XMLoadFloat3(&point);
+			auto inverse = XMVectorReciprocal(XMLoadFloat3(&direction));
+			auto minimum = XMLoadFloat3(&bounds[i].center) - XMLoadFloat3(&bounds[i].extents);
+			auto maximum = XMLoadFloat3(&bounds[i].center) + XMLoadFloat3(&bounds[i].extents);
+			auto t1 = (minimum - origin) * inverse;
+			auto t2 = (maximum - origin) * inverse;
+			auto near3 = XMVectorMin(t1, t2);
+			auto far3 = XMVectorMax(t1, t2);
+			float enter = std::max({ XMVectorGetX(near3), XMVectorGetY(near3), XMVectorGetZ(near3), 0.0f });
+			float exit = std::min({ XMVectorGetX(far3), XMVectorGetY(far3), XMVectorGetZ(far3), maxDistance });
+			if (enter <= exit)
+			{
+				nearest = std::min(nearest, enter);
+			}
+		}
+
+		return nearest;
+	};
+
+	double treeSeconds[4] = {};
+	double scanSeconds[4] = {};
+	size_t found[4] = {};
+
+	vector<unsigned int> result;
+	vector<int> expected;
+	for (int query = 0; query < queries && correct; query++)
+	{
+		XMFLOAT3 point = randomBounds().center;
+
+		// Frustum, against the SIMD culler over every live object.
+		auto view = XMMatrixLookToLH(XMLoadFloat3(&point), XMVector3Normalize(XMVectorSet(random() - 0.5f, random() - 0.5f, random() - 0.5f, 0.0f)),
+			XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		auto frustum = MakeFrustum(view * XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 200.0f));
+
+		start = Clock::now();
+		tree.QueryFrustum(frustum, result);
+		treeSeconds[0] += SecondsSince(start);
+		found[0] += result.size();
+
+		start = Clock::now();
+		FrustumCuller culler;
+		vector<int> culled;
+		for (int i = 0; i < objects; i++)
+		{
+			if (live[i])
+			{
+				culler.Add(bounds[i]);
+				culled.push_back(i);
+			}
+		}
+
+		vector<unsigned int> visible;
+		culler.Cull(frustum, visible);
+		scanSeconds[0] += SecondsSince(start);
+
+		expected.clear();
+		for (auto index : visible)
+		{
+			expected.push_back(culled[index]);
+		}
+
+		correct = correct && sortedObjects(result) == expected;
+
+		// Sphere.
+		float radius = 5.0f + random() * 45.0f;
+
+		start = Clock::now();
+		tree.QuerySphere(point, radius, result);
+		treeSeconds[1] += SecondsSince(start);
+		found[1] += result.size();
+
+		start = Clock::now();
+		expected.clear();
+		for (int i = 0; i < objects; i++)
+		{
+			if (live[i] && distanceSq(bounds[i], point) <= radius * radius)
+			{
+				expected.push_back(i);
+			}
+		}
+
+		scanSeconds[1] += SecondsSince(start);
+		correct = correct && sortedObjects(result) == expected;
+
+		// Ray, compared by distance as boxes can overlap where it enters them.
+		XMFLOAT3 direction;
+		XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSet(random() - 0.5f, random() - 0.5f, random() - 0.5f, 0.0f)));
+
+		float hitDistance = 0.0f;
+		start = Clock::now();
+		auto hit = tree.Raycast(point, direction, 2000.0f, &hitDistance);
+		treeSeconds[2] += SecondsSince(start);
+		found[2] += hit != BoundingVolumeHierarchy::INVALID_HANDLE;
+
+		start = Clock::now();
+		float nearest = scanRay(point, direction, 2000.0f);
+		scanSeconds[2] += SecondsSince(start);
+		correct = correct && (hit == BoundingVolumeHierarchy::INVALID_HANDLE ? nearest == FLT_MAX : fabsf(hitDistance - nearest) <= 1e-3f);
+
+		// Unbounded, which finds whatever is furthest along it too.
+		hit = tree.Raycast(point, direction, FLT_MAX, &hitDistance);
+		nearest = scanRay(point, direction, FLT_MAX);
+		correct = correct && (hit == BoundingVolumeHierarchy::INVALID_HANDLE ? nearest == FLT_MAX : fabsf(hitDistance - nearest) <= 1e-3f);
+
+		// Nearest 16, compared by distance as several boxes can be equally close.
+		const unsigned int K = 16;
+
+		start = Clock::now();
+		tree.QueryNearest(point, K, result);
+		treeSeconds[3] += SecondsSince(start);
+		found[3] += result.size();
+
+		start = Clock::now();
+		vector<float> distances;
+		for (int i = 0; i < objects; i++)
+		{
+			if (live[i])
+			{
+				distances.push_back(distanceSq(bounds[i], point));
+			}
+		}
+
+		std::partial_sort(distances.begin(), distances.begin() + std::min<size_t>(K, distances.size()), distances.end());
+		scanSeconds[3] += SecondsSince(start);
+
+		correct = correct && result.size() == std::min<size_t>(K, distances.size());
+		for (size_t i = 0; i < result.size() && correct; i++)
+		{
+			correct = fabsf(distanceSq(bounds[objectOf(result[i])], point) - distances[i]) <= 1e-3f;
+		}
+	}
+
+	// An unbounded ray leaving the furthest object along x from inside its margin passes through its box
+	// but misses its bounds and everything else.
+	int furthest = -1;
+	for (int i = 0; i < objects; i++)
+	{
+		if (live[i] && (furthest < 0 || bounds[i].center.x + bounds[i].extents.x > bounds[furthest].center.x + bounds[furthest].extents.x))
+		{
+			furthest = i;
+		}
+	}
+
+	if (furthest >= 0)
+	{
+		const auto& object = bounds[furthest];
+		XMFLOAT3 origin(object.center.x + object.extents.x + 0.05f, object.center.y, object.center.z);
+		correct = correct && tree.Raycast(origin, XMFLOAT3(1.0f, 0.0f, 0.0f), FLT_MAX, nullptr) == BoundingVolumeHierarchy::INVALID_HANDLE;
+	}
+
+	cout << "Bounding volume hierarchy of " << objects << " objects, " << queries << " queries of each kind after removing a third:" << endl;
+	cout << "	Inserted in " << insertSeconds * 1000.0 << " ms, height " << insertedHeight << ", cost " << insertedCost << endl;
+	cout << "	" << moves << " moves in " << moveSeconds * 1000.0 << " ms, " << moveSeconds / moves * 1e9 << " ns per move, cost " << movedCost << endl;
+	cout << "	Rebuilt in " << rebuildSeconds * 1000.0 << " ms, height " << tree.GetHeight() << ", cost " << rebuiltCost << endl;
+
+	const char* names[4] = { "Frustum", "Sphere", "Ray", "Nearest 16" };
+	for (int i = 0; i < 4; i++)
+	{
+		cout << "	" << names[i] << ": " << treeSeconds[i] / queries * 1e6 << " us against " << scanSeconds[i] / queries * 1e6 << " us scanning, "
+			<< static_cast<double>(found[i]) / queries << " found per query" << endl;
+	}
+
+	cout << "	" << (correct ? "every query matches a scan" : "queries are WRONG") << endl;
+
+	return correct;
+}
+
+namespace
+{
+	// A unit cube centered on the origin, 4 vertices per face so its triangles are each face's own,
+	// clockwise seen from outside.
+	void MakeBoxMesh(vector<XMFLOAT3>& positions, vector<unsigned int>& indices)
+	{
+		positions.clear();
+		indices.clear();
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			for (float sign : { -1.0f, 1.0f })
+			{
+				// Tangents whose cross product is the face's normal.
+				float n[3] = {};
+				float t[3] = {};
+				n[axis] = sign * 0.5f;
+				t[(axis + 1) % 3] = 0.5f;
+
+				XMVECTOR normal = XMVectorSet(n[0], n[1], n[2], 0.0f);
+				XMVECTOR tangent = XMVectorSet(t[0], t[1], t[2], 0.0f);
+				XMVECTOR bitangent = XMVector3Cross(normal, tangent) * 2.0f;
+
+				auto first = static_cast<unsigned int>(positions.size());
+				for (auto corner : { normal - tangent - bitangent, normal + tangent - bitangent, normal + tangent + bitangent, normal - tangent + bitangent })
+				{
+					XMFLOAT3 position;
+					XMStoreFloat3(&position, corner);
+					positions.push_back(position);
+				}
+
+				indices.insert(indices.end(), { first, first + 1, first + 2, first, first + 2, first + 3 });
+			}
+		}
+	}
+}
+
+bool Benchmarks::RunOcclusionCulling(int occludees, int iterations)
+{
+	uint32_t seed = 12345;
+	auto random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / static_cast<float>(1 << 24);
+	};
+
+	// A city of 20x20 blocks, each one building, seen from a street at head height where the nearest buildings
+	// hide most of the rest.
+	const int blocks = 20;
+	const float spacing = 20.0f;
+
+	vector<XMFLOAT3> boxPositions;
+	vector<unsigned int> boxIndices;
+	MakeBoxMesh(boxPositions, boxIndices);
+
+	vector<XMFLOAT4X4> buildings;
+	for (int x = 0; x < blocks; x++)
+	{
+		for (int z = 0; z < blocks; z++)
+		{
+			float width = 12.0f + random() * 4.0f;
+			float depth = 12.0f + random() * 4.0f;
+			float height = 10.0f + random() * 30.0f;
+
+			XMFLOAT4X4 world;
+			XMStoreFloat4x4(&world, XMMatrixScaling(width, height, depth)
+				* XMMatrixTranslation((x - blocks / 2) * spacing, height * 0.5f, z * spacing));
+			buildings.push_back(world);
+		}
+	}
+
+	auto view = XMMatrixLookToLH(XMVectorSet(10.0f, 2.0f, -10.0f, 1.0f), XMVectorSet(0.3f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	auto projection = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 1000.0f);
+	auto viewProjection = view * projection;
+
+	// Small boxes, people and cars, scattered over the streets and roofs of the city.
+	vector<Bounds> bounds(occludees);
+	for (auto& box : bounds)
+	{
+		box.center = XMFLOAT3((random() - 0.5f) * blocks * spacing, random() * 40.0f, random() * blocks * spacing);
+		box.extents = XMFLOAT3(0.5f + random() * 2.0f, 0.5f + random() * 2.0f, 0.5f + random() * 2.0f);
+		box.radius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&box.extents)));
+	}
+
+	OcclusionCuller culler;
+	ThreadPool threadPool;
+
+	double addSeconds = 0.0;
+	double serialSeconds = 0.0;
+	double parallelSeconds = 0.0;
+	double testSeconds = 0.0;
+
+	vector<float> serialDepth;
+	vector<float> parallelDepth;
+	vector<char> visible(occludees);
+
+	for (int i = 0; i < iterations; i++)
+	{
+		for (ThreadPool* pool : { static_cast<ThreadPool*>(nullptr), &threadPool })
+		{
+			culler.Clear();
+			culler.SetViewProjection(viewProjection);
+
+			auto start = Clock::now();
+			for (const auto& world : buildings)
+			{
+				culler.AddOccluder(boxPositions.data(), static_cast<unsigned int>(boxPositions.size()),
+					boxIndices.data(), static_cast<unsigned int>(boxIndices.size()), XMLoadFloat4x4(&world));
+			}
+
+			addSeconds += SecondsSince(start);
+
+			start = Clock::now();
+			culler.RenderOccluders(pool);
+			(pool ? parallelSeconds : serialSeconds) += SecondsSince(start);
+		}
+
+		auto start = Clock::now();
+		for (int j = 0; j < occludees; j++)
+		{
+			visible[j] = culler.TestBounds(bounds[j]);
+		}
+
+		testSeconds += SecondsSince(start);
+	}
+
+	addSeconds /= iterations * 2;
+	serialSeconds /= iterations;
+	parallelSeconds /= iterations;
+	testSeconds /= iterations;
+
+	// Rows are rasterized alone, in the same order, so threads change nothing.
+	culler.GetDepth(parallelDepth);
+	culler.Clear();
+	culler.SetViewProjection(viewProjection);
+	for (const auto& world : buildings)
+	{
+		culler.AddOccluder(boxPositions.data(), static_cast<unsigned int>(boxPositions.size()),
+			boxIndices.data(), static_cast<unsigned int>(boxIndices.size()), XMLoadFloat4x4(&world));
+	}
+
+	culler.RenderOccluders();
+	culler.GetDepth(serialDepth);
+	bool correct = serialDepth == parallelDepth;
+
+	// The masked buffer is never nearer than the exact one, so it can't hide anything the exact one shows.
+	vector<float> reference;
+	auto start = Clock::now();
+	culler.RasterizeReference(reference);
+	double referenceSeconds = SecondsSince(start);
+
+	unsigned int coveredPixels = 0;
+	for (size_t i = 0; i < reference.size(); i++)
+	{
+		correct = correct && serialDepth[i] >= reference[i];
+		coveredPixels += reference[i] < FLT_MAX;
+	}
+
+	unsigned int hidden = 0;
+	unsigned int referenceHidden = 0;
+	for (int j = 0; j < occludees; j++)
+	{
+		bool referenceVisible = culler.TestBoundsReference(bounds[j], reference);
+		correct = correct && (visible[j] || !referenceVisible);
+
+		hidden += !visible[j];
+		referenceHidden += !referenceVisible;
+	}
+
+	const auto& stats = culler.GetStats();
+
+	const char* path = HasAvx2() ? "AVX2" : "scalar";
+
+	cout << "Occlusion culling " << occludees << " boxes behind " << buildings.size() << " buildings at " << culler.GetWidth() << "x" << culler.GetHeight()
+		<< ", " << iterations << " iterations, " << path << " coverage:" << endl;
+	cout << "	" << stats.triangles << " occluder triangles added in " << addSeconds * 1000.0 << " ms, " << stats.rasterized << " left to rasterize, covering "
+		<< 100.0 * coveredPixels / reference.size() << "% of the screen" << endl;
+	cout << "	Rasterized in " << serialSeconds * 1000.0 << " ms on one thread, " << parallelSeconds * 1000.0 << " ms on "
+		<< threadPool.GetThreadCount() << " threads, " << referenceSeconds * 1000.0 << " ms with exact per pixel depth" << endl;
+	cout << "	Tested in " << testSeconds * 1000.0 << " ms, " << testSeconds / occludees * 1e9 << " ns per box" << endl;
+	cout << "	" << hidden << " hidden (off screen or occluded), " << referenceHidden << " by exact depth, "
+		<< (referenceHidden ? 100.0 * hidden / referenceHidden : 100.0) << "% found" << endl;
+	cout << "	" << (correct ? "nothing the exact depth shows is hidden" : "visible boxes are HIDDEN") << endl;
+
+	return correct;
+}
+
+namespace
+{
+	// A camera which stays where it is put.
+	class FixedCamera :
+		public ICamera
+	{
+	public:
+		XMFLOAT3 eyePosition;
+		XMFLOAT4X4 view;
+		XMFLOAT4X4 projection;
+
+		FixedCamera(FXMMATRIX viewMatrix, CXMMATRIX projectionMatrix, XMFLOAT3 eye) : eyePosition(eye)
+		{
+			XMStoreFloat4x4(&view, viewMatrix);
+			XMStoreFloat4x4(&projection, projectionMatrix);
+		}
+
+		virtual XMFLOAT3 GetEyePosition() override
+		{
+			return eyePosition;
+		}
+
+		virtual XMMATRIX GetView() override
+		{
+			return XMLoadFloat4x4(&view);
+		}
+
+		virtual XMMATRIX GetProjection() override
+		{
+			return XMLoadFloat4x4(&projection);
+		}
+	};
+
+	// A unit sphere of one part, with texture coordinates wrapping around it once.
+	MeshData MakeSphereMeshData(unsigned int slices, unsigned int stacks)
+	{
+		MeshData mesh;
+
+		for (unsigned int stack = 0; stack <= stacks; stack++)
+		{
+			float v = static_cast<float>(stack) / stacks;
+			float phi = v * XM_PI;
+
+			for (unsigned int slice = 0; slice <= slices; slice++)
+			{
+				float u = static_cast<float>(slice) / slices;
+				float theta = u * XM_2PI;
+
+				XMFLOAT3 normal(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta));
+				mesh.vertices.push_back(VertexStandard(normal, XMFLOAT2(u, v), normal));
+			}
+		}
+
+		// Clockwise seen from outside.
+		for (unsigned int stack = 0; stack < stacks; stack++)
+		{
+			for (unsigned int slice = 0; slice < slices; slice++)
+			{
+				unsigned int a = stack * (slices + 1) + slice;
+				unsigned int b = a + slices + 1;
+
+				mesh.indices.insert(mesh.indices.end(), { a, a + 1, b, a + 1, b + 1, b });
+			}
+		}
+
+		MeshDataPart part;
+		part.indexCount = static_cast<unsigned int>(mesh.indices.size());
+		part.vertexCount = static_cast<unsigned int>(mesh.vertices.size());
+		part.material = 0;
+		mesh.parts.push_back(part);
+
+		return mesh;
+	}
+}
+
+bool Benchmarks::RunSoftwareRenderer(int objects, int frames, const char* outputPath)
+{
+	const unsigned int width = 1280;
+	const unsigned int height = 720;
+
+	uint32_t seed = 12345;
+	auto random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / static_cast<float>(1 << 24);
+	};
+
+	auto sphere = MakeSphereMeshData(48, 24);
+
+	// A checkerboard, so the texture's levels show.
+	const int textureSize = 256;
+	vector<unsigned char> checker(textureSize * textureSize * 4);
+	for (int y = 0; y < textureSize; y++)
+	{
+		for (int x = 0; x < textureSize; x++)
+		{
+			unsigned char value = ((x / 16) + (y / 16)) % 2 ? 200 : 40;
+			auto* texel = &checker[(y * textureSize + x) * 4];
+			texel[0] = value;
+			texel[1] = value;
+			texel[2] = value;
+			texel[3] = 255;
+		}
+	}
+
+	MipChain checkerMips;
+	GenerateMipChain(checker.data(), textureSize, textureSize, MipSettings(), checkerMips);
+
+	SoftwareMaterial materials[4];
+	materials[0].diffuse = XMFLOAT3(0.8f, 0.2f, 0.2f);
+	materials[0].specular = XMFLOAT3(0.5f, 0.5f, 0.5f);
+	materials[0].specularExponent = 32.0f;
+	materials[1].diffuseTexture = &checkerMips;
+	materials[2].diffuse = XMFLOAT3(0.2f, 0.6f, 0.9f);
+	materials[2].ambient = XMFLOAT3(0.2f, 0.2f, 0.2f);
+	materials[3].diffuse = XMFLOAT3(0.1f, 0.1f, 0.1f);
+	materials[3].specularTexture = &checkerMips;
+
+	// Spheres of every size scattered in front of the camera, many of them overlapping.
+	vector<XMFLOAT4X4> worlds(objects);
+	for (auto& world : worlds)
+	{
+		float scale = 0.2f + random() * 1.5f;
+		XMStoreFloat4x4(&world, XMMatrixScaling(scale, scale, scale) * XMMatrixRotationY(random() * XM_2PI)
+			* XMMatrixTranslation(random() * 40.0f - 20.0f, random() * 20.0f - 10.0f, 5.0f + random() * 40.0f));
+	}
+
+	FixedCamera camera(XMMatrixLookToLH(XMVectorSet(0.0f, 0.0f, -5.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)),
+		XMMatrixPerspectiveFovLH(XM_PIDIV4, static_cast<float>(width) / height, 0.1f, 100.0f), XMFLOAT3(0.0f, 0.0f, -5.0f));
+
+	// Lit as the demo lights its scene.
+	SoftwareRenderer renderer(width, height);
+	XMStoreFloat3(&renderer.lights[0].direction, XMVector3Normalize(XMVectorSet(-1.0f, -1.0f, 0.0f, 0.0f)));
+	renderer.lights[0].color = { 1.0, 1.0, 1.0, 1.0f };
+	XMStoreFloat3(&renderer.lights[1].direction, XMVector3Normalize(XMVectorSet(1.0f, -1.0f, 0.0f, 0.0f)));
+	renderer.lights[1].color = { 0.0, 1.0, 1.0, 1.0f };
+	XMStoreFloat3(&renderer.lights[2].direction, XMVector3Normalize(XMVectorSet(-1.0f, -2.0f, -1.0f, 0.0f)));
+	renderer.lights[2].color = { 1.0, 0.0, 1.0, 1.0f };
+	renderer.ambientLight = { 0.1f, 0.1f, 0.2f, 0.5f };
+	renderer.SetClearColor({ 0.1f, 0.1f, 0.2f, 1.0f });
+
+	ThreadPool threadPool;
+
+	double drawSeconds[2] = {};
+	double renderSeconds[2] = {};
+	vector<unsigned char> images[2];
+
+	for (int threaded = 0; threaded < 2; threaded++)
+	{
+		for (int frame = 0; frame < frames; frame++)
+		{
+			renderer.Clear();
+
+			auto start = Clock::now();
+			for (int i = 0; i < objects; i++)
+			{
+				renderer.DrawMesh(sphere, { &materials[i % 4] }, &camera, XMLoadFloat4x4(&worlds[i]));
+			}
+
+			drawSeconds[threaded] += SecondsSince(start);
+
+			start = Clock::now();
+			renderer.Render(threaded ? &threadPool : nullptr);
+			renderSeconds[threaded] += SecondsSince(start);
+		}
+
+		drawSeconds[threaded] /= frames;
+		renderSeconds[threaded] /= frames;
+		images[threaded] = renderer.GetPixels();
+	}
+
+	auto stats = renderer.GetStats();
+
+	// Tiles are shaded alone, in the order their triangles were drawn, so threads change nothing.
+	bool correct = images[0] == images[1];
+
+	uint64_t hash = 14695981039346656037ull;
+	for (auto byte : images[1])
+	{
+		hash = (hash ^ byte) * 1099511628211ull;
+	}
+
+	if (outputPath)
+	{
+		correct = renderer.WritePng(outputPath) && correct;
+	}
+
+	// A screen of jittered triangles sharing their edges, each nearer than the last and drawn without
+	// sharing vertices, must shade every pixel exactly once: a gap leaves one unshaded and a pixel drawn
+	// by both triangles of an edge is shaded twice.
+	MeshData grid;
+	const int cells = 37;
+	vector<XMFLOAT2> corners((cells + 1) * (cells + 1));
+	for (int y = 0; y <= cells; y++)
+	{
+		for (int x = 0; x <= cells; x++)
+		{
+			float jitter = x > 0 && x < cells && y > 0 && y < cells ? 0.4f : 0.0f;
+			corners[y * (cells + 1) + x] = XMFLOAT2(
+				((x + (random() - 0.5f) * jitter) / cells) * 2.0f - 1.0f,
+				((y + (random() - 0.5f) * jitter) / cells) * 2.0f - 1.0f);
+		}
+	}
+
+	unsigned int gridTriangles = cells * cells * 2;
+	auto addVertex = [&](int x, int y)
+	{
+		float depth = 1.0f - static_cast<float>(grid.vertices.size() / 3 + 1) / (gridTriangles + 1);
+		const auto& corner = corners[y * (cells + 1) + x];
+		grid.indices.push_back(static_cast<unsigned int>(grid.vertices.size()));
+		grid.vertices.push_back(VertexStandard(XMFLOAT3(corner.x, corner.y, depth), XMFLOAT2(0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, -1.0f)));
+	};
+
+	for (int y = 0; y < cells; y++)
+	{
+		for (int x = 0; x < cells; x++)
+		{
+			// Clockwise on screen, whose y is up in clip space.
+			const int order[6][2] = { { 0, 0 }, { 0, 1 }, { 1, 1 }, { 0, 0 }, { 1, 1 }, { 1, 0 } };
+			for (const auto& corner : order)
+			{
+				addVertex(x + corner[0], y + corner[1]);
+			}
+		}
+	}
+
+	MeshDataPart gridPart;
+	gridPart.indexCount = static_cast<unsigned int>(grid.indices.size());
+	gridPart.vertexCount = static_cast<unsigned int>(grid.vertices.size());
+	grid.parts.push_back(gridPart);
+
+	FixedCamera clipCamera(XMMatrixIdentity(), XMMatrixIdentity(), XMFLOAT3(0.0f, 0.0f, -1.0f));
+	renderer.Clear();
+	renderer.DrawMesh(grid, { &materials[2] }, &clipCamera, XMMatrixIdentity());
+	renderer.Render(&threadPool);
+
+	bool watertight = renderer.GetStats().rasterized == gridTriangles && renderer.GetStats().pixelsShaded == width * height;
+	correct = correct && watertight;
+
+	const char* path = HasAvx2() ? "AVX" : "SSE";
+
+	double pixels = static_cast<double>(stats.pixelsShaded);
+
+	cout << "Software rendering " << objects << " spheres at " << width << "x" << height << ", " << frames << " frames, " << path << " vertex transform:" << endl;
+	cout << "	" << stats.triangles << " triangles drawn, " << stats.rasterized << " left after clipping and culling, "
+		<< stats.pixelsShaded << " pixels shaded" << endl;
+	for (int threaded = 0; threaded < 2; threaded++)
+	{
+		double seconds = drawSeconds[threaded] + renderSeconds[threaded];
+		cout << "	" << (threaded ? threadPool.GetThreadCount() : 1) << (threaded ? " threads: " : " thread: ") << seconds * 1000.0 << " ms per frame, "
+			<< drawSeconds[threaded] * 1000.0 << " ms transforming and binning, " << renderSeconds[threaded] * 1000.0 << " ms shading, "
+			<< stats.triangles / seconds / 1e6 << " M triangles/s, " << pixels / renderSeconds[threaded] / 1e6 << " M pixels/s" << endl;
+	}
+
+	cout << "	Image hash " << std::hex << hash << std::dec << (outputPath ? string(", written to ") + outputPath : string()) << endl;
+	cout << "	" << (images[0] == images[1] ? "same image on every thread count" : "images DIFFER between thread counts") << ", "
+		<< (watertight ? "edges shared by triangles are shaded exactly once" : "shared edges are NOT watertight") << endl;
+
+	return correct;
+}
+
+bool Benchmarks::RunGameFrames(const SyntheticSceneSettings& scene, int frames, const char* outputPath)
+{
+	const int width = 1600;
+	const int height = 900;
+	const float delta = 1.0f / 60.0f;
+
+	Game game(width, height, scene);
+	auto timings = game.RunFrames(static_cast<unsigned int>(frames), delta);
+
+	const auto& state = game.GetStateStats();
+
+	std::ostringstream json;
+	json << "{\"benchmark\": \"game_frames\", \"width\": " << width << ", \"height\": " << height << ", \"delta\": " << delta
+		<< ", \"scene\": {\"actors\": " << scene.actors << ", \"depth\": " << scene.depth << ", \"meshes\": " << scene.meshes
+		<< ", \"materials\": " << scene.materials << ", \"seed\": " << scene.seed << "}"
+		<< ", \"last_frame\": {\"visible\": " << game.GetVisibleCount() << ", \"occluded\": " << game.GetOccludedCount()
+		<< ", \"draws\": " << state.draws << ", \"instances\": " << state.instances << "}"
+		<< ", \"timings\": ";
+	timings.WriteJson(json);
+	json << "}";
+
+	bool complete = timings.GetFrameCount() == static_cast<unsigned int>(frames);
+
+	// Only the JSON goes to the output when there's no file, so it can be piped straight into other tools.
+	if (!outputPath)
+	{
+		cout << json.str() << endl;
+		return complete;
+	}
+
+	std::ofstream file(outputPath);
+	if (!file)
+	{
+		cout << "Could not open " << outputPath << " for writing." << endl;
+		return false;
+	}
+
+	file << json.str() << endl;
+
+	cout << "Ran " << timings.GetFrameCount() << " frames of " << scene.actors << " actors, " << scene.depth << " deep, with " << scene.meshes << " meshes and "
+		<< scene.materials << " materials at " << width << "x" << height << ":" << endl;
+	cout << "	Last frame: " << game.GetVisibleCount() << " meshes in view, " << game.GetOccludedCount() << " of them occluded, "
+		<< state.draws << " draws of " << state.instances << " instances" << endl;
+	for (unsigned int i = 0; i < FrameTimings::PHASE_COUNT; i++)
+	{
+		auto phase = static_cast<FramePhase>(i);
+		auto summary = timings.Summarize(phase);
+		cout << "	" << FrameTimings::GetPhaseName(phase) << ": " << summary.mean << " ms mean, " << summary.p50 << " ms p50, "
+			<< summary.p99 << " ms p99, " << summary.max << " ms max" << endl;
+	}
+	cout << "	Written to " << outputPath << endl;
+
+	return complete;
+}
+
+bool Benchmarks::WriteGridObj(const char* path, unsigned int triangles)
+{
+	FILE* file = nullptr;
+	if (fopen_s(&file, path, "wb") != 0 || !file)
+	{
+		cout << "Could not open " << path << " for writing." << endl;
+		return false;
+	}
+
+	auto quadsPerSide = static_cast<unsigned int>(sqrt(triangles / 2.0)) + 1;
+	auto verticesPerSide = quadsPerSide + 1;
+
+	fprintf(file, "# Generated grid, %u triangles\no Grid\n", quadsPerSide * quadsPerSide * 2);
+
+	for (unsigned int y = 0; y < verticesPerSide; y++)
+	{
+		for (unsigned int x = 0; x < verticesPerSide; x++)
+		{
+			float u = static_cast<float>(x) / quadsPerSide;
+			float v = static_cast<float>(y) / quadsPerSide;
+
+			fprintf(file, "v %f %f %f\n", u * 2.0f - 1.0f, sinf(u * 20.0f) * cosf(v * 20.0f) * 0.05f, v * 2.0f - 1.0f);
+			fprintf(file, "vt %f %f\n", u, v);
+		}
+	}
+
+	fprintf(file, "vn 0.0 1.0 0.0\n");
+
+	for (unsigned int y = 0; y < quadsPerSide; y++)
+	{
+		for (unsigned int x = 0; x < quadsPerSide; x++)
+		{
+			unsigned int i0 = y * verticesPerSide + x + 1;
+			unsigned int i1 = i0 + 1;
+			unsigned int i2 = i0 + verticesPerSide;
+			unsigned int i3 = i2 + 1;
+
+			fprintf(file, "f %u/%u/1 %u/%u/1 %u/%u/1\n", i0, i0, i2, i2, i1, i1);
+			fprintf(file, "f %u/%u/1 %u/%u/1 %u/%u/1\n", i1, i1, i2, i2, i3, i3);
+		}
+	}
+
+	fclose(file);
+
+	return true;
+}
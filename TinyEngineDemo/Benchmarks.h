@@ -0,0 +1,135 @@
+#pragma once
+
+#include "SyntheticScene.h"
+
+// Headless benchmarks which can be run from the command line instead of the game.
+// None of these need a window, and only RunGameFrames needs a D3D device.
+namespace Benchmarks
+{
+	// Compare the load throughput of TinyEngine::ObjParser against objl::Loader.
+	//	const char* path: .obj file to load
+	//	int iterations: Number of times the file is loaded by each parser
+	//	returns: false if the file couldn't be loaded or a threaded load differs from the serial one
+	bool RunObjLoad(const char* path, int iterations);
+
+	// Select levels of detail for randomly placed and scaled meshes from a sweep of distances, checking each
+	// choice is repeatable, never finer further away, and the coarsest level whose projected error is allowed.
+	//	int views: Number of meshes swept
+	//	returns: false if any selection is wrong
+	bool RunLodSelection(int views);
+
+	// Build meshlets for a mesh and cull them from a ring of cameras around it, reporting the build time,
+	// how much frustum and normal cone culling reject and what culling costs, and checking every triangle
+	// which drawing the whole mesh could show is in a meshlet which was kept.
+	//	const char* path: .obj file to load
+	//	int iterations: Number of times every camera is culled
+	//	returns: false if the file couldn't be loaded or culling rejected a triangle which can be seen
+	bool RunMeshletCulling(const char* path, int iterations);
+
+	// Allocate and free random sizes from a TinyEngine::RangeAllocator, as GeometryArena does for meshes, growing
+	// it when an allocation fails and defragmenting it now and then. Every range is checked against a model of the
+	// space for overlaps, free neighbours being merged and allocations only failing when no free range fits, and
+	// defragmenting is checked to keep every allocation's contents.
+	//	int operations: Number of allocations, frees and defragments
+	//	returns: false if any range is wrong
+	bool RunRangeAllocator(int operations);
+
+	// Generate mip chains for an image with every filter, timing the SIMD generator on one thread and on
+	// the thread pool against the scalar reference, and checking they agree to within one step.
+	//	const char* path: Image to load
+	//	int iterations: Number of times each chain is generated
+	//	returns: false if the image couldn't be loaded or the generators disagree
+	bool RunMipGeneration(const char* path, int iterations);
+
+	// Block compress an image's mip chain to every BC format, reporting encode throughput on the thread pool
+	// and the PSNR of each format's first level against the source.
+	//	const char* path: Image to load
+	//	int iterations: Number of times each format is compressed
+	//	returns: false if the image couldn't be loaded or compressed
+	bool RunBlockCompression(const char* path, int iterations);
+
+	// Load an image the way AssetManager does with a DerivedDataCache, timing a cold load which decodes and
+	// stores it against warm loads which hash the source and read the cached mips, and checking LRU eviction.
+	//	const char* path: Image to load
+	//	int iterations: Number of warm loads
+	//	returns: false if the image couldn't be loaded or the cache returned different texels
+	bool RunDerivedDataCache(const char* path, int iterations);
+
+	// Fly a simulated camera over a field of objects with large streamed textures, reporting how well
+	// TextureResidency keeps the levels they want under a budget and what each update costs. Levels become
+	// resident a few reads a frame, as AssetManager streams them.
+	//	int textures: Number of objects, each with its own 2048x2048 BC7 texture
+	//	int frames: Number of frames the camera path is split into
+	//	returns: false if the targeted or resident levels ever exceeded the budget
+	bool RunTextureStreaming(int textures, int frames);
+
+	// Queue random draws across a few shaders, materials and meshes, a fifth of them transparent, timing the
+	// queue's radix sort against std::stable_sort and checking what a recording backend is submitted:
+	// opaque draws grouped by state and front to back within it, then transparent draws back to front.
+	//	int draws: Number of draws queued each iteration
+	//	int iterations: Number of times the draws are queued and sorted
+	//	returns: false if the submitted order is wrong
+	bool RunRenderQueue(int draws, int iterations);
+
+	// Queue objects over a few meshes and materials, as MeshActors would, plus one instanced mesh, then submit
+	// them with and without batching instances and count the draws a backend receives. Batched, every opaque
+	// mesh, part and material should be one draw, with no instance lost or repeated.
+	//	int objects: Number of objects queued
+	//	int iterations: Number of times the objects are queued and submitted each way
+	//	returns: false if the draws submitted are wrong
+	bool RunInstancing(int objects, int iterations);
+
+	// Allocate random sizes and alignments from a TinyEngine::RingAllocator for a number of frames, as the
+	// renderer does for its constants, checking every range is aligned, inside the ring and never overlaps
+	// a range of the frames still in flight, and that retiring every frame frees the whole ring.
+	//	int frames: Number of frames simulated
+	//	returns: false if any range is wrong
+	bool RunRingAllocator(int frames);
+
+	// Cull random boxes scattered around a camera with a TinyEngine::FrustumCuller, timing the SIMD path
+	// against the scalar reference. Both must find the same boxes, including every box whose center is in view.
+	//	int boxes: Number of boxes culled
+	//	int iterations: Number of times they are culled each way
+	//	returns: false if the visible boxes are wrong
+	bool RunFrustumCulling(int boxes, int iterations);
+
+	// Insert random boxes into a TinyEngine::BoundingVolumeHierarchy, move some of them every frame, rebuild
+	// it and remove a third, then time frustum, sphere, ray and nearest queries against scanning every object.
+	// The tree is validated after every step and every query must find what the scan does.
+	//	int objects: Number of objects inserted
+	//	int queries: Number of queries of each kind
+	//	returns: false if the tree or any query is wrong
+	bool RunBoundingVolumeHierarchy(int objects, int queries);
+
+	// Rasterize a city of buildings as occluders with a TinyEngine::OcclusionCuller, on one thread and on a pool,
+	// and test small boxes scattered through it, as the game does its mesh actors each frame. The masked depth
+	// must never be nearer than exact per pixel depth of the same triangles, nor hide a box that depth shows.
+	//	int occludees: Number of boxes tested
+	//	int iterations: Number of times the occluders are rasterized and the boxes tested
+	//	returns: false if the depth or any box is wrong
+	bool RunOcclusionCulling(int occludees, int iterations);
+
+	// Draw lit, textured spheres with a TinyEngine::SoftwareRenderer for a number of frames, on one thread and on
+	// a pool, timing transforming and binning apart from shading. Both must give the same image, and a screen
+	// of triangles sharing edges must shade every pixel exactly once.
+	//	int objects: Number of spheres drawn each frame
+	//	int frames: Number of frames drawn each way
+	//	const char* outputPath: .png file to write the last frame to, nullptr to write nothing
+	//	returns: false if the images differ, any pixel is shaded twice or missed, or the file could not be written
+	bool RunSoftwareRenderer(int objects, int frames, const char* outputPath = nullptr);
+
+	// Run the game without a window against a synthetic scene for a number of frames, each a fixed 1/60th of a second
+	// after the last, and report the mean, p50 and p99 of the time spent updating, submitting draws and presenting
+	// as JSON. The device is WARP's if there is no GPU, so it runs on build machines.
+	//	const SyntheticSceneSettings& scene: Shape of the scene
+	//	int frames: Number of frames to run
+	//	const char* outputPath: .json file to write the report to, with a summary printed, nullptr to print only the JSON
+	//	returns: false if the game stopped early or the file could not be written
+	bool RunGameFrames(const SyntheticSceneSettings& scene, int frames, const char* outputPath = nullptr);
+
+	// Write a tessellated grid to an .obj file, useful for generating large benchmark inputs.
+	//	const char* path: .obj file to write
+	//	unsigned int triangles: Approximate number of triangles to write
+	//	returns: false if the file could not be written
+	bool WriteGridObj(const char* path, unsigned int triangles);
+}
@@ -0,0 +1,7 @@
+#include "DefaultShader.hlsli"
+
+// DefaultVertexShader with the world matrices of each instance in a second vertex buffer.
+VS_OUT main(VS_IN i, VS_INSTANCE instance)
+{
+	return TransformVertex(i, instance.world, instance.worldInverseTranspose);
+}
\ No newline at end of file
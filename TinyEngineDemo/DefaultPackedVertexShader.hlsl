@@ -0,0 +1,7 @@
+#include "DefaultShader.hlsli"
+
+// DefaultVertexShader for meshes with VertexPacked vertices.
+VS_OUT main(VS_IN_PACKED i)
+{
+	return TransformVertex(DecodePackedVertex(i));
+}
\ No newline at end of file
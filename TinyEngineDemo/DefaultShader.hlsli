@@ -26,12 +26,25 @@ cbuffer CBMaterial : register(b1)
 	float _pad0;
 };
 
+// Constants are split by how often they change, see Renderer::Prepare. Per object and per view constants
+// are 256 byte blocks of one buffer, bound at their offsets.
 cbuffer CbPerObject : register(b0)
 {
-	DirectionLight DirectionLights[3];
-	float4 AmbientLight;
 	float4x4 World;
 	float4x4 WorldInverseTranspose;
+	// Decodes VS_IN_PACKED positions.
+	float4 PositionScale;
+	float4 PositionOffset;
+};
+
+cbuffer CbPerFrame : register(b2)
+{
+	DirectionLight DirectionLights[3];
+	float4 AmbientLight;
+};
+
+cbuffer CbPerView : register(b3)
+{
 	float4x4 View;
 	float4x4 Projection;
 	float3 EyePositionW;
@@ -45,10 +58,64 @@ struct VS_IN
 	float3 normalL: NORMAL;
 };
 
+// VertexPacked, see VertexPacked.h.
+struct VS_IN_PACKED
+{
+	float4 positionQ: POSITION;
+	float2 normalOct: NORMAL;
+	float2 texcoord: TEXCOORD;
+};
+
+// Per instance matrices, see InstanceData in Renderer.h. Each element is a row.
+struct VS_INSTANCE
+{
+	row_major float4x4 world: WORLD;
+	row_major float4x4 worldInverseTranspose: WORLDINVERSETRANSPOSE;
+};
+
 typedef struct VS_OUT
 {
 	float4 positionH: SV_POSITION;
 	float3 positionW: POSITION;
 	float3 normalW: NORMAL;
 	float2 texcoord: TEXCOORD;
-} PS_IN;
\ No newline at end of file
+} PS_IN;
+
+// Decode a normal folded onto an octahedron.
+float3 DecodeOctahedral(float2 e)
+{
+	float3 n = float3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.xy += n.xy >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+VS_IN DecodePackedVertex(VS_IN_PACKED i)
+{
+	VS_IN o;
+	o.positionL = PositionOffset.xyz + i.positionQ.xyz * PositionScale.xyz;
+	o.texcoord = i.texcoord;
+	o.normalL = DecodeOctahedral(i.normalOct);
+	return o;
+}
+
+VS_OUT TransformVertex(VS_IN i, float4x4 world, float4x4 worldInverseTranspose)
+{
+	VS_OUT o;
+	o.normalW = mul(float4(i.normalL, 1.0), worldInverseTranspose).xyz;
+
+	float4 positionL = float4(i.positionL, 1.0);
+
+	o.positionH = mul(positionL, world);
+	o.positionW = o.positionH.xyz;
+	o.positionH = mul(o.positionH, View);
+	o.positionH = mul(o.positionH, Projection);
+	o.texcoord = i.texcoord;
+
+	return o;
+}
+
+VS_OUT TransformVertex(VS_IN i)
+{
+	return TransformVertex(i, World, WorldInverseTranspose);
+}
\ No newline at end of file
@@ -1,16 +1,7 @@
 #include "Game.h"
 
-#pragma warning(disable: 4067 4244)
-#include "vendor/OBJ_Loader.h";
-#pragma warning(default: 4067 4244)
-
-#define STB_IMAGE_IMPLEMENTATION
-#define STBI_FAILURE_USERMSG
-#include "vendor\stb_image.h"
-
 #include <iostream>
 #include <DirectXMath.h>
-#include <filesystem>
 #include "FreeCameraActor.h"
 
 using namespace DirectX;
@@ -18,155 +9,26 @@ using namespace TinyEngine;
 
 using std::cout;
 using std::endl;
-using std::vector;
 
-Game::Game(int width, int height, const char* title) : TinyEngine::TinyEngineGame(width, height, title), _activeCamera(nullptr)
+Game::Game(int width, int height, const char* title) : TinyEngine::TinyEngineGame(width, height, title), _reportedLoad(false), _occluded(0), _synthetic(false), _activeCamera(nullptr)
 {
 	SetInputHandler(&_inputHandler);
 
-	_nullTexture = new Texture(GetRenderer());
-
 	_rootActor = new Actor(this);
 }
 
-Game::~Game()
+Game::Game(int width, int height, const SyntheticSceneSettings& scene) : TinyEngine::TinyEngineGame(width, height), _reportedLoad(true), _occluded(0),
+	_synthetic(true), _syntheticSettings(scene), _activeCamera(nullptr)
 {
-	delete _rootActor;
-	_rootActor = nullptr;
-
-	delete _nullTexture;
-	_nullTexture = nullptr;
-
-	for (auto mesh : _meshes)
-	{
-		delete mesh.mesh;
-		
-		for (auto mat : mesh.materials)
-		{
-			delete mat;
-		}
-	}
-
-	for (auto textureKeyVal : _textures)
-	{
-		delete textureKeyVal.second;
-		textureKeyVal.second = nullptr;
-	}
-}
-
-Texture* Game::LoadTexture(const char* path)
-{
-	if (_textures[path])
-	{
-		return _textures[path];
-	}
-
-	int w, h, bpp;
-	unsigned char* texData = stbi_load(path, &w, &h, &bpp, STBI_rgb_alpha);
-
-	auto failure = stbi_failure_reason();
-	if (failure)
-	{
-		cout << "STB Failed to load Image: " << failure << endl;
-	}
-
-	Texture* tex = new Texture(GetRenderer(), texData, w, h);
-	_textures[path] = tex;
-
-	stbi_image_free(texData);
-
-	return tex;
-}
-
-Game::MeshAsset Game::LoadMesh(const char* path)
-{
-	objl::Loader loader;
-
-	auto* renderer = GetRenderer();
-
-	if (loader.LoadFile(path))
-	{
-		vector<VertexStandard> vertices;
-
-		MeshAsset asset;
-		asset.mesh = new Mesh(renderer);
-
-		for (objl::Mesh& meshData : loader.LoadedMeshes)
-		{
-			auto base = vertices.size();
-			for (const auto& objlVertex : meshData.Vertices)
-			{
-				XMFLOAT3 pos(&objlVertex.Position.X);
-				XMFLOAT2 tex(&objlVertex.TextureCoordinate.X);
-				XMFLOAT3 norm(&objlVertex.Normal.X);
-
-				vertices.emplace_back(pos, tex, norm);
-			}
-
-			const auto& objlMat = meshData.MeshMaterial;
-
-			auto* mat = ConvertMaterial(path, objlMat);
-
-			asset.materials.push_back(mat);
-			asset.mesh->AddIndexBuffer(meshData.Indices.data(), static_cast<unsigned int>(meshData.Indices.size()), static_cast<unsigned int>(base));
-		}
-
-		asset.mesh->SetVertices(vertices.data(), static_cast<unsigned int>(vertices.size()));
-		_meshes.push_back(asset);
-
-		return asset;
-	}
-	else
-	{
-		cout << "Could not load mesh: " << path << endl;
+	SetInputHandler(&_inputHandler);
 
-		return MeshAsset();
-	}
+	_rootActor = new Actor(this);
 }
 
-Material* Game::ConvertMaterial(const char* path, const objl::Material& objlMat)
+Game::~Game()
 {
-	auto* mat = new Material{};
-	mat->transparency = objlMat.d;
-
-	if (objlMat.map_Ka != "")
-	{
-		std::filesystem::path texPath(path);
-		texPath.remove_filename().append(objlMat.map_Ka);
-		mat->ambientTexture = LoadTexture(texPath.string().c_str());
-	}
-	else
-	{
-		mat->ambientTexture = _nullTexture;
-		mat->ambient = XMFLOAT3(&objlMat.Ka.X);
-	}
-
-	if (objlMat.map_Kd != "")
-	{
-		std::filesystem::path texPath(path);
-		texPath.remove_filename().append(objlMat.map_Kd);
-		mat->diffuseTexture = LoadTexture(texPath.string().c_str());
-	}
-	else
-	{
-		mat->diffuseTexture = _nullTexture;
-		mat->diffuse = XMFLOAT3(&objlMat.Kd.X);
-	}
-
-	if (objlMat.map_Ks != "")
-	{
-		std::filesystem::path texPath(path);
-		texPath.remove_filename().append(objlMat.map_Ks);
-		mat->specularTexture = LoadTexture(texPath.string().c_str());
-	}
-	else
-	{
-		mat->specularTexture = _nullTexture;
-		mat->specular = XMFLOAT3(&objlMat.Ks.X);
-		mat->specularExponent = objlMat.Ns;
-	}
-
-	return mat;
+	delete _rootActor;
+	_rootActor = nullptr;
 }
 
 // Inherited via Game
@@ -182,12 +44,22 @@ void Game::OnInit()
 	AddObserver(*freeCamera);
 	_activeCamera = freeCamera;
 
-	auto sphereMesh = LoadMesh("./assets/mesh/sphere_1u.obj");
-
-	auto* sphereActor = new MeshActor(this);
-	sphereActor->SetMesh(sphereMesh.mesh);
-	sphereActor->SetMaterials(sphereMesh.materials);
-	sphereActor->SetParent(_rootActor);
+	if (_synthetic)
+	{
+		BuildSyntheticScene(this, _rootActor, _syntheticSettings, _syntheticMaterials);
+	}
+	else
+	{
+		// Loads in the background, the actor draws nothing until it is resident.
+		MeshImportSettings sphereSettings;
+		sphereSettings.occluder = true;
+		auto sphereMesh = GetAssets()->LoadMesh("./assets/mesh/sphere_1u.obj", sphereSettings);
+
+		auto* sphereActor = new MeshActor(this);
+		sphereActor->SetMesh(sphereMesh);
+		sphereActor->SetOccluder(true);
+		sphereActor->SetParent(_rootActor);
+	}
 
 	XMStoreFloat3(&renderer->lights[0].direction, XMVector3Normalize(XMVectorSet(-1.0f, -1.0f, 0.0f, 0.0f)));
 	renderer->lights[0].color = { 1.0, 1.0, 1.0, 1.0f };
@@ -205,19 +77,96 @@ void Game::OnInit()
 void Game::OnUpdate(float elapsed, float delta)
 {
 	auto input = GetInput();
+	auto assets = GetAssets();
+
+	if (!_reportedLoad && !assets->IsLoading())
+	{
+		auto stats = assets->GetStats();
+		cout << "Loaded " << stats.resident << " assets (" << stats.failed << " failed) in " << stats.loadSeconds << "s, "
+			<< stats.decodeSeconds << "s decoding across workers, " << stats.uploadSeconds << "s uploading." << endl;
+		cout << "Derived data cache: " << stats.cache.hits << " hits, " << stats.cache.misses << " misses, " << stats.cache.evictions << " evicted, "
+			<< stats.cache.entries << " entries using " << stats.cache.bytes / (1024 * 1024) << " MB." << endl;
+		cout << "Texture streaming: " << stats.streaming.textures << " textures with " << stats.residentBytes / (1024 * 1024) << " MB resident." << endl;
+
+		auto shaders = GetRenderer()->GetShaders()->GetStats();
+		cout << "Shaders: " << shaders.requests << " requested from " << shaders.filesOpened << " files, created " << shaders.vertexShadersCreated << " vertex, "
+			<< shaders.pixelShadersCreated << " pixel and " << shaders.inputLayoutsCreated << " input layout objects, " << shaders.objectsShared << " shared." << endl;
+
+		const auto& state = GetRenderer()->GetStateStats();
+		cout << "Last frame: " << _visible.size() << " of " << _scene.GetCount() << " meshes in view, " << _occluded << " of them occluded, " << state.draws << " draws of " << state.instances << " instances, " << state.GetIssued() << " binds issued and " << state.GetElided() << " redundant binds dropped." << endl;
+
+		_reportedLoad = true;
+	}
 
-	if (input->GetKeyDown(Key::ESC))
+	if (input->GetKeyDown(Key::ESC) && GetWindow())
 	{
 		auto window = GetWindow();
 		window->SetCaptureMouse(!window->GetCaptureMouse());
 		window->SetMouseVisible(!window->GetMouseVisible());
 	}
 
+	// Mesh actors move their bounds in the scene as they update, and only what the scene finds in view is drawn.
 	_rootActor->OnUpdate(elapsed, delta);
 	_rootActor->OnDraw(GetRenderer());
+
+	_scene.RebuildIfDegraded();
+
+	_visible.clear();
+	_occlusion.Clear();
+	if (_activeCamera)
+	{
+		auto viewProjection = _activeCamera->GetView() * _activeCamera->GetProjection();
+		_scene.QueryFrustum(MakeFrustum(viewProjection), _visible);
+
+		// Occluders in view are rasterized first, then everything else is tested against them.
+		_occlusion.SetViewProjection(viewProjection);
+		for (auto handle : _visible)
+		{
+			auto* actor = static_cast<MeshActor*>(_scene.GetUserData(handle));
+			if (actor->IsOccluder())
+			{
+				actor->AddOccluder(&_occlusion);
+			}
+		}
+
+		_occlusion.RenderOccluders(GetThreadPool());
+	}
+
+	_occluded = 0;
+	for (auto handle : _visible)
+	{
+		auto* actor = static_cast<MeshActor*>(_scene.GetUserData(handle));
+		if (!actor->IsOccluder() && !_occlusion.TestBounds(_scene.GetBounds(handle)))
+		{
+			_occluded++;
+			continue;
+		}
+
+		actor->Draw(GetRenderer());
+	}
 }
 
 Input* Game::GetInput() const
 {
 	return static_cast<Input*>(TinyEngineGame::GetInput());
 }
+
+BoundingVolumeHierarchy* Game::GetScene()
+{
+	return &_scene;
+}
+
+unsigned int Game::GetVisibleCount() const
+{
+	return static_cast<unsigned int>(_visible.size());
+}
+
+unsigned int Game::GetOccludedCount() const
+{
+	return _occluded;
+}
+
+const StateCacheStats& Game::GetStateStats() const
+{
+	return GetRenderer()->GetStateStats();
+}
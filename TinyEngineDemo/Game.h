@@ -6,53 +6,50 @@
 #include "Input.h"
 #include <string>
 #include "Actor.h"
-#include "Mesh.h"
-#include "Texture.h"
-#include "Material.h"
 #include "FreeCameraActor.h"
 #include "MeshActor.h"
-
-// OBJL is a bit rubbish, since i cant indlude the header i've prototyped what i need here.
-namespace objl
-{
-	struct Material;
-}
+#include "BoundingVolumeHierarchy.h"
+#include "OcclusionCulling.h"
+#include "SyntheticScene.h"
 
 class Game :
 	public TinyEngine::TinyEngineGame
 {
-public:
-	struct MeshAsset
-	{
-		TinyEngine::Mesh* mesh;
-		std::vector<TinyEngine::Material*> materials;
-	};
-
 private:
 	// Game
 	Actor* _rootActor;
 	Input _inputHandler;
 
-public:
-	// Asset manager?
-	// TODO WT: should all be maps so assets can be requested by name, far easier to work with.
-	std::vector<MeshAsset> _meshes;
-	std::unordered_map<std::string, TinyEngine::Texture*> _textures;
-	TinyEngine::Texture* _nullTexture;
+	// Has the time taken to load the initial assets been reported?
+	bool _reportedLoad;
+
+	// World space bounds of every mesh actor, whose user data is the actor, and which of them were in view.
+	TinyEngine::BoundingVolumeHierarchy _scene;
+	std::vector<unsigned int> _visible;
+
+	// Depth of the occluders in view, which hides the other mesh actors behind them, and how many it hid.
+	TinyEngine::OcclusionCuller _occlusion;
+	unsigned int _occluded;
+
+	// Whether OnInit builds a synthetic scene instead of loading the demo scene, its shape and its materials.
+	bool _synthetic;
+	SyntheticSceneSettings _syntheticSettings;
+	std::vector<TinyEngine::Material> _syntheticMaterials;
 
+public:
 	// Game
 	TinyEngine::ICamera* _activeCamera;
 
 public:
 	Game(int width, int height, const char* title);
 
-	~Game();
-
-	TinyEngine::Texture* LoadTexture(const char* path);
-
-	MeshAsset LoadMesh(const char* path);
+	// Construct a Game with no window, which draws a synthetic scene instead of loading any assets, for benchmarks.
+	//	int width: Width drawn to
+	//	int height: Height drawn to
+	//	const SyntheticSceneSettings& scene: Shape of the scene, see BuildSyntheticScene
+	Game(int width, int height, const SyntheticSceneSettings& scene);
 
-	TinyEngine::Material* ConvertMaterial(const char* path, const objl::Material& objlMat);
+	~Game();
 
 	// Inherited via Game
 	virtual void OnInit() override;
@@ -60,4 +57,14 @@ public:
 	virtual void OnUpdate(float elapsed, float delta) override;
 
 	virtual Input* GetInput() const override;
+
+	// Mesh actors by their bounds, for culling and proximity queries. Handles' user data is the MeshActor.
+	TinyEngine::BoundingVolumeHierarchy* GetScene();
+
+	// Mesh actors in view last frame, and how many of those were occluded.
+	unsigned int GetVisibleCount() const;
+	unsigned int GetOccludedCount() const;
+
+	// Draws and binds of the last frame.
+	const TinyEngine::StateCacheStats& GetStateStats() const;
 };
\ No newline at end of file
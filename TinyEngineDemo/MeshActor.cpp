@@ -1,22 +1,96 @@
 #include "MeshActor.h"
 #include "Game.h"
+#include "MeshLod.h"
+#include "TextureStreaming.h"
 
-void MeshActor::SetMesh(TinyEngine::Mesh* mesh)
+void MeshActor::SetMesh(TinyEngine::MeshHandle mesh)
 {
 	_mesh = mesh;
 }
 
-void MeshActor::SetMaterials(std::vector<TinyEngine::Material*> materials)
+void MeshActor::SetMaterials(const std::vector<TinyEngine::Material*>& materials)
 {
 	_materials = materials;
 }
 
-void MeshActor::OnDraw(TinyEngine::Renderer* renderer)
+MeshActor::~MeshActor()
 {
-	if (_mesh)
+	if (_sceneHandle != TinyEngine::BoundingVolumeHierarchy::INVALID_HANDLE)
 	{
-		renderer->DrawMesh(_mesh, _materials, _game->_activeCamera, GetWorld());
+		_game->GetScene()->Remove(_sceneHandle);
 	}
+}
+
+void MeshActor::OnUpdate(float elapsed, float delta)
+{
+	const auto* asset = _game->GetAssets()->GetMesh(_mesh);
+
+	if (asset)
+	{
+		auto bounds = TinyEngine::TransformBounds(asset->mesh->GetBounds(), GetWorld());
+
+		// Does nothing unless the actor has moved past the scene's margin.
+		auto* scene = _game->GetScene();
+		if (_sceneHandle == TinyEngine::BoundingVolumeHierarchy::INVALID_HANDLE)
+		{
+			_sceneHandle = scene->Insert(bounds, this);
+		}
+		else
+		{
+			scene->Update(_sceneHandle, bounds);
+		}
+	}
+
+	Actor::OnUpdate(elapsed, delta);
+}
+
+void MeshActor::Draw(TinyEngine::Renderer* renderer)
+{
+	const auto* asset = _game->GetAssets()->GetMesh(_mesh);
+
+	if (asset)
+	{
+		auto* mesh = asset->mesh;
+		auto* camera = _game->_activeCamera;
+		auto world = GetWorld();
+
+		// Coarsest level whose simplification error stays under a fraction of the screen.
+		const auto& lodErrors = mesh->GetLodErrors();
+		unsigned int lod = TinyEngine::SelectLod(lodErrors.data(), static_cast<unsigned int>(lodErrors.size()),
+			mesh->GetBoundsCenter(), mesh->GetBoundsRadius(), world, camera->GetView(), camera->GetProjection());
+
+		// How finely the textures are seen decides which of their levels stream in.
+		auto demand = TinyEngine::ComputeTextureDemand(mesh->GetUvDensity(), mesh->GetBoundsCenter(), mesh->GetBoundsRadius(),
+			world, camera->GetView(), camera->GetProjection(), static_cast<float>(_game->GetHeight()));
+		for (auto texture : asset->textures)
+		{
+			_game->GetAssets()->RequestTexture(texture, demand);
+		}
 
-	Actor::OnDraw(renderer);
+		renderer->DrawMesh(mesh, _materials.empty() ? asset->materials : _materials, camera, world, lod);
+	}
+}
+
+void MeshActor::SetOccluder(bool occluder)
+{
+	_occluder = occluder;
+}
+
+bool MeshActor::IsOccluder() const
+{
+	return _occluder;
+}
+
+void MeshActor::AddOccluder(TinyEngine::OcclusionCuller* culler)
+{
+	const auto* asset = _game->GetAssets()->GetMesh(_mesh);
+
+	if (asset)
+	{
+		const auto& positions = asset->mesh->GetPositions();
+		const auto& indices = asset->mesh->GetOccluderIndices();
+
+		culler->AddOccluder(positions.data(), static_cast<unsigned int>(positions.size()),
+			indices.data(), static_cast<unsigned int>(indices.size()), GetWorld());
+	}
 }
@@ -1,6 +1,8 @@
 #pragma once
-#include "Mesh.h"
+#include "AssetManager.h"
 #include "Actor.h"
+#include "BoundingVolumeHierarchy.h"
+#include "OcclusionCulling.h"
 
 class Game;
 
@@ -8,15 +10,41 @@ class MeshActor :
 	public Actor
 {
 private:
-	TinyEngine::Mesh* _mesh;
+	TinyEngine::MeshHandle _mesh;
+
+	// Materials drawn with instead of the mesh's own, empty to use the mesh's.
 	std::vector<TinyEngine::Material*> _materials;
 
+	// Handle of the actor's bounds in the game's scene, once its mesh is resident.
+	unsigned int _sceneHandle = TinyEngine::BoundingVolumeHierarchy::INVALID_HANDLE;
+
+	bool _occluder = false;
+
 public:
-	MeshActor(Game* game) : Actor(game), _mesh(nullptr) { }
+	MeshActor(Game* game) : Actor(game) { }
+	virtual ~MeshActor();
+
+	// Draw a mesh and its materials, or its placeholder until it is resident.
+	void SetMesh(TinyEngine::MeshHandle mesh);
+
+	// Draw the mesh with other materials than its own, one per part as Renderer::DrawMesh takes them.
+	//	const std::vector<TinyEngine::Material*>& materials: Materials, which must outlive the actor. Empty to use the mesh's own
+	void SetMaterials(const std::vector<TinyEngine::Material*>& materials);
+
+	// Move the mesh's bounds in the game's scene, it is drawn if the scene finds it in view.
+	virtual void OnUpdate(float elapsed, float delta) override;
+
+	// Draw the mesh, once the game has found it is in view.
+	void Draw(TinyEngine::Renderer* renderer);
+
+	// Have the mesh hide what is behind it from the game's occlusion culling. Best kept to large, solid meshes,
+	// as every occluder in view is rasterized on the CPU each frame. Occluders are always drawn.
+	// The mesh must be loaded as an occluder, see MeshImportSettings::occluder, or it hides nothing.
+	void SetOccluder(bool occluder);
 
-	void SetMesh(TinyEngine::Mesh* mesh);
-	void SetMaterials(std::vector<TinyEngine::Material*> materials);
+	bool IsOccluder() const;
 
-	virtual void OnDraw(TinyEngine::Renderer* renderer) override;
+	// Add the mesh's coarsest level to an occlusion culler, once it is resident.
+	void AddOccluder(TinyEngine::OcclusionCuller* culler);
 };
 
@@ -0,0 +1,10 @@
+#include "SpinActor.h"
+
+using namespace DirectX;
+
+void SpinActor::OnUpdate(float elapsed, float delta)
+{
+	XMStoreFloat4(&_orientation, XMQuaternionRotationAxis(XMVector3Normalize(XMLoadFloat3(&_axis)), _speed * elapsed));
+
+	Actor::OnUpdate(elapsed, delta);
+}
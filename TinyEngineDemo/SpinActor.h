@@ -0,0 +1,20 @@
+#pragma once
+#include "Actor.h"
+
+class Game;
+
+// Turns about an axis at a constant rate, carrying its children with it.
+class SpinActor :
+	public Actor
+{
+private:
+	DirectX::XMFLOAT3 _axis;
+	// Radians per second.
+	float _speed;
+
+public:
+	SpinActor(Game* game, DirectX::XMFLOAT3 axis, float speed) : Actor(game), _axis(axis), _speed(speed) { }
+
+	// Turns to the angle elapsed time puts it at, so the same times always give the same orientation.
+	virtual void OnUpdate(float elapsed, float delta) override;
+};
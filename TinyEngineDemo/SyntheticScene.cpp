@@ -0,0 +1,157 @@
+#include "SyntheticScene.h"
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include "Game.h"
+#include "MeshActor.h"
+#include "MeshImport.h"
+#include "SpinActor.h"
+
+using namespace TinyEngine;
+using namespace DirectX;
+using std::vector;
+
+namespace
+{
+	// Distance between the hierarchies in the grid.
+	const float SPACING = 4.0f;
+
+	// A sphere with bumps of the given frequency, clockwise seen from outside like the meshes the importer reads.
+	MeshData MakeBumpySphereMeshData(unsigned int slices, unsigned int stacks, float frequency)
+	{
+		MeshData mesh;
+
+		for (unsigned int stack = 0; stack <= stacks; stack++)
+		{
+			float v = static_cast<float>(stack) / stacks;
+			float phi = v * XM_PI;
+
+			for (unsigned int slice = 0; slice <= slices; slice++)
+			{
+				float u = static_cast<float>(slice) / slices;
+				float theta = u * XM_2PI;
+
+				float radius = 1.0f + 0.15f * sinf(frequency * theta) * sinf(frequency * phi);
+				XMFLOAT3 position(radius * sinf(phi) * cosf(theta), radius * cosf(phi), radius * sinf(phi) * sinf(theta));
+				mesh.vertices.push_back(VertexStandard(position, XMFLOAT2(u, v), XMFLOAT3(0.0f, 0.0f, 0.0f)));
+			}
+		}
+
+		for (unsigned int stack = 0; stack < stacks; stack++)
+		{
+			for (unsigned int slice = 0; slice < slices; slice++)
+			{
+				unsigned int a = stack * (slices + 1) + slice;
+				unsigned int b = a + slices + 1;
+
+				mesh.indices.insert(mesh.indices.end(), { a, a + 1, b, a + 1, b + 1, b });
+			}
+		}
+
+		// Area weighted face normals, which point outwards as the triangles are clockwise.
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			auto& a = mesh.vertices[mesh.indices[i]];
+			auto& b = mesh.vertices[mesh.indices[i + 1]];
+			auto& c = mesh.vertices[mesh.indices[i + 2]];
+
+			auto p0 = XMLoadFloat3(&a.position);
+			auto normal = XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&b.position), p0), XMVectorSubtract(XMLoadFloat3(&c.position), p0));
+
+			for (auto* vertex : { &a, &b, &c })
+			{
+				XMStoreFloat3(&vertex->normal, XMVectorAdd(XMLoadFloat3(&vertex->normal), normal));
+			}
+		}
+
+		for (auto& vertex : mesh.vertices)
+		{
+			XMStoreFloat3(&vertex.normal, XMVector3Normalize(XMLoadFloat3(&vertex.normal)));
+		}
+
+		MeshDataPart part;
+		part.indexCount = static_cast<unsigned int>(mesh.indices.size());
+		part.vertexCount = static_cast<unsigned int>(mesh.vertices.size());
+		part.material = 0;
+		mesh.parts.push_back(part);
+
+		return mesh;
+	}
+}
+
+void BuildSyntheticScene(Game* game, Actor* root, const SyntheticSceneSettings& settings, vector<Material>& materials)
+{
+	uint32_t seed = settings.seed;
+	auto random = [&seed]()
+	{
+		seed = seed * 1664525u + 1013904223u;
+		return (seed >> 8) / static_cast<float>(1 << 24);
+	};
+
+	auto* assets = game->GetAssets();
+
+	// From 32 to 256 slices, so the meshes cost different amounts to draw and their levels of detail matter.
+	vector<MeshHandle> meshes;
+	for (unsigned int i = 0; i < settings.meshes; i++)
+	{
+		unsigned int slices = 32u << (i % 4);
+		auto meshData = MakeBumpySphereMeshData(slices, slices / 2, static_cast<float>(2 + i % 5));
+		ImportMesh(meshData, MeshImportSettings());
+
+		// Any of them may be picked for an occluder below.
+		auto name = "synthetic/sphere" + std::to_string(i);
+		vector<Material> meshMaterials(1);
+		meshes.push_back(assets->CreateMesh(name.c_str(), meshData, meshMaterials, true));
+	}
+
+	// Filled before any actor points into it.
+	materials.clear();
+	materials.resize(settings.materials);
+	for (auto& material : materials)
+	{
+		material.ambient = { 0.05f, 0.05f, 0.05f };
+		material.diffuse = { 0.2f + 0.8f * random(), 0.2f + 0.8f * random(), 0.2f + 0.8f * random() };
+		material.specular = { 0.5f, 0.5f, 0.5f };
+		material.specularExponent = 8.0f + 120.0f * random();
+		material.ambientTexture = assets->GetNullTexture();
+		material.diffuseTexture = assets->GetNullTexture();
+		material.specularTexture = assets->GetNullTexture();
+	}
+
+	unsigned int depth = settings.depth > 0 ? settings.depth : 1;
+	unsigned int hierarchies = (settings.actors + depth - 1) / depth;
+	unsigned int columns = static_cast<unsigned int>(ceilf(sqrtf(static_cast<float>(hierarchies))));
+
+	unsigned int actors = 0;
+	for (unsigned int h = 0; h < hierarchies; h++)
+	{
+		float x = (static_cast<float>(h % columns) - 0.5f * static_cast<float>(columns - 1)) * SPACING;
+		float z = static_cast<float>(h / columns) * SPACING;
+
+		Actor* parent = root;
+		XMFLOAT3 position(x, 2.0f * random() - 1.0f, z);
+		float scale = 1.0f;
+
+		// Each level turns the ones after it, which orbit it a little further in.
+		for (unsigned int level = 0; level < depth && actors < settings.actors; level++, actors++)
+		{
+			auto* spin = new SpinActor(game, { 0.2f * random() - 0.1f, 1.0f, 0.2f * random() - 0.1f }, 0.2f + 0.8f * random());
+			spin->SetPosition(position);
+			spin->SetParent(parent);
+
+			auto* meshActor = new MeshActor(game);
+			meshActor->SetMesh(meshes.empty() ? MeshHandle() : meshes[static_cast<unsigned int>(random() * meshes.size()) % meshes.size()]);
+			if (!materials.empty())
+			{
+				meshActor->SetMaterials({ &materials[static_cast<unsigned int>(random() * materials.size()) % materials.size()] });
+			}
+			meshActor->SetScale({ 0.6f * scale, 0.6f * scale, 0.6f * scale });
+			meshActor->SetOccluder(level == 0 && h % 8 == 0);
+			meshActor->SetParent(spin);
+
+			parent = spin;
+			position = { 1.2f * scale, 0.0f, 0.0f };
+			scale *= 0.7f;
+		}
+	}
+}
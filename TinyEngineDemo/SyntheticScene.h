@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+#include "Material.h"
+
+class Game;
+class Actor;
+
+// Shape of a procedural scene to run the game against without any assets, see BuildSyntheticScene.
+struct SyntheticSceneSettings
+{
+	// Mesh actors in the scene.
+	unsigned int actors = 2000;
+	// Mesh actors in each hierarchy, every one turning and carrying the rest with it. 1 leaves every actor on its own.
+	unsigned int depth = 4;
+	// Different meshes and materials the actors are given.
+	unsigned int meshes = 8;
+	unsigned int materials = 16;
+	// Seed of everything random, the same settings always build the same scene.
+	unsigned int seed = 1;
+};
+
+// Build a procedural scene of mesh actors under an actor: hierarchies spinning in a grid centered on x and
+// stretching away along z from the origin, so from behind it some are off screen and some behind others.
+// Meshes are bumpy spheres of a few sizes, imported with levels of detail as an .obj would be, and every
+// eighth hierarchy's first mesh is an occluder.
+//	Game* game: Game whose assets the meshes are created in
+//	Actor* root: Actor the hierarchies are added to
+//	const SyntheticSceneSettings& settings: Shape of the scene
+//	std::vector<TinyEngine::Material>& materials: Receives the materials the actors draw with, which must outlive them
+void BuildSyntheticScene(Game* game, Actor* root, const SyntheticSceneSettings& settings, std::vector<TinyEngine::Material>& materials);
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <string>
 #include "Game.h"
+#include "Benchmarks.h"
 
 #ifdef TINY_ENGINE_EXPOSE_NATIVE
 #error "TINY_ENGINE_EXPOSE_NATIVE has leaked to main."
@@ -15,6 +16,156 @@ using std::endl;
 
 using namespace DirectX;
 
+// Run a headless benchmark if one was requested on the command line.
+//	bool& passed: Receives whether the benchmark's results were correct, true for those which don't check them
+//	returns: true if a benchmark was run and the game should not start
+bool RunBenchmarks(int argc, char** argv, bool& passed)
+{
+	passed = true;
+
+	for (auto i = 0; i < argc; i++)
+	{
+		auto arg = string(argv[i]);
+		auto remaining = argc - i - 1;
+
+		if (arg == "/bench-obj" && remaining >= 1)
+		{
+			int iterations = remaining >= 2 ? std::atoi(argv[i + 2]) : 3;
+			passed = Benchmarks::RunObjLoad(argv[i + 1], iterations > 0 ? iterations : 1);
+			return true;
+		}
+
+		if (arg == "/bench-lod")
+		{
+			int views = remaining >= 1 ? std::atoi(argv[i + 1]) : 0;
+			passed = Benchmarks::RunLodSelection(views > 0 ? views : 1000);
+			return true;
+		}
+
+		if (arg == "/bench-meshlets" && remaining >= 1)
+		{
+			int iterations = remaining >= 2 ? std::atoi(argv[i + 2]) : 10;
+			passed = Benchmarks::RunMeshletCulling(argv[i + 1], iterations > 0 ? iterations : 1);
+			return true;
+		}
+
+		if (arg == "/bench-range")
+		{
+			int operations = remaining >= 1 ? std::atoi(argv[i + 1]) : 0;
+			passed = Benchmarks::RunRangeAllocator(operations > 0 ? operations : 100000);
+			return true;
+		}
+
+		if (arg == "/bench-mips" && remaining >= 1)
+		{
+			int iterations = remaining >= 2 ? std::atoi(argv[i + 2]) : 3;
+			passed = Benchmarks::RunMipGeneration(argv[i + 1], iterations > 0 ? iterations : 1);
+			return true;
+		}
+
+		if (arg == "/bench-bc" && remaining >= 1)
+		{
+			int iterations = remaining >= 2 ? std::atoi(argv[i + 2]) : 1;
+			passed = Benchmarks::RunBlockCompression(argv[i + 1], iterations > 0 ? iterations : 1);
+			return true;
+		}
+
+		if (arg == "/bench-ddc" && remaining >= 1)
+		{
+			int iterations = remaining >= 2 ? std::atoi(argv[i + 2]) : 5;
+			passed = Benchmarks::RunDerivedDataCache(argv[i + 1], iterations > 0 ? iterations : 1);
+			return true;
+		}
+
+		if (arg == "/bench-streaming")
+		{
+			int textures = remaining >= 1 ? std::atoi(argv[i + 1]) : 1024;
+			int frames = remaining >= 2 ? std::atoi(argv[i + 2]) : 600;
+			passed = Benchmarks::RunTextureStreaming(textures > 0 ? textures : 1024, frames > 0 ? frames : 600);
+			return true;
+		}
+
+		if (arg == "/bench-queue")
+		{
+			int draws = remaining >= 1 ? std::atoi(argv[i + 1]) : 0;
+			int iterations = remaining >= 2 ? std::atoi(argv[i + 2]) : 0;
+			passed = Benchmarks::RunRenderQueue(draws > 0 ? draws : 100000, iterations > 0 ? iterations : 20);
+			return true;
+		}
+
+		if (arg == "/bench-instancing")
+		{
+			int objects = remaining >= 1 ? std::atoi(argv[i + 1]) : 0;
+			int iterations = remaining >= 2 ? std::atoi(argv[i + 2]) : 0;
+			passed = Benchmarks::RunInstancing(objects > 0 ? objects : 10000, iterations > 0 ? iterations : 20);
+			return true;
+		}
+
+		if (arg == "/bench-ring")
+		{
+			int frames = remaining >= 1 ? std::atoi(argv[i + 1]) : 0;
+			passed = Benchmarks::RunRingAllocator(frames > 0 ? frames : 100000);
+			return true;
+		}
+
+		if (arg == "/bench-culling")
+		{
+			int boxes = remaining >= 1 ? std::atoi(argv[i + 1]) : 0;
+			int iterations = remaining >= 2 ? std::atoi(argv[i + 2]) : 0;
+			passed = Benchmarks::RunFrustumCulling(boxes > 0 ? boxes : 1000000, iterations > 0 ? iterations : 20);
+			return true;
+		}
+
+		if (arg == "/bench-bvh")
+		{
+			int objects = remaining >= 1 ? std::atoi(argv[i + 1]) : 0;
+			int queries = remaining >= 2 ? std::atoi(argv[i + 2]) : 0;
+			passed = Benchmarks::RunBoundingVolumeHierarchy(objects > 0 ? objects : 100000, queries > 0 ? queries : 100);
+			return true;
+		}
+
+		if (arg == "/bench-occlusion")
+		{
+			int occludees = remaining >= 1 ? std::atoi(argv[i + 1]) : 0;
+			int iterations = remaining >= 2 ? std::atoi(argv[i + 2]) : 0;
+			passed = Benchmarks::RunOcclusionCulling(occludees > 0 ? occludees : 10000, iterations > 0 ? iterations : 100);
+			return true;
+		}
+
+		if (arg == "/bench-software")
+		{
+			int objects = remaining >= 1 ? std::atoi(argv[i + 1]) : 0;
+			int frames = remaining >= 2 ? std::atoi(argv[i + 2]) : 0;
+			passed = Benchmarks::RunSoftwareRenderer(objects > 0 ? objects : 200, frames > 0 ? frames : 10, remaining >= 3 ? argv[i + 3] : nullptr);
+			return true;
+		}
+
+		if (arg == "/bench-frames")
+		{
+			SyntheticSceneSettings scene;
+			int frames = remaining >= 1 ? std::atoi(argv[i + 1]) : 0;
+			int actors = remaining >= 2 ? std::atoi(argv[i + 2]) : 0;
+			int depth = remaining >= 3 ? std::atoi(argv[i + 3]) : 0;
+			int meshes = remaining >= 4 ? std::atoi(argv[i + 4]) : 0;
+			int materials = remaining >= 5 ? std::atoi(argv[i + 5]) : 0;
+			scene.actors = actors > 0 ? actors : scene.actors;
+			scene.depth = depth > 0 ? depth : scene.depth;
+			scene.meshes = meshes > 0 ? meshes : scene.meshes;
+			scene.materials = materials > 0 ? materials : scene.materials;
+			passed = Benchmarks::RunGameFrames(scene, frames > 0 ? frames : 600, remaining >= 6 ? argv[i + 6] : nullptr);
+			return true;
+		}
+
+		if (arg == "/write-grid-obj" && remaining >= 2)
+		{
+			passed = Benchmarks::WriteGridObj(argv[i + 1], static_cast<unsigned int>(std::strtoul(argv[i + 2], nullptr, 10)));
+			return true;
+		}
+	}
+
+	return false;
+}
+
 int main(int argc, char** argv)
 {
 	for (auto i = 0, l = argc - 1; i < l; i++)
@@ -26,6 +177,12 @@ int main(int argc, char** argv)
 		}
 	}
 
+	bool passed;
+	if (RunBenchmarks(argc, argv, passed))
+	{
+		return passed ? 0 : 1;
+	}
+
 	auto game = Game(1600, 900, "Game");
 	game.Run();
 